@@ -156,12 +156,34 @@ def log_error(msg: str) -> None:
     os._exit(1)  # Жёстко останавливаем сборку.
 
 
+# Получить имя цели сборки из аргументов ("-t=<name>" / "-target=<name>", None - основная программа):
+def get_target() -> str:
+    for arg in sys.argv[1:]:
+        if arg.startswith("-t=") or arg.startswith("-target="):
+            return arg.split("=", 1)[1] or None
+    return None
+
+
+# Получить путь до конфигурации цели сборки (относительно "<build-dir>/tools/"):
+def get_target_config_path(target: str) -> str:
+    return "../config.json" if target is None else f"../{target}.json"
+
+
+# Получить имя мета-файла цели сборки:
+def get_target_metadata_name(target: str) -> str:
+    return "metadata.json" if target is None else f"metadata-{target}.json"
+
+
 # Обработать аргументы:
 def handle_args() -> None:
     is_exit = False
     for arg in sys.argv[1:]:
+        # Если передана цель сборки (обрабатывается до чтения конфигурации):
+        if arg.startswith("-t=") or arg.startswith("-target="):
+            pass
+
         # Если передан флаг об очистке объектных файлов:
-        if arg in ["-c", "-clear"]:
+        elif arg in ["-c", "-clear"]:
             Vars.build_clear = True
             Vars.reset_build = True
 
@@ -175,6 +197,7 @@ def handle_args() -> None:
             log("\n"
                 "+ List of arguments:\n"
                 "| [-c] / [-clear] - Delete previous build and build it again (Build is running).\n|\n"
+                "| [-t=<name>] / [-target=<name>] - Build a tool target from \"<build-dir>/<name>.json\" (e.g. -t=packer).\n|\n"
                 "| [-v] / [-version] - Get version of the build system (Build is not start).\n|\n"
                 "| [-h] / [-help] - Get help with the startup arguments (Build is not start).\n+\n"
             )
@@ -543,8 +566,10 @@ def copy_libs(all_libs: list) -> None:
 
 # Основная функция:
 def main() -> None:
-    Vars.init_vars("../config.json")  # Инициализируем переменные.
-    metadata = load_metadata("metadata.json")  # Читаем мета-данные.
+    target = get_target()  # Цель сборки (None - основная программа).
+    metadata_name = get_target_metadata_name(target)
+    Vars.init_vars(get_target_config_path(target))  # Инициализируем переменные.
+    metadata = load_metadata(metadata_name)  # Читаем мета-данные.
     Vars.cpu_threads = os.cpu_count()  # Узнаем количество ядер.
 
     os.chdir("../../")  # Переходим в корневую директорию из "<build-dir>/tools/".
@@ -596,7 +621,7 @@ def main() -> None:
 
         # Вторая часть вывода информации:
         if Vars.build_clear: log(f"[!] Used clear flag for reset build.")
-        if Vars.build_no_meta: log(f"[!] File not found \"metadata.json\".")
+        if Vars.build_no_meta: log(f"[!] File not found \"{metadata_name}\".")
         if Vars.build_cfg_edt: log(f"[!] Build config edited.")
         if Vars.build_new_os:
             old_os, new_os = Vars.build_new_os_info["old"], Vars.build_new_os_info["new"]
@@ -630,7 +655,7 @@ def main() -> None:
         log(f"Build finished: {time.time()-start_time:.2f}s")
 
         # Сохраняем мета-данные в случае удачной сборки:
-        save_metadata("tools/metadata.json", metadata_new)
+        save_metadata(f"tools/{metadata_name}", metadata_new)
 
         log(f"{'-'*80}")
     except Exception as error:
@@ -0,0 +1,402 @@
+//
+// archive.c - Реализация архива ресурсов движка (.pak).
+//
+
+
+// Включаем POSIX функции (opendir, stat) при строгом -std=c17:
+#if !defined(_WIN32) && !defined(_WIN64) && !defined(_DEFAULT_SOURCE)
+    #define _DEFAULT_SOURCE
+#endif
+
+
+// Подключаем:
+#include "libs/tinycthread.h"
+#include "std.h"
+#include "mm.h"
+#include "array.h"
+#include "files.h"
+#include "compress.h"
+#include "archive.h"
+
+#if defined(_WIN32) || defined(_WIN64)
+    #include <windows.h>
+#else
+    #include <dirent.h>
+    #include <sys/stat.h>
+#endif
+
+
+// Объявление структур:
+typedef struct PackItem PackItem;  // Файл для упаковки.
+
+
+// Файл для упаковки:
+struct PackItem {
+    uint64_t hash;  // Хэш пути в архиве.
+    char *name;     // Путь в архиве (относительно каталога).
+    char *path;     // Путь на диске.
+};
+
+
+// Таблица CRC32 (полином 0xEDB88320), заполняется один раз:
+static uint32_t crc32_table[256];
+static once_flag crc32_once = ONCE_FLAG_INIT;
+
+
+// Заполнить таблицу CRC32:
+static void crc32_init() {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        crc32_table[i] = c;
+    }
+}
+
+
+// Сравнить пути (разделители '\\' и '/' считаются одинаковыми):
+static bool path_equal(const char *a, const char *b, size_t b_len) {
+    for (size_t i = 0; i < b_len; i++) {
+        char ca = a[i] == '\\' ? '/' : a[i];
+        char cb = b[i] == '\\' ? '/' : b[i];
+        if (ca != cb || ca == '\0') return false;
+    }
+    return a[b_len] == '\0';
+}
+
+
+// Сравнение файлов для сортировки оглавления (по хэшу, потом по имени):
+static int pack_item_compare(const void *a, const void *b) {
+    const PackItem *x = (const PackItem*)a;
+    const PackItem *y = (const PackItem*)b;
+    if (x->hash != y->hash) return x->hash < y->hash ? -1 : 1;
+    return strcmp(x->name, y->name);
+}
+
+
+// Рекурсивно собрать файлы каталога:
+static void collect_files(const char *dir, const char *rel, Array *items) {
+    #if defined(_WIN32) || defined(_WIN64)
+        char pattern[1024];
+        snprintf(pattern, sizeof(pattern), "%s/*", dir);
+        WIN32_FIND_DATAA fd;
+        HANDLE find = FindFirstFileA(pattern, &fd);
+        if (find == INVALID_HANDLE_VALUE) return;
+        do {
+            const char *name = fd.cFileName;
+            bool is_dir = (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+    #else
+        DIR *d = opendir(dir);
+        if (!d) return;
+        struct dirent *ent;
+        while ((ent = readdir(d)) != NULL) {
+            const char *name = ent->d_name;
+    #endif
+            if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) continue;
+
+            char path[1024], sub[1024];
+            snprintf(path, sizeof(path), "%s/%s", dir, name);
+            if (rel[0]) snprintf(sub, sizeof(sub), "%s/%s", rel, name);
+            else snprintf(sub, sizeof(sub), "%s", name);
+
+            #if !defined(_WIN32) && !defined(_WIN64)
+                struct stat st;
+                if (stat(path, &st) != 0) continue;
+                bool is_dir = S_ISDIR(st.st_mode);
+                if (!is_dir && !S_ISREG(st.st_mode)) continue;
+            #endif
+
+            if (is_dir) {
+                collect_files(path, sub, items);
+            } else {
+                PackItem item;
+                item.name = mm_strdup(sub);
+                item.path = mm_strdup(path);
+                item.hash = Archive_hash_path(item.name);
+                Array_push(items, &item);
+            }
+    #if defined(_WIN32) || defined(_WIN64)
+        } while (FindNextFileA(find, &fd));
+        FindClose(find);
+    #else
+        }
+        closedir(d);
+    #endif
+}
+
+
+// Дописать нули до смещения:
+static bool write_padding(FILE *f, uint64_t *pos, uint64_t target) {
+    static const unsigned char zeros[ARCHIVE_ALIGNMENT] = {0};
+    while (*pos < target) {
+        size_t n = (size_t)(target - *pos);
+        if (n > sizeof(zeros)) n = sizeof(zeros);
+        if (fwrite(zeros, 1, n, f) != n) return false;
+        *pos += n;
+    }
+    return true;
+}
+
+
+// Посчитать CRC32 (продолжить с crc, начальное значение 0):
+uint32_t Archive_crc32(uint32_t crc, const void *data, size_t size) {
+    call_once(&crc32_once, crc32_init);
+    const unsigned char *p = (const unsigned char*)data;
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) crc = crc32_table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+
+// Посчитать хэш пути (разделители '\\' считаются как '/'):
+uint64_t Archive_hash_path(const char *path) {
+    uint64_t hash = 14695981039346656037ull;  // FNV-1a 64.
+    for (const char *c = path; c && *c; c++) {
+        unsigned char ch = (unsigned char)(*c == '\\' ? '/' : *c);
+        hash ^= ch;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+
+// Открыть архив (verify = true - проверить контрольные суммы всех записей):
+Archive* Archive_open(const char *path, bool verify) {
+    FileMap *map = Files_map(path, FILE_MAP_RANDOM);
+    if (!map) return NULL;
+
+    // Проверяем заголовок и границы оглавления:
+    const ArchiveHeader *header = (const ArchiveHeader*)map->data;
+    if (map->size < sizeof(ArchiveHeader) || memcmp(header->magic, ARCHIVE_MAGIC, 4) != 0) {
+        fprintf(stderr, "Archive_open: \"%s\" is not an archive.\n", path);
+        Files_unmap(&map);
+        return NULL;
+    }
+    if (header->version != ARCHIVE_VERSION) {
+        fprintf(stderr, "Archive_open: \"%s\" has unsupported version %u.\n", path, header->version);
+        Files_unmap(&map);
+        return NULL;
+    }
+    uint64_t toc_size = (uint64_t)header->entries_count * sizeof(ArchiveEntry);
+    if (header->toc_offset + toc_size > map->size || header->names_offset + header->names_size > map->size) {
+        fprintf(stderr, "Archive_open: \"%s\" is truncated.\n", path);
+        Files_unmap(&map);
+        return NULL;
+    }
+
+    // Проверяем контрольную сумму оглавления:
+    uint32_t crc = Archive_crc32(0, map->data + header->toc_offset, (size_t)toc_size);
+    crc = Archive_crc32(crc, map->data + header->names_offset, (size_t)header->names_size);
+    if (crc != header->toc_checksum) {
+        fprintf(stderr, "Archive_open: \"%s\" has corrupted table of contents.\n", path);
+        Files_unmap(&map);
+        return NULL;
+    }
+
+    Archive *archive = (Archive*)mm_alloc(sizeof(Archive));
+    archive->map = map;
+    archive->header = header;
+    archive->entries = (const ArchiveEntry*)(map->data + header->toc_offset);
+    archive->names = (const char*)(map->data + header->names_offset);
+
+    // Проверяем границы и (по желанию) контрольные суммы записей:
+    for (uint32_t i = 0; i < header->entries_count; i++) {
+        const ArchiveEntry *entry = &archive->entries[i];
+        bool bad = entry->offset + entry->size > map->size ||
+                   (uint64_t)entry->name_offset + entry->name_size >= header->names_size;
+        if (!bad && (entry->flags & ARCHIVE_ENTRY_COMPRESSED)) {
+            bad = !Compress_is_stream(map->data + entry->offset, (size_t)entry->size);
+        }
+        if (!bad && verify) bad = !Archive_verify_entry(archive, entry);
+        if (bad) {
+            fprintf(stderr, "Archive_open: \"%s\" has corrupted entry %u.\n", path, i);
+            Archive_close(&archive);
+            return NULL;
+        }
+    }
+    return archive;
+}
+
+
+// Закрыть архив:
+void Archive_close(Archive **archive) {
+    if (!archive || !*archive) return;
+    Files_unmap(&(*archive)->map);
+    mm_free(*archive);
+    *archive = NULL;
+}
+
+
+// Найти запись по пути внутри архива (NULL - не найдено):
+const ArchiveEntry* Archive_find(Archive *archive, const char *path) {
+    if (!archive || !path) return NULL;
+    uint64_t hash = Archive_hash_path(path);
+
+    // Бинарный поиск первой записи с таким хэшем:
+    size_t lo = 0, hi = archive->header->entries_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (archive->entries[mid].hash < hash) lo = mid + 1;
+        else hi = mid;
+    }
+
+    // Среди записей с одинаковым хэшем сравниваем имена:
+    for (size_t i = lo; i < archive->header->entries_count && archive->entries[i].hash == hash; i++) {
+        const ArchiveEntry *entry = &archive->entries[i];
+        if (path_equal(path, archive->names + entry->name_offset, entry->name_size)) return entry;
+    }
+    return NULL;
+}
+
+
+// Получить хранимые данные записи (указатель внутрь отображения архива, для сжатой записи - поток):
+const unsigned char* Archive_get_data(Archive *archive, const ArchiveEntry *entry) {
+    if (!archive || !entry) return NULL;
+    return archive->map->data + entry->offset;
+}
+
+
+// Получить размер несжатых данных записи:
+size_t Archive_get_size(Archive *archive, const ArchiveEntry *entry) {
+    if (!archive || !entry) return 0;
+    if (!(entry->flags & ARCHIVE_ENTRY_COMPRESSED)) return (size_t)entry->size;
+    return Compress_get_raw_size(Archive_get_data(archive, entry), (size_t)entry->size);
+}
+
+
+// Прочитать (распаковать) данные записи в буфер размером Archive_get_size:
+bool Archive_read(Archive *archive, const ArchiveEntry *entry, void *dst, size_t dst_size) {
+    if (!archive || !entry || dst_size != Archive_get_size(archive, entry)) return false;
+    const unsigned char *data = Archive_get_data(archive, entry);
+    if (!(entry->flags & ARCHIVE_ENTRY_COMPRESSED)) {
+        if (dst_size > 0) memcpy(dst, data, dst_size);
+        return true;
+    }
+    if (!Compress_decode(data, (size_t)entry->size, dst, dst_size)) {
+        fprintf(stderr, "Archive_read: Entry \"%s\" is corrupted.\n", Archive_get_name(archive, entry));
+        return false;
+    }
+    return true;
+}
+
+
+// Получить имя записи:
+const char* Archive_get_name(Archive *archive, const ArchiveEntry *entry) {
+    if (!archive || !entry) return NULL;
+    return archive->names + entry->name_offset;
+}
+
+
+// Проверить контрольную сумму записи:
+bool Archive_verify_entry(Archive *archive, const ArchiveEntry *entry) {
+    if (!archive || !entry) return false;
+    return Archive_crc32(0, Archive_get_data(archive, entry), (size_t)entry->size) == entry->checksum;
+}
+
+
+// Собрать архив из всех файлов каталога (рекурсивно). Пути в архиве - относительно src_dir.
+// compress = true - сжимать записи, которым это даёт выигрыш больше ARCHIVE_COMPRESS_MIN_GAIN:
+bool Archive_pack(const char *src_dir, const char *out_path, bool compress, bool verbose) {
+    if (!src_dir || !out_path) return false;
+
+    // Собираем и сортируем файлы:
+    Array *items = Array_create(sizeof(PackItem), 256);
+    collect_files(src_dir, "", items);
+    size_t count = Array_len(items);
+    if (count > 0) qsort(items->data, count, sizeof(PackItem), pack_item_compare);
+
+    FILE *f = fopen(out_path, "wb");
+    bool ok = f != NULL;
+    if (!ok) fprintf(stderr, "Archive_pack: Failed to create \"%s\".\n", out_path);
+
+    ArchiveEntry *entries = (ArchiveEntry*)mm_calloc(count > 0 ? count : 1, sizeof(ArchiveEntry));
+    ArchiveHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ARCHIVE_MAGIC, 4);
+    header.version = ARCHIVE_VERSION;
+    header.entries_count = (uint32_t)count;
+
+    // Данные записей, каждая с границы страницы:
+    uint64_t pos = 0;
+    if (ok) ok = write_padding(f, &pos, ARCHIVE_ALIGNMENT);  // Место под заголовок.
+    uint32_t names_size = 0;
+    uint64_t raw_total = 0;
+    for (size_t i = 0; ok && i < count; i++) {
+        PackItem *item = (PackItem*)Array_get(items, i);
+        size_t size = 0;
+        unsigned char *data = Files_load_bin(item->path, "rb", &size);
+        if (!data) {
+            fprintf(stderr, "Archive_pack: Failed to read \"%s\".\n", item->path);
+            ok = false;
+            break;
+        }
+        ArchiveEntry *entry = &entries[i];
+
+        // Сжимаем, если выигрыш заметен (уже сжатые форматы вроде png остаются как есть):
+        size_t raw_size = size;
+        raw_total += size;
+        if (compress && size > 0) {
+            size_t packed_size = 0;
+            unsigned char *packed = Compress_encode(data, size, &packed_size);
+            if (packed_size < size - size / ARCHIVE_COMPRESS_MIN_GAIN) {
+                mm_free(data);
+                data = packed;
+                size = packed_size;
+                entry->flags |= ARCHIVE_ENTRY_COMPRESSED;
+            } else {
+                mm_free(packed);
+            }
+        }
+
+        ok = write_padding(f, &pos, (pos + ARCHIVE_ALIGNMENT - 1) & ~(uint64_t)(ARCHIVE_ALIGNMENT - 1));
+        if (ok && size > 0) ok = fwrite(data, 1, size, f) == size;
+
+        entry->hash = item->hash;
+        entry->offset = pos;
+        entry->size = size;
+        entry->name_offset = names_size;
+        entry->name_size = (uint32_t)strlen(item->name);
+        entry->checksum = Archive_crc32(0, data, size);
+        names_size += entry->name_size + 1;
+        header.data_size += size;
+        pos += size;
+        mm_free(data);
+        if (verbose) {
+            printf("  %-48s %10zu bytes  crc %08x", item->name, raw_size, entry->checksum);
+            if (entry->flags & ARCHIVE_ENTRY_COMPRESSED) printf("  lz %5.1f%%", 100.0 * size / raw_size);
+            printf("\n");
+        }
+    }
+
+    // Оглавление и имена:
+    if (ok) ok = write_padding(f, &pos, (pos + 7) & ~(uint64_t)7);
+    header.toc_offset = pos;
+    if (ok && count > 0) ok = fwrite(entries, sizeof(ArchiveEntry), count, f) == count;
+    pos += count * sizeof(ArchiveEntry);
+    header.names_offset = pos;
+    header.names_size = names_size;
+    header.toc_checksum = Archive_crc32(0, entries, count * sizeof(ArchiveEntry));
+    for (size_t i = 0; ok && i < count; i++) {
+        PackItem *item = (PackItem*)Array_get(items, i);
+        size_t len = strlen(item->name) + 1;
+        ok = fwrite(item->name, 1, len, f) == len;
+        header.toc_checksum = Archive_crc32(header.toc_checksum, item->name, len);
+    }
+
+    // Заголовок пишем в конце, когда всё известно:
+    if (ok) ok = fseek(f, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, f) == 1;
+    if (f) fclose(f);
+    if (ok && verbose) {
+        printf("Packed %zu files (%.2f MB, stored %.2f MB) into \"%s\".\n",
+            count, raw_total / 1024.0 / 1024.0, header.data_size / 1024.0 / 1024.0, out_path);
+    }
+
+    // Освобождаем память:
+    for (size_t i = 0; i < count; i++) {
+        PackItem *item = (PackItem*)Array_get(items, i);
+        mm_free(item->name);
+        mm_free(item->path);
+    }
+    Array_destroy(&items);
+    mm_free(entries);
+    return ok;
+}
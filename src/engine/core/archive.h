@@ -0,0 +1,103 @@
+//
+// archive.h - Архив ресурсов движка (.pak): заголовок, отсортированное оглавление, выровненные записи.
+//
+// Формат файла:
+//   [ArchiveHeader][данные записей, каждая с границы ARCHIVE_ALIGNMENT][оглавление ArchiveEntry[]][имена]
+// Оглавление отсортировано по хэшу пути (FNV-1a 64), поиск - бинарный. Каждая запись хранит CRC32 данных.
+// Архив открывается через Files_map, поэтому данные записей читаются прямо из отображения без копирования.
+// Сжатые записи (ARCHIVE_ENTRY_COMPRESSED) хранятся потоком блоков по 64 КБ (compress.h) и распаковываются
+// параллельно прямо в буфер назначения через Archive_read.
+//
+
+#pragma once
+
+
+// Подключаем:
+#include "std.h"
+#include "files.h"
+
+
+// Определения:
+#define ARCHIVE_MAGIC     "EPAK"  // Сигнатура файла архива.
+#define ARCHIVE_VERSION   2       // Версия формата.
+#define ARCHIVE_ALIGNMENT 4096    // Выравнивание начала данных каждой записи (размер страницы).
+#define ARCHIVE_EXTENSION ".pak"  // Расширение файла архива.
+
+#define ARCHIVE_ENTRY_COMPRESSED 0x1  // Флаг записи: данные - поток сжатых блоков (compress.h).
+#define ARCHIVE_COMPRESS_MIN_GAIN 8   // Сжимать запись, только если она уменьшается больше чем на 1/N.
+
+
+// Объявление структур:
+typedef struct ArchiveHeader ArchiveHeader;  // Заголовок архива.
+typedef struct ArchiveEntry ArchiveEntry;    // Запись оглавления.
+typedef struct Archive Archive;              // Открытый архив.
+
+
+// Заголовок архива (64 байта, little-endian):
+struct ArchiveHeader {
+    char     magic[4];       // ARCHIVE_MAGIC.
+    uint32_t version;        // ARCHIVE_VERSION.
+    uint32_t entries_count;  // Количество записей.
+    uint32_t toc_checksum;   // CRC32 оглавления и имён.
+    uint64_t toc_offset;     // Смещение оглавления.
+    uint64_t names_offset;   // Смещение блока имён.
+    uint64_t names_size;     // Размер блока имён.
+    uint64_t data_size;      // Суммарный размер данных записей (без выравнивания).
+    uint8_t  reserved[16];
+};
+
+
+// Запись оглавления (40 байт):
+struct ArchiveEntry {
+    uint64_t hash;         // Хэш пути (Archive_hash_path).
+    uint64_t offset;       // Смещение данных (кратно ARCHIVE_ALIGNMENT).
+    uint64_t size;         // Размер хранимых данных (для сжатой записи - размер потока).
+    uint32_t name_offset;  // Смещение имени в блоке имён.
+    uint32_t name_size;    // Длина имени (без '\0').
+    uint32_t checksum;     // CRC32 хранимых данных.
+    uint32_t flags;        // Флаги записи (ARCHIVE_ENTRY_*).
+};
+
+
+// Открытый архив:
+struct Archive {
+    FileMap *map;                  // Отображение файла архива.
+    const ArchiveHeader *header;   // Заголовок.
+    const ArchiveEntry *entries;   // Оглавление.
+    const char *names;             // Блок имён (каждое имя заканчивается '\0').
+};
+
+
+// Посчитать CRC32 (продолжить с crc, начальное значение 0):
+uint32_t Archive_crc32(uint32_t crc, const void *data, size_t size);
+
+// Посчитать хэш пути (разделители '\\' считаются как '/'):
+uint64_t Archive_hash_path(const char *path);
+
+// Открыть архив (verify = true - проверить контрольные суммы всех записей):
+Archive* Archive_open(const char *path, bool verify);
+
+// Закрыть архив:
+void Archive_close(Archive **archive);
+
+// Найти запись по пути внутри архива (NULL - не найдено):
+const ArchiveEntry* Archive_find(Archive *archive, const char *path);
+
+// Получить хранимые данные записи (указатель внутрь отображения архива, для сжатой записи - поток):
+const unsigned char* Archive_get_data(Archive *archive, const ArchiveEntry *entry);
+
+// Получить размер несжатых данных записи:
+size_t Archive_get_size(Archive *archive, const ArchiveEntry *entry);
+
+// Прочитать (распаковать) данные записи в буфер размером Archive_get_size:
+bool Archive_read(Archive *archive, const ArchiveEntry *entry, void *dst, size_t dst_size);
+
+// Получить имя записи:
+const char* Archive_get_name(Archive *archive, const ArchiveEntry *entry);
+
+// Проверить контрольную сумму записи:
+bool Archive_verify_entry(Archive *archive, const ArchiveEntry *entry);
+
+// Собрать архив из всех файлов каталога (рекурсивно). Пути в архиве - относительно src_dir.
+// compress = true - сжимать записи, которым это даёт выигрыш больше ARCHIVE_COMPRESS_MIN_GAIN:
+bool Archive_pack(const char *src_dir, const char *out_path, bool compress, bool verbose);
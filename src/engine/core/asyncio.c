@@ -0,0 +1,935 @@
+//
+// asyncio.c - Реализация асинхронного чтения файлов.
+//
+// Запросы кладутся в lock-free стек отправки из любого потока. В Linux их забирает
+// поток io_uring: открывает файлы, заполняет очередь отправки (одним системным вызовом
+// на всю пачку) и разбирает очередь завершения. Поток спит на eventfd, который будят
+// и новые запросы, и ядро при завершении чтения. Если io_uring недоступен (старое ядро,
+// запрет seccomp или другая ОС), запросы выполняет пул потоков блокирующим чтением.
+//
+
+
+// Подключаем:
+#include "libs/tinycthread.h"
+#include "std.h"
+#include "mm.h"
+#include "time.h"
+#include "asyncio.h"
+
+#if defined(_WIN32) || defined(_WIN64)
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/stat.h>
+#endif
+
+#if defined(__linux__)
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+    #include <sys/eventfd.h>
+    #include <sys/uio.h>
+    #include <linux/io_uring.h>
+    #if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(__NR_io_uring_register)
+        #define ASYNCIO_HAS_IO_URING 1
+    #endif
+#endif
+
+
+// Определения:
+#define ASYNCIO_DEFAULT_THREADS 2  // Потоков пула по умолчанию (чтение упирается в диск, а не в процессор).
+
+
+// Кольца io_uring, отображённые в память процесса:
+#if defined(ASYNCIO_HAS_IO_URING)
+typedef struct IoUring {
+    int fd;                     // Дескриптор io_uring.
+    int event_fd;               // eventfd для пробуждения потока.
+    unsigned entries;           // Размер очереди отправки.
+    _Atomic unsigned *sq_head;  // Голова очереди отправки (двигает ядро).
+    _Atomic unsigned *sq_tail;  // Хвост очереди отправки (двигаем мы).
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    _Atomic unsigned *cq_head;  // Голова очереди завершения (двигаем мы).
+    _Atomic unsigned *cq_tail;  // Хвост очереди завершения (двигает ядро).
+    unsigned *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ptr;
+    void *cq_ptr;
+    size_t sq_size;
+    size_t cq_size;
+    size_t sqes_size;
+} IoUring;
+#endif
+
+
+// Глобальное состояние асинхронного чтения:
+static struct {
+    bool initialized;
+    AsyncIO_Backend backend;
+    atomic_bool running;
+    _Atomic(AsyncIO_Request*) incoming;  // Запросы на отправку (lock-free стек).
+    _Atomic(AsyncIO_Request*) done;      // Завершённые запросы с функцией завершения (lock-free стек).
+
+    // Ожидание завершения:
+    mtx_t wait_lock;
+    cnd_t wait_cond;
+
+    // Пул потоков:
+    int threads_count;
+    thrd_t threads[ASYNCIO_MAX_THREADS];
+    mtx_t pool_lock;
+    cnd_t pool_cond;
+    AsyncIO_Request *pool_head;  // Очередь пула (FIFO).
+    AsyncIO_Request *pool_tail;
+
+    // Поток io_uring:
+    #if defined(ASYNCIO_HAS_IO_URING)
+        IoUring ring;
+        thrd_t ring_thread;
+    #endif
+
+    // Статистика:
+    mtx_t stats_lock;
+    AsyncIO_Stats stats;
+    double latency_sum;
+    double first_submit;
+    double last_complete;
+} aio = {0};
+
+
+// Выполнить чтение на месте (для пула потоков и режима без инициализации):
+static void read_sync(AsyncIO_Request *req);
+
+
+// Статистика и завершение запроса:
+
+
+// Учесть отправку запросов:
+static void stats_submit(size_t count, double now) {
+    if (!aio.initialized) return;
+    mtx_lock(&aio.stats_lock);
+    if (aio.stats.in_flight == 0 && aio.first_submit <= 0.0) aio.first_submit = now;
+    aio.stats.requests += count;
+    aio.stats.in_flight += (int)count;
+    mtx_unlock(&aio.stats_lock);
+}
+
+
+// Учесть завершение запроса:
+static void stats_complete(AsyncIO_Request *req, int status) {
+    double latency = req->complete_time - req->submit_time;
+    mtx_lock(&aio.stats_lock);
+    aio.stats.in_flight--;
+    if (status == ASYNCIO_DONE) {
+        aio.stats.completed++;
+        aio.stats.bytes += req->read_size;
+    } else {
+        aio.stats.failed++;
+    }
+    uint64_t finished = aio.stats.completed + aio.stats.failed;
+    if (finished == 1 || latency < aio.stats.latency_min) aio.stats.latency_min = latency;
+    if (finished == 1 || latency > aio.stats.latency_max) aio.stats.latency_max = latency;
+    aio.latency_sum += latency;
+    aio.last_complete = req->complete_time;
+    mtx_unlock(&aio.stats_lock);
+}
+
+
+// Завершить запрос (из любого потока):
+static void complete_request(AsyncIO_Request *req, int error) {
+    // Закрываем файл:
+    #if !defined(_WIN32) && !defined(_WIN64)
+        if (req->fd >= 0) close(req->fd);
+    #endif
+    req->fd = -1;
+
+    // Буфер, выделенный модулем, всегда заканчивается на '\0':
+    if (req->own_buffer && req->buffer) ((char*)req->buffer)[req->read_size] = '\0';
+
+    req->error = error;
+    req->complete_time = Time_now(NULL);
+    int status = error ? ASYNCIO_FAILED : ASYNCIO_DONE;
+
+    // Без инициализации некого будить:
+    if (!aio.initialized) {
+        atomic_store_explicit(&req->status, status, memory_order_release);
+        return;
+    }
+    stats_complete(req, status);
+    AsyncIO_Callback callback = req->callback;  // После публикации запрос без callback может быть уже освобождён.
+
+    // Публикуем состояние под блокировкой, чтобы ожидающий не пропустил сигнал:
+    mtx_lock(&aio.wait_lock);
+    atomic_store_explicit(&req->status, status, memory_order_release);
+    cnd_broadcast(&aio.wait_cond);
+    mtx_unlock(&aio.wait_lock);
+
+    // Запросы с функцией завершения отдаём в AsyncIO_poll (освобождать их до вызова нельзя):
+    if (callback) {
+        req->next_done = atomic_load_explicit(&aio.done, memory_order_relaxed);
+        while (!atomic_compare_exchange_weak_explicit(
+            &aio.done, &req->next_done, req, memory_order_release, memory_order_relaxed
+        ));
+    }
+}
+
+
+// Подготовить запрос: открыть файл, узнать размер, выделить буфер. Возвращает код ошибки или 0:
+static int open_request(AsyncIO_Request *req) {
+    #if defined(_WIN32) || defined(_WIN64)
+        (void)req;
+        return 0;  // В Windows файл открывается прямо в read_sync.
+    #else
+        // Прямое чтение возможно только в выровненный буфер вызывающего:
+        bool direct = false;
+        #if defined(O_DIRECT)
+            direct = (req->flags & ASYNCIO_FLAG_DIRECT) && !req->own_buffer && req->buffer &&
+                     ((uintptr_t)req->buffer % ASYNCIO_ALIGNMENT) == 0 &&
+                     (req->offset % ASYNCIO_ALIGNMENT) == 0 && (req->capacity % ASYNCIO_ALIGNMENT) == 0;
+            if (direct) {
+                req->fd = open(req->path, O_RDONLY | O_CLOEXEC | O_DIRECT);
+                if (req->fd < 0) direct = false;  // Файловая система не поддерживает O_DIRECT.
+            }
+        #endif
+        if (!direct) req->fd = open(req->path, O_RDONLY | O_CLOEXEC);
+        if (req->fd < 0) return errno ? errno : EIO;
+        req->direct = direct;
+
+        // Узнаём размер файла и сколько читать:
+        struct stat st;
+        if (fstat(req->fd, &st) != 0) return errno ? errno : EIO;
+        size_t file_size = (size_t)st.st_size;
+        size_t available = req->offset < file_size ? file_size - req->offset : 0;
+        if (req->size == 0 || req->size > available) req->size = available;
+
+        // Выделяем буфер или проверяем вместимость буфера вызывающего:
+        if (!req->buffer) {
+            req->buffer = mm_alloc(req->size + 1);
+            req->capacity = req->size;
+            req->own_buffer = true;
+        } else if (req->size > req->capacity) {
+            req->size = req->capacity;
+        }
+        return 0;
+    #endif
+}
+
+
+// Выполнить чтение на месте (для пула потоков и режима без инициализации):
+static void read_sync(AsyncIO_Request *req) {
+    #if defined(_WIN32) || defined(_WIN64)
+        FILE *f = fopen(req->path, "rb");
+        if (!f) { complete_request(req, errno ? errno : ENOENT); return; }
+
+        // Узнаём размер файла и сколько читать:
+        _fseeki64(f, 0, SEEK_END);
+        size_t file_size = (size_t)_ftelli64(f);
+        size_t available = req->offset < file_size ? file_size - req->offset : 0;
+        if (req->size == 0 || req->size > available) req->size = available;
+        if (!req->buffer) {
+            req->buffer = mm_alloc(req->size + 1);
+            req->capacity = req->size;
+            req->own_buffer = true;
+        } else if (req->size > req->capacity) {
+            req->size = req->capacity;
+        }
+
+        _fseeki64(f, (long long)req->offset, SEEK_SET);
+        req->read_size = fread(req->buffer, 1, req->size, f);
+        int error = ferror(f) ? EIO : 0;
+        fclose(f);
+        complete_request(req, error);
+    #else
+        int error = open_request(req);
+        if (error) { complete_request(req, error); return; }
+
+        // Читаем, пока не прочитаем всё (pread может вернуть меньше запрошенного):
+        size_t want = req->direct ? AsyncIO_align_size(req->size) : req->size;
+        if (want > req->capacity && req->direct) want = req->capacity;
+        while (req->read_size < req->size) {
+            ssize_t n = pread(req->fd, (char*)req->buffer + req->read_size,
+                              want - req->read_size, (off_t)(req->offset + req->read_size));
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) { error = errno; break; }
+            if (n == 0) break;  // Конец файла.
+            req->read_size += (size_t)n;
+            if (req->direct) break;  // Прямое чтение не продолжаем с невыровненного смещения.
+        }
+        if (req->read_size > req->size) req->read_size = req->size;
+        complete_request(req, error);
+    #endif
+}
+
+
+// Пул потоков:
+
+
+// Цикл потока пула:
+static int pool_main(void *arg) {
+    (void)arg;
+    mtx_lock(&aio.pool_lock);
+    while (true) {
+        while (!aio.pool_head && atomic_load(&aio.running)) cnd_wait(&aio.pool_cond, &aio.pool_lock);
+        AsyncIO_Request *req = aio.pool_head;
+        if (!req) break;  // Очередь пуста и пул остановлен.
+        aio.pool_head = req->next;
+        if (!aio.pool_head) aio.pool_tail = NULL;
+        mtx_unlock(&aio.pool_lock);
+
+        read_sync(req);
+
+        mtx_lock(&aio.pool_lock);
+    }
+    mtx_unlock(&aio.pool_lock);
+    return 0;
+}
+
+
+// Отдать цепочку запросов пулу потоков:
+static void pool_submit(AsyncIO_Request *first, AsyncIO_Request *last, size_t count) {
+    mtx_lock(&aio.pool_lock);
+    if (aio.pool_tail) aio.pool_tail->next = first;
+    else aio.pool_head = first;
+    aio.pool_tail = last;
+    if (count == 1) cnd_signal(&aio.pool_cond);
+    else cnd_broadcast(&aio.pool_cond);
+    mtx_unlock(&aio.pool_lock);
+}
+
+
+// Запустить пул потоков:
+static bool pool_start(int threads_count) {
+    mtx_init(&aio.pool_lock, mtx_plain);
+    cnd_init(&aio.pool_cond);
+    aio.pool_head = NULL;
+    aio.pool_tail = NULL;
+    aio.threads_count = 0;
+    for (int i = 0; i < threads_count; i++) {
+        if (thrd_create(&aio.threads[i], pool_main, NULL) != thrd_success) {
+            fprintf(stderr, "AsyncIO_init: Failed to create I/O thread %d.\n", i);
+            break;
+        }
+        aio.threads_count++;
+    }
+    if (aio.threads_count == 0) {
+        mtx_destroy(&aio.pool_lock);
+        cnd_destroy(&aio.pool_cond);
+        return false;
+    }
+    return true;
+}
+
+
+// Остановить пул потоков (потоки дочитывают очередь):
+static void pool_stop() {
+    mtx_lock(&aio.pool_lock);
+    cnd_broadcast(&aio.pool_cond);
+    mtx_unlock(&aio.pool_lock);
+    for (int i = 0; i < aio.threads_count; i++) thrd_join(aio.threads[i], NULL);
+    mtx_destroy(&aio.pool_lock);
+    cnd_destroy(&aio.pool_cond);
+    aio.threads_count = 0;
+}
+
+
+// Механизм io_uring:
+
+
+#if defined(ASYNCIO_HAS_IO_URING)
+
+
+// Системные вызовы io_uring (без liburing):
+static inline int uring_setup(unsigned entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static inline int uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static inline int uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+
+// Разбудить поток io_uring:
+static inline void uring_wake() {
+    uint64_t one = 1;
+    ssize_t n = write(aio.ring.event_fd, &one, sizeof(one));
+    (void)n;
+}
+
+
+// Освободить кольца io_uring:
+static void uring_close(IoUring *ring) {
+    if (ring->sqes && ring->sqes != MAP_FAILED) munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ptr && ring->cq_ptr != MAP_FAILED && ring->cq_ptr != ring->sq_ptr) munmap(ring->cq_ptr, ring->cq_size);
+    if (ring->sq_ptr && ring->sq_ptr != MAP_FAILED) munmap(ring->sq_ptr, ring->sq_size);
+    if (ring->event_fd >= 0) close(ring->event_fd);
+    if (ring->fd >= 0) close(ring->fd);
+    memset(ring, 0, sizeof(IoUring));
+    ring->fd = -1;
+    ring->event_fd = -1;
+}
+
+
+// Создать io_uring и отобразить кольца в память. Возвращает false, если io_uring недоступен:
+static bool uring_open(IoUring *ring, unsigned entries) {
+    memset(ring, 0, sizeof(IoUring));
+    ring->fd = -1;
+    ring->event_fd = -1;
+
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    ring->fd = uring_setup(entries, &p);
+    if (ring->fd < 0) return false;
+
+    // Отображаем кольца (в новых ядрах оба кольца лежат в одном отображении):
+    ring->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    ring->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_mmap = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+        if (ring->cq_size > ring->sq_size) ring->sq_size = ring->cq_size;
+        ring->cq_size = ring->sq_size;
+    }
+    ring->sq_ptr = mmap(NULL, ring->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ptr == MAP_FAILED) { uring_close(ring); return false; }
+    if (single_mmap) {
+        ring->cq_ptr = ring->sq_ptr;
+    } else {
+        ring->cq_ptr = mmap(NULL, ring->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ptr == MAP_FAILED) { uring_close(ring); return false; }
+    }
+    ring->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = (struct io_uring_sqe*)mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) { uring_close(ring); return false; }
+
+    char *sq = (char*)ring->sq_ptr;
+    char *cq = (char*)ring->cq_ptr;
+    ring->sq_head  = (_Atomic unsigned*)(sq + p.sq_off.head);
+    ring->sq_tail  = (_Atomic unsigned*)(sq + p.sq_off.tail);
+    ring->sq_mask  = (unsigned*)(sq + p.sq_off.ring_mask);
+    ring->sq_array = (unsigned*)(sq + p.sq_off.array);
+    ring->cq_head  = (_Atomic unsigned*)(cq + p.cq_off.head);
+    ring->cq_tail  = (_Atomic unsigned*)(cq + p.cq_off.tail);
+    ring->cq_mask  = (unsigned*)(cq + p.cq_off.ring_mask);
+    ring->cqes     = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+    ring->entries  = p.sq_entries;
+
+    // Ядро пишет в eventfd при каждом завершении, а мы - при каждой новой пачке запросов:
+    ring->event_fd = eventfd(0, EFD_CLOEXEC);
+    if (ring->event_fd < 0 || uring_register(ring->fd, IORING_REGISTER_EVENTFD, &ring->event_fd, 1) < 0) {
+        uring_close(ring);
+        return false;
+    }
+    return true;
+}
+
+
+// Положить чтение (или его продолжение) в очередь отправки:
+static void uring_prep_read(IoUring *ring, AsyncIO_Request *req) {
+    unsigned tail = atomic_load_explicit(ring->sq_tail, memory_order_relaxed);
+    unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+
+    size_t want = req->direct ? AsyncIO_align_size(req->size) : req->size;
+    if (want > req->capacity && req->direct) want = req->capacity;
+    req->iov.base = (char*)req->buffer + req->read_size;
+    req->iov.len = want - req->read_size;
+
+    // readv вместо read поддерживается всеми ядрами с io_uring (начиная с 5.1):
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = req->fd;
+    sqe->addr = (uint64_t)(uintptr_t)&req->iov;
+    sqe->len = 1;
+    sqe->off = (uint64_t)(req->offset + req->read_size);
+    sqe->user_data = (uint64_t)(uintptr_t)req;
+
+    ring->sq_array[index] = index;
+    atomic_store_explicit(ring->sq_tail, tail + 1, memory_order_release);
+}
+
+
+// Отправить подготовленные чтения ядру:
+static void uring_submit(IoUring *ring, unsigned count) {
+    while (count > 0) {
+        int ret = uring_enter(ring->fd, count, 0, 0);
+        if (ret < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY) { thrd_yield(); continue; }
+            fprintf(stderr, "AsyncIO: io_uring_enter failed (errno %d).\n", errno);
+            return;
+        }
+        count -= (unsigned)ret;
+    }
+}
+
+
+// Разобрать очередь завершения. Возвращает сколько продолжений чтения положено в очередь отправки:
+static unsigned uring_reap(IoUring *ring, int *in_flight, int *reaped) {
+    unsigned resubmit = 0;
+    unsigned head = atomic_load_explicit(ring->cq_head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(ring->cq_tail, memory_order_acquire);
+    while (head != tail) {
+        struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+        AsyncIO_Request *req = (AsyncIO_Request*)(uintptr_t)cqe->user_data;
+        int res = cqe->res;
+        head++;
+        (*reaped)++;
+
+        if (res == -EINTR || res == -EAGAIN) {
+            uring_prep_read(ring, req);  // Повторяем чтение.
+            resubmit++;
+            continue;
+        }
+
+        (*in_flight)--;
+        if (res < 0) {
+            complete_request(req, -res);
+            continue;
+        }
+        req->read_size += (size_t)res;
+
+        // Недочитали (и это не конец файла) - читаем остаток:
+        if (res > 0 && req->read_size < req->size && !req->direct) {
+            uring_prep_read(ring, req);
+            (*in_flight)++;
+            resubmit++;
+            continue;
+        }
+        if (req->read_size > req->size) req->read_size = req->size;
+        complete_request(req, 0);
+    }
+    atomic_store_explicit(ring->cq_head, head, memory_order_release);
+    return resubmit;
+}
+
+
+// Цикл потока io_uring:
+static int uring_main(void *arg) {
+    IoUring *ring = (IoUring*)arg;
+    AsyncIO_Request *backlog_head = NULL;  // Запросы, которые не влезли в очередь отправки.
+    AsyncIO_Request *backlog_tail = NULL;
+    int in_flight = 0;
+
+    while (true) {
+        // Забираем новые запросы и восстанавливаем порядок отправки (стек -> FIFO):
+        AsyncIO_Request *taken = atomic_exchange_explicit(&aio.incoming, NULL, memory_order_acquire);
+        AsyncIO_Request *fifo = NULL;
+        while (taken) {
+            AsyncIO_Request *next = taken->next;
+            taken->next = fifo;
+            fifo = taken;
+            taken = next;
+        }
+        if (fifo) {
+            if (backlog_tail) backlog_tail->next = fifo;
+            else backlog_head = fifo;
+            backlog_tail = fifo;
+            while (backlog_tail->next) backlog_tail = backlog_tail->next;
+        }
+
+        // Заполняем очередь отправки, пока есть место:
+        unsigned to_submit = 0;
+        while (backlog_head && (unsigned)in_flight < ring->entries) {
+            AsyncIO_Request *req = backlog_head;
+            backlog_head = req->next;
+            if (!backlog_head) backlog_tail = NULL;
+            req->next = NULL;
+
+            int error = open_request(req);
+            if (error || req->size == 0) {
+                complete_request(req, error);
+                continue;
+            }
+            uring_prep_read(ring, req);
+            in_flight++;
+            to_submit++;
+        }
+
+        // Одна отправка на всю пачку:
+        if (to_submit > 0) uring_submit(ring, to_submit);
+
+        // Разбираем завершения:
+        int reaped = 0;
+        unsigned resubmit = uring_reap(ring, &in_flight, &reaped);
+        if (resubmit > 0) uring_submit(ring, resubmit);
+
+        // Выходим, когда всё дочитано:
+        bool idle = in_flight == 0 && !backlog_head && !atomic_load(&aio.incoming);
+        if (!atomic_load(&aio.running) && idle) break;
+
+        // Спим до нового запроса или завершения чтения:
+        if (to_submit == 0 && reaped == 0 && (in_flight > 0 || idle)) {
+            uint64_t value;
+            ssize_t n = read(ring->event_fd, &value, sizeof(value));
+            (void)n;
+        }
+    }
+    return 0;
+}
+
+
+#endif  // ASYNCIO_HAS_IO_URING
+
+
+// Отправить цепочку запросов механизму чтения:
+static void submit_chain(AsyncIO_Request *first, AsyncIO_Request *last, size_t count) {
+    stats_submit(count, first->submit_time);
+
+    switch (aio.backend) {
+        #if defined(ASYNCIO_HAS_IO_URING)
+        case ASYNCIO_BACKEND_IO_URING: {
+            last->next = atomic_load_explicit(&aio.incoming, memory_order_relaxed);
+            while (!atomic_compare_exchange_weak_explicit(
+                &aio.incoming, &last->next, first, memory_order_release, memory_order_relaxed
+            ));
+            uring_wake();
+        } break;
+        #endif
+
+        case ASYNCIO_BACKEND_THREADS: {
+            last->next = NULL;
+            pool_submit(first, last, count);
+        } break;
+
+        default: {
+            // Без инициализации читаем на месте:
+            while (first) {
+                AsyncIO_Request *next = first->next;
+                read_sync(first);
+                if (first->callback) first->callback(first, first->data);
+                first = next;
+            }
+        } break;
+    }
+}
+
+
+// Создать запрос по описанию:
+static AsyncIO_Request* create_request(const AsyncIO_Read *read, double now) {
+    AsyncIO_Request *req = (AsyncIO_Request*)mm_calloc(1, sizeof(AsyncIO_Request));
+    req->path = mm_strdup(read->path);
+    req->buffer = read->buffer;
+    req->capacity = read->buffer ? read->capacity : 0;
+    req->offset = read->offset;
+    req->size = read->size;
+    req->flags = read->flags;
+    req->callback = read->callback;
+    req->data = read->data;
+    req->fd = -1;
+    req->submit_time = now;
+    atomic_store(&req->status, ASYNCIO_PENDING);
+    return req;
+}
+
+
+// Инициализация асинхронного чтения (threads_count - потоки запасного пула, <= 0 - автоматически):
+bool AsyncIO_init(int threads_count) {
+    if (aio.initialized) return true;
+
+    if (threads_count <= 0) threads_count = ASYNCIO_DEFAULT_THREADS;
+    if (threads_count > ASYNCIO_MAX_THREADS) threads_count = ASYNCIO_MAX_THREADS;
+
+    mtx_init(&aio.wait_lock, mtx_plain);
+    cnd_init(&aio.wait_cond);
+    mtx_init(&aio.stats_lock, mtx_plain);
+    atomic_store(&aio.incoming, NULL);
+    atomic_store(&aio.done, NULL);
+    atomic_store(&aio.running, true);
+    memset(&aio.stats, 0, sizeof(AsyncIO_Stats));
+    aio.latency_sum = 0.0;
+    aio.first_submit = 0.0;
+    aio.last_complete = 0.0;
+    aio.backend = ASYNCIO_BACKEND_NONE;
+
+    // Пробуем io_uring:
+    #if defined(ASYNCIO_HAS_IO_URING)
+        if (uring_open(&aio.ring, ASYNCIO_QUEUE_DEPTH)) {
+            if (thrd_create(&aio.ring_thread, uring_main, &aio.ring) == thrd_success) {
+                aio.backend = ASYNCIO_BACKEND_IO_URING;
+            } else {
+                uring_close(&aio.ring);
+            }
+        }
+    #endif
+
+    // Иначе пул потоков:
+    if (aio.backend == ASYNCIO_BACKEND_NONE) {
+        if (!pool_start(threads_count)) {
+            mtx_destroy(&aio.wait_lock);
+            cnd_destroy(&aio.wait_cond);
+            mtx_destroy(&aio.stats_lock);
+            return false;
+        }
+        aio.backend = ASYNCIO_BACKEND_THREADS;
+    }
+
+    aio.initialized = true;
+    return true;
+}
+
+
+// Уничтожение асинхронного чтения (дожидается всех запросов и вызывает оставшиеся функции завершения):
+void AsyncIO_destroy() {
+    if (!aio.initialized) return;
+
+    // Останавливаем потоки (они дочитывают все отправленные запросы):
+    atomic_store(&aio.running, false);
+    switch (aio.backend) {
+        #if defined(ASYNCIO_HAS_IO_URING)
+        case ASYNCIO_BACKEND_IO_URING: {
+            uring_wake();
+            thrd_join(aio.ring_thread, NULL);
+            uring_close(&aio.ring);
+        } break;
+        #endif
+        case ASYNCIO_BACKEND_THREADS: pool_stop(); break;
+        default: break;
+    }
+
+    // Отдаём оставшиеся завершения:
+    AsyncIO_poll();
+
+    mtx_destroy(&aio.wait_lock);
+    cnd_destroy(&aio.wait_cond);
+    mtx_destroy(&aio.stats_lock);
+    aio.backend = ASYNCIO_BACKEND_NONE;
+    aio.initialized = false;
+}
+
+
+// Инициализировано ли асинхронное чтение:
+bool AsyncIO_is_initialized() { return aio.initialized; }
+
+
+// Получить используемый механизм чтения:
+AsyncIO_Backend AsyncIO_get_backend() { return aio.backend; }
+
+
+// Получить название используемого механизма чтения:
+const char* AsyncIO_get_backend_name() {
+    switch (aio.backend) {
+        case ASYNCIO_BACKEND_IO_URING: return "io_uring";
+        case ASYNCIO_BACKEND_THREADS:  return "threads";
+        default:                       return "none";
+    }
+}
+
+
+// Отправить запрос чтения:
+AsyncIO_Request* AsyncIO_read(const AsyncIO_Read *read) {
+    if (!read || !read->path) return NULL;
+    AsyncIO_Request *req = create_request(read, Time_now(NULL));
+    submit_chain(req, req, 1);
+    return req;
+}
+
+
+// Отправить пачку запросов чтения разом. Возвращает сколько запросов отправлено:
+size_t AsyncIO_read_batch(const AsyncIO_Read *reads, size_t count, AsyncIO_Request **out_requests) {
+    if (!reads || count == 0) return 0;
+    double now = Time_now(NULL);
+
+    // Собираем цепочку в порядке отправки:
+    AsyncIO_Request *first = NULL, *last = NULL;
+    size_t submitted = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (out_requests) out_requests[i] = NULL;
+        if (!reads[i].path) continue;
+        AsyncIO_Request *req = create_request(&reads[i], now);
+        if (out_requests) out_requests[i] = req;
+        if (last) last->next = req;
+        else first = req;
+        last = req;
+        submitted++;
+    }
+    if (!first) return 0;
+
+    // Для стека отправки io_uring цепочка разворачивается при разборе, поэтому кладём её задом наперёд:
+    #if defined(ASYNCIO_HAS_IO_URING)
+        if (aio.backend == ASYNCIO_BACKEND_IO_URING) {
+            AsyncIO_Request *reversed = NULL, *tail = first;
+            while (first) {
+                AsyncIO_Request *next = first->next;
+                first->next = reversed;
+                reversed = first;
+                first = next;
+            }
+            first = reversed;
+            last = tail;
+        }
+    #endif
+    submit_chain(first, last, submitted);
+    return submitted;
+}
+
+
+// Прочитать файл целиком в новый буфер (с '\0' в конце, как Files_load):
+AsyncIO_Request* AsyncIO_load(const char *path, AsyncIO_Callback callback, void *data) {
+    AsyncIO_Read read = {0};
+    read.path = path;
+    read.callback = callback;
+    read.data = data;
+    return AsyncIO_read(&read);
+}
+
+
+// Завершён ли запрос (успешно или с ошибкой):
+bool AsyncIO_is_done(AsyncIO_Request *request) {
+    if (!request) return true;
+    return atomic_load_explicit(&request->status, memory_order_acquire) != ASYNCIO_PENDING;
+}
+
+
+// Дождаться завершения запроса. Возвращает true, если чтение успешно:
+bool AsyncIO_wait(AsyncIO_Request *request) {
+    if (!request) return false;
+    if (!AsyncIO_is_done(request)) {
+        mtx_lock(&aio.wait_lock);
+        while (atomic_load_explicit(&request->status, memory_order_acquire) == ASYNCIO_PENDING) {
+            cnd_wait(&aio.wait_cond, &aio.wait_lock);
+        }
+        mtx_unlock(&aio.wait_lock);
+    }
+    return atomic_load(&request->status) == ASYNCIO_DONE;
+}
+
+
+// Дождаться завершения нескольких запросов. Возвращает true, если все чтения успешны:
+bool AsyncIO_wait_all(AsyncIO_Request **requests, size_t count) {
+    if (!requests) return false;
+    bool ok = true;
+    for (size_t i = 0; i < count; i++) {
+        if (!AsyncIO_wait(requests[i])) ok = false;
+    }
+    return ok;
+}
+
+
+// Вызвать функции завершения выполненных запросов в текущем потоке. Возвращает их количество:
+int AsyncIO_poll() {
+    AsyncIO_Request *req = atomic_exchange_explicit(&aio.done, NULL, memory_order_acquire);
+    if (!req) return 0;
+
+    // Восстанавливаем порядок завершения (стек -> FIFO):
+    AsyncIO_Request *fifo = NULL;
+    while (req) {
+        AsyncIO_Request *next = req->next_done;
+        req->next_done = fifo;
+        fifo = req;
+        req = next;
+    }
+
+    // Вызываем (функция завершения может освободить запрос, поэтому next берём заранее):
+    int count = 0;
+    while (fifo) {
+        AsyncIO_Request *next = fifo->next_done;
+        fifo->callback(fifo, fifo->data);
+        fifo = next;
+        count++;
+    }
+    return count;
+}
+
+
+// Забрать буфер запроса себе (освобождается через mm_free). NULL, если буфер не выделялся модулем:
+void* AsyncIO_take_buffer(AsyncIO_Request *request, size_t *out_size) {
+    if (out_size) *out_size = 0;
+    if (!request || !request->own_buffer || !AsyncIO_is_done(request)) return NULL;
+    void *buffer = request->buffer;
+    if (out_size) *out_size = request->read_size;
+    request->buffer = NULL;
+    request->own_buffer = false;
+    return buffer;
+}
+
+
+// Освободить запрос (после завершения. Запрос с callback освобождается в нём или после него):
+void AsyncIO_release(AsyncIO_Request **request) {
+    if (!request || !*request) return;
+    AsyncIO_Request *req = *request;
+    AsyncIO_wait(req);
+    if (req->own_buffer && req->buffer) mm_free(req->buffer);
+    mm_free(req->path);
+    mm_free(req);
+    *request = NULL;
+}
+
+
+// Получить задержку запроса в секундах (от отправки до завершения):
+double AsyncIO_get_latency(AsyncIO_Request *request) {
+    if (!request || !AsyncIO_is_done(request)) return 0.0;
+    return request->complete_time - request->submit_time;
+}
+
+
+// Выделить выровненный по ASYNCIO_ALIGNMENT буфер (для ASYNCIO_FLAG_DIRECT):
+void* AsyncIO_alloc_aligned(size_t size) {
+    // Перед выровненным адресом храним указатель на начало блока:
+    char *raw = (char*)mm_alloc(size + ASYNCIO_ALIGNMENT + sizeof(void*));
+    if (!raw) return NULL;
+    uintptr_t aligned = ((uintptr_t)(raw + sizeof(void*)) + ASYNCIO_ALIGNMENT - 1) & ~(uintptr_t)(ASYNCIO_ALIGNMENT - 1);
+    ((void**)aligned)[-1] = raw;
+    return (void*)aligned;
+}
+
+
+// Освободить выровненный буфер:
+void AsyncIO_free_aligned(void *ptr) {
+    if (!ptr) return;
+    mm_free(((void**)ptr)[-1]);
+}
+
+
+// Округлить размер вверх до кратного ASYNCIO_ALIGNMENT:
+size_t AsyncIO_align_size(size_t size) {
+    return (size + ASYNCIO_ALIGNMENT - 1) & ~(size_t)(ASYNCIO_ALIGNMENT - 1);
+}
+
+
+// Получить статистику чтения:
+void AsyncIO_get_stats(AsyncIO_Stats *out_stats) {
+    if (!out_stats) return;
+    memset(out_stats, 0, sizeof(AsyncIO_Stats));
+    if (!aio.initialized) return;
+    mtx_lock(&aio.stats_lock);
+    *out_stats = aio.stats;
+    uint64_t finished = aio.stats.completed + aio.stats.failed;
+    if (finished > 0) out_stats->latency_avg = aio.latency_sum / (double)finished;
+    if (aio.last_complete > aio.first_submit && aio.first_submit > 0.0) {
+        out_stats->busy_time = aio.last_complete - aio.first_submit;
+        out_stats->throughput = (double)aio.stats.bytes / out_stats->busy_time;
+    }
+    mtx_unlock(&aio.stats_lock);
+}
+
+
+// Сбросить статистику чтения:
+void AsyncIO_reset_stats() {
+    if (!aio.initialized) return;
+    mtx_lock(&aio.stats_lock);
+    int in_flight = aio.stats.in_flight;
+    memset(&aio.stats, 0, sizeof(AsyncIO_Stats));
+    aio.stats.in_flight = in_flight;
+    aio.latency_sum = 0.0;
+    aio.first_submit = 0.0;
+    aio.last_complete = 0.0;
+    mtx_unlock(&aio.stats_lock);
+}
+
+
+// Вывести статистику чтения:
+void AsyncIO_print_stats(FILE *out) {
+    if (!out) return;
+    AsyncIO_Stats s;
+    AsyncIO_get_stats(&s);
+    fprintf(out, "AsyncIO (%s): %llu requests, %llu done, %llu failed, %d in flight.\n", AsyncIO_get_backend_name(),
+            (unsigned long long)s.requests, (unsigned long long)s.completed, (unsigned long long)s.failed, s.in_flight);
+    fprintf(out, "  Read %.3f MB in %.3f ms (%.2f MB/s).\n", s.bytes / 1024.0 / 1024.0,
+            s.busy_time * 1000.0, s.throughput / 1024.0 / 1024.0);
+    fprintf(out, "  Latency: min %.3f ms, avg %.3f ms, max %.3f ms.\n",
+            s.latency_min * 1000.0, s.latency_avg * 1000.0, s.latency_max * 1000.0);
+}
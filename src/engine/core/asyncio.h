@@ -0,0 +1,166 @@
+//
+// asyncio.h - Асинхронное чтение файлов (io_uring в Linux, иначе пул потоков).
+//
+
+#pragma once
+
+
+// Подключаем:
+#include "std.h"
+
+
+// Определения:
+#define ASYNCIO_ALIGNMENT   4096  // Выравнивание буфера, смещения и размера для прямого чтения (O_DIRECT).
+#define ASYNCIO_QUEUE_DEPTH 256   // Глубина очереди io_uring (сколько чтений одновременно в полёте).
+#define ASYNCIO_MAX_THREADS 16    // Максимальное количество потоков запасного пула.
+
+
+// Механизм асинхронного чтения:
+typedef enum AsyncIO_Backend {
+    ASYNCIO_BACKEND_NONE,      // Не инициализировано (чтение выполняется сразу в вызывающем потоке).
+    ASYNCIO_BACKEND_IO_URING,  // Linux io_uring.
+    ASYNCIO_BACKEND_THREADS,   // Пул потоков с блокирующим чтением.
+} AsyncIO_Backend;
+
+
+// Состояние запроса:
+typedef enum AsyncIO_Status {
+    ASYNCIO_PENDING,  // Запрос в очереди или выполняется.
+    ASYNCIO_DONE,     // Запрос выполнен.
+    ASYNCIO_FAILED,   // Ошибка (см. AsyncIO_Request.error).
+} AsyncIO_Status;
+
+
+// Флаги запроса:
+typedef enum AsyncIO_Flags {
+    ASYNCIO_FLAG_NONE   = 0,
+    ASYNCIO_FLAG_DIRECT = 1 << 0,  // Читать в обход кэша ОС (буфер, смещение и вместимость кратны ASYNCIO_ALIGNMENT).
+} AsyncIO_Flags;
+
+
+// Объявление структур:
+typedef struct AsyncIO_Read AsyncIO_Read;        // Описание запроса чтения.
+typedef struct AsyncIO_Request AsyncIO_Request;  // Запрос чтения (хэндл).
+typedef struct AsyncIO_Stats AsyncIO_Stats;      // Статистика чтения.
+
+
+// Функция завершения запроса (вызывается в AsyncIO_poll в потоке, который его вызвал):
+typedef void (*AsyncIO_Callback)(AsyncIO_Request *request, void *data);
+
+
+// Описание запроса чтения:
+struct AsyncIO_Read {
+    const char *path;           // Путь до файла.
+    void *buffer;               // Буфер для чтения (NULL - выделить, в конце будет добавлен '\0').
+    size_t capacity;            // Вместимость буфера в байтах (если buffer задан).
+    size_t offset;              // Смещение в файле.
+    size_t size;                // Сколько байт прочитать (0 - до конца файла).
+    uint32_t flags;             // Флаги запроса (AsyncIO_Flags).
+    AsyncIO_Callback callback;  // Функция завершения (может быть NULL).
+    void *data;                 // Данные для функции завершения.
+};
+
+
+// Запрос чтения:
+struct AsyncIO_Request {
+    char *path;                 // Путь до файла.
+    void *buffer;               // Буфер с данными.
+    size_t capacity;            // Вместимость буфера в байтах.
+    size_t offset;              // Смещение в файле.
+    size_t size;                // Сколько байт нужно прочитать.
+    size_t read_size;           // Сколько байт прочитано.
+    uint32_t flags;             // Флаги запроса (AsyncIO_Flags).
+    bool own_buffer;            // Буфер выделен этим модулем (освобождается в AsyncIO_release).
+    AsyncIO_Callback callback;  // Функция завершения.
+    void *data;                 // Данные для функции завершения.
+    atomic_int status;          // Состояние запроса (AsyncIO_Status).
+    int error;                  // Код ошибки (errno) при ASYNCIO_FAILED.
+    double submit_time;         // Время отправки (сек).
+    double complete_time;       // Время завершения (сек).
+
+    // Внутреннее:
+    int fd;                     // Дескриптор файла.
+    bool direct;                // Файл открыт с O_DIRECT.
+    AsyncIO_Request *next;      // Следующий запрос в очереди отправки.
+    AsyncIO_Request *next_done; // Следующий запрос в очереди завершённых.
+    struct { void *base; size_t len; } iov;  // Кусок для readv (совместим с struct iovec).
+};
+
+
+// Статистика чтения:
+struct AsyncIO_Stats {
+    uint64_t requests;      // Сколько запросов отправлено.
+    uint64_t completed;     // Сколько запросов выполнено успешно.
+    uint64_t failed;        // Сколько запросов завершилось ошибкой.
+    uint64_t bytes;         // Сколько байт прочитано.
+    int in_flight;          // Сколько запросов выполняется сейчас.
+    double latency_min;     // Минимальная задержка запроса (сек).
+    double latency_max;     // Максимальная задержка запроса (сек).
+    double latency_avg;     // Средняя задержка запроса (сек).
+    double busy_time;       // Время от первой отправки до последнего завершения (сек).
+    double throughput;      // Пропускная способность (байт/сек за busy_time).
+};
+
+
+// Инициализация асинхронного чтения (threads_count - потоки запасного пула, <= 0 - автоматически):
+bool AsyncIO_init(int threads_count);
+
+// Уничтожение асинхронного чтения (дожидается всех запросов и вызывает оставшиеся функции завершения):
+void AsyncIO_destroy();
+
+// Инициализировано ли асинхронное чтение:
+bool AsyncIO_is_initialized();
+
+// Получить используемый механизм чтения:
+AsyncIO_Backend AsyncIO_get_backend();
+
+// Получить название используемого механизма чтения:
+const char* AsyncIO_get_backend_name();
+
+// Отправить запрос чтения:
+AsyncIO_Request* AsyncIO_read(const AsyncIO_Read *read);
+
+// Отправить пачку запросов чтения разом. Возвращает сколько запросов отправлено:
+size_t AsyncIO_read_batch(const AsyncIO_Read *reads, size_t count, AsyncIO_Request **out_requests);
+
+// Прочитать файл целиком в новый буфер (с '\0' в конце, как Files_load):
+AsyncIO_Request* AsyncIO_load(const char *path, AsyncIO_Callback callback, void *data);
+
+// Завершён ли запрос (успешно или с ошибкой):
+bool AsyncIO_is_done(AsyncIO_Request *request);
+
+// Дождаться завершения запроса. Возвращает true, если чтение успешно:
+bool AsyncIO_wait(AsyncIO_Request *request);
+
+// Дождаться завершения нескольких запросов. Возвращает true, если все чтения успешны:
+bool AsyncIO_wait_all(AsyncIO_Request **requests, size_t count);
+
+// Вызвать функции завершения выполненных запросов в текущем потоке. Возвращает их количество:
+int AsyncIO_poll();
+
+// Забрать буфер запроса себе (освобождается через mm_free). NULL, если буфер не выделялся модулем:
+void* AsyncIO_take_buffer(AsyncIO_Request *request, size_t *out_size);
+
+// Освободить запрос (после завершения. Запрос с callback освобождается в нём или после него):
+void AsyncIO_release(AsyncIO_Request **request);
+
+// Получить задержку запроса в секундах (от отправки до завершения):
+double AsyncIO_get_latency(AsyncIO_Request *request);
+
+// Выделить выровненный по ASYNCIO_ALIGNMENT буфер (для ASYNCIO_FLAG_DIRECT):
+void* AsyncIO_alloc_aligned(size_t size);
+
+// Освободить выровненный буфер:
+void AsyncIO_free_aligned(void *ptr);
+
+// Округлить размер вверх до кратного ASYNCIO_ALIGNMENT:
+size_t AsyncIO_align_size(size_t size);
+
+// Получить статистику чтения:
+void AsyncIO_get_stats(AsyncIO_Stats *out_stats);
+
+// Сбросить статистику чтения:
+void AsyncIO_reset_stats();
+
+// Вывести статистику чтения:
+void AsyncIO_print_stats(FILE *out);
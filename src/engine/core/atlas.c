@@ -0,0 +1,286 @@
+//
+// atlas.c - Реализация сборки атласа текстур.
+//
+
+
+// Подключаем:
+#include <limits.h>
+#include "std.h"
+#include "mm.h"
+#include "array.h"
+#include "pixmap.h"
+#include "atlas.h"
+
+
+// Объявление структур:
+typedef struct PackRect PackRect;  // Прямоугольник упаковщика.
+typedef struct PackItem PackItem;  // Картинка в очереди упаковки.
+
+
+struct PackRect {
+    int x, y, w, h;
+};
+
+
+struct PackItem {
+    int index;
+    int w, h;  // Размер вместе с отступом и продлением краёв.
+};
+
+
+// Наименьшая степень двойки >= value:
+static int next_pow2(int value) {
+    int result = 1;
+    while (result < value) result <<= 1;
+    return result;
+}
+
+
+// Лежит ли a целиком внутри b:
+static inline bool rect_contains(const PackRect *b, const PackRect *a) {
+    return a->x >= b->x && a->y >= b->y && a->x + a->w <= b->x + b->w && a->y + a->h <= b->y + b->h;
+}
+
+
+// Разрезать свободный прямоугольник занятым (до 4 остатков). false - не пересекаются:
+static bool split_free_rect(Array *free_rects, PackRect free, const PackRect *used) {
+    if (used->x >= free.x + free.w || used->x + used->w <= free.x ||
+        used->y >= free.y + free.h || used->y + used->h <= free.y) return false;
+
+    if (used->x > free.x) {
+        PackRect r = { free.x, free.y, used->x - free.x, free.h };
+        Array_push(free_rects, &r);
+    }
+    if (used->x + used->w < free.x + free.w) {
+        PackRect r = { used->x + used->w, free.y, free.x + free.w - (used->x + used->w), free.h };
+        Array_push(free_rects, &r);
+    }
+    if (used->y > free.y) {
+        PackRect r = { free.x, free.y, free.w, used->y - free.y };
+        Array_push(free_rects, &r);
+    }
+    if (used->y + used->h < free.y + free.h) {
+        PackRect r = { free.x, used->y + used->h, free.w, free.y + free.h - (used->y + used->h) };
+        Array_push(free_rects, &r);
+    }
+    return true;
+}
+
+
+// Удалить свободные прямоугольники, которые лежат внутри других:
+static void prune_free_rects(Array *free_rects) {
+    for (size_t i = 0; i < free_rects->len; i++) {
+        for (size_t j = i + 1; j < free_rects->len; j++) {
+            PackRect *a = (PackRect*)Array_get(free_rects, i);
+            PackRect *b = (PackRect*)Array_get(free_rects, j);
+            if (rect_contains(b, a)) {
+                Array_remove_swap(free_rects, i, NULL);
+                i--;
+                break;
+            }
+            if (rect_contains(a, b)) {
+                Array_remove_swap(free_rects, j, NULL);
+                j--;
+            }
+        }
+    }
+}
+
+
+// Сортировка: сначала с большей длинной стороной, затем с большей площадью:
+static int compare_items(const void *a, const void *b) {
+    const PackItem *ia = (const PackItem*)a, *ib = (const PackItem*)b;
+    int max_a = ia->w > ia->h ? ia->w : ia->h, max_b = ib->w > ib->h ? ib->w : ib->h;
+    if (max_a != max_b) return max_b - max_a;
+    long long area_a = (long long)ia->w * ia->h, area_b = (long long)ib->w * ib->h;
+    if (area_a != area_b) return area_b > area_a ? 1 : -1;
+    return ia->index - ib->index;
+}
+
+
+// Уложить все картинки в область width x height (позиции - в out_x/out_y по индексу картинки):
+static bool pack_all(const PackItem *items, int count, int width, int height, int *out_x, int *out_y) {
+    AtlasPacker *packer = Atlas_packer_create(width, height);
+    bool ok = true;
+    for (int i = 0; i < count && ok; i++) {
+        const PackItem *item = &items[i];
+        ok = Atlas_packer_insert(packer, item->w, item->h, &out_x[item->index], &out_y[item->index]);
+    }
+    Atlas_packer_destroy(&packer);
+    return ok;
+}
+
+
+// Скопировать картинку в атлас и продлить её края наружу:
+static void blit_sprite(Pixmap *atlas, const Pixmap *sprite, int x, int y, int extrude) {
+    int ch = atlas->channels;
+    size_t atlas_stride = Pixmap_get_stride(atlas);
+    size_t sprite_stride = Pixmap_get_stride(sprite);
+    size_t row_size = (size_t)sprite->width * ch;
+    for (int sy = 0; sy < sprite->height; sy++) {
+        uint8_t *dst = atlas->data + (size_t)(y + sy) * atlas_stride + (size_t)x * ch;
+        const uint8_t *src = sprite->data + sy * sprite_stride;
+        memcpy(dst, src, row_size);
+        for (int e = 1; e <= extrude; e++) {
+            memcpy(dst - (size_t)e * ch, src, ch);
+            memcpy(dst + row_size + (size_t)(e - 1) * ch, src + row_size - ch, ch);
+        }
+    }
+    if (extrude <= 0 || sprite->height <= 0) return;
+
+    // Верхние и нижние строки - копии крайних строк (уже с продлёнными углами):
+    size_t ext_row = row_size + (size_t)extrude * 2 * ch;
+    uint8_t *first = atlas->data + (size_t)y * atlas_stride + (size_t)(x - extrude) * ch;
+    uint8_t *last = first + (size_t)(sprite->height - 1) * atlas_stride;
+    for (int e = 1; e <= extrude; e++) {
+        memcpy(first - (size_t)e * atlas_stride, first, ext_row);
+        memcpy(last + (size_t)e * atlas_stride, last, ext_row);
+    }
+}
+
+
+// Собрать атлас:
+Atlas* Atlas_build(Pixmap *const *pixmaps, int count, int channels, int padding, int extrude, int max_size) {
+    if (!pixmaps || count <= 0) return NULL;
+    if (channels < 1 || channels > 4) channels = PIXMAP_RGBA;
+    if (padding < 0) padding = 0;
+    if (extrude < 0) extrude = 0;
+    int border = padding + extrude;
+
+    // Очередь упаковки и начальный размер (вмещает самую большую картинку и суммарную площадь):
+    PackItem *items = (PackItem*)mm_alloc(sizeof(PackItem) * count);
+    int need_w = 1, need_h = 1;
+    long long area = 0;
+    for (int i = 0; i < count; i++) {
+        const Pixmap *pixmap = pixmaps[i];
+        items[i].index = i;
+        items[i].w = (pixmap ? pixmap->width : 0) + border * 2;
+        items[i].h = (pixmap ? pixmap->height : 0) + border * 2;
+        if (items[i].w > need_w) need_w = items[i].w;
+        if (items[i].h > need_h) need_h = items[i].h;
+        area += (long long)items[i].w * items[i].h;
+    }
+    qsort(items, count, sizeof(PackItem), compare_items);
+
+    int width = next_pow2(need_w), height = next_pow2(need_h);
+    while ((long long)width * height < area) {
+        if (width <= height) width *= 2; else height *= 2;
+    }
+
+    // Увеличиваем атлас, пока всё не поместится:
+    int *pos_x = (int*)mm_alloc(sizeof(int) * count);
+    int *pos_y = (int*)mm_alloc(sizeof(int) * count);
+    bool packed = false;
+    while (width <= max_size && height <= max_size) {
+        if ((packed = pack_all(items, count, width, height, pos_x, pos_y))) break;
+        if (width <= height) width *= 2; else height *= 2;
+    }
+    mm_free(items);
+    if (!packed) {
+        fprintf(stderr, "Atlas_build: %d images do not fit into %d x %d.\n", count, max_size, max_size);
+        mm_free(pos_x);
+        mm_free(pos_y);
+        return NULL;
+    }
+
+    // Рисуем картинки и считаем текстурные координаты:
+    Atlas *atlas = (Atlas*)mm_alloc(sizeof(Atlas));
+    atlas->pixmap = Pixmap_create(width, height, channels);
+    atlas->rects = (AtlasRect*)mm_calloc(count, sizeof(AtlasRect));
+    atlas->count = count;
+    for (int i = 0; i < count; i++) {
+        const Pixmap *pixmap = pixmaps[i];
+        AtlasRect *rect = &atlas->rects[i];
+        rect->x = pos_x[i] + border;
+        rect->y = pos_y[i] + border;
+        rect->width = pixmap ? pixmap->width : 0;
+        rect->height = pixmap ? pixmap->height : 0;
+        rect->u0 = (float)rect->x / width;
+        rect->v0 = (float)rect->y / height;
+        rect->u1 = (float)(rect->x + rect->width) / width;
+        rect->v1 = (float)(rect->y + rect->height) / height;
+        if (!pixmap || rect->width == 0 || rect->height == 0) continue;
+
+        Pixmap *u8 = pixmap->type != PIXMAP_U8 ? Pixmap_convert_type(pixmap, PIXMAP_U8) : NULL;
+        if (u8) pixmap = u8;
+        Pixmap *converted = pixmap->channels != channels ? Pixmap_convert(pixmap, channels) : NULL;
+        blit_sprite(atlas->pixmap, converted ? converted : pixmap, rect->x, rect->y, extrude);
+        Pixmap_destroy(&converted);
+        Pixmap_destroy(&u8);
+    }
+    mm_free(pos_x);
+    mm_free(pos_y);
+    return atlas;
+}
+
+
+// Уничтожить атлас:
+void Atlas_destroy(Atlas **atlas) {
+    if (!atlas || !*atlas) return;
+    Pixmap_destroy(&(*atlas)->pixmap);
+    mm_free((*atlas)->rects);
+    mm_free(*atlas);
+    *atlas = NULL;
+}
+
+
+// Создать упаковщик:
+AtlasPacker* Atlas_packer_create(int width, int height) {
+    AtlasPacker *packer = (AtlasPacker*)mm_alloc(sizeof(AtlasPacker));
+    packer->width = width;
+    packer->height = height;
+    packer->free_rects = Array_create(sizeof(PackRect), 64);
+    PackRect all = { 0, 0, width, height };
+    Array_push(packer->free_rects, &all);
+    return packer;
+}
+
+
+// Уничтожить упаковщик:
+void Atlas_packer_destroy(AtlasPacker **packer) {
+    if (!packer || !*packer) return;
+    Array_destroy(&(*packer)->free_rects);
+    mm_free(*packer);
+    *packer = NULL;
+}
+
+
+// Разместить прямоугольник:
+bool Atlas_packer_insert(AtlasPacker *packer, int width, int height, int *out_x, int *out_y) {
+    if (!packer || width <= 0 || height <= 0) {
+        if (out_x) *out_x = 0;
+        if (out_y) *out_y = 0;
+        return packer && width >= 0 && height >= 0;
+    }
+
+    // Лучший свободный прямоугольник - с наименьшим остатком по короткой стороне (затем по длинной):
+    Array *free_rects = packer->free_rects;
+    PackRect best = { 0, 0, 0, 0 };
+    int best_short = INT_MAX, best_long = INT_MAX;
+    for (size_t i = 0; i < free_rects->len; i++) {
+        const PackRect *r = (const PackRect*)Array_get(free_rects, i);
+        if (r->w < width || r->h < height) continue;
+        int left_w = r->w - width, left_h = r->h - height;
+        int short_side = left_w < left_h ? left_w : left_h;
+        int long_side = left_w < left_h ? left_h : left_w;
+        if (short_side < best_short || (short_side == best_short && long_side < best_long)) {
+            best = (PackRect){ r->x, r->y, width, height };
+            best_short = short_side;
+            best_long = long_side;
+        }
+    }
+    if (best_short == INT_MAX) return false;
+
+    // Режем все свободные прямоугольники, пересекающиеся с занятым (остатки и нетронутые - в новый список):
+    Array *next_rects = Array_create(sizeof(PackRect), free_rects->capacity);
+    for (size_t i = 0; i < free_rects->len; i++) {
+        PackRect free = *(PackRect*)Array_get(free_rects, i);
+        if (!split_free_rect(next_rects, free, &best)) Array_push(next_rects, &free);
+    }
+    Array_destroy(&packer->free_rects);
+    packer->free_rects = free_rects = next_rects;
+    prune_free_rects(free_rects);
+    if (out_x) *out_x = best.x;
+    if (out_y) *out_y = best.y;
+    return true;
+}
@@ -0,0 +1,65 @@
+//
+// atlas.h - Сборка атласа текстур из множества маленьких картинок (спрайты, глифы, иконки интерфейса).
+//
+// Прямоугольники упаковываются алгоритмом MaxRects (свободное место - список максимальных прямоугольников,
+// выбирается тот, где короче остаток по меньшей стороне). Вокруг каждой картинки можно оставить прозрачный
+// отступ и продлить её крайние пиксели наружу (extrude), чтобы при мипмапах и билинейной фильтрации соседи
+// не смешивались. Один атлас вместо многих текстур - меньше привязок текстур и вызовов отрисовки.
+//
+
+#pragma once
+
+
+// Подключаем:
+#include "std.h"
+#include "array.h"
+#include "pixmap.h"
+
+
+// Объявление структур:
+typedef struct AtlasRect AtlasRect;      // Место картинки в атласе.
+typedef struct Atlas Atlas;              // Атлас текстур.
+typedef struct AtlasPacker AtlasPacker;  // Упаковщик прямоугольников MaxRects.
+
+
+// Место картинки в атласе (без отступа и продления краёв):
+struct AtlasRect {
+    int x, y;           // Левый верхний угол в пикселях атласа.
+    int width, height;
+    float u0, v0;       // Текстурные координаты углов (строка 0 картинки - v = 0).
+    float u1, v1;
+};
+
+
+// Атлас текстур:
+struct Atlas {
+    Pixmap *pixmap;     // Картинка атласа (ширина и высота - степени двойки).
+    AtlasRect *rects;   // Места картинок в порядке входного массива.
+    int count;
+};
+
+
+// Упаковщик прямоугольников MaxRects:
+struct AtlasPacker {
+    int width;
+    int height;
+    Array *free_rects;  // Свободные максимальные прямоугольники (int x, y, w, h).
+};
+
+
+// Собрать атлас (8 бит на канал). channels - каналы атласа (картинки с другим числом каналов или типом значения
+// конвертируются), padding - прозрачный отступ вокруг картинки, extrude - сколько пикселей края продлить наружу,
+// max_size - предельная сторона атласа. NULL - картинки не помещаются:
+Atlas* Atlas_build(Pixmap *const *pixmaps, int count, int channels, int padding, int extrude, int max_size);
+
+// Уничтожить атлас:
+void Atlas_destroy(Atlas **atlas);
+
+// Создать упаковщик для области width x height:
+AtlasPacker* Atlas_packer_create(int width, int height);
+
+// Уничтожить упаковщик:
+void Atlas_packer_destroy(AtlasPacker **packer);
+
+// Разместить прямоугольник (false - не помещается):
+bool Atlas_packer_insert(AtlasPacker *packer, int width, int height, int *out_x, int *out_y);
@@ -0,0 +1,387 @@
+//
+// compress.c - Реализация сжатия в формате блоков LZ4.
+//
+// Последовательность: токен (старшие 4 бита - длина литералов, младшие - длина совпадения - 4),
+// доп. байты длины литералов, литералы, смещение (2 байта LE), доп. байты длины совпадения.
+// Последние 5 байт блока всегда литералы, совпадение не начинается ближе 12 байт к концу.
+//
+
+
+// Подключаем:
+#include "std.h"
+#include "mm.h"
+#include "jobs.h"
+#include "compress.h"
+
+
+// Определения:
+#define LZ_MIN_MATCH   4             // Минимальная длина совпадения.
+#define LZ_LAST_LITS   5             // Сколько байт в конце блока всегда идут литералами.
+#define LZ_MF_LIMIT    12            // Совпадение не может начинаться ближе к концу блока.
+#define LZ_MAX_OFFSET  65535         // Максимальное смещение совпадения.
+#define LZ_HASH_LOG    12            // Размер хэш-таблицы компрессора (2^LZ_HASH_LOG позиций).
+#define LZ_MAX_INPUT   0x7E000000    // Максимальный размер входного блока.
+#define LZ_SKIP_TRIGGER 6            // Ускорение поиска на несжимаемых данных (шаг растёт каждые 2^N промахов).
+
+
+// Объявление структур:
+typedef struct CompressJob CompressJob;  // Данные параллельного сжатия/распаковки потока.
+
+
+// Данные параллельного сжатия/распаковки потока:
+struct CompressJob {
+    const unsigned char *src;  // Входные данные.
+    unsigned char *dst;        // Выходные данные.
+    size_t raw_size;           // Размер несжатых данных.
+    size_t block_size;         // Размер несжатого блока.
+    size_t stride;             // Шаг между блоками во временном буфере сжатия.
+    uint32_t *sizes;           // Размеры сжатых блоков (с флагом COMPRESS_BLOCK_RAW).
+    size_t *offsets;           // Смещения сжатых блоков (для распаковки).
+    atomic_bool failed;        // Хотя бы один блок повреждён.
+};
+
+
+// Прочитать 4 байта без требований к выравниванию:
+static inline uint32_t read32(const unsigned char *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+
+// Хэш 4 байт для поиска совпадений:
+static inline uint32_t hash32(uint32_t v) {
+    return (v * 2654435761u) >> (32 - LZ_HASH_LOG);
+}
+
+
+// Записать длину больше 15 дополнительными байтами:
+static inline unsigned char* write_length(unsigned char *op, size_t len) {
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (unsigned char)len;
+    return op;
+}
+
+
+// Записать последовательность (литералы + совпадение). Возвращает NULL, если не влезает:
+static unsigned char* write_sequence(
+    unsigned char *op, unsigned char *oend, const unsigned char *lit, size_t lit_len, size_t offset, size_t match_len
+) {
+    // Худший случай для этой последовательности:
+    size_t need = 1 + lit_len + lit_len / 255 + 1 + (match_len ? 2 + match_len / 255 + 1 : 0);
+    if ((size_t)(oend - op) < need) return NULL;
+
+    unsigned char *token = op++;
+    *token = (unsigned char)((lit_len >= 15 ? 15 : lit_len) << 4);
+    if (lit_len >= 15) op = write_length(op, lit_len - 15);
+    memcpy(op, lit, lit_len);
+    op += lit_len;
+
+    // Последняя последовательность блока состоит только из литералов:
+    if (match_len == 0) return op;
+
+    *op++ = (unsigned char)(offset & 0xFF);
+    *op++ = (unsigned char)(offset >> 8);
+    size_t ml = match_len - LZ_MIN_MATCH;
+    *token |= (unsigned char)(ml >= 15 ? 15 : ml);
+    if (ml >= 15) op = write_length(op, ml - 15);
+    return op;
+}
+
+
+// Максимальный размер сжатого блока для size байт входных данных:
+size_t Compress_bound(size_t size) {
+    return size + size / 255 + 16;
+}
+
+
+// Сжать один блок. Возвращает размер сжатых данных (0 - не влезло в dst_capacity):
+size_t Compress_block_encode(const void *src, size_t src_size, void *dst, size_t dst_capacity) {
+    if (!src || !dst || src_size > LZ_MAX_INPUT) return 0;
+    const unsigned char *base = (const unsigned char*)src;
+    const unsigned char *ip = base;
+    const unsigned char *anchor = base;
+    const unsigned char *iend = base + src_size;
+    unsigned char *op = (unsigned char*)dst;
+    unsigned char *oend = op + dst_capacity;
+
+    // Совпадения ищем только если блок достаточно длинный:
+    if (src_size >= LZ_MF_LIMIT + 1) {
+        const unsigned char *mflimit = iend - LZ_MF_LIMIT;
+        const unsigned char *matchlimit = iend - LZ_LAST_LITS;
+        uint32_t table[1 << LZ_HASH_LOG];  // Последняя позиция для каждого хэша (смещение от base).
+        memset(table, 0, sizeof(table));
+        ip++;
+
+        uint32_t misses = 1u << LZ_SKIP_TRIGGER;
+        while (ip < mflimit) {
+            uint32_t h = hash32(read32(ip));
+            const unsigned char *ref = base + table[h];
+            table[h] = (uint32_t)(ip - base);
+
+            if (ref >= ip || (size_t)(ip - ref) > LZ_MAX_OFFSET || read32(ref) != read32(ip)) {
+                ip += misses++ >> LZ_SKIP_TRIGGER;
+                continue;
+            }
+            misses = 1u << LZ_SKIP_TRIGGER;
+
+            // Расширяем совпадение назад и вперёд:
+            while (ip > anchor && ref > base && ip[-1] == ref[-1]) { ip--; ref--; }
+            const unsigned char *mp = ip + LZ_MIN_MATCH;
+            const unsigned char *rp = ref + LZ_MIN_MATCH;
+            while (mp < matchlimit && *mp == *rp) { mp++; rp++; }
+            size_t match_len = (size_t)(mp - ip);
+
+            op = write_sequence(op, oend, anchor, (size_t)(ip - anchor), (size_t)(ip - ref), match_len);
+            if (!op) return 0;
+            ip = mp;
+            anchor = ip;
+
+            // Запоминаем позицию перед концом совпадения (улучшает сжатие повторов):
+            if (ip < mflimit) table[hash32(read32(ip - 2))] = (uint32_t)(ip - 2 - base);
+        }
+    }
+
+    // Оставшиеся литералы:
+    op = write_sequence(op, oend, anchor, (size_t)(iend - anchor), 0, 0);
+    if (!op) return 0;
+    return (size_t)(op - (unsigned char*)dst);
+}
+
+
+// Распаковать один блок ровно в dst_size байт. Возвращает false при повреждённых данных:
+bool Compress_block_decode(const void *src, size_t src_size, void *dst, size_t dst_size) {
+    if (!src || !dst) return false;
+    const unsigned char *ip = (const unsigned char*)src;
+    const unsigned char *iend = ip + src_size;
+    unsigned char *op = (unsigned char*)dst;
+    unsigned char *ostart = op;
+    unsigned char *oend = op + dst_size;
+
+    while (ip < iend) {
+        unsigned token = *ip++;
+
+        // Литералы:
+        size_t lit_len = token >> 4;
+        if (lit_len == 15) {
+            unsigned b;
+            do {
+                if (ip >= iend) return false;
+                b = *ip++;
+                lit_len += b;
+            } while (b == 255);
+        }
+        if ((size_t)(iend - ip) < lit_len || (size_t)(oend - op) < lit_len) return false;
+        memcpy(op, ip, lit_len);
+        ip += lit_len;
+        op += lit_len;
+        if (ip >= iend) break;  // Последняя последовательность - только литералы.
+
+        // Совпадение:
+        if (iend - ip < 2) return false;
+        size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - ostart)) return false;
+        size_t match_len = token & 15;
+        if (match_len == 15) {
+            unsigned b;
+            do {
+                if (ip >= iend) return false;
+                b = *ip++;
+                match_len += b;
+            } while (b == 255);
+        }
+        match_len += LZ_MIN_MATCH;
+        if ((size_t)(oend - op) < match_len) return false;
+
+        // Копируем (при перекрытии - побайтно, чтобы повторять уже записанные данные):
+        const unsigned char *ref = op - offset;
+        if (offset >= match_len) {
+            memcpy(op, ref, match_len);
+            op += match_len;
+        } else {
+            for (size_t i = 0; i < match_len; i++) *op++ = *ref++;
+        }
+    }
+    return op == oend;
+}
+
+
+// Сжать блоки потока с индексами [start, end):
+static void encode_range(size_t start, size_t end, void *data) {
+    CompressJob *job = (CompressJob*)data;
+    for (size_t i = start; i < end; i++) {
+        size_t offset = i * job->block_size;
+        size_t size = job->raw_size - offset < job->block_size ? job->raw_size - offset : job->block_size;
+        unsigned char *out = job->dst + i * job->stride;
+        size_t packed = Compress_block_encode(job->src + offset, size, out, job->stride);
+
+        // Несжимаемый блок храним как есть:
+        if (packed == 0 || packed >= size) {
+            memcpy(out, job->src + offset, size);
+            job->sizes[i] = (uint32_t)size | COMPRESS_BLOCK_RAW;
+        } else {
+            job->sizes[i] = (uint32_t)packed;
+        }
+    }
+}
+
+
+// Распаковать блоки потока с индексами [start, end):
+static void decode_range(size_t start, size_t end, void *data) {
+    CompressJob *job = (CompressJob*)data;
+    for (size_t i = start; i < end && !atomic_load_explicit(&job->failed, memory_order_relaxed); i++) {
+        size_t offset = i * job->block_size;
+        size_t size = job->raw_size - offset < job->block_size ? job->raw_size - offset : job->block_size;
+        const unsigned char *in = job->src + job->offsets[i];
+        uint32_t packed = job->sizes[i] & ~COMPRESS_BLOCK_RAW;
+        bool ok;
+        if (job->sizes[i] & COMPRESS_BLOCK_RAW) {
+            ok = packed == size;
+            if (ok) memcpy(job->dst + offset, in, size);
+        } else {
+            ok = Compress_block_decode(in, packed, job->dst + offset, size);
+        }
+        if (!ok) atomic_store(&job->failed, true);
+    }
+}
+
+
+// Сжать данные в поток блоков (параллельно). Возвращает буфер mm_alloc, размер в out_size:
+unsigned char* Compress_encode(const void *src, size_t src_size, size_t *out_size) {
+    if (out_size) *out_size = 0;
+    if (!src && src_size > 0) return NULL;
+    size_t blocks = (src_size + COMPRESS_BLOCK_SIZE - 1) / COMPRESS_BLOCK_SIZE;
+
+    // Сжимаем блоки параллельно во временный буфер (у каждого блока своё место):
+    CompressJob job;
+    memset(&job, 0, sizeof(job));
+    job.src = (const unsigned char*)src;
+    job.raw_size = src_size;
+    job.block_size = COMPRESS_BLOCK_SIZE;
+    job.stride = Compress_bound(COMPRESS_BLOCK_SIZE);
+    job.sizes = (uint32_t*)mm_alloc(sizeof(uint32_t) * (blocks > 0 ? blocks : 1));
+    job.dst = (unsigned char*)mm_alloc(job.stride * (blocks > 0 ? blocks : 1));
+    Jobs_parallel_for(blocks, 1, encode_range, &job);
+
+    // Собираем поток:
+    size_t total = sizeof(CompressHeader) + blocks * sizeof(uint32_t);
+    for (size_t i = 0; i < blocks; i++) total += job.sizes[i] & ~COMPRESS_BLOCK_RAW;
+    unsigned char *out = (unsigned char*)mm_alloc(total);
+    CompressHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, COMPRESS_MAGIC, 4);
+    header.block_size = COMPRESS_BLOCK_SIZE;
+    header.raw_size = src_size;
+    header.blocks_count = (uint32_t)blocks;
+    memcpy(out, &header, sizeof(header));
+    memcpy(out + sizeof(header), job.sizes, blocks * sizeof(uint32_t));
+    unsigned char *op = out + sizeof(header) + blocks * sizeof(uint32_t);
+    for (size_t i = 0; i < blocks; i++) {
+        size_t packed = job.sizes[i] & ~COMPRESS_BLOCK_RAW;
+        memcpy(op, job.dst + i * job.stride, packed);
+        op += packed;
+    }
+
+    mm_free(job.sizes);
+    mm_free(job.dst);
+    if (out_size) *out_size = total;
+    return out;
+}
+
+
+// Распаковать поток в буфер назначения (блоки распаковываются параллельно):
+bool Compress_decode(const void *src, size_t src_size, void *dst, size_t dst_size) {
+    if (!Compress_is_stream(src, src_size)) return false;
+    CompressHeader header;
+    memcpy(&header, src, sizeof(header));
+    if (header.raw_size != dst_size || header.block_size == 0) return false;
+    if ((header.raw_size + header.block_size - 1) / header.block_size != header.blocks_count) return false;
+    if (dst_size > 0 && !dst) return false;
+
+    // Таблица размеров и смещения блоков (префиксная сумма):
+    size_t blocks = header.blocks_count;
+    size_t table_end = sizeof(header) + blocks * sizeof(uint32_t);
+    if (table_end > src_size) return false;
+    CompressJob job;
+    memset(&job, 0, sizeof(job));
+    job.src = (const unsigned char*)src;
+    job.dst = (unsigned char*)dst;
+    job.raw_size = header.raw_size;
+    job.block_size = header.block_size;
+    job.sizes = (uint32_t*)mm_alloc(sizeof(uint32_t) * (blocks > 0 ? blocks : 1));
+    job.offsets = (size_t*)mm_alloc(sizeof(size_t) * (blocks > 0 ? blocks : 1));
+    memcpy(job.sizes, job.src + sizeof(header), blocks * sizeof(uint32_t));
+    size_t offset = table_end;
+    for (size_t i = 0; i < blocks; i++) {
+        job.offsets[i] = offset;
+        offset += job.sizes[i] & ~COMPRESS_BLOCK_RAW;
+    }
+    bool ok = offset <= src_size;
+    atomic_store(&job.failed, false);
+    if (ok) Jobs_parallel_for(blocks, 1, decode_range, &job);
+    ok = ok && !atomic_load(&job.failed);
+
+    mm_free(job.sizes);
+    mm_free(job.offsets);
+    return ok;
+}
+
+
+// Является ли буфер потоком сжатых блоков:
+bool Compress_is_stream(const void *src, size_t src_size) {
+    return src && src_size >= sizeof(CompressHeader) && memcmp(src, COMPRESS_MAGIC, 4) == 0;
+}
+
+
+// Получить размер несжатых данных потока (0 - не поток):
+size_t Compress_get_raw_size(const void *src, size_t src_size) {
+    if (!Compress_is_stream(src, src_size)) return 0;
+    CompressHeader header;
+    memcpy(&header, src, sizeof(header));
+    return (size_t)header.raw_size;
+}
+
+
+// Начать последовательную распаковку потока:
+bool Compress_cursor_init(CompressCursor *cursor, const void *src, size_t src_size) {
+    if (!cursor) return false;
+    memset(cursor, 0, sizeof(CompressCursor));
+    if (!Compress_is_stream(src, src_size)) return false;
+    memcpy(&cursor->header, src, sizeof(CompressHeader));
+    const CompressHeader *h = &cursor->header;
+    if (h->block_size == 0 || (h->raw_size + h->block_size - 1) / h->block_size != h->blocks_count) return false;
+    if (sizeof(CompressHeader) + (size_t)h->blocks_count * sizeof(uint32_t) > src_size) return false;
+    cursor->src = (const unsigned char*)src;
+    cursor->src_size = src_size;
+    cursor->offset = sizeof(CompressHeader) + (size_t)h->blocks_count * sizeof(uint32_t);
+    return true;
+}
+
+
+// Распаковать следующий блок (dst_capacity >= block_size). Возвращает его размер (0 - конец или ошибка):
+size_t Compress_cursor_next(CompressCursor *cursor, void *dst, size_t dst_capacity) {
+    if (!cursor || !cursor->src || cursor->block >= cursor->header.blocks_count) return 0;
+    size_t start = cursor->block * cursor->header.block_size;
+    size_t size = cursor->header.raw_size - start;
+    if (size > cursor->header.block_size) size = cursor->header.block_size;
+    if (size > dst_capacity) return 0;
+
+    uint32_t entry;
+    memcpy(&entry, cursor->src + sizeof(CompressHeader) + cursor->block * sizeof(uint32_t), sizeof(entry));
+    size_t packed = entry & ~COMPRESS_BLOCK_RAW;
+    if (cursor->offset + packed > cursor->src_size) return 0;
+    const unsigned char *in = cursor->src + cursor->offset;
+    if (entry & COMPRESS_BLOCK_RAW) {
+        if (packed != size) return 0;
+        memcpy(dst, in, size);
+    } else if (!Compress_block_decode(in, packed, dst, size)) {
+        return 0;
+    }
+    cursor->block++;
+    cursor->offset += packed;
+    return size;
+}
@@ -0,0 +1,71 @@
+//
+// compress.h - Быстрое сжатие без потерь (формат блоков LZ4) и поток из независимых блоков по 64 КБ.
+//
+// Поток: [CompressHeader][uint32_t размеры блоков][блоки]. Каждый блок сжимается отдельно,
+// поэтому большие данные распаковываются параллельно в системе задач прямо в буфер назначения.
+//
+
+#pragma once
+
+
+// Подключаем:
+#include "std.h"
+
+
+// Определения:
+#define COMPRESS_MAGIC      "ELZB"      // Сигнатура потока.
+#define COMPRESS_BLOCK_SIZE (64*1024)   // Размер несжатого блока потока.
+#define COMPRESS_BLOCK_RAW  0x80000000  // Флаг в таблице размеров: блок хранится без сжатия.
+
+
+// Объявление структур:
+typedef struct CompressHeader CompressHeader;  // Заголовок потока.
+typedef struct CompressCursor CompressCursor;  // Последовательная распаковка потока по блокам.
+
+
+// Заголовок потока (24 байта):
+struct CompressHeader {
+    char     magic[4];      // COMPRESS_MAGIC.
+    uint32_t block_size;    // Размер несжатого блока.
+    uint64_t raw_size;      // Размер несжатых данных.
+    uint32_t blocks_count;  // Количество блоков.
+    uint32_t reserved;
+};
+
+
+// Последовательная распаковка потока по блокам (для чтения без распаковки целиком):
+struct CompressCursor {
+    const unsigned char *src;  // Поток.
+    size_t src_size;           // Размер потока.
+    CompressHeader header;     // Заголовок потока.
+    size_t block;              // Индекс следующего блока.
+    size_t offset;             // Смещение данных следующего блока в потоке.
+};
+
+
+// Максимальный размер сжатого блока для size байт входных данных:
+size_t Compress_bound(size_t size);
+
+// Сжать один блок. Возвращает размер сжатых данных (0 - не влезло в dst_capacity):
+size_t Compress_block_encode(const void *src, size_t src_size, void *dst, size_t dst_capacity);
+
+// Распаковать один блок ровно в dst_size байт. Возвращает false при повреждённых данных:
+bool Compress_block_decode(const void *src, size_t src_size, void *dst, size_t dst_size);
+
+// Сжать данные в поток блоков (параллельно). Возвращает буфер mm_alloc, размер в out_size:
+unsigned char* Compress_encode(const void *src, size_t src_size, size_t *out_size);
+
+// Распаковать поток в буфер назначения (блоки распаковываются параллельно):
+bool Compress_decode(const void *src, size_t src_size, void *dst, size_t dst_size);
+
+// Является ли буфер потоком сжатых блоков:
+bool Compress_is_stream(const void *src, size_t src_size);
+
+// Получить размер несжатых данных потока (0 - не поток):
+size_t Compress_get_raw_size(const void *src, size_t src_size);
+
+// Начать последовательную распаковку потока:
+bool Compress_cursor_init(CompressCursor *cursor, const void *src, size_t src_size);
+
+// Распаковать следующий блок (dst_capacity >= block_size). Возвращает его размер (0 - конец или ошибка):
+size_t Compress_cursor_next(CompressCursor *cursor, void *dst, size_t dst_capacity);
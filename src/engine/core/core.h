@@ -15,16 +15,31 @@ extern "C" {
 // Подключаем:
 #include "std.h"
 #include "libs/tinycthread.h"
+#include "archive.h"
 #include "array.h"
+#include "asyncio.h"
+#include "atlas.h"
+#include "compress.h"
 #include "constants.h"
 #include "crash.h"
+#include "filecache.h"
 #include "files.h"
 #include "hashtable.h"
+#include "jobs.h"
 #include "math.h"
 #include "mm.h"
+#include "objfile.h"
 #include "pixmap.h"
+#include "pixops.h"
+#include "rawmesh.h"
+#include "rawtex.h"
+#include "scratch.h"
 #include "platform.h"
+#include "snapshot.h"
+#include "taskgraph.h"
+#include "texcompress.h"
 #include "time.h"
+#include "watcher.h"
 // #include "vector.h"  // Подключается в "math.h".
 
 
@@ -32,10 +47,22 @@ extern "C" {
 static inline bool core_init() {
     Time_init();
     crash_logger_init();
+    Jobs_init(0);  // По одному потоку на каждый аппаратный поток процессора.
+    AsyncIO_init(0);  // io_uring в Linux, иначе пул потоков чтения.
+    Watcher_init();   // Горячая перезагрузка ресурсов (inotify в Linux, иначе опрос).
     return true;
 }
 
 
+// Завершение работы ядра:
+static inline void core_quit() {
+    Watcher_destroy();
+    Files_unmount_all();
+    AsyncIO_destroy();
+    Jobs_destroy();
+}
+
+
 #ifdef __cplusplus
 }
 #endif
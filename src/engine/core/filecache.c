@@ -0,0 +1,136 @@
+//
+// filecache.c - Реализация общей части файловых кэшей ресурсов.
+//
+
+
+// Подключаем:
+#include "std.h"
+#include "mm.h"
+#include "files.h"
+#include "archive.h"
+#include "filecache.h"
+
+
+// Включить кэш в каталоге:
+bool FileCache_set_dir(FileCache *cache, const char *dir) {
+    mm_free(cache->dir);
+    cache->dir = NULL;
+    if (!dir || !*dir) return true;
+    if (!Files_make_dirs(dir)) {
+        fprintf(stderr, "%s_set_cache_dir: Failed to create \"%s\".\n", cache->name, dir);
+        return false;
+    }
+    size_t len = strlen(dir);
+    bool slash = dir[len - 1] == '/' || dir[len - 1] == '\\';
+    cache->dir = (char*)mm_alloc(len + 2);
+    memcpy(cache->dir, dir, len);
+    cache->dir[len] = '/';
+    cache->dir[slash ? len : len + 1] = '\0';
+    return true;
+}
+
+
+// Получить путь файла кэша:
+char* FileCache_make_path(const FileCache *cache, uint64_t path_hash, uint64_t variant) {
+    uint64_t hash = (path_hash ^ variant) * 1099511628211ull;
+    size_t size = strlen(cache->dir) + 16 + strlen(cache->extension) + 1;
+    char *path = (char*)mm_alloc(size);
+    snprintf(path, size, "%s%016llx%s", cache->dir, (unsigned long long)hash, cache->extension);
+    return path;
+}
+
+
+// Заполнить ключ источника без CRC:
+bool FileCache_source_key(const char *source_path, FileCacheKey *key) {
+    memset(key, 0, sizeof(FileCacheKey));
+    if (!source_path || Files_find_mounted(source_path, NULL)) return false;
+    if (!Files_stat(source_path, &key->source_mtime, &key->source_size)) return false;
+    key->path_hash = Archive_hash_path(source_path);
+    return true;
+}
+
+
+// Посчитать CRC32 источника:
+bool FileCache_source_crc(const char *source_path, FileCacheKey *key) {
+    FileMap *source = Files_map(source_path, FILE_MAP_SEQUENTIAL);
+    if (!source) return false;
+    key->source_crc = Archive_crc32(0, source->data, source->size);
+    bool same_size = (int64_t)source->size == key->source_size;
+    Files_unmap(&source);
+    return same_size;
+}
+
+
+// Сверить ключ из заголовка кэша с ключом источника:
+FileCacheMatch FileCache_match(const FileCacheKey *cached, FileCacheKey *key, const char *source_path) {
+    if (cached->path_hash != key->path_hash) return FILECACHE_MISS;
+    if (cached->source_mtime == key->source_mtime && cached->source_size == key->source_size) return FILECACHE_HIT;
+    if (!FileCache_source_crc(source_path, key)) return FILECACHE_MISS;
+    return cached->source_crc == key->source_crc ? FILECACHE_TOUCHED : FILECACHE_MISS;
+}
+
+
+// Записать время и размер источника в ключ заголовка файла кэша:
+void FileCache_update_key(const char *cache_path, size_t key_offset, const FileCacheKey *key) {
+    FILE *file = fopen(cache_path, "r+b");
+    if (!file) return;
+    FileCacheKey stored;
+    if (fseek(file, (long)key_offset, SEEK_SET) == 0 && fread(&stored, sizeof(stored), 1, file) == 1) {
+        stored.source_mtime = key->source_mtime;
+        stored.source_size = key->source_size;
+        fseek(file, (long)key_offset, SEEK_SET);
+        fwrite(&stored, sizeof(stored), 1, file);
+    }
+    fclose(file);
+}
+
+
+// Начать запись файла кэша:
+bool FileCache_write_begin(FileCache *cache, const char *cache_path, FileCacheWriter *writer) {
+    memset(writer, 0, sizeof(FileCacheWriter));
+    if (!cache_path) return false;
+    writer->path = mm_strdup(cache_path);
+    size_t temp_size = strlen(cache_path) + 32;
+    writer->temp_path = (char*)mm_alloc(temp_size);
+    snprintf(writer->temp_path, temp_size, "%s.%u.tmp", cache_path, atomic_fetch_add(&cache->temp_counter, 1));
+    writer->file = fopen(writer->temp_path, "wb");
+    writer->ok = writer->file != NULL;
+    return writer->ok;
+}
+
+
+// Записать данные со смещения offset:
+void FileCache_write_at(FileCacheWriter *writer, uint64_t offset, const void *data, size_t size) {
+    static const uint8_t zeros[256] = {0};
+    if (!writer->ok) return;
+    if (offset < writer->pos) {
+        writer->ok = false;
+        return;
+    }
+    while (writer->ok && writer->pos < offset) {
+        size_t pad = offset - writer->pos < sizeof(zeros) ? (size_t)(offset - writer->pos) : sizeof(zeros);
+        writer->ok = fwrite(zeros, 1, pad, writer->file) == pad;
+        writer->pos += pad;
+    }
+    if (writer->ok && size > 0) writer->ok = fwrite(data, 1, size, writer->file) == size;
+    writer->pos += size;
+}
+
+
+// Закончить запись:
+bool FileCache_write_end(FileCache *cache, FileCacheWriter *writer) {
+    bool ok = writer->ok;
+    if (writer->file) ok = (fclose(writer->file) == 0) && ok;
+    if (ok) {
+        remove(writer->path);  // В Windows rename не заменяет существующий файл.
+        ok = rename(writer->temp_path, writer->path) == 0;
+    }
+    if (!ok) {
+        fprintf(stderr, "%s: Failed to write cache \"%s\".\n", cache->name, writer->path ? writer->path : "");
+        if (writer->temp_path) remove(writer->temp_path);
+    }
+    mm_free(writer->temp_path);
+    mm_free(writer->path);
+    memset(writer, 0, sizeof(FileCacheWriter));
+    return ok;
+}
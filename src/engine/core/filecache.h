@@ -0,0 +1,85 @@
+//
+// filecache.h - Общая часть файловых кэшей ресурсов (rawtex.h, rawmesh.h).
+//
+// Каталог кэша, ключ источника и атомарная запись. Ключ лежит в заголовке файла кэша: хэш пути, время изменения,
+// размер и CRC32 файла источника. Если время изменилось, а содержимое нет (например, после checkout), кэш
+// считается действительным, а ключ в заголовке обновляется. Файл кэша пишется во временный и переименовывается,
+// чтобы читатели (и запуск после падения) никогда не видели недописанный файл.
+//
+
+#pragma once
+
+
+// Подключаем:
+#include "std.h"
+
+
+// Объявление структур:
+typedef struct FileCacheKey FileCacheKey;        // Ключ источника.
+typedef struct FileCache FileCache;              // Каталог кэша одного вида ресурсов.
+typedef struct FileCacheWriter FileCacheWriter;  // Запись файла кэша.
+
+
+// Ключ источника:
+struct FileCacheKey {
+    uint64_t path_hash;     // Хэш пути источника (Archive_hash_path).
+    int64_t  source_mtime;  // Время изменения источника (нс).
+    int64_t  source_size;   // Размер файла источника.
+    uint32_t source_crc;    // CRC32 файла источника.
+    uint32_t reserved;
+};
+
+
+// Каталог кэша одного вида ресурсов (статическая переменная модуля, настраивается при запуске):
+struct FileCache {
+    const char *name;          // Имя для сообщений об ошибках ("RawTex").
+    const char *extension;     // Расширение файлов кэша (".rawtex").
+    char *dir;                 // Каталог кэша с '/' на конце (NULL - кэш выключен).
+    atomic_uint temp_counter;  // Для уникальных имён временных файлов.
+};
+
+
+// Запись файла кэша:
+struct FileCacheWriter {
+    FILE *file;
+    char *path;       // Итоговый путь.
+    char *temp_path;  // Временный файл.
+    uint64_t pos;     // Сколько байт уже записано.
+    bool ok;
+};
+
+
+// Результат сверки кэша с источником:
+typedef enum FileCacheMatch {
+    FILECACHE_MISS,     // Источник изменился (в key - CRC32 источника, если его удалось прочитать).
+    FILECACHE_HIT,      // Время и размер совпали.
+    FILECACHE_TOUCHED,  // Время изменилось, содержимое нет - нужно FileCache_update_key.
+} FileCacheMatch;
+
+
+// Включить кэш в каталоге (NULL - выключить). Каталог создаётся:
+bool FileCache_set_dir(FileCache *cache, const char *dir);
+
+// Получить путь файла кэша (хэш пути источника смешивается с вариантом - форматом, каналами...). mm_free:
+char* FileCache_make_path(const FileCache *cache, uint64_t path_hash, uint64_t variant);
+
+// Заполнить ключ источника без CRC. false - источник не на диске (например, в смонтированном архиве):
+bool FileCache_source_key(const char *source_path, FileCacheKey *key);
+
+// Посчитать CRC32 источника в key->source_crc. false - файл не прочитан или его размер не совпал с ключом:
+bool FileCache_source_crc(const char *source_path, FileCacheKey *key);
+
+// Сверить ключ из заголовка кэша с ключом источника (CRC32 источника считается, только если время изменилось):
+FileCacheMatch FileCache_match(const FileCacheKey *cached, FileCacheKey *key, const char *source_path);
+
+// Записать время и размер источника в ключ заголовка файла кэша (key_offset - смещение ключа в заголовке):
+void FileCache_update_key(const char *cache_path, size_t key_offset, const FileCacheKey *key);
+
+// Начать запись файла кэша (во временный файл рядом с cache_path). FileCache_write_end вызывается в любом случае:
+bool FileCache_write_begin(FileCache *cache, const char *cache_path, FileCacheWriter *writer);
+
+// Записать данные со смещения offset (промежуток после записанного заполняется нулями, назад писать нельзя):
+void FileCache_write_at(FileCacheWriter *writer, uint64_t offset, const void *data, size_t size);
+
+// Закончить запись: файл переименовывается в итоговый (при ошибке - удаляется). false - кэш не записан:
+bool FileCache_write_end(FileCache *cache, FileCacheWriter *writer);
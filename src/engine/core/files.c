@@ -3,14 +3,134 @@
 //
 
 
+// Включаем POSIX функции (mmap, madvise) при строгом -std=c17:
+#if !defined(_WIN32) && !defined(_WIN64) && !defined(_DEFAULT_SOURCE)
+    #define _DEFAULT_SOURCE
+#endif
+
+
 // Подключаем:
 #include "std.h"
 #include "mm.h"
+#include "array.h"
+#include "time.h"
+#include "archive.h"
+#include "asyncio.h"
+#include "compress.h"
 #include "files.h"
 
+#if defined(_WIN32) || defined(_WIN64)
+    #include <windows.h>
+    #include <sys/stat.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+
+// Объявление структур:
+typedef struct MountPoint MountPoint;  // Смонтированный архив.
+
+
+// Смонтированный архив:
+struct MountPoint {
+    Archive *archive;   // Архив.
+    char *prefix;       // Префикс путей (точка монтирования, например "data/").
+    size_t prefix_len;  // Длина префикса.
+};
+
+
+// Смонтированные архивы (MountPoint):
+static Array *mounts = NULL;
+
+
+// Смонтировать архив ресурсов: пути вида "<mount_point><путь в архиве>" будут читаться из него
+// (verify = true - проверить контрольные суммы всех записей). Монтировать до загрузки из других потоков:
+bool Files_mount(const char* archive_path, const char* mount_point, bool verify) {
+    if (!archive_path) return false;
+    Archive *archive = Archive_open(archive_path, verify);
+    if (!archive) return false;
+
+    if (!mounts) mounts = Array_create(sizeof(MountPoint), 4);
+    MountPoint mount;
+    mount.archive = archive;
+    mount.prefix = mm_strdup(mount_point ? mount_point : "");
+    mount.prefix_len = strlen(mount.prefix);
+    for (size_t i = 0; i < mount.prefix_len; i++) if (mount.prefix[i] == '\\') mount.prefix[i] = '/';
+    Array_push(mounts, &mount);
+    return true;
+}
+
+
+// Размонтировать все архивы ресурсов:
+void Files_unmount_all() {
+    for (size_t i = 0; i < Array_len(mounts); i++) {
+        MountPoint *mount = (MountPoint*)Array_get(mounts, i);
+        Archive_close(&mount->archive);
+        mm_free(mount->prefix);
+    }
+    Array_destroy(&mounts);
+}
+
+
+// Найти запись файла в смонтированных архивах (NULL - не найдена):
+static const ArchiveEntry* find_mounted_entry(const char* file_path, Archive** out_archive) {
+    if (!file_path || Array_len(mounts) == 0) return NULL;
+    while (file_path[0] == '.' && (file_path[1] == '/' || file_path[1] == '\\')) file_path += 2;
+
+    // Последний смонтированный архив имеет приоритет:
+    for (size_t i = Array_len(mounts); i-- > 0;) {
+        MountPoint *mount = (MountPoint*)Array_get(mounts, i);
+        bool match = true;
+        for (size_t k = 0; k < mount->prefix_len && match; k++) {
+            char c = file_path[k] == '\\' ? '/' : file_path[k];
+            match = c == mount->prefix[k];
+        }
+        if (!match) continue;
+        const ArchiveEntry *entry = Archive_find(mount->archive, file_path + mount->prefix_len);
+        if (!entry) continue;
+        *out_archive = mount->archive;
+        return entry;
+    }
+    return NULL;
+}
+
+
+// Распаковать запись смонтированного архива в новый буфер (+1 байт под '\0'):
+static unsigned char* read_mounted_entry(Archive* archive, const ArchiveEntry* entry, size_t* out_size) {
+    size_t size = Archive_get_size(archive, entry);
+    unsigned char* buffer = (unsigned char*)mm_alloc(size + 1);
+    if (!Archive_read(archive, entry, buffer, size)) {
+        mm_free(buffer);
+        return NULL;
+    }
+    buffer[size] = '\0';
+    if (out_size) *out_size = size;
+    return buffer;
+}
+
+
+// Найти несжатый файл в смонтированных архивах (NULL - не найден или сжат, тогда читать через Files_load_bin).
+// Данные действительны до Files_unmount_all:
+const unsigned char* Files_find_mounted(const char* file_path, size_t* out_size) {
+    if (out_size) *out_size = 0;
+    Archive *archive = NULL;
+    const ArchiveEntry *entry = find_mounted_entry(file_path, &archive);
+    if (!entry || (entry->flags & ARCHIVE_ENTRY_COMPRESSED)) return NULL;
+    if (out_size) *out_size = (size_t)entry->size;
+    return Archive_get_data(archive, entry);
+}
+
 
 // Загружаем файл в строку:
 char* Files_load(const char* file_path, const char* mode) {
+    // Файл из смонтированного архива:
+    Archive* archive = NULL;
+    const ArchiveEntry* entry = find_mounted_entry(file_path, &archive);
+    if (entry) return (char*)read_mounted_entry(archive, entry, NULL);
+
     FILE* f = fopen(file_path, mode);
     if (!f) return NULL;
 
@@ -48,6 +168,11 @@ bool Files_save(const char* file_path, const char* data, const char* mode) {
 
 // Загружаем файл в буфер бинарно:
 unsigned char* Files_load_bin(const char* file_path, const char* mode, size_t* out_size) {
+    // Файл из смонтированного архива (сжатая запись распаковывается параллельно):
+    Archive* archive = NULL;
+    const ArchiveEntry* entry = find_mounted_entry(file_path, &archive);
+    if (entry) return read_mounted_entry(archive, entry, out_size);
+
     FILE* f = fopen(file_path, mode);
     if (!f) return NULL;
 
@@ -69,6 +194,53 @@ unsigned char* Files_load_bin(const char* file_path, const char* mode, size_t* o
 }
 
 
+// Получить время изменения (нс) и размер файла на диске (false - файла нет):
+bool Files_stat(const char* file_path, int64_t* out_mtime, int64_t* out_size) {
+    if (!file_path) return false;
+    int64_t mtime;
+    #if defined(_WIN32) || defined(_WIN64)
+        struct _stat64 st;
+        if (_stat64(file_path, &st) != 0) return false;
+        mtime = (int64_t)st.st_mtime * 1000000000;
+    #else
+        struct stat st;
+        if (stat(file_path, &st) != 0) return false;
+        #if defined(__APPLE__)
+            mtime = (int64_t)st.st_mtimespec.tv_sec * 1000000000 + st.st_mtimespec.tv_nsec;
+        #else
+            mtime = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+        #endif
+    #endif
+    if (out_mtime) *out_mtime = mtime;
+    if (out_size) *out_size = (int64_t)st.st_size;
+    return true;
+}
+
+
+// Создать каталог вместе с недостающими родительскими:
+bool Files_make_dirs(const char* dir_path) {
+    if (!dir_path || !*dir_path) return false;
+    char *path = mm_strdup(dir_path);
+    bool ok = true;
+    for (char *c = path + 1; ok; c++) {
+        bool end = *c == '\0';
+        if (!end && *c != '/' && *c != '\\') continue;
+        char saved = *c;
+        *c = '\0';
+        #if defined(_WIN32) || defined(_WIN64)
+            bool made = CreateDirectoryA(path, NULL) || GetLastError() == ERROR_ALREADY_EXISTS;
+        #else
+            bool made = mkdir(path, 0755) == 0 || errno == EEXIST;
+        #endif
+        if (!made && end) ok = false;  // Промежуточные ошибки (например, нет прав на корень) не важны, если итог есть.
+        *c = saved;
+        if (end) break;
+    }
+    mm_free(path);
+    return ok;
+}
+
+
 // Сохраняем буфер в файл бинарно:
 bool Files_save_bin(const char* file_path, const void* data, size_t size, const char* mode) {
     FILE* f = fopen(file_path, mode);
@@ -78,3 +250,368 @@ bool Files_save_bin(const char* file_path, const void* data, size_t size, const
     fclose(f);
     return true;
 }
+
+
+// Отобразить файл в память только для чтения (без копирования в буфер, как в Files_load):
+FileMap* Files_map(const char* file_path, FileMapAccess access) {
+    if (!file_path) return NULL;
+    FileMap *map = (FileMap*)mm_calloc(1, sizeof(FileMap));
+
+    // Файл из смонтированного архива (данные записи выровнены по странице, поэтому подсказки тоже работают):
+    size_t mounted_size = 0;
+    const unsigned char* mounted = Files_find_mounted(file_path, &mounted_size);
+    if (mounted) {
+        map->data = mounted;
+        map->size = mounted_size;
+        map->borrowed = true;
+        if (mounted_size > 0) {
+            map->mapped = true;
+            map->base = (void*)mounted;
+            map->base_size = mounted_size;
+            Files_map_advise(map, access);
+        }
+        return map;
+    }
+
+    // Сжатая запись смонтированного архива - распаковываем в собственный буфер:
+    Archive* archive = NULL;
+    const ArchiveEntry* entry = find_mounted_entry(file_path, &archive);
+    if (entry) {
+        unsigned char* buffer = read_mounted_entry(archive, entry, &map->size);
+        if (!buffer) {
+            mm_free(map);
+            return NULL;
+        }
+        map->base = buffer;
+        map->data = buffer;
+        return map;
+    }
+
+    #if defined(_WIN32) || defined(_WIN64)
+        HANDLE file = CreateFileA(file_path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+            access == FILE_MAP_SEQUENTIAL ? FILE_FLAG_SEQUENTIAL_SCAN :
+            access == FILE_MAP_RANDOM ? FILE_FLAG_RANDOM_ACCESS : FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) {
+            mm_free(map);
+            return NULL;
+        }
+        LARGE_INTEGER size;
+        GetFileSizeEx(file, &size);
+        map->size = (size_t)size.QuadPart;
+        map->file = file;
+
+        // Пустой файл отобразить нельзя:
+        if (map->size > 0) {
+            HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            void *view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+            if (!view) {
+                if (mapping) CloseHandle(mapping);
+                CloseHandle(file);
+                mm_free(map);
+                return NULL;
+            }
+            map->mapping = mapping;
+            map->base = view;
+            map->base_size = map->size;
+            map->data = (const unsigned char*)view;
+            map->mapped = true;
+        }
+    #else
+        int fd = open(file_path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            mm_free(map);
+            return NULL;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            mm_free(map);
+            return NULL;
+        }
+        map->size = (size_t)st.st_size;
+
+        // Пустой файл отобразить нельзя:
+        if (map->size > 0) {
+            void *view = mmap(NULL, map->size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (view != MAP_FAILED) {
+                map->base = view;
+                map->base_size = map->size;
+                map->data = (const unsigned char*)view;
+                map->mapped = true;
+                Files_map_advise(map, access);
+            } else {
+                // Отображение недоступно (например специальный файл) - читаем в память:
+                unsigned char *buffer = (unsigned char*)mm_alloc(map->size);
+                size_t done = 0;
+                while (done < map->size) {
+                    ssize_t n = pread(fd, buffer + done, map->size - done, (off_t)done);
+                    if (n < 0 && errno == EINTR) continue;
+                    if (n <= 0) break;
+                    done += (size_t)n;
+                }
+                map->base = buffer;
+                map->size = done;
+                map->data = buffer;
+            }
+        }
+        close(fd);  // Отображение остаётся действительным после закрытия файла.
+    #endif
+
+    if (!map->data) map->data = (const unsigned char*)"";
+    return map;
+}
+
+
+// Сменить подсказку доступа к отображению:
+void Files_map_advise(FileMap* map, FileMapAccess access) {
+    if (!map || !map->mapped) return;
+    #if !defined(_WIN32) && !defined(_WIN64)
+        int advice = MADV_NORMAL;
+        if (access == FILE_MAP_SEQUENTIAL) advice = MADV_SEQUENTIAL;
+        else if (access == FILE_MAP_RANDOM) advice = MADV_RANDOM;
+        madvise(map->base, map->base_size, advice);
+    #else
+        (void)access;  // В Windows подсказка задаётся при открытии файла.
+    #endif
+}
+
+
+// Закрыть отображение файла:
+void Files_unmap(FileMap** map) {
+    if (!map || !*map) return;
+    FileMap *m = *map;
+    if (m->borrowed) {
+        mm_free(m);
+        *map = NULL;
+        return;
+    }
+    #if defined(_WIN32) || defined(_WIN64)
+        if (m->mapped) UnmapViewOfFile(m->base);
+        else if (m->base) mm_free(m->base);
+        if (m->mapping) CloseHandle((HANDLE)m->mapping);
+        if (m->file) CloseHandle((HANDLE)m->file);
+    #else
+        if (m->mapped) munmap(m->base, m->base_size);
+        else if (m->base) mm_free(m->base);
+    #endif
+    mm_free(m);
+    *map = NULL;
+}
+
+
+// Отправить чтение следующего куска с диска в свободный буфер:
+static void stream_prefetch(FileStream* stream) {
+    if (stream->file_offset >= stream->size) return;
+    AsyncIO_Read read = {0};
+    read.path = stream->path;
+    read.buffer = stream->buffers[stream->next_buffer];
+    read.capacity = stream->chunk_size;
+    read.offset = stream->file_offset;
+    read.size = stream->chunk_size;
+    stream->prefetch = AsyncIO_read(&read);
+}
+
+
+// Перейти к следующему куску. Возвращает false в конце файла:
+static bool stream_next_chunk(FileStream* stream) {
+    stream->data = NULL;
+    stream->len = 0;
+    stream->pos = 0;
+
+    // Несжатая запись архива - кусок прямо в отображении:
+    if (stream->mapped) {
+        size_t offset = stream->consumed;
+        if (offset >= stream->size) return false;
+        stream->data = (char*)stream->mapped + offset;
+        stream->len = stream->size - offset < stream->chunk_size ? stream->size - offset : stream->chunk_size;
+        stream->writable = false;
+        stream->chunks++;
+        return true;
+    }
+
+    // Сжатая запись архива - распаковываем блоки до заполнения куска:
+    if (stream->compressed) {
+        char* dst = stream->buffers[0];
+        size_t block_size = stream->cursor.header.block_size;
+        while (stream->len + block_size <= stream->chunk_size) {
+            size_t n = Compress_cursor_next(&stream->cursor, dst + stream->len, stream->chunk_size - stream->len);
+            if (n == 0) break;
+            stream->len += n;
+        }
+        if (stream->len == 0) return false;
+        stream->data = dst;
+        stream->writable = true;
+        stream->chunks++;
+        return true;
+    }
+
+    // Файл с диска - ждём уже отправленное чтение и сразу отправляем следующее:
+    if (!stream->prefetch) return false;
+    double start = Time_now(NULL);
+    bool ok = AsyncIO_wait(stream->prefetch);
+    stream->wait_time += Time_now(NULL) - start;
+    size_t read_size = ok ? stream->prefetch->read_size : 0;
+    AsyncIO_release(&stream->prefetch);
+    if (read_size == 0) return false;
+
+    stream->data = stream->buffers[stream->next_buffer];
+    stream->len = read_size;
+    stream->writable = true;
+    stream->chunks++;
+    stream->file_offset += read_size;
+    stream->next_buffer ^= 1;
+    stream_prefetch(stream);
+    return true;
+}
+
+
+// Открыть файл для потокового чтения (chunk_size = 0 - FILE_STREAM_CHUNK_SIZE). Файл ищется и в смонтированных архивах:
+FileStream* FileStream_open(const char* file_path, size_t chunk_size) {
+    if (!file_path) return NULL;
+    if (chunk_size == 0) chunk_size = FILE_STREAM_CHUNK_SIZE;
+    chunk_size = AsyncIO_align_size(chunk_size);
+    if (chunk_size < COMPRESS_BLOCK_SIZE) chunk_size = COMPRESS_BLOCK_SIZE;
+
+    FileStream* stream = (FileStream*)mm_calloc(1, sizeof(FileStream));
+    stream->chunk_size = chunk_size;
+    stream->open_time = Time_now(NULL);
+
+    // Запись смонтированного архива:
+    Archive* archive = NULL;
+    const ArchiveEntry* entry = find_mounted_entry(file_path, &archive);
+    if (entry) {
+        stream->size = Archive_get_size(archive, entry);
+        if (entry->flags & ARCHIVE_ENTRY_COMPRESSED) {
+            stream->compressed = true;
+            stream->buffers[0] = (char*)mm_alloc(chunk_size);
+            if (!Compress_cursor_init(&stream->cursor, Archive_get_data(archive, entry), (size_t)entry->size)) {
+                FileStream_close(&stream);
+                return NULL;
+            }
+        } else {
+            stream->mapped = Archive_get_data(archive, entry);
+        }
+        return stream;
+    }
+
+    // Файл с диска:
+    #if defined(_WIN32) || defined(_WIN64)
+        struct _stat64 st;
+        if (_stat64(file_path, &st) != 0) {
+    #else
+        struct stat st;
+        if (stat(file_path, &st) != 0 || !S_ISREG(st.st_mode)) {
+    #endif
+        mm_free(stream);
+        return NULL;
+    }
+    stream->size = (size_t)st.st_size;
+    stream->path = mm_strdup(file_path);
+    stream->buffers[0] = (char*)AsyncIO_alloc_aligned(chunk_size);
+    stream->buffers[1] = (char*)AsyncIO_alloc_aligned(chunk_size);
+    stream_prefetch(stream);
+    return stream;
+}
+
+
+// Закрыть потоковое чтение:
+void FileStream_close(FileStream** stream) {
+    if (!stream || !*stream) return;
+    FileStream* s = *stream;
+    if (s->prefetch) {
+        AsyncIO_wait(s->prefetch);  // Нельзя освобождать буфер, пока в него читают.
+        AsyncIO_release(&s->prefetch);
+    }
+    if (s->path) {
+        AsyncIO_free_aligned(s->buffers[0]);
+        AsyncIO_free_aligned(s->buffers[1]);
+        mm_free(s->path);
+    } else if (s->buffers[0]) {
+        mm_free(s->buffers[0]);
+    }
+    if (s->line) mm_free(s->line);
+    mm_free(s);
+    *stream = NULL;
+}
+
+
+// Прочитать до size байт. Возвращает сколько прочитано (меньше size - конец файла):
+size_t FileStream_read(FileStream* stream, void* dst, size_t size) {
+    if (!stream || !dst) return 0;
+    size_t done = 0;
+    while (done < size) {
+        if (stream->pos >= stream->len && !stream_next_chunk(stream)) break;
+        size_t n = stream->len - stream->pos;
+        if (n > size - done) n = size - done;
+        memcpy((char*)dst + done, stream->data + stream->pos, n);
+        stream->pos += n;
+        stream->consumed += n;
+        done += n;
+    }
+    return done;
+}
+
+
+// Прочитать строку (без '\n' и '\r\n', завершена '\0'). NULL - конец файла.
+// Строку можно менять, она действительна до следующего чтения:
+char* FileStream_read_line(FileStream* stream, size_t* out_len) {
+    if (out_len) *out_len = 0;
+    if (!stream) return NULL;
+    size_t len = 0;
+    bool found = false;  // Прочитан хотя бы один символ или перевод строки.
+
+    for (;;) {
+        if (stream->pos >= stream->len && !stream_next_chunk(stream)) break;
+        char* start = stream->data + stream->pos;
+        size_t available = stream->len - stream->pos;
+        char* newline = (char*)memchr(start, '\n', available);
+        size_t n = newline ? (size_t)(newline - start) : available;
+        size_t step = newline ? n + 1 : n;
+        stream->pos += step;
+        stream->consumed += step;
+        found = true;
+
+        // Строка целиком в изменяемом куске - отдаём без копирования:
+        if (newline && len == 0 && stream->writable) {
+            if (n > 0 && start[n - 1] == '\r') n--;
+            start[n] = '\0';
+            if (out_len) *out_len = n;
+            return start;
+        }
+
+        // Иначе собираем строку в буфере (разрыв на границе куска или данные только для чтения):
+        if (len + n + 1 > stream->line_capacity) {
+            size_t capacity = stream->line_capacity ? stream->line_capacity : 256;
+            while (capacity < len + n + 1) capacity *= 2;
+            stream->line = (char*)mm_realloc(stream->line, capacity);
+            stream->line_capacity = capacity;
+        }
+        memcpy(stream->line + len, start, n);
+        len += n;
+        if (newline) break;
+    }
+    if (!found) return NULL;
+    if (len > 0 && stream->line[len - 1] == '\r') len--;
+    stream->line[len] = '\0';
+    if (out_len) *out_len = len;
+    return stream->line;
+}
+
+
+// Дочитан ли файл до конца:
+bool FileStream_eof(FileStream* stream) {
+    return !stream || stream->consumed >= stream->size;
+}
+
+
+// Получить статистику чтения:
+void FileStream_get_stats(FileStream* stream, FileStreamStats* out_stats) {
+    if (!out_stats) return;
+    memset(out_stats, 0, sizeof(FileStreamStats));
+    if (!stream) return;
+    out_stats->bytes = stream->consumed;
+    out_stats->chunks = stream->chunks;
+    out_stats->elapsed = Time_now(NULL) - stream->open_time;
+    out_stats->wait_time = stream->wait_time;
+    out_stats->bytes_per_sec = out_stats->elapsed > 0.0 ? (double)stream->consumed / out_stats->elapsed : 0.0;
+}
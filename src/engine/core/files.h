@@ -7,8 +7,99 @@
 
 // Подключаем:
 #include "std.h"
+#include "compress.h"
 
 
+// Определения:
+#define FILE_STREAM_CHUNK_SIZE (1024 * 1024)  // Размер куска потокового чтения по умолчанию.
+
+
+// Как будут читаться отображённые в память данные (подсказка ОС для подкачки страниц):
+typedef enum FileMapAccess {
+    FILE_MAP_NORMAL,      // Без подсказки.
+    FILE_MAP_SEQUENTIAL,  // Последовательное чтение (агрессивное чтение наперёд).
+    FILE_MAP_RANDOM,      // Произвольный доступ (без чтения наперёд).
+} FileMapAccess;
+
+
+// Объявление структур:
+typedef struct FileMap FileMap;                  // Отображение файла в память (только чтение).
+typedef struct FileStream FileStream;            // Потоковое чтение файла кусками.
+typedef struct FileStreamStats FileStreamStats;  // Статистика потокового чтения.
+typedef struct AsyncIO_Request AsyncIO_Request;  // Запрос асинхронного чтения (asyncio.h).
+
+
+// Отображение файла в память (только чтение):
+struct FileMap {
+    const unsigned char *data;  // Данные файла.
+    size_t size;                // Размер данных в байтах.
+    bool mapped;                // Данные отображены (false - скопированы в память, если отображение недоступно).
+    bool borrowed;              // Данные принадлежат смонтированному архиву (Files_mount).
+    void *base;                 // Начало отображения (для Files_unmap).
+    size_t base_size;           // Размер отображения.
+    #if defined(_WIN32) || defined(_WIN64)
+        void *file;             // HANDLE файла.
+        void *mapping;          // HANDLE отображения.
+    #endif
+};
+
+
+// Потоковое чтение файла кусками (двойной буфер: пока читатель разбирает один кусок, следующий уже читается).
+// Файл с диска читается через AsyncIO выровненными кусками, несжатая запись архива - прямо из отображения,
+// сжатая - распаковывается по блокам по мере чтения:
+struct FileStream {
+    size_t size;                // Размер данных файла.
+    size_t consumed;            // Сколько байт уже отдано читателю.
+    size_t chunk_size;          // Размер куска.
+    char *data;                 // Текущий кусок.
+    size_t len;                 // Размер текущего куска.
+    size_t pos;                 // Позиция чтения в текущем куске.
+    bool writable;              // Текущий кусок можно менять (строки завершаются '\0' на месте).
+
+    // Чтение с диска:
+    char *path;                 // Путь до файла (NULL - запись архива).
+    char *buffers[2];           // Двойной буфер кусков (выровнен по ASYNCIO_ALIGNMENT).
+    int next_buffer;            // В какой буфер читается следующий кусок.
+    size_t file_offset;         // Смещение следующего куска в файле.
+    AsyncIO_Request *prefetch;  // Чтение следующего куска в полёте.
+
+    // Чтение записи архива:
+    const unsigned char *mapped;  // Несжатые данные записи (в отображении архива).
+    bool compressed;              // Запись сжата.
+    CompressCursor cursor;        // Распаковка сжатой записи по блокам.
+
+    // Строки, разорванные границей куска:
+    char *line;                 // Буфер строки.
+    size_t line_capacity;       // Вместимость буфера строки.
+
+    // Статистика:
+    double open_time;           // Время открытия (сек).
+    double wait_time;           // Сколько читатель ждал данные (сек).
+    uint64_t chunks;            // Сколько кусков прочитано.
+};
+
+
+// Статистика потокового чтения:
+struct FileStreamStats {
+    uint64_t bytes;             // Сколько байт отдано читателю.
+    uint64_t chunks;            // Сколько кусков прочитано.
+    double elapsed;             // Время с открытия (сек).
+    double wait_time;           // Сколько читатель ждал данные (сек).
+    double bytes_per_sec;       // Скорость чтения (байт/сек за elapsed).
+};
+
+
+// Смонтировать архив ресурсов: пути вида "<mount_point><путь в архиве>" будут читаться из него
+// (verify = true - проверить контрольные суммы всех записей). Монтировать до загрузки из других потоков:
+bool Files_mount(const char* archive_path, const char* mount_point, bool verify);
+
+// Размонтировать все архивы ресурсов:
+void Files_unmount_all();
+
+// Найти несжатый файл в смонтированных архивах (NULL - не найден или сжат, тогда читать через Files_load_bin).
+// Данные действительны до Files_unmount_all:
+const unsigned char* Files_find_mounted(const char* file_path, size_t* out_size);
+
 // Загружаем файл в строку:
 char* Files_load(const char* file_path, const char* mode);
 
@@ -20,3 +111,37 @@ unsigned char* Files_load_bin(const char* file_path, const char* mode, size_t* o
 
 // Сохраняем буфер в файл бинарно:
 bool Files_save_bin(const char* file_path, const void* data, size_t size, const char* mode);
+
+// Получить время изменения (нс) и размер файла на диске (false - файла нет; архивы не учитываются):
+bool Files_stat(const char* file_path, int64_t* out_mtime, int64_t* out_size);
+
+// Создать каталог вместе с недостающими родительскими:
+bool Files_make_dirs(const char* dir_path);
+
+// Отобразить файл в память только для чтения (без копирования в буфер, как в Files_load):
+FileMap* Files_map(const char* file_path, FileMapAccess access);
+
+// Сменить подсказку доступа к отображению:
+void Files_map_advise(FileMap* map, FileMapAccess access);
+
+// Закрыть отображение файла:
+void Files_unmap(FileMap** map);
+
+// Открыть файл для потокового чтения (chunk_size = 0 - FILE_STREAM_CHUNK_SIZE). Файл ищется и в смонтированных архивах:
+FileStream* FileStream_open(const char* file_path, size_t chunk_size);
+
+// Закрыть потоковое чтение:
+void FileStream_close(FileStream** stream);
+
+// Прочитать до size байт. Возвращает сколько прочитано (меньше size - конец файла):
+size_t FileStream_read(FileStream* stream, void* dst, size_t size);
+
+// Прочитать строку (без '\n' и '\r\n', завершена '\0'). NULL - конец файла.
+// Строку можно менять, она действительна до следующего чтения:
+char* FileStream_read_line(FileStream* stream, size_t* out_len);
+
+// Дочитан ли файл до конца:
+bool FileStream_eof(FileStream* stream);
+
+// Получить статистику чтения:
+void FileStream_get_stats(FileStream* stream, FileStreamStats* out_stats);
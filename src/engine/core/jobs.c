@@ -0,0 +1,429 @@
+//
+// jobs.c - Реализация системы задач на основе work-stealing дек (Chase-Lev).
+//
+// У каждого потока системы есть своя дека задач: владелец кладёт и берёт задачи
+// с нижнего конца (LIFO), а свободные потоки воруют задачи с верхнего (FIFO).
+// Поток, вызвавший Jobs_init, считается потоком с индексом 0 и выполняет задачи
+// только во время Jobs_wait. Сторонние потоки кладут задачи в общую очередь.
+//
+
+
+// Подключаем:
+#include "libs/tinycthread.h"
+#include "std.h"
+#include "mm.h"
+#include "array.h"
+#include "jobs.h"
+
+#if defined(_WIN32) || defined(_WIN64)
+    #include <windows.h>
+#else
+    #include <unistd.h>
+#endif
+
+
+// Определения:
+#define JOBS_DEQUE_MASK  (JOBS_DEQUE_CAPACITY - 1)
+#define JOBS_SPIN_COUNT  64  // Сколько раз воркер ищет задачу перед тем как уснуть.
+#define JOBS_BATCH_SPLIT 4   // На сколько кусков делить работу на каждый поток в Jobs_parallel_for.
+
+
+// Объявление структур:
+typedef struct Job Job;            // Задача.
+typedef struct JobDeque JobDeque;  // Дека задач потока.
+typedef struct JobRange JobRange;  // Кусок диапазона для Jobs_parallel_for.
+
+
+// Задача:
+struct Job {
+    JobFunc func;         // Функция задачи.
+    void *data;           // Данные задачи.
+    JobCounter *counter;  // Счётчик группы (может быть NULL).
+};
+
+
+// Дека задач потока (top и bottom разнесены по разным кэш-линиям):
+struct JobDeque {
+    _Atomic int64_t top;     // Верх деки (отсюда воруют другие потоки).
+    char _pad0_[64 - sizeof(int64_t)];
+    _Atomic int64_t bottom;  // Низ деки (сюда кладёт и отсюда берёт владелец).
+    char _pad1_[64 - sizeof(int64_t)];
+    _Atomic(Job*) buffer[JOBS_DEQUE_CAPACITY];  // Кольцевой буфер задач.
+};
+
+
+// Кусок диапазона для Jobs_parallel_for:
+struct JobRange {
+    size_t start;
+    size_t end;
+    JobRangeFunc func;
+    void *data;
+};
+
+
+// Глобальное состояние системы задач:
+static struct {
+    bool initialized;
+    atomic_bool running;
+    int threads_count;                    // Количество потоков (включая поток Jobs_init).
+    thrd_t threads[JOBS_MAX_THREADS];     // Потоки воркеров (индекс 0 не используется).
+    JobDeque *deques[JOBS_MAX_THREADS];   // Деки задач потоков.
+    Array *global;                        // Общая очередь задач от сторонних потоков.
+    atomic_int global_len;                // Длина общей очереди (для проверки без блокировки).
+    mtx_t global_lock;                    // Блокировка общей очереди.
+    mtx_t sleep_lock;                     // Блокировка сна воркеров.
+    cnd_t sleep_cond;                     // Условие пробуждения воркеров.
+    atomic_int sleeping;                  // Сколько воркеров сейчас спит.
+    atomic_int queued;                    // Сколько задач лежит в очередях и ещё не взято.
+} jobs = {0};
+
+static _Thread_local int jobs_thread_index = -1;   // Индекс текущего потока в системе задач.
+static _Thread_local uint32_t jobs_rand_state = 0;  // Состояние генератора для выбора жертвы кражи.
+
+
+// Положить задачу в низ деки (только владелец). Возвращает false, если дека заполнена:
+static bool Deque_push(JobDeque *dq, Job *job) {
+    int64_t b = atomic_load_explicit(&dq->bottom, memory_order_relaxed);
+    int64_t t = atomic_load_explicit(&dq->top, memory_order_acquire);
+    if (b - t >= JOBS_DEQUE_CAPACITY) return false;
+    atomic_store_explicit(&dq->buffer[b & JOBS_DEQUE_MASK], job, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&dq->bottom, b + 1, memory_order_relaxed);
+    return true;
+}
+
+
+// Взять задачу с низа деки (только владелец):
+static Job* Deque_take(JobDeque *dq) {
+    int64_t b = atomic_load_explicit(&dq->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&dq->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t t = atomic_load_explicit(&dq->top, memory_order_relaxed);
+
+    // Дека пуста:
+    if (t > b) {
+        atomic_store_explicit(&dq->bottom, b + 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    Job *job = atomic_load_explicit(&dq->buffer[b & JOBS_DEQUE_MASK], memory_order_relaxed);
+    if (t == b) {  // Последняя задача - соревнуемся с ворами:
+        if (!atomic_compare_exchange_strong_explicit(
+                &dq->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed)) {
+            job = NULL;  // Задачу украли.
+        }
+        atomic_store_explicit(&dq->bottom, b + 1, memory_order_relaxed);
+    }
+    return job;
+}
+
+
+// Украсть задачу с верха деки (любой поток):
+static Job* Deque_steal(JobDeque *dq) {
+    int64_t t = atomic_load_explicit(&dq->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t b = atomic_load_explicit(&dq->bottom, memory_order_acquire);
+    if (t >= b) return NULL;
+
+    Job *job = atomic_load_explicit(&dq->buffer[t & JOBS_DEQUE_MASK], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(
+            &dq->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed)) {
+        return NULL;  // Проиграли гонку другому потоку.
+    }
+    return job;
+}
+
+
+// Быстрый генератор случайных чисел (xorshift32) для выбора жертвы кражи:
+static inline uint32_t next_rand() {
+    uint32_t x = jobs_rand_state ? jobs_rand_state : (uint32_t)(jobs_thread_index + 2) * 2654435761u;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    jobs_rand_state = x;
+    return x;
+}
+
+
+// Разбудить один спящий воркер:
+static inline void wake_workers() {
+    if (atomic_load(&jobs.sleeping) <= 0) return;
+    mtx_lock(&jobs.sleep_lock);
+    cnd_signal(&jobs.sleep_cond);
+    mtx_unlock(&jobs.sleep_lock);
+}
+
+
+// Найти задачу: своя дека -> общая очередь -> кража у других потоков:
+static Job* find_job(int index) {
+    Job *job = NULL;
+
+    // Своя дека:
+    if (index >= 0) job = Deque_take(jobs.deques[index]);
+
+    // Общая очередь:
+    if (!job && atomic_load(&jobs.global_len) > 0) {
+        mtx_lock(&jobs.global_lock);
+        if (Array_len(jobs.global) > 0) {
+            Array_pop(jobs.global, &job);
+            atomic_fetch_sub(&jobs.global_len, 1);
+        }
+        mtx_unlock(&jobs.global_lock);
+    }
+
+    // Воруем у других потоков, начиная со случайного:
+    if (!job) {
+        int count = jobs.threads_count;
+        int start = (int)(next_rand() % (uint32_t)count);
+        for (int i = 0; i < count && !job; i++) {
+            int victim = (start + i) % count;
+            if (victim == index) continue;
+            job = Deque_steal(jobs.deques[victim]);
+        }
+    }
+
+    if (job) atomic_fetch_sub(&jobs.queued, 1);
+    return job;
+}
+
+
+// Выполнить задачу и освободить её:
+static inline void execute_job(Job *job) {
+    job->func(job->data);
+    if (job->counter) atomic_fetch_sub_explicit(&job->counter->pending, 1, memory_order_release);
+    mm_free(job);
+}
+
+
+// Цикл воркера:
+static int worker_main(void *arg) {
+    int index = (int)(intptr_t)arg;
+    jobs_thread_index = index;
+    int spins = 0;
+
+    while (atomic_load(&jobs.running)) {
+        Job *job = find_job(index);
+        if (job) {
+            execute_job(job);
+            spins = 0;
+            continue;
+        }
+
+        // Немного покрутимся, прежде чем уснуть:
+        if (++spins < JOBS_SPIN_COUNT) {
+            thrd_yield();
+            continue;
+        }
+
+        // Засыпаем до появления новых задач:
+        mtx_lock(&jobs.sleep_lock);
+        atomic_fetch_add(&jobs.sleeping, 1);
+        while (atomic_load(&jobs.running) && atomic_load(&jobs.queued) <= 0) {
+            cnd_wait(&jobs.sleep_cond, &jobs.sleep_lock);
+        }
+        atomic_fetch_sub(&jobs.sleeping, 1);
+        mtx_unlock(&jobs.sleep_lock);
+        spins = 0;
+    }
+    return 0;
+}
+
+
+// Выполнить кусок диапазона:
+static void range_job(void *data) {
+    JobRange *range = (JobRange*)data;
+    range->func(range->start, range->end, range->data);
+}
+
+
+// Инициализация системы задач (threads_count <= 0 - по количеству аппаратных потоков):
+bool Jobs_init(int threads_count) {
+    if (jobs.initialized) return true;
+
+    if (threads_count <= 0) threads_count = Jobs_get_hardware_threads();
+    if (threads_count > JOBS_MAX_THREADS) threads_count = JOBS_MAX_THREADS;
+    if (threads_count < 1) threads_count = 1;
+
+    // Создаём деки и общую очередь:
+    for (int i = 0; i < threads_count; i++) {
+        jobs.deques[i] = (JobDeque*)mm_calloc(1, sizeof(JobDeque));
+    }
+    jobs.global = Array_create(sizeof(Job*), 256);
+    mtx_init(&jobs.global_lock, mtx_plain);
+    mtx_init(&jobs.sleep_lock, mtx_plain);
+    cnd_init(&jobs.sleep_cond);
+    atomic_store(&jobs.global_len, 0);
+    atomic_store(&jobs.sleeping, 0);
+    atomic_store(&jobs.queued, 0);
+    atomic_store(&jobs.running, true);
+
+    // Текущий поток становится потоком с индексом 0:
+    jobs_thread_index = 0;
+    jobs.threads_count = threads_count;
+    jobs.initialized = true;
+
+    // Запускаем воркеры:
+    for (int i = 1; i < threads_count; i++) {
+        if (thrd_create(&jobs.threads[i], worker_main, (void*)(intptr_t)i) != thrd_success) {
+            fprintf(stderr, "Jobs_init: Failed to create worker thread %d.\n", i);
+            // Оставляем только успешно запущенные воркеры:
+            for (int j = i; j < threads_count; j++) {
+                mm_free(jobs.deques[j]);
+                jobs.deques[j] = NULL;
+            }
+            jobs.threads_count = i;
+            break;
+        }
+    }
+    return true;
+}
+
+
+// Уничтожение системы задач (дожидается завершения воркеров):
+void Jobs_destroy() {
+    if (!jobs.initialized) return;
+
+    // Останавливаем и дожидаемся воркеров:
+    atomic_store(&jobs.running, false);
+    mtx_lock(&jobs.sleep_lock);
+    cnd_broadcast(&jobs.sleep_cond);
+    mtx_unlock(&jobs.sleep_lock);
+    for (int i = 1; i < jobs.threads_count; i++) thrd_join(jobs.threads[i], NULL);
+
+    // Выполняем оставшиеся задачи, чтобы никто не ждал их вечно:
+    Job *job;
+    while ((job = find_job(jobs_thread_index)) != NULL) execute_job(job);
+
+    // Освобождаем ресурсы:
+    for (int i = 0; i < jobs.threads_count; i++) {
+        mm_free(jobs.deques[i]);
+        jobs.deques[i] = NULL;
+    }
+    Array_destroy(&jobs.global);
+    mtx_destroy(&jobs.global_lock);
+    mtx_destroy(&jobs.sleep_lock);
+    cnd_destroy(&jobs.sleep_cond);
+    jobs.threads_count = 0;
+    jobs.initialized = false;
+    jobs_thread_index = -1;
+}
+
+
+// Инициализирована ли система задач:
+bool Jobs_is_initialized() { return jobs.initialized; }
+
+
+// Получить количество аппаратных потоков процессора:
+int Jobs_get_hardware_threads() {
+    #if defined(_WIN32) || defined(_WIN64)
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        int count = (int)info.dwNumberOfProcessors;
+    #else
+        int count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    #endif
+    return count > 0 ? count : 1;
+}
+
+
+// Получить количество потоков системы задач (воркеры + поток, вызвавший Jobs_init):
+int Jobs_get_threads_count() { return jobs.initialized ? jobs.threads_count : 1; }
+
+
+// Получить индекс текущего потока в системе задач (0 - поток Jobs_init, -1 - сторонний поток):
+int Jobs_get_thread_index() { return jobs_thread_index; }
+
+
+// Запустить задачу (counter может быть NULL, если ожидание не требуется):
+void Jobs_run(JobFunc func, void *data, JobCounter *counter) {
+    if (!func) return;
+
+    // Без системы задач просто выполняем на месте:
+    if (!jobs.initialized) {
+        func(data);
+        return;
+    }
+
+    Job *job = (Job*)mm_alloc(sizeof(Job));
+    job->func = func;
+    job->data = data;
+    job->counter = counter;
+    if (counter) atomic_fetch_add_explicit(&counter->pending, 1, memory_order_relaxed);
+
+    // Кладём в свою деку или в общую очередь (для сторонних потоков):
+    int index = jobs_thread_index;
+    atomic_fetch_add(&jobs.queued, 1);
+    if (index >= 0) {
+        if (!Deque_push(jobs.deques[index], job)) {
+            atomic_fetch_sub(&jobs.queued, 1);
+            execute_job(job);  // Дека переполнена - выполняем сразу.
+            return;
+        }
+    } else {
+        mtx_lock(&jobs.global_lock);
+        Array_push(jobs.global, &job);
+        atomic_fetch_add(&jobs.global_len, 1);
+        mtx_unlock(&jobs.global_lock);
+    }
+    wake_workers();
+}
+
+
+// Выполнено ли всё по счётчику:
+bool Jobs_is_done(JobCounter *counter) {
+    if (!counter) return true;
+    return atomic_load_explicit(&counter->pending, memory_order_acquire) <= 0;
+}
+
+
+// Выполнить одну задачу из очередей, если она есть (возвращает true, если задача была выполнена):
+bool Jobs_try_execute() {
+    if (!jobs.initialized) return false;
+    Job *job = find_job(jobs_thread_index);
+    if (!job) return false;
+    execute_job(job);
+    return true;
+}
+
+
+// Дождаться выполнения задач по счётчику (во время ожидания выполняет другие задачи):
+void Jobs_wait(JobCounter *counter) {
+    if (!counter) return;
+    while (!Jobs_is_done(counter)) {
+        if (!Jobs_try_execute()) thrd_yield();
+    }
+}
+
+
+// Обработать диапазон [0, count) параллельно кусками по batch индексов (batch = 0 - автоматически):
+void Jobs_parallel_for(size_t count, size_t batch, JobRangeFunc func, void *data) {
+    if (!func || count == 0) return;
+
+    // Подбираем размер куска:
+    if (batch == 0) {
+        size_t parts = (size_t)Jobs_get_threads_count() * JOBS_BATCH_SPLIT;
+        batch = (count + parts - 1) / parts;
+        if (batch == 0) batch = 1;
+    }
+
+    // Если делить нечего - выполняем на месте:
+    if (!jobs.initialized || jobs.threads_count <= 1 || count <= batch) {
+        func(0, count, data);
+        return;
+    }
+
+    // Делим на куски. Первый кусок выполняем сами:
+    size_t chunks = (count + batch - 1) / batch;
+    JobRange *ranges = (JobRange*)mm_alloc(chunks * sizeof(JobRange));
+    JobCounter counter = {0};
+    for (size_t i = 0; i < chunks; i++) {
+        ranges[i].start = i * batch;
+        ranges[i].end = (i + 1) * batch < count ? (i + 1) * batch : count;
+        ranges[i].func = func;
+        ranges[i].data = data;
+        if (i > 0) Jobs_run(range_job, &ranges[i], &counter);
+    }
+    range_job(&ranges[0]);
+    Jobs_wait(&counter);
+    mm_free(ranges);
+}
@@ -0,0 +1,65 @@
+//
+// jobs.h - Система задач (job system) с воркерами на каждый аппаратный поток.
+//
+
+#pragma once
+
+
+// Подключаем:
+#include "std.h"
+
+
+// Определения:
+#define JOBS_MAX_THREADS    64    // Максимальное количество потоков (включая главный поток).
+#define JOBS_DEQUE_CAPACITY 4096  // Вместимость деки задач одного потока (степень двойки).
+
+
+// Объявление структур:
+typedef struct JobCounter JobCounter;  // Счётчик выполнения группы задач (хэндл задач).
+
+
+// Функция задачи:
+typedef void (*JobFunc)(void *data);
+
+// Функция обработки диапазона индексов [start, end) для Jobs_parallel_for:
+typedef void (*JobRangeFunc)(size_t start, size_t end, void *data);
+
+
+// Счётчик выполнения группы задач (можно создавать на стеке: JobCounter c = {0}):
+struct JobCounter {
+    atomic_int pending;  // Сколько задач группы ещё не выполнено.
+};
+
+
+// Инициализация системы задач (threads_count <= 0 - по количеству аппаратных потоков):
+bool Jobs_init(int threads_count);
+
+// Уничтожение системы задач (дожидается завершения воркеров):
+void Jobs_destroy();
+
+// Инициализирована ли система задач:
+bool Jobs_is_initialized();
+
+// Получить количество аппаратных потоков процессора:
+int Jobs_get_hardware_threads();
+
+// Получить количество потоков системы задач (воркеры + поток, вызвавший Jobs_init):
+int Jobs_get_threads_count();
+
+// Получить индекс текущего потока в системе задач (0 - поток Jobs_init, -1 - сторонний поток):
+int Jobs_get_thread_index();
+
+// Запустить задачу (counter может быть NULL, если ожидание не требуется):
+void Jobs_run(JobFunc func, void *data, JobCounter *counter);
+
+// Выполнено ли всё по счётчику:
+bool Jobs_is_done(JobCounter *counter);
+
+// Выполнить одну задачу из очередей, если она есть (возвращает true, если задача была выполнена):
+bool Jobs_try_execute();
+
+// Дождаться выполнения задач по счётчику (во время ожидания выполняет другие задачи):
+void Jobs_wait(JobCounter *counter);
+
+// Обработать диапазон [0, count) параллельно кусками по batch индексов (batch = 0 - автоматически):
+void Jobs_parallel_for(size_t count, size_t batch, JobRangeFunc func, void *data);
@@ -3,6 +3,20 @@
 //
 
 
+// Подключаем:
+#include "../mm.h"
+#include "../scratch.h"
+
+
+// Память stb_image идёт через арену потока (Scratch_bind) или mm, stb_image_write - через mm:
+#define STBI_MALLOC(size)        Scratch_alloc(size)
+#define STBI_REALLOC(ptr, size)  Scratch_realloc(ptr, size)
+#define STBI_FREE(ptr)           Scratch_free(ptr)
+#define STBIW_MALLOC(size)       mm_alloc(size)
+#define STBIW_REALLOC(ptr, size) mm_realloc(ptr, size)
+#define STBIW_FREE(ptr)          mm_free(ptr)
+
+
 // Определения:
 #define STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_WRITE_IMPLEMENTATION
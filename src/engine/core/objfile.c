@@ -0,0 +1,444 @@
+//
+// objfile.c - Реализация быстрого разбора OBJ-файлов.
+//
+
+
+// Подключаем:
+#include "std.h"
+#include "mm.h"
+#include "array.h"
+#include "files.h"
+#include "jobs.h"
+#include "objfile.h"
+
+
+// Точные степени десяти (в double точно представимы до 1e22):
+static const double pow10_exact[23] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+
+static inline bool is_digit(char c) {
+    return (unsigned)(c - '0') < 10u;
+}
+
+
+static inline bool is_space(char c) {
+    return c == ' ' || c == '\t';
+}
+
+
+// Конец строки или комментарий:
+static inline bool is_line_end(char c) {
+    return c == '\n' || c == '\r' || c == '#';
+}
+
+
+static inline const char* skip_spaces(const char *c, const char *end) {
+    while (c < end && is_space(*c)) c++;
+    return c;
+}
+
+
+// Перейти к началу следующей строки:
+static inline const char* next_line(const char *c, const char *end) {
+    const char *nl = (const char*)memchr(c, '\n', (size_t)(end - c));
+    return nl ? nl + 1 : end;
+}
+
+
+// Запасной путь для редких чисел (больше 19 значащих цифр, большой порядок, nan/inf) - strtod по копии:
+static const char* parse_float_slow(const char *text, const char *end, float *out) {
+    char buffer[128];
+    size_t len = 0;
+    while (text + len < end && len < sizeof(buffer) - 1 && !is_space(text[len]) && !is_line_end(text[len])) len++;
+    memcpy(buffer, text, len);
+    buffer[len] = '\0';
+    char *stop;
+    double value = strtod(buffer, &stop);
+    if (stop == buffer) return text;
+    *out = (float)value;
+    return text + (stop - buffer);
+}
+
+
+// Прочитать число с плавающей точкой:
+const char* ObjFile_parse_float(const char *text, const char *end, float *out) {
+    const char *c = text;
+    bool negative = false;
+    if (c < end && (*c == '-' || *c == '+')) negative = *c++ == '-';
+
+    // Мантисса - до 19 значащих цифр в uint64, остальные только сдвигают порядок:
+    uint64_t mantissa = 0;
+    int significant = 0, exponent = 0;
+    bool any_digit = false;
+    for (; c < end && is_digit(*c); c++) {
+        any_digit = true;
+        if (significant < 19) {
+            mantissa = mantissa * 10 + (uint64_t)(*c - '0');
+            if (mantissa) significant++;
+        } else {
+            exponent++;
+        }
+    }
+    if (c < end && *c == '.') {
+        for (c++; c < end && is_digit(*c); c++) {
+            any_digit = true;
+            if (significant < 19) {
+                mantissa = mantissa * 10 + (uint64_t)(*c - '0');
+                if (mantissa) significant++;
+                exponent--;
+            }
+        }
+    }
+    if (!any_digit) return parse_float_slow(text, end, out);  // nan, inf или не число.
+
+    // Порядок:
+    if (c < end && (*c == 'e' || *c == 'E')) {
+        const char *e = c + 1;
+        bool exp_negative = false;
+        if (e < end && (*e == '-' || *e == '+')) exp_negative = *e++ == '-';
+        if (e < end && is_digit(*e)) {
+            int value = 0;
+            for (; e < end && is_digit(*e); e++) if (value < 10000) value = value * 10 + (*e - '0');
+            exponent += exp_negative ? -value : value;
+            c = e;
+        }
+    }
+
+    // Мантисса точна в double и степень точна - одно округление (иначе - strtod):
+    if (mantissa >= (1ull << 53) || exponent < -22 || exponent > 22) return parse_float_slow(text, end, out);
+    double value = (double)mantissa;
+    value = exponent < 0 ? value / pow10_exact[-exponent] : value * pow10_exact[exponent];
+    *out = (float)(negative ? -value : value);
+    return c;
+}
+
+
+// Прочитать до count чисел строки (недостающие - 0):
+static const char* parse_floats(const char *c, const char *end, float *out, int count) {
+    for (int i = 0; i < count; i++) {
+        c = skip_spaces(c, end);
+        out[i] = 0.0f;
+        c = ObjFile_parse_float(c, end, &out[i]);
+    }
+    return c;
+}
+
+
+// Прочитать индекс (1-based или отрицательный относительный) и перевести в 0-based (-1 - нет или неверный):
+static const char* parse_index(const char *c, const char *end, size_t count, int32_t *out) {
+    bool negative = false;
+    if (c < end && *c == '-') { negative = true; c++; }
+    int64_t value = 0;
+    bool any_digit = false;
+    for (; c < end && is_digit(*c); c++) {
+        any_digit = true;
+        if (value <= INT32_MAX) value = value * 10 + (*c - '0');
+    }
+    int64_t index = !any_digit ? -1 : negative ? (int64_t)count - value : value - 1;
+    *out = index >= 0 && index < (int64_t)count ? (int32_t)index : -1;
+    return c;
+}
+
+
+// Вид строки OBJ:
+typedef enum ObjLine {
+    OBJ_LINE_OTHER,     // o, g, usemtl, s, комментарии... - пропускаем.
+    OBJ_LINE_POSITION,  // v.
+    OBJ_LINE_NORMAL,    // vn.
+    OBJ_LINE_TEXCOORD,  // vt.
+    OBJ_LINE_FACE,      // f.
+} ObjLine;
+
+
+// Кусок файла (начинается с начала строки), разбираемый одним потоком:
+typedef struct ObjChunk {
+    const char *start;
+    const char *end;
+    size_t positions;       // Элементов в куске.
+    size_t normals;
+    size_t texcoords;
+    size_t positions_base;  // Сколько элементов в файле до куска (префиксная сумма).
+    size_t normals_base;
+    size_t texcoords_base;
+    Array *corners;         // ObjIndex треугольников куска (индексы уже глобальные).
+    size_t corners_base;    // Сколько углов в файле до куска.
+    size_t skipped;
+} ObjChunk;
+
+
+// Параллельный разбор:
+typedef struct ObjParseJob {
+    ObjFile *obj;
+    ObjChunk *chunks;
+} ObjParseJob;
+
+
+// Определить вид строки (c - начало строки после пробелов), *body - начало данных:
+static inline ObjLine line_kind(const char *c, const char *end, const char **body) {
+    if (end - c >= 2 && c[0] == 'v') {
+        if (is_space(c[1])) { *body = c + 2; return OBJ_LINE_POSITION; }
+        if (end - c >= 3 && is_space(c[2])) {
+            *body = c + 3;
+            if (c[1] == 'n') return OBJ_LINE_NORMAL;
+            if (c[1] == 't') return OBJ_LINE_TEXCOORD;
+        }
+    } else if (end - c >= 2 && c[0] == 'f' && is_space(c[1])) {
+        *body = c + 2;
+        return OBJ_LINE_FACE;
+    }
+    return OBJ_LINE_OTHER;
+}
+
+
+// Разобрать строку "f" (многоугольник разбивается веером). Индексы проверяются по числу элементов до этой строки:
+static const char* parse_face(ObjChunk *chunk, const char *c, const char *end) {
+    size_t positions = chunk->positions_base + chunk->positions;
+    size_t texcoords = chunk->texcoords_base + chunk->texcoords;
+    size_t normals = chunk->normals_base + chunk->normals;
+    ObjIndex first = { -1, -1, -1 }, prev = { -1, -1, -1 };
+    int count = 0;
+    bool valid = true;
+    while ((c = skip_spaces(c, end)) < end && !is_line_end(*c)) {
+        ObjIndex idx = { -1, -1, -1 };
+        c = parse_index(c, end, positions, &idx.p);
+        if (c < end && *c == '/') {
+            c++;
+            if (c < end && *c != '/') c = parse_index(c, end, texcoords, &idx.t);
+            if (c < end && *c == '/') c = parse_index(c + 1, end, normals, &idx.n);
+        }
+        while (c < end && !is_space(*c) && !is_line_end(*c)) c++;  // Мусор после индексов.
+        if (idx.p < 0) valid = false;
+
+        if (count == 0) first = idx;
+        else if (count >= 2) {
+            if (valid) {
+                Array_push(chunk->corners, &first);
+                Array_push(chunk->corners, &prev);
+                Array_push(chunk->corners, &idx);
+            } else {
+                chunk->skipped++;
+            }
+        }
+        prev = idx;
+        count++;
+    }
+    return c;
+}
+
+
+// Разобрать кусок. append = true - элементы дописываются в массивы obj (один кусок на файл), иначе пишутся на
+// свои места в заранее выделенные массивы (по базам куска):
+static void parse_chunk(ObjFile *obj, ObjChunk *chunk, bool append) {
+    const char *c = chunk->start, *end = chunk->end, *body;
+    while (c < end) {
+        c = skip_spaces(c, end);
+        switch (line_kind(c, end, &body)) {
+            case OBJ_LINE_POSITION: {
+                float p[3];
+                c = parse_floats(body, end, p, 3);
+                if (append) Array_push(obj->positions, p);
+                else memcpy((float*)obj->positions->data + (chunk->positions_base + chunk->positions) * 3, p, sizeof(p));
+                chunk->positions++;
+            } break;
+            case OBJ_LINE_NORMAL: {
+                float n[3];
+                c = parse_floats(body, end, n, 3);
+                if (append) Array_push(obj->normals, n);
+                else memcpy((float*)obj->normals->data + (chunk->normals_base + chunk->normals) * 3, n, sizeof(n));
+                chunk->normals++;
+            } break;
+            case OBJ_LINE_TEXCOORD: {
+                float t[2];
+                c = parse_floats(body, end, t, 2);
+                if (append) Array_push(obj->texcoords, t);
+                else memcpy((float*)obj->texcoords->data + (chunk->texcoords_base + chunk->texcoords) * 2, t, sizeof(t));
+                chunk->texcoords++;
+            } break;
+            case OBJ_LINE_FACE: c = parse_face(chunk, body, end); break;
+            case OBJ_LINE_OTHER: break;
+        }
+        c = next_line(c, end);  // Остаток строки пропускаем.
+    }
+}
+
+
+// Создать массив из count элементов (содержимое заполнят потоки):
+static Array* create_filled(size_t item_size, size_t count) {
+    Array *arr = Array_create(item_size, count > 0 ? count : 1);
+    arr->len = count;
+    return arr;
+}
+
+
+// Посчитать элементы кусков (первый проход):
+static void count_range(size_t start, size_t end, void *data) {
+    ObjParseJob *job = (ObjParseJob*)data;
+    for (size_t i = start; i < end; i++) {
+        ObjChunk *chunk = &job->chunks[i];
+        const char *c = chunk->start, *body;
+        while (c < chunk->end) {
+            c = skip_spaces(c, chunk->end);
+            switch (line_kind(c, chunk->end, &body)) {
+                case OBJ_LINE_POSITION: chunk->positions++; break;
+                case OBJ_LINE_NORMAL: chunk->normals++; break;
+                case OBJ_LINE_TEXCOORD: chunk->texcoords++; break;
+                default: break;
+            }
+            c = next_line(c, chunk->end);
+        }
+    }
+}
+
+
+// Разобрать куски (второй проход, базы уже известны):
+static void parse_range(size_t start, size_t end, void *data) {
+    ObjParseJob *job = (ObjParseJob*)data;
+    for (size_t i = start; i < end; i++) {
+        ObjChunk *chunk = &job->chunks[i];
+        chunk->positions = chunk->normals = chunk->texcoords = 0;
+        chunk->corners = Array_create(sizeof(ObjIndex), (size_t)(chunk->end - chunk->start) / 64 + 16);
+        parse_chunk(job->obj, chunk, false);
+    }
+}
+
+
+// Перенести треугольники кусков в общий массив (по префиксной сумме):
+static void merge_range(size_t start, size_t end, void *data) {
+    ObjParseJob *job = (ObjParseJob*)data;
+    for (size_t i = start; i < end; i++) {
+        ObjChunk *chunk = &job->chunks[i];
+        size_t count = Array_len(chunk->corners);
+        if (count > 0) {
+            memcpy((ObjIndex*)job->obj->corners->data + chunk->corners_base, chunk->corners->data, count * sizeof(ObjIndex));
+        }
+        Array_destroy(&chunk->corners);
+    }
+}
+
+
+// Параллельный разбор: считаем элементы кусков, префиксной суммой получаем, с какого номера каждый кусок пишет
+// свои элементы, разбираем куски на местах (индексы граней сразу глобальные) и сливаем треугольники:
+static void parse_parallel(ObjFile *obj, const char *text, size_t size) {
+    size_t count = (size_t)Jobs_get_threads_count() * OBJFILE_CHUNKS_PER_THREAD;
+    if (count > size / OBJFILE_MIN_CHUNK_SIZE) count = size / OBJFILE_MIN_CHUNK_SIZE;
+    if (count < 1) count = 1;
+
+    // Режем по границам строк:
+    ObjChunk *chunks = (ObjChunk*)mm_calloc(count, sizeof(ObjChunk));
+    const char *c = text, *end = text + size;
+    for (size_t i = 0; i < count; i++) {
+        const char *split = i + 1 < count ? text + size / count * (i + 1) : end;
+        if (split < c) split = c;
+        if (split < end) split = next_line(split, end);
+        chunks[i].start = c;
+        chunks[i].end = split;
+        c = split;
+    }
+    ObjParseJob job = { obj, chunks };
+    Jobs_parallel_for(count, 1, count_range, &job);
+
+    // Базы кусков и массивы элементов сразу нужного размера:
+    size_t positions = 0, normals = 0, texcoords = 0;
+    for (size_t i = 0; i < count; i++) {
+        chunks[i].positions_base = positions;
+        chunks[i].normals_base = normals;
+        chunks[i].texcoords_base = texcoords;
+        positions += chunks[i].positions;
+        normals += chunks[i].normals;
+        texcoords += chunks[i].texcoords;
+    }
+    obj->positions = create_filled(sizeof(float) * 3, positions);
+    obj->normals = create_filled(sizeof(float) * 3, normals);
+    obj->texcoords = create_filled(sizeof(float) * 2, texcoords);
+    Jobs_parallel_for(count, 1, parse_range, &job);
+
+    // Треугольники:
+    size_t corners = 0;
+    for (size_t i = 0; i < count; i++) {
+        chunks[i].corners_base = corners;
+        corners += Array_len(chunks[i].corners);
+        obj->skipped += chunks[i].skipped;
+    }
+    obj->corners = create_filled(sizeof(ObjIndex), corners);
+    Jobs_parallel_for(count, 1, merge_range, &job);
+    mm_free(chunks);
+}
+
+
+// Разобрать OBJ из памяти:
+ObjFile* ObjFile_parse(const char *text, size_t size) {
+    if (!text) size = 0;
+    ObjFile *obj = (ObjFile*)mm_calloc(1, sizeof(ObjFile));
+    if (size >= OBJFILE_PARALLEL_MIN_SIZE && Jobs_is_initialized() && Jobs_get_threads_count() > 1) {
+        parse_parallel(obj, text, size);
+    } else {
+        size_t guess = size / 64 + 16;  // Примерно строк в файле.
+        obj->positions = Array_create(sizeof(float) * 3, guess / 2);
+        obj->normals = Array_create(sizeof(float) * 3, 16);
+        obj->texcoords = Array_create(sizeof(float) * 2, 16);
+        obj->corners = Array_create(sizeof(ObjIndex), guess);
+        ObjChunk chunk = { .start = text, .end = text + size, .corners = obj->corners };
+        parse_chunk(obj, &chunk, true);
+        obj->skipped = chunk.skipped;
+    }
+    if (obj->skipped > 0) fprintf(stderr, "ObjFile_parse: %zu triangles with invalid indices skipped.\n", obj->skipped);
+    return obj;
+}
+
+
+// Загрузить и разобрать OBJ-файл:
+ObjFile* ObjFile_load(const char *filepath) {
+    FileMap *map = filepath ? Files_map(filepath, FILE_MAP_SEQUENTIAL) : NULL;
+    if (!map) return NULL;
+    ObjFile *obj = ObjFile_parse((const char*)map->data, map->size);
+    Files_unmap(&map);
+    return obj;
+}
+
+
+// Сварить одинаковые углы:
+uint32_t ObjFile_weld(const ObjFile *obj, ObjIndex *unique, uint32_t *indices) {
+    if (!obj || !unique || !indices) return 0;
+    const uint32_t none = UINT32_MAX;
+    size_t count = Array_len(obj->corners);
+    size_t positions = Array_len(obj->positions);
+    const ObjIndex *corners = (const ObjIndex*)obj->corners->data;
+
+    // Хэш-таблица с корзиной на каждую позицию (хэш - сам индекс позиции): first[p] - последняя вершина с этой
+    // позицией, next[v] - предыдущая. Углов с одной позицией обычно единицы - поиск в одно-два сравнения:
+    uint32_t *first = (uint32_t*)mm_alloc(sizeof(uint32_t) * (positions > 0 ? positions : 1));
+    uint32_t *next = (uint32_t*)mm_alloc(sizeof(uint32_t) * (count > 0 ? count : 1));
+    memset(first, 0xFF, sizeof(uint32_t) * positions);
+
+    uint32_t unique_count = 0;
+    for (size_t i = 0; i < count; i++) {
+        ObjIndex c = corners[i];
+        uint32_t v = first[c.p];
+        while (v != none && (unique[v].t != c.t || unique[v].n != c.n)) v = next[v];
+        if (v == none) {
+            v = unique_count++;
+            unique[v] = c;
+            next[v] = first[c.p];
+            first[c.p] = v;
+        }
+        indices[i] = v;
+    }
+    mm_free(first);
+    mm_free(next);
+    return unique_count;
+}
+
+
+// Уничтожить разобранный файл:
+void ObjFile_destroy(ObjFile **obj) {
+    if (!obj || !*obj) return;
+    Array_destroy(&(*obj)->positions);
+    Array_destroy(&(*obj)->normals);
+    Array_destroy(&(*obj)->texcoords);
+    Array_destroy(&(*obj)->corners);
+    mm_free(*obj);
+    *obj = NULL;
+}
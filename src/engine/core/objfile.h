@@ -0,0 +1,67 @@
+//
+// objfile.h - Быстрый разбор OBJ-файлов (Wavefront) без sscanf/strtok.
+//
+// Файл отображается в память и разбирается одним проходом рукописного сканера: числа читаются своим парсером
+// (целая мантисса до 19 цифр и точная степень десяти, редкие случаи - через strtod), сразу во float. Длина строк
+// не ограничена, многоугольники разбиваются веером на треугольники, отрицательные (относительные) индексы
+// поддерживаются. Большие файлы (если система задач запущена) режутся по строкам на куски, которые разбираются
+// параллельно: первый проход считает элементы кусков, префиксная сумма даёт номера их первых элементов, второй проход
+// пишет элементы сразу на места, а треугольники кусков сливаются в общий массив. Одинаковые углы соседних
+// треугольников свариваются в одну вершину (ObjFile_weld). Сборка вершин для GPU - в загрузчике моделей
+// (graphics-gl/model/loader).
+//
+
+#pragma once
+
+
+// Подключаем:
+#include "std.h"
+#include "array.h"
+
+
+// Определения:
+#define OBJFILE_PARALLEL_MIN_SIZE (4u << 20)  // Файлы меньше разбираются в одном потоке.
+#define OBJFILE_MIN_CHUNK_SIZE    (1u << 20)  // Минимальный размер куска параллельного разбора.
+#define OBJFILE_CHUNKS_PER_THREAD 4           // Кусков на поток (выравнивает нагрузку: строки f дороже строк v).
+
+
+// Объявление структур:
+typedef struct ObjIndex ObjIndex;  // Индексы угла треугольника.
+typedef struct ObjFile ObjFile;    // Разобранный OBJ-файл.
+
+
+// Индексы угла треугольника (с нуля, -1 - нет):
+struct ObjIndex {
+    int32_t p;  // Позиция.
+    int32_t t;  // Текстурные координаты.
+    int32_t n;  // Нормаль.
+};
+
+
+// Разобранный OBJ-файл:
+struct ObjFile {
+    Array *positions;  // float x, y, z.
+    Array *normals;    // float x, y, z.
+    Array *texcoords;  // float u, v.
+    Array *corners;    // ObjIndex, по три на треугольник.
+    size_t skipped;    // Пропущено треугольников с неверным индексом позиции.
+};
+
+
+// Разобрать OBJ из памяти (текст не обязан заканчиваться нулём):
+ObjFile* ObjFile_parse(const char *text, size_t size);
+
+// Загрузить и разобрать OBJ-файл (через отображение в память, работает и для смонтированных архивов). NULL - нет файла:
+ObjFile* ObjFile_load(const char *filepath);
+
+// Уничтожить разобранный файл:
+void ObjFile_destroy(ObjFile **obj);
+
+// Сварить одинаковые углы: каждая уникальная тройка (p, t, n) записывается в unique один раз (в порядке первого
+// появления), indices[i] - номер уникального угла для corners[i]. Оба массива - на Array_len(corners) элементов.
+// Возвращает число уникальных углов (вершин):
+uint32_t ObjFile_weld(const ObjFile *obj, ObjIndex *unique, uint32_t *indices);
+
+// Прочитать число с плавающей точкой (как strtod, но без локали и нуля в конце). Возвращает конец числа
+// (text - числа нет):
+const char* ObjFile_parse_float(const char *text, const char *end, float *out);
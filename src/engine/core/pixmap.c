@@ -4,74 +4,939 @@
 
 
 // Подключаем:
+#include "libs/tinycthread.h"
 #include "std.h"
 #include "mm.h"
 #include "crash.h"
+#include "files.h"
+#include "jobs.h"
+#include "pixops.h"
+#include "rawtex.h"
+#include "scratch.h"
 #include "libs/stb_image.h"
 #include "libs/stb_image_write.h"
 #include "pixmap.h"
 
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+    #define PIXMAP_SSE2 1
+#endif
+
+
+// Объявление структур:
+typedef struct PixmapRowsJob PixmapRowsJob;          // Операция над строками картинки (для параллельного выполнения).
+typedef struct PixmapFilter PixmapFilter;            // Веса фильтра передискретизации по одной оси.
+typedef struct PixmapResampleJob PixmapResampleJob;  // Передискретизация картинки (для параллельного выполнения).
+typedef struct PixmapBatchItem PixmapBatchItem;      // Картинка пакетной загрузки.
+
+
+// Операция над строками картинки:
+typedef void (*PixmapRowFunc)(const uint8_t *src, uint8_t *dst, size_t count, int channels);
+
+struct PixmapRowsJob {
+    const Pixmap *src;
+    Pixmap *dst;
+    PixmapRowFunc func;
+};
+
+
+// Ядро фильтра (t - расстояние в пикселях результата):
+typedef float (*PixmapKernelFunc)(float t);
+
+// Веса фильтра по одной оси: пиксель результата i = сумма weights[i * taps + k] * src[start[i] + k], k < count[i]:
+struct PixmapFilter {
+    int taps;
+    int *start;
+    int *count;
+    float *weights;
+};
+
+struct PixmapResampleJob {
+    const Pixmap *src;
+    Pixmap *dst;
+    const PixmapFilter *horizontal;
+    const PixmapFilter *vertical;
+    bool srgb;
+};
+
+
+// Картинка пакетной загрузки:
+struct PixmapBatchItem {
+    PixmapBatch *batch;
+    size_t index;     // Индекс в списке путей.
+    char *path;
+    FileMap *map;     // Отображение файла (открывается при проверке бюджета).
+    size_t bytes;     // Размер декодированной картинки (по заголовку файла).
+    bool probed;      // Файл уже отображён и заголовок прочитан.
+    Pixmap *pixmap;   // Результат (до выдачи вызывающему).
+};
+
+
+// Пакетная загрузка картинок:
+struct PixmapBatch {
+    size_t count;            // Сколько картинок в пакете.
+    int format;              // Каналы результата.
+    size_t memory_budget;    // Бюджет памяти в байтах (0 - без ограничения).
+    PixmapBatchItem *items;
+
+    mtx_t lock;
+    size_t next_submit;      // Следующая картинка к запуску.
+    bool probing;            // Следующая картинка проверяется вне блокировки (её и запустит проверяющий поток).
+    size_t in_flight;        // Запущено, но не отдано.
+    size_t in_flight_bytes;  // Память запущенных, но не отданных картинок.
+    size_t *completed;       // Очередь готовых индексов.
+    size_t completed_head;
+    size_t completed_tail;
+    size_t delivered;        // Сколько отдано вызывающему.
+    bool cancelled;          // Новые картинки не запускаются (Pixmap_batch_destroy).
+};
+
+
+static atomic_size_t pixmap_scratch_size = 0;  // Предел арены потока для декодирования (0 - без арены).
+
+
+// Таблицы гамма-коррекции для усреднения в линейном пространстве:
+#define PIXMAP_LINEAR_LUT_SIZE 4096
+static float srgb_to_linear_f[256];
+static uint8_t linear_to_srgb_u8[PIXMAP_LINEAR_LUT_SIZE];
+static once_flag gamma_once = ONCE_FLAG_INIT;
+
+
+// Преобразовать строку в другое число каналов (channels - каналы приёмника):
+static void row_convert(const uint8_t *src, uint8_t *dst, size_t count, int channels, int src_channels) {
+    if (src_channels == 3 && channels == 4) { PixOps_rgb_to_rgba(src, dst, count, 255); return; }
+    if (src_channels == 4 && channels == 3) { PixOps_rgba_to_rgb(src, dst, count); return; }
+    bool src_color = src_channels >= 3, dst_color = channels >= 3;
+    bool src_alpha = src_channels == 2 || src_channels == 4, dst_alpha = channels == 2 || channels == 4;
+    for (size_t i = 0; i < count; i++, src += src_channels, dst += channels) {
+        uint8_t r, g, b;
+        if (src_color) { r = src[0]; g = src[1]; b = src[2]; } else { r = g = b = src[0]; }
+        if (dst_color) {
+            dst[0] = r;
+            dst[1] = g;
+            dst[2] = b;
+        } else {
+            dst[0] = src_color ? (uint8_t)((r * 77 + g * 150 + b * 29 + 128) >> 8) : r;  // Яркость (BT.601).
+        }
+        if (dst_alpha) dst[channels - 1] = src_alpha ? src[src_channels - 1] : 255;
+    }
+}
+
+
+static void row_swap_rb(const uint8_t *src, uint8_t *dst, size_t count, int channels) {
+    PixOps_swap_rb(src, dst, count, channels);
+}
+
+
+static void row_premultiply(const uint8_t *src, uint8_t *dst, size_t count, int channels) {
+    PixOps_premultiply(src, dst, count);
+}
+
+
+static void row_unpremultiply(const uint8_t *src, uint8_t *dst, size_t count, int channels) {
+    PixOps_unpremultiply(src, dst, count);
+}
+
+
+// Обработать диапазон строк:
+static void rows_range(size_t start, size_t end, void *data) {
+    PixmapRowsJob *job = (PixmapRowsJob*)data;
+    size_t width = (size_t)job->src->width;
+    size_t src_stride = Pixmap_get_stride(job->src);
+    size_t dst_stride = Pixmap_get_stride(job->dst);
+    for (size_t y = start; y < end; y++) {
+        const uint8_t *src = job->src->data + y * src_stride;
+        uint8_t *dst = job->dst->data + y * dst_stride;
+        if (job->func) job->func(src, dst, width, job->dst->channels);
+        else row_convert(src, dst, width, job->dst->channels, job->src->channels);
+    }
+}
+
+
+// Сколько строк брать в одну задачу (около 64 КБ пикселей, чтобы задача не была слишком мелкой):
+static size_t rows_batch(const Pixmap *pixmap) {
+    size_t width = pixmap->width > 0 ? (size_t)pixmap->width : 1;
+    size_t batch = (64 * 1024) / width;
+    return batch > 0 ? batch : 1;
+}
+
+
+// Выполнить обработчик диапазона строк над всеми строками job->src (параллельно для больших картинок):
+static void run_rows(PixmapRowsJob *job, JobRangeFunc range) {
+    size_t pixels = (size_t)job->src->width * job->src->height;
+    if (pixels >= PIXMAP_PARALLEL_MIN_PIXELS && Jobs_is_initialized()) {
+        Jobs_parallel_for((size_t)job->src->height, rows_batch(job->src), range, job);
+    } else {
+        range(0, (size_t)job->src->height, job);
+    }
+}
+
+
+// Выполнить операцию над всеми строками (параллельно по строкам для больших картинок).
+// func = NULL - преобразование числа каналов из src в dst:
+static void for_rows(const Pixmap *src, Pixmap *dst, PixmapRowFunc func) {
+    PixmapRowsJob job = { .src = src, .dst = dst, .func = func };
+    run_rows(&job, rows_range);
+}
+
+
+// Перевести строку значений любого типа во float (целые нормируются в 0..1):
+static void row_type_to_float(const uint8_t *src, float *dst, size_t count, PixmapType type) {
+    switch (type) {
+        case PIXMAP_U8: {
+            for (size_t i = 0; i < count; i++) dst[i] = src[i] * (1.0f / 255.0f);
+            break;
+        }
+        case PIXMAP_U16: {
+            const uint16_t *in = (const uint16_t*)src;
+            for (size_t i = 0; i < count; i++) dst[i] = in[i] * (1.0f / 65535.0f);
+            break;
+        }
+        case PIXMAP_F16: { PixOps_f16_to_f32((const uint16_t*)src, dst, count); break; }
+        case PIXMAP_F32: { memcpy(dst, src, count * sizeof(float)); break; }
+    }
+}
+
+
+// Перевести строку float в значения любого типа (целые - с округлением и насыщением):
+static void row_type_from_float(const float *src, uint8_t *dst, size_t count, PixmapType type) {
+    switch (type) {
+        case PIXMAP_U8: {
+            for (size_t i = 0; i < count; i++) {
+                float v = src[i] * 255.0f + 0.5f;
+                dst[i] = v >= 255.0f ? 255 : v > 0.0f ? (uint8_t)v : 0;  // NaN - 0.
+            }
+            break;
+        }
+        case PIXMAP_U16: {
+            uint16_t *out = (uint16_t*)dst;
+            for (size_t i = 0; i < count; i++) {
+                float v = src[i] * 65535.0f + 0.5f;
+                out[i] = v >= 65535.0f ? 65535 : v > 0.0f ? (uint16_t)v : 0;
+            }
+            break;
+        }
+        case PIXMAP_F16: { PixOps_f32_to_f16(src, (uint16_t*)dst, count); break; }
+        case PIXMAP_F32: { memcpy(dst, src, count * sizeof(float)); break; }
+    }
+}
+
+
+// Перевести диапазон строк в другой тип значения (f32 <-> f16 - напрямую, остальное - через строку float):
+static void type_range(size_t start, size_t end, void *data) {
+    PixmapRowsJob *job = (PixmapRowsJob*)data;
+    const Pixmap *src = job->src;
+    Pixmap *dst = job->dst;
+    size_t count = (size_t)src->width * src->channels;
+    size_t src_stride = Pixmap_get_stride(src), dst_stride = Pixmap_get_stride(dst);
+    bool direct = src->type == PIXMAP_F32 || dst->type == PIXMAP_F32;
+    float *row = direct ? NULL : (float*)mm_alloc(count * sizeof(float));
+    for (size_t y = start; y < end; y++) {
+        const uint8_t *in = src->data + y * src_stride;
+        uint8_t *out = dst->data + y * dst_stride;
+        if (src->type == PIXMAP_F32) row_type_from_float((const float*)in, out, count, dst->type);
+        else if (dst->type == PIXMAP_F32) row_type_to_float(in, (float*)out, count, src->type);
+        else {
+            row_type_to_float(in, row, count, src->type);
+            row_type_from_float(row, out, count, dst->type);
+        }
+    }
+    mm_free(row);
+}
+
+
+// Обменять диапазон строк верхней половины с зеркальными строками нижней:
+static void flip_range(size_t start, size_t end, void *data) {
+    Pixmap *pixmap = (Pixmap*)data;
+    size_t stride = Pixmap_get_stride(pixmap);
+    size_t row_size = (size_t)pixmap->width * Pixmap_get_pixel_size(pixmap);
+    for (size_t y = start; y < end; y++) {
+        PixOps_swap_rows(pixmap->data + y * stride, pixmap->data + (pixmap->height - 1 - y) * stride, row_size);
+    }
+}
+
+
+static size_t flip_batch(const Pixmap *pixmap) {
+    size_t batch = rows_batch(pixmap) / 2;
+    return batch > 0 ? batch : 1;
+}
+
+
+// Заполнить таблицы гамма-коррекции:
+static void gamma_init() {
+    for (int i = 0; i < 256; i++) {
+        float c = i / 255.0f;
+        srgb_to_linear_f[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+    }
+    for (int i = 0; i < PIXMAP_LINEAR_LUT_SIZE; i++) {
+        float c = i / (float)(PIXMAP_LINEAR_LUT_SIZE - 1);
+        float srgb = c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+        linear_to_srgb_u8[i] = (uint8_t)(srgb * 255.0f + 0.5f);
+    }
+}
+
+
+// Ядра фильтров:
+
+
+static float kernel_box(float t) {
+    return (t > -0.5f && t <= 0.5f) ? 1.0f : 0.0f;
+}
+
+
+// Модифицированная функция Бесселя нулевого порядка (ряд):
+static float bessel_i0(float x) {
+    float sum = 1.0f, term = 1.0f, half = x * 0.5f;
+    for (int k = 1; k < 32; k++) {
+        term *= (half / k) * (half / k);
+        sum += term;
+        if (term < sum * 1e-7f) break;
+    }
+    return sum;
+}
+
+
+#define KAISER_WIDTH 3.0f
+#define KAISER_ALPHA 4.0f
+#define PIXMAP_PI 3.14159265358979f
+
+static float kernel_kaiser(float t) {
+    if (t <= -KAISER_WIDTH || t >= KAISER_WIDTH) return 0.0f;
+    float sinc = t == 0.0f ? 1.0f : sinf(PIXMAP_PI * t) / (PIXMAP_PI * t);
+    float r = t / KAISER_WIDTH;
+    return sinc * bessel_i0(KAISER_ALPHA * sqrtf(1.0f - r * r)) / bessel_i0(KAISER_ALPHA);
+}
+
+
+// Треугольник (билинейная):
+static float kernel_triangle(float t) {
+    t = fabsf(t);
+    return t < 1.0f ? 1.0f - t : 0.0f;
+}
+
+
+// Кубический сплайн Катмулла-Рома (бикубическая, B = 0, C = 0.5):
+static float kernel_cubic(float t) {
+    t = fabsf(t);
+    if (t < 1.0f) return (1.5f * t - 2.5f) * t * t + 1.0f;
+    if (t < 2.0f) return ((-0.5f * t + 2.5f) * t - 4.0f) * t + 2.0f;
+    return 0.0f;
+}
+
+
+// Ланцош с тремя лепестками:
+static float kernel_lanczos3(float t) {
+    if (t <= -3.0f || t >= 3.0f) return 0.0f;
+    if (t == 0.0f) return 1.0f;
+    float x = PIXMAP_PI * t;
+    return 3.0f * sinf(x) * sinf(x / 3.0f) / (x * x);
+}
+
+
+// Посчитать веса фильтра для оси src_size -> dst_size (support - радиус ядра в пикселях результата).
+// При уменьшении ядро растягивается на пиксели источника, выходящие за край отсчёты прижимаются к краю:
+static void filter_init(PixmapFilter *filter, int src_size, int dst_size, PixmapKernelFunc kernel, float support) {
+    float scale = (float)src_size / (float)dst_size;
+    float fscale = scale > 1.0f ? scale : 1.0f;
+    float radius = support * fscale;
+    int taps = (int)ceilf(radius * 2.0f) + 3;
+    if (taps > src_size) taps = src_size;
+    filter->taps = taps;
+    filter->start = (int*)mm_alloc(sizeof(int) * dst_size);
+    filter->count = (int*)mm_alloc(sizeof(int) * dst_size);
+    filter->weights = (float*)mm_alloc(sizeof(float) * dst_size * taps);
+    memset(filter->weights, 0, sizeof(float) * dst_size * taps);
+
+    for (int i = 0; i < dst_size; i++) {
+        float center = (i + 0.5f) * scale - 0.5f;
+        int lo = (int)floorf(center - radius), hi = (int)ceilf(center + radius);
+        int first = lo < 0 ? 0 : lo;
+        int last = hi > src_size - 1 ? src_size - 1 : hi;
+        if (first > src_size - 1) first = src_size - 1;
+        if (last < first) last = first;
+        if (last - first + 1 > taps) last = first + taps - 1;  // Не бывает при taps < src_size (запас +3).
+        float *w = filter->weights + (size_t)i * taps;
+        float sum = 0.0f;
+        for (int j = lo; j <= hi; j++) {
+            float value = kernel(((float)j - center) / fscale);
+            int k = (j < first ? first : (j > last ? last : j)) - first;
+            w[k] += value;
+            sum += value;
+        }
+        if (fabsf(sum) < 1e-8f) {  // Ядро не попало ни в один отсчёт - берём ближайший.
+            int nearest = (int)floorf(center + 0.5f);
+            nearest = nearest < first ? first : (nearest > last ? last : nearest);
+            memset(w, 0, sizeof(float) * taps);
+            w[nearest - first] = 1.0f;
+            sum = 1.0f;
+        }
+        for (int k = 0; k <= last - first; k++) w[k] /= sum;
+        filter->start[i] = first;
+        filter->count[i] = last - first + 1;
+    }
+}
+
+
+static void filter_free(PixmapFilter *filter) {
+    mm_free(filter->start);
+    mm_free(filter->count);
+    mm_free(filter->weights);
+}
+
+
+// Строку источника в float (цветовые каналы при srgb - в линейное пространство):
+static void row_to_float(const uint8_t *in, float *out, size_t count, int ch, bool srgb) {
+    size_t n = count * ch;
+    if (!srgb) {
+        for (size_t i = 0; i < n; i++) out[i] = in[i];
+        return;
+    }
+    int color = (ch == 2 || ch == 4) ? ch - 1 : ch;  // Альфа (последний канал при 2 и 4) всегда линейна.
+    for (size_t i = 0; i < n; i++) out[i] = (int)(i % ch) < color ? srgb_to_linear_f[in[i]] * 255.0f : in[i];
+}
+
+
+// Отфильтровать строку по горизонтали (RGBA - по пикселю за раз в одном векторе):
+static void row_filter_horizontal(const float *in, float *out, const PixmapFilter *hf, int width, int ch) {
+    #if defined(PIXMAP_SSE2)
+        if (ch == 4) {
+            for (int x = 0; x < width; x++) {
+                const float *w = hf->weights + (size_t)x * hf->taps;
+                const float *px = in + (size_t)hf->start[x] * 4;
+                __m128 sum = _mm_setzero_ps();
+                for (int k = 0; k < hf->count[x]; k++) {
+                    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(w[k]), _mm_loadu_ps(px + k * 4)));
+                }
+                _mm_storeu_ps(out + (size_t)x * 4, sum);
+            }
+            return;
+        }
+    #endif
+    for (int x = 0; x < width; x++) {
+        const float *w = hf->weights + (size_t)x * hf->taps;
+        const float *px = in + (size_t)hf->start[x] * ch;
+        for (int c = 0; c < ch; c++) {
+            float sum = 0.0f;
+            for (int k = 0; k < hf->count[x]; k++) sum += w[k] * px[k * ch + c];
+            out[(size_t)x * ch + c] = sum;
+        }
+    }
+}
+
+
+// Записать строку результата из float (с насыщением 0..255):
+static void row_from_float(const float *in, uint8_t *out, size_t count, int ch, bool srgb) {
+    size_t n = count * ch, i = 0;
+    if (srgb) {
+        int color = (ch == 2 || ch == 4) ? ch - 1 : ch;
+        for (; i < n; i++) {
+            float v = in[i];
+            v = v < 0.0f ? 0.0f : (v > 255.0f ? 255.0f : v);
+            if ((int)(i % ch) < color) out[i] = linear_to_srgb_u8[(int)(v * ((PIXMAP_LINEAR_LUT_SIZE - 1) / 255.0f) + 0.5f)];
+            else out[i] = (uint8_t)(v + 0.5f);
+        }
+        return;
+    }
+    #if defined(PIXMAP_SSE2)
+        const __m128 half = _mm_set1_ps(0.5f);
+        for (; i + 16 <= n; i += 16) {  // cvttps + 0.5 - то же округление, что и в скалярном хвосте.
+            __m128i a = _mm_cvttps_epi32(_mm_add_ps(_mm_max_ps(_mm_loadu_ps(in + i), _mm_setzero_ps()), half));
+            __m128i b = _mm_cvttps_epi32(_mm_add_ps(_mm_max_ps(_mm_loadu_ps(in + i + 4), _mm_setzero_ps()), half));
+            __m128i c = _mm_cvttps_epi32(_mm_add_ps(_mm_max_ps(_mm_loadu_ps(in + i + 8), _mm_setzero_ps()), half));
+            __m128i d = _mm_cvttps_epi32(_mm_add_ps(_mm_max_ps(_mm_loadu_ps(in + i + 12), _mm_setzero_ps()), half));
+            _mm_storeu_si128((__m128i*)(out + i), _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+        }
+    #endif
+    for (; i < n; i++) {
+        float v = in[i] + 0.5f;
+        out[i] = (uint8_t)(v < 0.0f ? 0.0f : (v > 255.0f ? 255.0f : v));
+    }
+}
+
+
+// Передискретизировать диапазон строк результата. Сначала по горизонтали считаются только строки источника,
+// нужные этому диапазону (во временный буфер задачи), затем по вертикали. Значения хранятся во float в шкале 0..255
+// (при srgb цвет линейный):
+static void resample_range(size_t start, size_t end, void *data) {
+    PixmapResampleJob *job = (PixmapResampleJob*)data;
+    const Pixmap *src = job->src;
+    Pixmap *dst = job->dst;
+    const PixmapFilter *hf = job->horizontal, *vf = job->vertical;
+    int ch = dst->channels;
+    size_t src_stride = Pixmap_get_stride(src);
+    size_t dst_stride = Pixmap_get_stride(dst);
+    size_t row_size = (size_t)dst->width * ch;
+
+    int row_lo = vf->start[start];
+    int row_hi = vf->start[end - 1] + vf->count[end - 1] - 1;
+    size_t rows_count = (size_t)(row_hi - row_lo + 1);
+    float *rows = (float*)mm_alloc(sizeof(float) * (row_size * (rows_count + 1) + (size_t)src->width * ch));
+    float *acc = rows + row_size * rows_count;
+    float *line = acc + row_size;
+
+    // По горизонтали:
+    for (int r = row_lo; r <= row_hi; r++) {
+        row_to_float(src->data + (size_t)r * src_stride, line, (size_t)src->width, ch, job->srgb);
+        row_filter_horizontal(line, rows + (size_t)(r - row_lo) * row_size, hf, dst->width, ch);
+    }
+
+    // По вертикали (внутренний цикл по всей строке векторизуется компилятором):
+    for (size_t y = start; y < end; y++) {
+        const float *w = vf->weights + y * vf->taps;
+        const float *in = rows + (size_t)(vf->start[y] - row_lo) * row_size;
+        memset(acc, 0, sizeof(float) * row_size);
+        for (int k = 0; k < vf->count[y]; k++) {
+            const float *restrict r = in + (size_t)k * row_size;
+            float *restrict a = acc;
+            float wk = w[k];
+            for (size_t i = 0; i < row_size; i++) a[i] += wk * r[i];
+        }
+        row_from_float(acc, dst->data + y * dst_stride, (size_t)dst->width, ch, job->srgb);
+    }
+    mm_free(rows);
+}
+
+
+// Передискретизировать картинку в dst (размеры и каналы dst уже заданы):
+static void resample(const Pixmap *src, Pixmap *dst, PixmapKernelFunc kernel, float support, bool srgb) {
+    if (srgb) call_once(&gamma_once, gamma_init);
+    PixmapFilter horizontal, vertical;
+    filter_init(&horizontal, src->width, dst->width, kernel, support);
+    filter_init(&vertical, src->height, dst->height, kernel, support);
+    PixmapResampleJob job = { .src = src, .dst = dst, .horizontal = &horizontal, .vertical = &vertical, .srgb = srgb };
+    size_t pixels = (size_t)dst->width * dst->height;
+    if (pixels >= PIXMAP_PARALLEL_MIN_PIXELS / 4 && Jobs_is_initialized()) {
+        Jobs_parallel_for((size_t)dst->height, 32, resample_range, &job);
+    } else {
+        resample_range(0, (size_t)dst->height, &job);
+    }
+    filter_free(&horizontal);
+    filter_free(&vertical);
+}
+
+
+// Уменьшить вдвое средним 2x2 (размеры источника чётные):
+static void box_half_range(size_t start, size_t end, void *data) {
+    PixmapRowsJob *job = (PixmapRowsJob*)data;
+    int ch = job->dst->channels;
+    size_t src_stride = Pixmap_get_stride(job->src);
+    size_t dst_stride = Pixmap_get_stride(job->dst);
+    size_t row_size = (size_t)job->dst->width * ch;
+    for (size_t y = start; y < end; y++) {
+        const uint8_t *a = job->src->data + (y * 2) * src_stride;
+        const uint8_t *b = a + src_stride;
+        uint8_t *out = job->dst->data + y * dst_stride;
+        for (size_t x = 0; x < row_size; x++) {
+            size_t i = (x / ch) * ch * 2 + x % ch;
+            out[x] = (uint8_t)((a[i] + a[i + ch] + b[i] + b[i + ch] + 2) >> 2);
+        }
+    }
+}
+
+
+// Построить следующий уровень мипмапов:
+static void build_mip_level(const Pixmap *src, Pixmap *dst, PixmapMipFilter filter, bool srgb) {
+    if (filter == PIXMAP_MIP_BOX && !srgb && src->width == dst->width * 2 && src->height == dst->height * 2) {
+        PixmapRowsJob job = { .src = src, .dst = dst, .func = NULL };
+        size_t pixels = (size_t)dst->width * dst->height;
+        if (pixels >= PIXMAP_PARALLEL_MIN_PIXELS && Jobs_is_initialized()) {
+            Jobs_parallel_for((size_t)dst->height, rows_batch(dst), box_half_range, &job);
+        } else {
+            box_half_range(0, (size_t)dst->height, &job);
+        }
+        return;
+    }
+    if (filter == PIXMAP_MIP_KAISER) resample(src, dst, kernel_kaiser, KAISER_WIDTH, srgb);
+    else resample(src, dst, kernel_box, 0.5f, srgb);
+}
+
+
+// Заполнить поля новой картинки со своей плотно упакованной памятью:
+static Pixmap* pixmap_init(Pixmap *pixmap, int width, int height, int channels, PixmapType type, unsigned char *data) {
+    pixmap->width = width;
+    pixmap->height = height;
+    pixmap->channels = channels;
+    pixmap->type = type;
+    pixmap->stride = (size_t)width * channels * Pixmap_type_size(type);
+    pixmap->parent = NULL;
+    atomic_init(&pixmap->refs, 1);
+    pixmap->data = data;
+    return pixmap;
+}
+
+
+// Декодировать картинку из отображения файла (отображение закрывается). Ошибка - стандартная картинка:
+static Pixmap* decode_map(FileMap *map, const char *filepath, int format, PixmapType type) {
+    if (!map) {
+        crash_print("Pixmap_load Error: file \"%s\" not found.\n", filepath);
+        return Pixmap_create_default();
+    }
+    Pixmap *pixmap = Pixmap_decode_typed(map->data, map->size, format, type);
+    bool empty = map->size == 0;
+    Files_unmap(&map);
+    if (!pixmap) {
+        // Причина ошибки stb_image - общая переменная, при параллельном декодировании может быть от соседней картинки:
+        const char *reason = empty ? "empty file" : stbi_failure_reason();
+        crash_print("Pixmap_load Error: failed to decode \"%s\" (%s).\n", filepath, reason ? reason : "unknown");
+        return Pixmap_create_default();
+    }
+    return pixmap;
+}
+
+
+// Задача декодирования одной картинки пакета:
+static void batch_decode(void *data) {
+    PixmapBatchItem *item = (PixmapBatchItem*)data;
+    PixmapBatch *batch = item->batch;
+    FileMap *map = item->map;
+    item->map = NULL;
+    Pixmap *pixmap = item->path ? decode_map(map, item->path, batch->format, PIXMAP_U8) : Pixmap_create_default();
+
+    mtx_lock(&batch->lock);
+    item->pixmap = pixmap;
+    batch->completed[batch->completed_tail++] = item->index;
+    mtx_unlock(&batch->lock);
+}
+
+
+// Запустить декодирование следующих картинок, пока они помещаются в бюджет памяти.
+// Размер картинки узнаётся по заголовку файла до декодирования, одна картинка запускается всегда. Отображение файла
+// и чтение заголовка идут вне блокировки, чтобы воркеры и Pixmap_batch_next не ждали диск:
+static void batch_submit(PixmapBatch *batch) {
+    while (true) {
+        // Берём следующую картинку (если её уже проверяет другой поток - он и запустит):
+        mtx_lock(&batch->lock);
+        if (batch->cancelled || batch->probing || batch->next_submit >= batch->count) {
+            mtx_unlock(&batch->lock);
+            return;
+        }
+        PixmapBatchItem *item = &batch->items[batch->next_submit];
+        bool probe = !item->probed;
+        batch->probing = probe;
+        mtx_unlock(&batch->lock);
+
+        // Проверяем без блокировки (до запуска картинкой владеет только этот поток):
+        if (probe) {
+            if (item->path) {
+                item->map = Files_map(item->path, FILE_MAP_SEQUENTIAL);
+                int width = 0, height = 0, channels = 0;
+                if (item->map && stbi_info_from_memory(item->map->data, (int)item->map->size, &width, &height, &channels)) {
+                    item->bytes = (size_t)width * height * batch->format;
+                }
+            }
+            item->probed = true;
+        }
+
+        // Запускаем, если помещается в бюджет:
+        mtx_lock(&batch->lock);
+        batch->probing = false;
+        bool fits = batch->memory_budget == 0 || batch->in_flight_bytes + item->bytes <= batch->memory_budget;
+        bool launch = !batch->cancelled && (fits || batch->in_flight == 0);
+        if (launch) {
+            batch->in_flight_bytes += item->bytes;
+            batch->in_flight++;
+            batch->next_submit++;
+        }
+        mtx_unlock(&batch->lock);
+        if (!launch) return;
+        Jobs_run(batch_decode, item, NULL);  // Без системы задач декодирование выполнится прямо здесь.
+    }
+}
+
 
 // Создать картинку:
 Pixmap* Pixmap_create(int width, int height, int channels) {
+    return Pixmap_create_typed(width, height, channels, PIXMAP_U8);
+}
+
+
+// Создать картинку с заданным типом значения канала:
+Pixmap* Pixmap_create_typed(int width, int height, int channels, PixmapType type) {
     Pixmap *pixmap = (Pixmap*)mm_alloc(sizeof(Pixmap));
-    size_t size = width * height * channels;
-    pixmap->data = (unsigned char*)mm_alloc(size);
+    size_t size = (size_t)width * height * channels * Pixmap_type_size(type);
+    pixmap_init(pixmap, width, height, channels, type, (unsigned char*)mm_alloc(size));
     memset(pixmap->data, 0, size);
-    pixmap->width = width;
-    pixmap->height = height;
-    pixmap->channels = channels;
-    pixmap->from_stbi = false;
     return pixmap;
 }
 
 
+// Получить размер значения канала в байтах:
+size_t Pixmap_type_size(PixmapType type) {
+    switch (type) {
+        case PIXMAP_U16: return 2;
+        case PIXMAP_F16: return 2;
+        case PIXMAP_F32: return 4;
+        default:         return 1;
+    }
+}
+
+
+// Получить размер пикселя в байтах:
+size_t Pixmap_get_pixel_size(const Pixmap *pixmap) {
+    if (!pixmap) return 0;
+    return (size_t)pixmap->channels * Pixmap_type_size(pixmap->type);
+}
+
+
 // Уничтожить картинку:
 void Pixmap_destroy(Pixmap **pixmap) {
     if (!pixmap || !*pixmap) return;
-    if ((*pixmap)->data != NULL) {
-        if ((*pixmap)->from_stbi) {
-            stbi_image_free((*pixmap)->data);
-            mm_used_size_sub(Pixmap_get_size(*pixmap));
-        } else { mm_free((*pixmap)->data); }
-    }
-    mm_free(*pixmap);
+    Pixmap *self = *pixmap;
     *pixmap = NULL;
+    if (atomic_fetch_sub(&self->refs, 1) != 1) return;  // Память ещё используют представления.
+    if (self->parent) Pixmap_destroy(&self->parent);
+    else mm_free(self->data);
+    mm_free(self);
+}
+
+
+// Создать представление области картинки без копирования:
+Pixmap* Pixmap_create_view(Pixmap *source, int x, int y, int width, int height) {
+    if (!source || !source->data || x < 0 || y < 0 || width <= 0 || height <= 0) return NULL;
+    if (x > source->width - width || y > source->height - height) return NULL;
+    Pixmap *root = source->parent ? source->parent : source;  // Ссылку держим на владельца памяти.
+    atomic_fetch_add(&root->refs, 1);
+
+    Pixmap *view = (Pixmap*)mm_alloc(sizeof(Pixmap));
+    size_t stride = Pixmap_get_stride(source);
+    unsigned char *data = source->data + (size_t)y * stride + (size_t)x * Pixmap_get_pixel_size(source);
+    pixmap_init(view, width, height, source->channels, source->type, data);
+    view->stride = stride;
+    view->parent = root;
+    return view;
+}
+
+
+// Получить шаг строк в байтах:
+size_t Pixmap_get_stride(const Pixmap *pixmap) {
+    if (!pixmap) return 0;
+    return pixmap->stride ? pixmap->stride : (size_t)pixmap->width * Pixmap_get_pixel_size(pixmap);
+}
+
+
+// Упакованы ли строки плотно:
+bool Pixmap_is_contiguous(const Pixmap *pixmap) {
+    return pixmap && Pixmap_get_stride(pixmap) == (size_t)pixmap->width * Pixmap_get_pixel_size(pixmap);
 }
 
 
 // Загрузить картинку:
 Pixmap* Pixmap_load(const char *filepath, int format) {
-    Pixmap *pixmap = (Pixmap*)mm_alloc(sizeof(Pixmap));
+    if (!format) format = PIXMAP_RGBA;
+    if (filepath == NULL) return Pixmap_create_default();
+
+    // Готовые пиксели из кэша (.rawtex) - без распаковки PNG:
+    if (RawTex_is_enabled()) {
+        RawTex *rawtex = RawTex_load(filepath, format, false, false);
+        if (rawtex) {
+            size_t size;
+            int width, height;
+            const uint8_t *data = RawTex_get_level(rawtex, 0, &size, &width, &height);
+            Pixmap *pixmap = (Pixmap*)mm_alloc(sizeof(Pixmap));
+            pixmap_init(pixmap, width, height, format, PIXMAP_U8, (unsigned char*)mm_alloc(size));
+            memcpy(pixmap->data, data, size);
+            RawTex_close(&rawtex);
+            return pixmap;
+        }
+    }
+
+    // Читаем через отображение файла (работает и для файлов из смонтированных архивов):
+    return decode_map(Files_map(filepath, FILE_MAP_SEQUENTIAL), filepath, format, PIXMAP_U8);
+}
+
+
+// Загрузить картинку с заданным типом значения канала:
+Pixmap* Pixmap_load_typed(const char *filepath, int format, PixmapType type) {
+    if (type == PIXMAP_U8) return Pixmap_load(filepath, format);
     if (!format) format = PIXMAP_RGBA;
     if (filepath == NULL) {
-        mm_free(pixmap);
-        return Pixmap_create_default();
+        Pixmap *fallback = Pixmap_create_default();
+        Pixmap *pixmap = Pixmap_convert_type(fallback, type);
+        Pixmap_destroy(&fallback);
+        return pixmap;
     }
-    pixmap->data = stbi_load(filepath, &pixmap->width, &pixmap->height, NULL, format);
-    pixmap->channels = format;
-    if (pixmap->data == NULL) {
-        crash_print("Pixmap_load Error: file \"%s\" not found.\n", filepath);
+    Pixmap *pixmap = decode_map(Files_map(filepath, FILE_MAP_SEQUENTIAL), filepath, format, type);
+    if (pixmap->type != type) {  // Стандартная картинка вместо ненайденного файла.
+        Pixmap *converted = Pixmap_convert_type(pixmap, type);
+        Pixmap_destroy(&pixmap);
+        pixmap = converted;
+    }
+    return pixmap;
+}
+
+
+// Декодировать картинку из памяти (PNG, JPG, BMP, TGA...). NULL - не удалось:
+Pixmap* Pixmap_decode(const void *data, size_t size, int format) {
+    return Pixmap_decode_typed(data, size, format, PIXMAP_U8);
+}
+
+
+// Декодировать картинку из памяти с заданным типом значения канала:
+Pixmap* Pixmap_decode_typed(const void *data, size_t size, int format, PixmapType type) {
+    if (!data || size == 0 || size > INT32_MAX) return NULL;
+    if (!format) format = PIXMAP_RGBA;
+    Pixmap *pixmap = (Pixmap*)mm_alloc(sizeof(Pixmap));
+    pixmap_init(pixmap, 0, 0, format, type, NULL);
+
+    // Временные буферы stb_image - в арене потока (если включена), итоговые пиксели - в mm:
+    size_t scratch_size = atomic_load(&pixmap_scratch_size);
+    ScratchArena *arena = scratch_size ? Scratch_get_thread(scratch_size) : NULL;
+    ScratchArena *previous = Scratch_bind(arena);
+    size_t mark = Scratch_mark(arena);
+    const stbi_uc *bytes = (const stbi_uc*)data;
+    switch (type) {
+        case PIXMAP_U8: {
+            pixmap->data = stbi_load_from_memory(bytes, (int)size, &pixmap->width, &pixmap->height, NULL, format);
+            break;
+        }
+        case PIXMAP_U16: {
+            pixmap->data = (unsigned char*)stbi_load_16_from_memory(bytes, (int)size, &pixmap->width, &pixmap->height, NULL, format);
+            break;
+        }
+        case PIXMAP_F16:
+        case PIXMAP_F32: {
+            pixmap->data = (unsigned char*)stbi_loadf_from_memory(bytes, (int)size, &pixmap->width, &pixmap->height, NULL, format);
+            if (!pixmap->data || type == PIXMAP_F32) break;
+
+            // Половинная точность - из float (float-буфер во временной памяти stb):
+            float *pixels = (float*)pixmap->data;
+            size_t count = (size_t)pixmap->width * pixmap->height * format;
+            pixmap->data = (unsigned char*)mm_alloc(count * sizeof(uint16_t));
+            PixOps_f32_to_f16(pixels, (uint16_t*)pixmap->data, count);
+            stbi_image_free(pixels);
+            break;
+        }
+    }
+    if (pixmap->data && Scratch_owns(arena, pixmap->data)) {
+        unsigned char *pixels = (unsigned char*)mm_alloc(Pixmap_get_size(pixmap));
+        memcpy(pixels, pixmap->data, Pixmap_get_size(pixmap));
+        pixmap->data = pixels;
+    }
+    Scratch_rewind(arena, mark);
+    Scratch_bind(previous);
+    pixmap->stride = (size_t)pixmap->width * Pixmap_get_pixel_size(pixmap);
+
+    if (!pixmap->data) {
         mm_free(pixmap);
-        return Pixmap_create_default();
+        return NULL;
     }
-    pixmap->from_stbi = true;
-    mm_used_size_add(Pixmap_get_size(pixmap));
     return pixmap;
 }
 
 
+// Задать размер арены потока для временных буферов декодирования:
+void Pixmap_set_scratch_size(size_t size) {
+    atomic_store(&pixmap_scratch_size, size);
+    if (size == 0) Scratch_release_thread();
+}
+
+
+// Начать загрузку картинок в потоках системы задач:
+PixmapBatch* Pixmap_load_batch(const char **paths, size_t count, int format, size_t memory_budget) {
+    if (!paths) count = 0;
+    PixmapBatch *batch = (PixmapBatch*)mm_alloc(sizeof(PixmapBatch));
+    memset(batch, 0, sizeof(PixmapBatch));
+    batch->count = count;
+    batch->format = format ? format : PIXMAP_RGBA;
+    batch->memory_budget = memory_budget;
+    batch->items = (PixmapBatchItem*)mm_calloc(count > 0 ? count : 1, sizeof(PixmapBatchItem));
+    batch->completed = (size_t*)mm_alloc(sizeof(size_t) * (count > 0 ? count : 1));
+    for (size_t i = 0; i < count; i++) {
+        batch->items[i].batch = batch;
+        batch->items[i].index = i;
+        batch->items[i].path = paths[i] ? mm_strdup(paths[i]) : NULL;
+    }
+    mtx_init(&batch->lock, mtx_plain);
+    batch_submit(batch);
+    return batch;
+}
+
+
+// Получить следующую готовую картинку (в порядке готовности):
+Pixmap* Pixmap_batch_next(PixmapBatch *batch, bool wait, size_t *out_index) {
+    if (!batch) return NULL;
+    while (true) {
+        mtx_lock(&batch->lock);
+        if (batch->completed_head < batch->completed_tail) {
+            PixmapBatchItem *item = &batch->items[batch->completed[batch->completed_head++]];
+            Pixmap *pixmap = item->pixmap;
+            item->pixmap = NULL;
+            batch->in_flight_bytes -= item->bytes;  // Картинка теперь принадлежит вызывающему - бюджет свободен.
+            batch->in_flight--;
+            batch->delivered++;
+            mtx_unlock(&batch->lock);
+            if (out_index) *out_index = item->index;
+            batch_submit(batch);
+            return pixmap;
+        }
+        bool finished = batch->delivered == batch->count;
+        mtx_unlock(&batch->lock);
+        if (finished || !wait) return NULL;
+
+        // Пока ждём - помогаем выполнять задачи (без воркеров декодирование идёт здесь):
+        if (!Jobs_try_execute()) thrd_yield();
+    }
+}
+
+
+// Все ли картинки уже отданы:
+bool Pixmap_batch_is_done(PixmapBatch *batch) {
+    if (!batch) return true;
+    mtx_lock(&batch->lock);
+    bool done = batch->delivered == batch->count;
+    mtx_unlock(&batch->lock);
+    return done;
+}
+
+
+// Уничтожить пакет (дожидается декодирования в полёте, неполученные картинки уничтожаются):
+void Pixmap_batch_destroy(PixmapBatch **batch) {
+    if (!batch || !*batch) return;
+    PixmapBatch *b = *batch;
+
+    // Новые задачи больше не запускаем, ждём запущенные:
+    mtx_lock(&b->lock);
+    b->cancelled = true;
+    mtx_unlock(&b->lock);
+    while (true) {
+        mtx_lock(&b->lock);
+        bool running = b->completed_tail < b->next_submit || b->probing;
+        mtx_unlock(&b->lock);
+        if (!running) break;
+        if (!Jobs_try_execute()) thrd_yield();
+    }
+
+    for (size_t i = 0; i < b->count; i++) {
+        PixmapBatchItem *item = &b->items[i];
+        Pixmap_destroy(&item->pixmap);
+        Files_unmap(&item->map);
+        mm_free(item->path);
+    }
+    mtx_destroy(&b->lock);
+    mm_free(b->items);
+    mm_free(b->completed);
+    mm_free(b);
+    *batch = NULL;
+}
+
+
 // Сохранить картинку:
 bool Pixmap_save(Pixmap *pixmap, const char *filepath, const char *format) {
     if (!pixmap || !pixmap->data || !filepath || !format) return false;
     bool success = false;
 
+    // HDR пишется во float, остальные форматы - 8 бит на канал. PNG пишется с шагом строк, остальным нужны плотные строки:
+    Pixmap *packed = NULL;
+    PixmapType want = strcmp(format, "hdr") == 0 ? PIXMAP_F32 : PIXMAP_U8;
+    if (pixmap->type != want) pixmap = packed = Pixmap_convert_type(pixmap, want);
+    else if (!Pixmap_is_contiguous(pixmap) && strcmp(format, "png") != 0) pixmap = packed = Pixmap_copy(pixmap);
+
     // Определяем формат по строке:
     if (strcmp(format, "png") == 0) {
         success = stbi_write_png(
             filepath, pixmap->width, pixmap->height,
             pixmap->channels, pixmap->data,
-            pixmap->width * pixmap->channels);
+            (int)Pixmap_get_stride(pixmap));
     } else if (strcmp(format, "jpg") == 0 || strcmp(format, "jpeg") == 0) {
         success = stbi_write_jpg(
             filepath, pixmap->width, pixmap->height, pixmap->channels, pixmap->data, 100); // Качество 100%.
@@ -79,10 +944,14 @@ bool Pixmap_save(Pixmap *pixmap, const char *filepath, const char *format) {
         success = stbi_write_bmp(filepath, pixmap->width, pixmap->height, pixmap->channels, pixmap->data);
     } else if (strcmp(format, "tga") == 0) {
         success = stbi_write_tga(filepath, pixmap->width, pixmap->height, pixmap->channels, pixmap->data);
+    } else if (strcmp(format, "hdr") == 0) {
+        success = stbi_write_hdr(filepath, pixmap->width, pixmap->height, pixmap->channels, (const float*)pixmap->data);
     } else {
         fprintf(stderr, "Pixmap_save: Unknown format: \"%s\"\n", format);
+        Pixmap_destroy(&packed);
         return false;
     }
+    Pixmap_destroy(&packed);
 
     // Если не удалось сохранить картинку:
     if (!success) {
@@ -99,13 +968,11 @@ Pixmap* Pixmap_copy(const Pixmap *source) {
     Pixmap* copy = (Pixmap*)mm_alloc(sizeof(Pixmap));
 
     // Копируем простые поля:
-    copy->width = source->width;
-    copy->height = source->height;
-    copy->channels = source->channels;
-    copy->from_stbi = false;
+    pixmap_init(copy, source->width, source->height, source->channels, source->type, NULL);
 
     // Вычисляем размер буфера:
-    size_t size = (size_t)source->width * source->height * source->channels;
+    size_t row_size = (size_t)source->width * Pixmap_get_pixel_size(source);
+    size_t size = row_size * source->height;
 
     if (source->data && size > 0) {
         copy->data = mm_alloc(size);
@@ -113,7 +980,11 @@ Pixmap* Pixmap_copy(const Pixmap *source) {
             mm_free(copy);
             mm_alloc_error();
         }
-        memcpy(copy->data, source->data, size);
+        if (Pixmap_is_contiguous(source)) memcpy(copy->data, source->data, size);
+        else {
+            size_t stride = Pixmap_get_stride(source);
+            for (int y = 0; y < source->height; y++) memcpy(copy->data + y * row_size, source->data + y * stride, row_size);
+        }
     } else { copy->data = NULL; }
 
     return copy;
@@ -132,11 +1003,7 @@ Pixmap* Pixmap_create_default() {
 
     // Копируем и используем стандартную картинку:
     memcpy(buffer, Pixmap_default_icon, Pixmap_default_icon_size);
-    pixmap->data = buffer;
-    pixmap->width = Pixmap_default_icon_width;
-    pixmap->height = Pixmap_default_icon_height;
-    pixmap->channels = PIXMAP_RGBA;
-    pixmap->from_stbi = false;
+    pixmap_init(pixmap, Pixmap_default_icon_width, Pixmap_default_icon_height, PIXMAP_RGBA, PIXMAP_U8, buffer);
 
     return pixmap;
 }
@@ -145,7 +1012,133 @@ Pixmap* Pixmap_create_default() {
 // Получить размер картинки в байтах:
 size_t Pixmap_get_size(Pixmap *pixmap) {
     if (!pixmap) return 0;
-    return pixmap->width * pixmap->height * pixmap->channels;
+    return (size_t)pixmap->width * pixmap->height * Pixmap_get_pixel_size(pixmap);
+}
+
+
+// Создать копию картинки с другим типом значения канала:
+Pixmap* Pixmap_convert_type(const Pixmap *source, PixmapType type) {
+    if (!source || !source->data) return NULL;
+    if (source->type == type) return Pixmap_copy(source);
+    Pixmap *pixmap = Pixmap_create_typed(source->width, source->height, source->channels, type);
+    PixmapRowsJob job = { .src = source, .dst = pixmap, .func = NULL };
+    run_rows(&job, type_range);
+    return pixmap;
+}
+
+
+// Создать копию картинки с другим числом каналов:
+Pixmap* Pixmap_convert(const Pixmap *source, int channels) {
+    if (!source || !source->data || channels < 1 || channels > 4) return NULL;
+    if (source->channels == channels) return Pixmap_copy(source);
+    if (source->type != PIXMAP_U8) {
+        fprintf(stderr, "Pixmap_convert: Only 8-bit pixmaps are supported (use Pixmap_convert_type first).\n");
+        return NULL;
+    }
+    Pixmap *pixmap = Pixmap_create(source->width, source->height, channels);
+    for_rows(source, pixmap, NULL);
+    return pixmap;
+}
+
+
+// Поменять местами каналы R и B (RGBA <-> BGRA):
+void Pixmap_swizzle_rb(Pixmap *pixmap) {
+    if (!pixmap || !pixmap->data || pixmap->channels < 3 || pixmap->type != PIXMAP_U8) return;
+    for_rows(pixmap, pixmap, row_swap_rb);
+}
+
+
+// Отразить картинку по вертикали:
+void Pixmap_flip_vertical(Pixmap *pixmap) {
+    if (!pixmap || !pixmap->data || pixmap->height < 2) return;
+    size_t pixels = (size_t)pixmap->width * pixmap->height;
+    size_t half = (size_t)pixmap->height / 2;
+    if (pixels >= PIXMAP_PARALLEL_MIN_PIXELS && Jobs_is_initialized()) {
+        Jobs_parallel_for(half, flip_batch(pixmap), flip_range, pixmap);
+    } else {
+        flip_range(0, half, pixmap);
+    }
+}
+
+
+// Умножить цвет на альфу (только RGBA):
+void Pixmap_premultiply(Pixmap *pixmap) {
+    if (!pixmap || !pixmap->data || pixmap->channels != PIXMAP_RGBA || pixmap->type != PIXMAP_U8) return;
+    for_rows(pixmap, pixmap, row_premultiply);
+}
+
+
+// Разделить цвет на альфу (только RGBA):
+void Pixmap_unpremultiply(Pixmap *pixmap) {
+    if (!pixmap || !pixmap->data || pixmap->channels != PIXMAP_RGBA || pixmap->type != PIXMAP_U8) return;
+    for_rows(pixmap, pixmap, row_unpremultiply);
+}
+
+
+// Перевести цвет из sRGB в линейное пространство (8 бит на канал, альфа не меняется):
+void Pixmap_srgb_to_linear(Pixmap *pixmap) {
+    if (!pixmap || !pixmap->data || pixmap->type != PIXMAP_U8) return;
+    for_rows(pixmap, pixmap, PixOps_srgb_to_linear);
+}
+
+
+// Перевести цвет из линейного пространства в sRGB (8 бит на канал, альфа не меняется):
+void Pixmap_linear_to_srgb(Pixmap *pixmap) {
+    if (!pixmap || !pixmap->data || pixmap->type != PIXMAP_U8) return;
+    for_rows(pixmap, pixmap, PixOps_linear_to_srgb);
+}
+
+
+// Изменить размер картинки (новая картинка):
+Pixmap* Pixmap_resize(const Pixmap *source, int width, int height, PixmapResizeFilter filter) {
+    if (!source || !source->data || source->width <= 0 || source->height <= 0 || width <= 0 || height <= 0) return NULL;
+    if (width == source->width && height == source->height) return Pixmap_copy(source);
+    if (source->type != PIXMAP_U8) {
+        fprintf(stderr, "Pixmap_resize: Only 8-bit pixmaps are supported.\n");
+        return NULL;
+    }
+    Pixmap *pixmap = Pixmap_create(width, height, source->channels);
+    switch (filter) {
+        case PIXMAP_RESIZE_BILINEAR: { resample(source, pixmap, kernel_triangle, 1.0f, false); break; }
+        case PIXMAP_RESIZE_BICUBIC:  { resample(source, pixmap, kernel_cubic, 2.0f, false); break; }
+        default:                     { resample(source, pixmap, kernel_lanczos3, 3.0f, false); break; }
+    }
+    return pixmap;
+}
+
+
+// Построить цепочку мипмапов на процессоре:
+PixmapMips* Pixmap_build_mips(const Pixmap *source, PixmapMipFilter filter, bool srgb) {
+    if (!source || !source->data || source->width <= 0 || source->height <= 0) return NULL;
+    if (source->type != PIXMAP_U8) {
+        fprintf(stderr, "Pixmap_build_mips: Only 8-bit pixmaps are supported.\n");
+        return NULL;
+    }
+    PixmapMips *mips = (PixmapMips*)mm_alloc(sizeof(PixmapMips));
+    memset(mips, 0, sizeof(PixmapMips));
+    mips->levels[0] = Pixmap_copy(source);
+    mips->count = 1;
+
+    // Каждый уровень строится из предыдущего, пока обе стороны не станут 1:
+    while (mips->count < PIXMAP_MIPS_MAX) {
+        const Pixmap *prev = mips->levels[mips->count - 1];
+        if (prev->width == 1 && prev->height == 1) break;
+        int width = prev->width > 1 ? prev->width / 2 : 1;
+        int height = prev->height > 1 ? prev->height / 2 : 1;
+        Pixmap *level = Pixmap_create(width, height, prev->channels);
+        build_mip_level(prev, level, filter, srgb);
+        mips->levels[mips->count++] = level;
+    }
+    return mips;
+}
+
+
+// Уничтожить цепочку мипмапов:
+void Pixmap_destroy_mips(PixmapMips **mips) {
+    if (!mips || !*mips) return;
+    for (int i = 0; i < (*mips)->count; i++) Pixmap_destroy(&(*mips)->levels[i]);
+    mm_free(*mips);
+    *mips = NULL;
 }
 
 
@@ -15,6 +15,12 @@
 #define PIXMAP_RGB  3
 #define PIXMAP_RGBA 4
 
+// Начиная с какого числа пикселей операции над картинкой делятся по строкам между потоками системы задач:
+#define PIXMAP_PARALLEL_MIN_PIXELS (256 * 256)
+
+// Максимум уровней в цепочке мипмапов (основа до 32768 пикселей):
+#define PIXMAP_MIPS_MAX 16
+
 
 // Определяем глобальные переменные стандартной картинки:
 extern const unsigned char Pixmap_default_icon[];
@@ -23,37 +29,157 @@ extern const int Pixmap_default_icon_width;
 extern const int Pixmap_default_icon_height;
 
 
+// Тип значения канала:
+typedef enum PixmapType {
+    PIXMAP_U8,   // 8 бит без знака (0..255), по умолчанию.
+    PIXMAP_U16,  // 16 бит без знака (0..65535).
+    PIXMAP_F16,  // Половинная точность (IEEE 754 binary16), вдвое меньше float для HDR и карт симуляции.
+    PIXMAP_F32,  // float.
+} PixmapType;
+
+
+// Фильтр уменьшения при построении мипмапов:
+typedef enum PixmapMipFilter {
+    PIXMAP_MIP_BOX,     // Среднее 2x2 (как glGenerateMipmap).
+    PIXMAP_MIP_KAISER,  // Окно Кайзера (sinc, ширина 3, alpha 4): резче, меньше муара.
+} PixmapMipFilter;
+
+
+// Фильтр изменения размера (раздельный: сначала по горизонтали, потом по вертикали):
+typedef enum PixmapResizeFilter {
+    PIXMAP_RESIZE_BILINEAR,  // Треугольник (при уменьшении усредняет все пиксели под ним).
+    PIXMAP_RESIZE_BICUBIC,   // Катмулл-Ром.
+    PIXMAP_RESIZE_LANCZOS,   // Ланцош-3 (самый резкий, возможен лёгкий ореол на контрастных краях).
+} PixmapResizeFilter;
+
+
 // Объявление структур:
-typedef struct Pixmap Pixmap;  // Картинка.
+typedef struct Pixmap Pixmap;            // Картинка.
+typedef struct PixmapMips PixmapMips;    // Цепочка мипмапов.
+typedef struct PixmapBatch PixmapBatch;  // Пакетная загрузка картинок в потоках системы задач (pixmap.c).
 
 
-// Структура картинки:
+// Структура картинки. Строки идут с шагом stride байт (у представлений - шаг родителя):
 struct Pixmap {
     int width;
     int height;
     int channels;
-    bool from_stbi;
+    PixmapType type;     // Тип значения канала (обработка, ресайз и мипмапы - только для PIXMAP_U8).
+    size_t stride;       // Байт от начала строки до начала следующей (0 - строки плотно упакованы).
+    Pixmap *parent;      // Чью память использует представление (NULL - память своя).
+    atomic_int refs;     // Ссылки на картинку: она сама и её представления.
     unsigned char* data;
 };
 
 
-// Создать картинку:
+// Цепочка мипмапов (levels[0] - копия исходной картинки, каждый следующий уровень вдвое меньше, до 1x1):
+struct PixmapMips {
+    int count;
+    Pixmap *levels[PIXMAP_MIPS_MAX];
+};
+
+
+// Создать картинку (8 бит на канал):
 Pixmap* Pixmap_create(int width, int height, int channels);
 
-// Уничтожить картинку:
+// Создать картинку с заданным типом значения канала:
+Pixmap* Pixmap_create_typed(int width, int height, int channels, PixmapType type);
+
+// Получить размер значения канала в байтах:
+size_t Pixmap_type_size(PixmapType type);
+
+// Получить размер пикселя в байтах (каналы * размер значения):
+size_t Pixmap_get_pixel_size(const Pixmap *pixmap);
+
+// Уничтожить картинку (память освобождается, когда уничтожены и все её представления):
 void Pixmap_destroy(Pixmap **pixmap);
 
-// Загрузить картинку:
+// Создать представление области картинки без копирования (держит ссылку на память родителя). NULL - область
+// выходит за картинку:
+Pixmap* Pixmap_create_view(Pixmap *source, int x, int y, int width, int height);
+
+// Получить шаг строк в байтах:
+size_t Pixmap_get_stride(const Pixmap *pixmap);
+
+// Упакованы ли строки плотно (шаг равен width * размер пикселя):
+bool Pixmap_is_contiguous(const Pixmap *pixmap);
+
+// Загрузить картинку (если включён кэш RawTex_set_cache_dir - готовые пиксели берутся из него):
 Pixmap* Pixmap_load(const char *filepath, int format);
 
-// Сохранить картинку:
+// Декодировать картинку из памяти (PNG, JPG, BMP, TGA...). NULL - не удалось:
+Pixmap* Pixmap_decode(const void *data, size_t size, int format);
+
+// Загрузить картинку с заданным типом значения канала. PIXMAP_F32/F16 - через stbi_loadf (HDR как есть, 8-битные
+// форматы переводятся в линейное пространство), PIXMAP_U16 - 16-битные PNG без потери точности. Кэш не используется:
+Pixmap* Pixmap_load_typed(const char *filepath, int format, PixmapType type);
+
+// Декодировать картинку из памяти с заданным типом значения канала. NULL - не удалось:
+Pixmap* Pixmap_decode_typed(const void *data, size_t size, int format, PixmapType type);
+
+// Задать размер арены потока для временных буферов декодирования (0 - выключить, по умолчанию). Арена каждого
+// потока растёт до size и переиспользуется между картинками. 0 также уничтожает арену вызывающего потока:
+void Pixmap_set_scratch_size(size_t size);
+
+// Начать загрузку картинок в потоках системы задач (memory_budget = 0 - без ограничения памяти). Декодирование идёт,
+// пока декодированные, но ещё не полученные картинки помещаются в бюджет (размер узнаётся по заголовку файла).
+// Пути копируются. Картинки забираются через Pixmap_batch_next в порядке готовности:
+PixmapBatch* Pixmap_load_batch(const char **paths, size_t count, int format, size_t memory_budget);
+
+// Получить следующую готовую картинку (её нужно уничтожить). wait = false - не ждать (NULL - пока ничего не готово).
+// NULL при wait = true - все картинки уже отданы. out_index - индекс пути картинки:
+Pixmap* Pixmap_batch_next(PixmapBatch *batch, bool wait, size_t *out_index);
+
+// Все ли картинки уже отданы:
+bool Pixmap_batch_is_done(PixmapBatch *batch);
+
+// Уничтожить пакет (дожидается декодирования в полёте, неполученные картинки уничтожаются):
+void Pixmap_batch_destroy(PixmapBatch **batch);
+
+// Сохранить картинку ("png", "jpg", "bmp", "tga", "hdr"). В "hdr" пишется float, остальные форматы - 8 бит на канал
+// (картинки других типов переводятся перед записью):
 bool Pixmap_save(Pixmap *pixmap, const char *filepath, const char *format);
 
-// Копировать картинку в памяти:
+// Копировать картинку в памяти (копия всегда плотно упакована, в том числе копия представления):
 Pixmap* Pixmap_copy(const Pixmap *source);
 
 // Создать стандартную картинку:
 Pixmap* Pixmap_create_default();
 
-// Получить размер картинки в байтах:
+// Получить размер пикселей картинки в байтах (без учёта шага строк):
 size_t Pixmap_get_size(Pixmap *pixmap);
+
+// Создать копию картинки с другим типом значения канала (целые нормируются в 0..1, float -> целые с насыщением,
+// f32 <-> f16 векторно через PixOps). Строки делятся между потоками системы задач:
+Pixmap* Pixmap_convert_type(const Pixmap *source, PixmapType type);
+
+// Создать копию картинки с другим числом каналов (только PIXMAP_U8; 1 <-> 3/4 через яркость, 3 <-> 4 векторно, новая альфа = 255):
+Pixmap* Pixmap_convert(const Pixmap *source, int channels);
+
+// Поменять местами каналы R и B (RGBA <-> BGRA):
+void Pixmap_swizzle_rb(Pixmap *pixmap);
+
+// Отразить картинку по вертикали:
+void Pixmap_flip_vertical(Pixmap *pixmap);
+
+// Умножить цвет на альфу (только RGBA):
+void Pixmap_premultiply(Pixmap *pixmap);
+
+// Разделить цвет на альфу (только RGBA):
+void Pixmap_unpremultiply(Pixmap *pixmap);
+
+// Перевести цвет из sRGB в линейное пространство (8 бит на канал, альфа не меняется):
+void Pixmap_srgb_to_linear(Pixmap *pixmap);
+
+// Перевести цвет из линейного пространства в sRGB (8 бит на канал, альфа не меняется):
+void Pixmap_linear_to_srgb(Pixmap *pixmap);
+
+// Изменить размер картинки (новая картинка). Строки делятся между потоками системы задач:
+Pixmap* Pixmap_resize(const Pixmap *source, int width, int height, PixmapResizeFilter filter);
+
+// Построить цепочку мипмапов на процессоре (srgb = true - усреднять в линейном пространстве, альфа линейна).
+// Строки уровня делятся между потоками системы задач, саму функцию можно вызывать из задач:
+PixmapMips* Pixmap_build_mips(const Pixmap *source, PixmapMipFilter filter, bool srgb);
+
+// Уничтожить цепочку мипмапов:
+void Pixmap_destroy_mips(PixmapMips **mips);
@@ -0,0 +1,700 @@
+//
+// pixops.c - Реализация ядер обработки строк пикселей.
+//
+// Для каждого ядра есть скалярная версия и, где это даёт выигрыш, версии SSE2/SSSE3/AVX2. Векторные версии
+// компилируются через target-атрибуты, поэтому сборка не требует -mavx2, а выбор происходит по процессору.
+// Хвосты строк, не кратные ширине вектора, обрабатывает скалярный код.
+//
+
+
+// Подключаем:
+#include "libs/tinycthread.h"
+#include "std.h"
+#include "pixops.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    #include <immintrin.h>
+    #define PIXOPS_X86 1
+    #define PIXOPS_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+
+// Объявление структур:
+typedef struct PixOps_Kernels PixOps_Kernels;  // Таблица ядер выбранного набора инструкций.
+
+
+// Таблица ядер выбранного набора инструкций:
+struct PixOps_Kernels {
+    void (*rgb_to_rgba)   (const uint8_t *src, uint8_t *dst, size_t count, uint8_t alpha);
+    void (*rgba_to_rgb)   (const uint8_t *src, uint8_t *dst, size_t count);
+    void (*swap_rb4)      (const uint8_t *src, uint8_t *dst, size_t count);
+    void (*swap_rows)     (uint8_t *a, uint8_t *b, size_t size);
+    void (*premultiply)   (const uint8_t *src, uint8_t *dst, size_t count);
+    void (*unpremultiply) (const uint8_t *src, uint8_t *dst, size_t count);
+    void (*f32_to_f16)    (const float *src, uint16_t *dst, size_t count);
+    void (*f16_to_f32)    (const uint16_t *src, float *dst, size_t count);
+};
+
+
+// Состояние модуля:
+static PixOps_Kernels kernels;
+static PixOps_ISA current_isa = PIXOPS_ISA_SCALAR;
+static PixOps_ISA best_isa = PIXOPS_ISA_SCALAR;
+static bool has_f16c = false;  // Аппаратное преобразование half (F16C, есть у всех процессоров с AVX2 на практике).
+static once_flag init_once = ONCE_FLAG_INIT;
+
+// Таблицы (заполняются один раз):
+static uint32_t unpremultiply_rcp[256];  // (255 << 16) / a с округлением.
+static uint8_t srgb_to_linear_lut[256];
+static uint8_t linear_to_srgb_lut[256];
+
+
+// Скалярные ядра:
+
+
+static void rgb_to_rgba_scalar(const uint8_t *src, uint8_t *dst, size_t count, uint8_t alpha) {
+    for (size_t i = 0; i < count; i++, src += 3, dst += 4) {
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+        dst[3] = alpha;
+    }
+}
+
+
+static void rgba_to_rgb_scalar(const uint8_t *src, uint8_t *dst, size_t count) {
+    for (size_t i = 0; i < count; i++, src += 4, dst += 3) {
+        uint8_t r = src[0], g = src[1], b = src[2];
+        dst[0] = r;
+        dst[1] = g;
+        dst[2] = b;
+    }
+}
+
+
+static void swap_rb4_scalar(const uint8_t *src, uint8_t *dst, size_t count) {
+    for (size_t i = 0; i < count; i++, src += 4, dst += 4) {
+        uint8_t r = src[0], g = src[1], b = src[2], a = src[3];
+        dst[0] = b;
+        dst[1] = g;
+        dst[2] = r;
+        dst[3] = a;
+    }
+}
+
+
+static void swap_rows_scalar(uint8_t *a, uint8_t *b, size_t size) {
+    uint8_t tmp[256];
+    while (size > 0) {
+        size_t n = size < sizeof(tmp) ? size : sizeof(tmp);
+        memcpy(tmp, a, n);
+        memcpy(a, b, n);
+        memcpy(b, tmp, n);
+        a += n;
+        b += n;
+        size -= n;
+    }
+}
+
+
+// Точное деление на 255 с округлением для x = c * a (0..65025):
+static inline uint8_t mul_div255(uint32_t c, uint32_t a) {
+    uint32_t t = c * a + 128;
+    return (uint8_t)((t + (t >> 8)) >> 8);
+}
+
+
+static void premultiply_scalar(const uint8_t *src, uint8_t *dst, size_t count) {
+    for (size_t i = 0; i < count; i++, src += 4, dst += 4) {
+        uint32_t a = src[3];
+        dst[0] = mul_div255(src[0], a);
+        dst[1] = mul_div255(src[1], a);
+        dst[2] = mul_div255(src[2], a);
+        dst[3] = (uint8_t)a;
+    }
+}
+
+
+// Деление канала на альфу через таблицу обратных значений (одинаково во всех версиях ядра):
+static inline uint8_t div_alpha(uint32_t c, uint32_t rcp) {
+    uint32_t v = (c * rcp + 32768) >> 16;
+    return (uint8_t)(v > 255 ? 255 : v);
+}
+
+
+static void unpremultiply_scalar(const uint8_t *src, uint8_t *dst, size_t count) {
+    for (size_t i = 0; i < count; i++, src += 4, dst += 4) {
+        uint8_t a = src[3];
+        uint32_t rcp = unpremultiply_rcp[a];
+        dst[0] = div_alpha(src[0], rcp);
+        dst[1] = div_alpha(src[1], rcp);
+        dst[2] = div_alpha(src[2], rcp);
+        dst[3] = a;
+    }
+}
+
+
+// Векторные ядра:
+
+
+// float -> half с округлением к ближайшему чётному. NaN остаётся NaN (тихим, старшие биты мантиссы сохраняются),
+// как в F16C, поэтому все версии дают одинаковый результат:
+static inline uint16_t f32_to_f16_one(float value) {
+    uint32_t f;
+    memcpy(&f, &value, 4);
+    uint32_t sign = (f >> 16) & 0x8000u;
+    f &= 0x7FFFFFFFu;
+    if (f >= 0x47800000u) {  // >= 65536 (с учётом округления) - бесконечность или NaN.
+        if (f > 0x7F800000u) return (uint16_t)(sign | 0x7E00u | ((f >> 13) & 0x3FFu));
+        return (uint16_t)(sign | 0x7C00u);
+    }
+    if (f < 0x38800000u) {  // Меньше наименьшего нормального half - денормализованное число или ноль.
+        float tmp;
+        uint32_t magic = 0x3F000000u, bits;  // 0.5: мантисса денормали оказывается в младших битах суммы.
+        float magic_f;
+        memcpy(&magic_f, &magic, 4);
+        memcpy(&tmp, &f, 4);
+        tmp += magic_f;
+        memcpy(&bits, &tmp, 4);
+        return (uint16_t)(sign | (bits - magic));
+    }
+    uint32_t mant_odd = (f >> 13) & 1u;
+    f += 0xC8000FFFu + mant_odd;  // Смена смещения порядка (15 - 127) << 23 и округление.
+    return (uint16_t)(sign | (f >> 13));
+}
+
+
+static inline float f16_to_f32_one(uint16_t h) {
+    uint32_t o = (uint32_t)(h & 0x7FFFu) << 13;
+    uint32_t exp = o & 0x0F800000u;
+    o += 0x38000000u;  // (127 - 15) << 23.
+    if (exp == 0x0F800000u) {  // Бесконечность или NaN (NaN становится тихим).
+        o += 0x38000000u;
+        if (o & 0x007FFFFFu) o |= 0x00400000u;
+    } else if (exp == 0) {  // Денормализованное число или ноль.
+        float tmp, magic_f;
+        uint32_t magic = 0x38800000u;
+        o += 0x00800000u;
+        memcpy(&tmp, &o, 4);
+        memcpy(&magic_f, &magic, 4);
+        tmp -= magic_f;
+        memcpy(&o, &tmp, 4);
+    }
+    o |= (uint32_t)(h & 0x8000u) << 16;
+    float value;
+    memcpy(&value, &o, 4);
+    return value;
+}
+
+
+static void f32_to_f16_scalar(const float *src, uint16_t *dst, size_t count) {
+    for (size_t i = 0; i < count; i++) dst[i] = f32_to_f16_one(src[i]);
+}
+
+
+static void f16_to_f32_scalar(const uint16_t *src, float *dst, size_t count) {
+    for (size_t i = 0; i < count; i++) dst[i] = f16_to_f32_one(src[i]);
+}
+
+
+#if defined(PIXOPS_X86)
+
+PIXOPS_TARGET("sse2")
+static void swap_rb4_sse2(const uint8_t *src, uint8_t *dst, size_t count) {
+    const __m128i mask_ga = _mm_set1_epi32((int)0xFF00FF00);
+    const __m128i mask_rb = _mm_set1_epi32(0x00FF00FF);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i * 4));
+        __m128i rb = _mm_and_si128(v, mask_rb);
+        rb = _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16));
+        _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_or_si128(_mm_and_si128(v, mask_ga), rb));
+    }
+    swap_rb4_scalar(src + i * 4, dst + i * 4, count - i);
+}
+
+
+PIXOPS_TARGET("sse2")
+static void swap_rows_sse2(uint8_t *a, uint8_t *b, size_t size) {
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m128i a0 = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i a1 = _mm_loadu_si128((const __m128i*)(a + i + 16));
+        __m128i b0 = _mm_loadu_si128((const __m128i*)(b + i));
+        __m128i b1 = _mm_loadu_si128((const __m128i*)(b + i + 16));
+        _mm_storeu_si128((__m128i*)(a + i), b0);
+        _mm_storeu_si128((__m128i*)(a + i + 16), b1);
+        _mm_storeu_si128((__m128i*)(b + i), a0);
+        _mm_storeu_si128((__m128i*)(b + i + 16), a1);
+    }
+    swap_rows_scalar(a + i, b + i, size - i);
+}
+
+
+// Умножение 16-битных каналов на альфу (для альфа-канала множитель 255, он не меняется):
+PIXOPS_TARGET("sse2")
+static inline __m128i premultiply_half_sse2(__m128i px) {
+    const __m128i alpha_lanes = _mm_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1);
+    __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(px, 0xFF), 0xFF);
+    a = _mm_or_si128(_mm_andnot_si128(alpha_lanes, a), _mm_and_si128(alpha_lanes, _mm_set1_epi16(255)));
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(px, a), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+
+PIXOPS_TARGET("sse2")
+static void premultiply_sse2(const uint8_t *src, uint8_t *dst, size_t count) {
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i * 4));
+        __m128i lo = premultiply_half_sse2(_mm_unpacklo_epi8(v, zero));
+        __m128i hi = premultiply_half_sse2(_mm_unpackhi_epi8(v, zero));
+        _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_packus_epi16(lo, hi));
+    }
+    premultiply_scalar(src + i * 4, dst + i * 4, count - i);
+}
+
+
+// Те же преобразования half по 4 значения (ветвления заменены масками):
+PIXOPS_TARGET("sse2")
+static inline __m128i f32_to_f16_x4_sse2(__m128 value) {
+    const __m128i abs_mask = _mm_set1_epi32(0x7FFFFFFF);
+    __m128i f = _mm_castps_si128(value);
+    __m128i sign = _mm_and_si128(_mm_srli_epi32(f, 16), _mm_set1_epi32(0x8000));
+    f = _mm_and_si128(f, abs_mask);
+
+    __m128i is_big = _mm_cmpgt_epi32(f, _mm_set1_epi32(0x477FFFFF));
+    __m128i is_nan = _mm_cmpgt_epi32(f, _mm_set1_epi32(0x7F800000));
+    __m128i big = _mm_or_si128(_mm_set1_epi32(0x7C00),
+        _mm_and_si128(is_nan, _mm_or_si128(_mm_set1_epi32(0x0200), _mm_and_si128(_mm_srli_epi32(f, 13), _mm_set1_epi32(0x3FF)))));
+
+    __m128i is_small = _mm_cmplt_epi32(f, _mm_set1_epi32(0x38800000));
+    const __m128i magic = _mm_set1_epi32(0x3F000000);
+    __m128i small = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(f), _mm_castsi128_ps(magic))), magic);
+
+    __m128i mant_odd = _mm_and_si128(_mm_srli_epi32(f, 13), _mm_set1_epi32(1));
+    __m128i normal = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(f, _mm_set1_epi32((int)0xC8000FFF)), mant_odd), 13);
+
+    __m128i result = _mm_or_si128(_mm_and_si128(is_small, small), _mm_andnot_si128(is_small, normal));
+    result = _mm_or_si128(_mm_and_si128(is_big, big), _mm_andnot_si128(is_big, result));
+    return _mm_or_si128(result, sign);
+}
+
+
+PIXOPS_TARGET("sse2")
+static inline __m128 f16_to_f32_x4_sse2(__m128i h) {
+    const __m128i exp_mask = _mm_set1_epi32(0x0F800000);
+    __m128i o = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x7FFF)), 13);
+    __m128i exp = _mm_and_si128(o, exp_mask);
+    o = _mm_add_epi32(o, _mm_set1_epi32(0x38000000));
+
+    __m128i is_inf_nan = _mm_cmpeq_epi32(exp, exp_mask);
+    __m128i has_mant = _mm_cmpgt_epi32(_mm_and_si128(o, _mm_set1_epi32(0x007FFFFF)), _mm_setzero_si128());
+    __m128i inf_nan = _mm_add_epi32(o, _mm_set1_epi32(0x38000000));
+    inf_nan = _mm_or_si128(inf_nan, _mm_and_si128(has_mant, _mm_set1_epi32(0x00400000)));
+
+    __m128i is_denorm = _mm_cmpeq_epi32(exp, _mm_setzero_si128());
+    const __m128 magic = _mm_castsi128_ps(_mm_set1_epi32(0x38800000));
+    __m128i denorm = _mm_castps_si128(_mm_sub_ps(_mm_castsi128_ps(_mm_add_epi32(o, _mm_set1_epi32(0x00800000))), magic));
+
+    o = _mm_or_si128(_mm_and_si128(is_inf_nan, inf_nan), _mm_andnot_si128(is_inf_nan, o));
+    o = _mm_or_si128(_mm_and_si128(is_denorm, denorm), _mm_andnot_si128(is_denorm, o));
+    return _mm_castsi128_ps(_mm_or_si128(o, _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x8000)), 16)));
+}
+
+
+PIXOPS_TARGET("sse2")
+static void f32_to_f16_sse2(const float *src, uint16_t *dst, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i lo = f32_to_f16_x4_sse2(_mm_loadu_ps(src + i));
+        __m128i hi = f32_to_f16_x4_sse2(_mm_loadu_ps(src + i + 4));
+        // Упаковка 32 -> 16 бит без насыщения: знаковое расширение младших 16 бит, затем packs:
+        lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+        hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packs_epi32(lo, hi));
+    }
+    f32_to_f16_scalar(src + i, dst + i, count - i);
+}
+
+
+PIXOPS_TARGET("sse2")
+static void f16_to_f32_sse2(const uint16_t *src, float *dst, size_t count) {
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i h = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_ps(dst + i, f16_to_f32_x4_sse2(_mm_unpacklo_epi16(h, zero)));
+        _mm_storeu_ps(dst + i + 4, f16_to_f32_x4_sse2(_mm_unpackhi_epi16(h, zero)));
+    }
+    f16_to_f32_scalar(src + i, dst + i, count - i);
+}
+
+
+PIXOPS_TARGET("ssse3")
+static void rgb_to_rgba_ssse3(const uint8_t *src, uint8_t *dst, size_t count, uint8_t alpha) {
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i alpha_mask = _mm_set1_epi32((int)((uint32_t)alpha << 24));
+    size_t i = 0;
+    for (; i + 6 <= count; i += 4) {  // Читаем 16 байт, используем 12 (4 пикселя).
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i * 3));
+        _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_or_si128(_mm_shuffle_epi8(v, shuffle), alpha_mask));
+    }
+    rgb_to_rgba_scalar(src + i * 3, dst + i * 4, count - i, alpha);
+}
+
+
+PIXOPS_TARGET("ssse3")
+static void rgba_to_rgb_ssse3(const uint8_t *src, uint8_t *dst, size_t count) {
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    size_t i = 0;
+    for (; i + 6 <= count; i += 4) {  // Пишем 16 байт, полезны 12 (следующая итерация перезапишет хвост).
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i * 4));
+        _mm_storeu_si128((__m128i*)(dst + i * 3), _mm_shuffle_epi8(v, shuffle));
+    }
+    rgba_to_rgb_scalar(src + i * 4, dst + i * 3, count - i);
+}
+
+
+PIXOPS_TARGET("ssse3")
+static void swap_rb4_ssse3(const uint8_t *src, uint8_t *dst, size_t count) {
+    const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i * 4));
+        _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_shuffle_epi8(v, shuffle));
+    }
+    swap_rb4_scalar(src + i * 4, dst + i * 4, count - i);
+}
+
+
+PIXOPS_TARGET("avx2")
+static void rgb_to_rgba_avx2(const uint8_t *src, uint8_t *dst, size_t count, uint8_t alpha) {
+    const __m256i shuffle = _mm256_setr_epi8(
+        0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+        0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m256i alpha_mask = _mm256_set1_epi32((int)((uint32_t)alpha << 24));
+    size_t i = 0;
+    for (; i + 10 <= count; i += 8) {  // Две половины по 4 пикселя (вторая читает 16 байт со смещения 12).
+        const uint8_t *s = src + i * 3;
+        __m256i v = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)s)), _mm_loadu_si128((const __m128i*)(s + 12)), 1);
+        _mm256_storeu_si256((__m256i*)(dst + i * 4), _mm256_or_si256(_mm256_shuffle_epi8(v, shuffle), alpha_mask));
+    }
+    rgb_to_rgba_ssse3(src + i * 3, dst + i * 4, count - i, alpha);
+}
+
+
+PIXOPS_TARGET("avx2")
+static void rgba_to_rgb_avx2(const uint8_t *src, uint8_t *dst, size_t count) {
+    const __m256i shuffle = _mm256_setr_epi8(
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    size_t i = 0;
+    for (; i + 10 <= count; i += 8) {
+        __m256i v = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(src + i * 4)), shuffle);
+        uint8_t *d = dst + i * 3;
+        _mm_storeu_si128((__m128i*)d, _mm256_castsi256_si128(v));
+        _mm_storeu_si128((__m128i*)(d + 12), _mm256_extracti128_si256(v, 1));
+    }
+    rgba_to_rgb_ssse3(src + i * 4, dst + i * 3, count - i);
+}
+
+
+PIXOPS_TARGET("avx2")
+static void swap_rb4_avx2(const uint8_t *src, uint8_t *dst, size_t count) {
+    const __m256i shuffle = _mm256_setr_epi8(
+        2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+        2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(src + i * 4));
+        _mm256_storeu_si256((__m256i*)(dst + i * 4), _mm256_shuffle_epi8(v, shuffle));
+    }
+    swap_rb4_scalar(src + i * 4, dst + i * 4, count - i);
+}
+
+
+PIXOPS_TARGET("avx2")
+static void swap_rows_avx2(uint8_t *a, uint8_t *b, size_t size) {
+    size_t i = 0;
+    for (; i + 64 <= size; i += 64) {
+        __m256i a0 = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i a1 = _mm256_loadu_si256((const __m256i*)(a + i + 32));
+        __m256i b0 = _mm256_loadu_si256((const __m256i*)(b + i));
+        __m256i b1 = _mm256_loadu_si256((const __m256i*)(b + i + 32));
+        _mm256_storeu_si256((__m256i*)(a + i), b0);
+        _mm256_storeu_si256((__m256i*)(a + i + 32), b1);
+        _mm256_storeu_si256((__m256i*)(b + i), a0);
+        _mm256_storeu_si256((__m256i*)(b + i + 32), a1);
+    }
+    swap_rows_scalar(a + i, b + i, size - i);
+}
+
+
+PIXOPS_TARGET("avx2")
+static inline __m256i premultiply_half_avx2(__m256i px) {
+    const __m256i alpha_lanes = _mm256_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1);
+    __m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(px, 0xFF), 0xFF);
+    a = _mm256_blendv_epi8(a, _mm256_set1_epi16(255), alpha_lanes);
+    __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(px, a), _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+
+PIXOPS_TARGET("avx2")
+static void premultiply_avx2(const uint8_t *src, uint8_t *dst, size_t count) {
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(src + i * 4));
+        __m256i lo = premultiply_half_avx2(_mm256_unpacklo_epi8(v, zero));
+        __m256i hi = premultiply_half_avx2(_mm256_unpackhi_epi8(v, zero));
+        _mm256_storeu_si256((__m256i*)(dst + i * 4), _mm256_packus_epi16(lo, hi));
+    }
+    premultiply_sse2(src + i * 4, dst + i * 4, count - i);
+}
+
+
+// Деление на альфу: обратные значения берутся из таблицы сбором (gather) по 8 пикселей:
+PIXOPS_TARGET("avx2")
+static void unpremultiply_avx2(const uint8_t *src, uint8_t *dst, size_t count) {
+    const __m256i byte_mask = _mm256_set1_epi32(0xFF);
+    const __m256i round = _mm256_set1_epi32(32768);
+    const __m256i alpha_mask = _mm256_set1_epi32((int)0xFF000000);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(src + i * 4));
+        __m256i rcp = _mm256_i32gather_epi32((const int*)unpremultiply_rcp, _mm256_srli_epi32(v, 24), 4);
+        __m256i r = _mm256_and_si256(v, byte_mask);
+        __m256i g = _mm256_and_si256(_mm256_srli_epi32(v, 8), byte_mask);
+        __m256i b = _mm256_and_si256(_mm256_srli_epi32(v, 16), byte_mask);
+        r = _mm256_min_epu32(_mm256_srli_epi32(_mm256_add_epi32(_mm256_mullo_epi32(r, rcp), round), 16), byte_mask);
+        g = _mm256_min_epu32(_mm256_srli_epi32(_mm256_add_epi32(_mm256_mullo_epi32(g, rcp), round), 16), byte_mask);
+        b = _mm256_min_epu32(_mm256_srli_epi32(_mm256_add_epi32(_mm256_mullo_epi32(b, rcp), round), 16), byte_mask);
+        __m256i out = _mm256_or_si256(_mm256_or_si256(r, _mm256_slli_epi32(g, 8)), _mm256_slli_epi32(b, 16));
+        _mm256_storeu_si256((__m256i*)(dst + i * 4), _mm256_or_si256(out, _mm256_and_si256(v, alpha_mask)));
+    }
+    unpremultiply_scalar(src + i * 4, dst + i * 4, count - i);
+}
+
+
+// Аппаратное преобразование half (F16C), по 8 значений:
+PIXOPS_TARGET("avx,f16c")
+static void f32_to_f16_f16c(const float *src, uint16_t *dst, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128((__m128i*)(dst + i), h);
+    }
+    f32_to_f16_scalar(src + i, dst + i, count - i);
+}
+
+
+PIXOPS_TARGET("avx,f16c")
+static void f16_to_f32_f16c(const uint16_t *src, float *dst, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(src + i))));
+    }
+    f16_to_f32_scalar(src + i, dst + i, count - i);
+}
+
+#endif
+
+
+// Заполнить таблицу ядер для набора инструкций:
+static void select_kernels(PixOps_ISA isa) {
+    kernels.rgb_to_rgba = rgb_to_rgba_scalar;
+    kernels.rgba_to_rgb = rgba_to_rgb_scalar;
+    kernels.swap_rb4 = swap_rb4_scalar;
+    kernels.swap_rows = swap_rows_scalar;
+    kernels.premultiply = premultiply_scalar;
+    kernels.unpremultiply = unpremultiply_scalar;
+    kernels.f32_to_f16 = f32_to_f16_scalar;
+    kernels.f16_to_f32 = f16_to_f32_scalar;
+    #if defined(PIXOPS_X86)
+        if (isa >= PIXOPS_ISA_SSE2) {
+            kernels.swap_rb4 = swap_rb4_sse2;
+            kernels.swap_rows = swap_rows_sse2;
+            kernels.premultiply = premultiply_sse2;
+            kernels.f32_to_f16 = f32_to_f16_sse2;
+            kernels.f16_to_f32 = f16_to_f32_sse2;
+        }
+        if (isa >= PIXOPS_ISA_SSSE3) {
+            kernels.rgb_to_rgba = rgb_to_rgba_ssse3;
+            kernels.rgba_to_rgb = rgba_to_rgb_ssse3;
+            kernels.swap_rb4 = swap_rb4_ssse3;
+        }
+        if (isa >= PIXOPS_ISA_AVX2) {
+            kernels.rgb_to_rgba = rgb_to_rgba_avx2;
+            kernels.rgba_to_rgb = rgba_to_rgb_avx2;
+            kernels.swap_rb4 = swap_rb4_avx2;
+            kernels.swap_rows = swap_rows_avx2;
+            kernels.premultiply = premultiply_avx2;
+            kernels.unpremultiply = unpremultiply_avx2;
+            if (has_f16c) {
+                kernels.f32_to_f16 = f32_to_f16_f16c;
+                kernels.f16_to_f32 = f16_to_f32_f16c;
+            }
+        }
+    #endif
+    current_isa = isa;
+}
+
+
+// Определить процессор и заполнить таблицы:
+static void pixops_init() {
+    best_isa = PIXOPS_ISA_SCALAR;
+    #if defined(PIXOPS_X86)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("sse2")) best_isa = PIXOPS_ISA_SSE2;
+        if (__builtin_cpu_supports("ssse3")) best_isa = PIXOPS_ISA_SSSE3;
+        if (__builtin_cpu_supports("avx2")) best_isa = PIXOPS_ISA_AVX2;
+        has_f16c = __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+    #endif
+
+    unpremultiply_rcp[0] = 0;
+    for (uint32_t a = 1; a < 256; a++) unpremultiply_rcp[a] = ((255u << 16) + a / 2) / a;
+    for (int i = 0; i < 256; i++) {
+        float c = i / 255.0f;
+        float lin = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+        float srgb = c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+        srgb_to_linear_lut[i] = (uint8_t)(lin * 255.0f + 0.5f);
+        linear_to_srgb_lut[i] = (uint8_t)(srgb * 255.0f + 0.5f);
+    }
+    select_kernels(best_isa);
+}
+
+
+// Применить таблицу к цветовым каналам (альфа - последний канал при 2 и 4 каналах - не меняется):
+static void apply_lut(const uint8_t *lut, const uint8_t *src, uint8_t *dst, size_t count, int channels) {
+    if (channels == 4) {
+        for (size_t i = 0; i < count; i++, src += 4, dst += 4) {
+            uint8_t a = src[3];
+            dst[0] = lut[src[0]];
+            dst[1] = lut[src[1]];
+            dst[2] = lut[src[2]];
+            dst[3] = a;
+        }
+        return;
+    }
+    int color = channels == 2 ? 1 : channels;
+    for (size_t i = 0; i < count; i++, src += channels, dst += channels) {
+        for (int c = 0; c < channels; c++) dst[c] = c < color ? lut[src[c]] : src[c];
+    }
+}
+
+
+// Получить используемый набор инструкций:
+PixOps_ISA PixOps_get_isa() {
+    call_once(&init_once, pixops_init);
+    return current_isa;
+}
+
+
+// Получить лучший набор инструкций, поддерживаемый процессором:
+PixOps_ISA PixOps_get_best_isa() {
+    call_once(&init_once, pixops_init);
+    return best_isa;
+}
+
+
+// Выбрать набор инструкций (не выше поддерживаемого). Не вызывать во время работы ядер в других потоках:
+void PixOps_set_isa(PixOps_ISA isa) {
+    call_once(&init_once, pixops_init);
+    select_kernels(isa > best_isa ? best_isa : isa);
+}
+
+
+// Получить название набора инструкций:
+const char* PixOps_get_isa_name(PixOps_ISA isa) {
+    switch (isa) {
+        case PIXOPS_ISA_SSE2:  return "SSE2";
+        case PIXOPS_ISA_SSSE3: return "SSSE3";
+        case PIXOPS_ISA_AVX2:  return "AVX2";
+        default: return "scalar";
+    }
+}
+
+
+// RGB -> RGBA (alpha - значение нового канала). src и dst не должны пересекаться:
+void PixOps_rgb_to_rgba(const uint8_t *src, uint8_t *dst, size_t count, uint8_t alpha) {
+    call_once(&init_once, pixops_init);
+    kernels.rgb_to_rgba(src, dst, count, alpha);
+}
+
+
+// RGBA -> RGB. Можно на месте (src == dst):
+void PixOps_rgba_to_rgb(const uint8_t *src, uint8_t *dst, size_t count) {
+    call_once(&init_once, pixops_init);
+    kernels.rgba_to_rgb(src, dst, count);
+}
+
+
+// Поменять местами каналы R и B (RGBA <-> BGRA, RGB <-> BGR). Можно на месте:
+void PixOps_swap_rb(const uint8_t *src, uint8_t *dst, size_t count, int channels) {
+    call_once(&init_once, pixops_init);
+    if (channels == 4) {
+        kernels.swap_rb4(src, dst, count);
+    } else if (channels == 3) {
+        for (size_t i = 0; i < count; i++, src += 3, dst += 3) {
+            uint8_t r = src[0], g = src[1], b = src[2];
+            dst[0] = b;
+            dst[1] = g;
+            dst[2] = r;
+        }
+    } else if (src != dst) {
+        memcpy(dst, src, count * (size_t)channels);
+    }
+}
+
+
+// Обменять содержимое двух строк по size байт:
+void PixOps_swap_rows(uint8_t *a, uint8_t *b, size_t size) {
+    call_once(&init_once, pixops_init);
+    if (a != b) kernels.swap_rows(a, b, size);
+}
+
+
+// Умножить RGB на альфу (RGBA). Можно на месте:
+void PixOps_premultiply(const uint8_t *src, uint8_t *dst, size_t count) {
+    call_once(&init_once, pixops_init);
+    kernels.premultiply(src, dst, count);
+}
+
+
+// Разделить RGB на альфу (RGBA, при нулевой альфе цвет обнуляется). Можно на месте:
+void PixOps_unpremultiply(const uint8_t *src, uint8_t *dst, size_t count) {
+    call_once(&init_once, pixops_init);
+    kernels.unpremultiply(src, dst, count);
+}
+
+
+// sRGB -> линейное пространство по таблице (альфа - последний канал при 2 и 4 каналах - не меняется). Можно на месте:
+void PixOps_srgb_to_linear(const uint8_t *src, uint8_t *dst, size_t count, int channels) {
+    call_once(&init_once, pixops_init);
+    apply_lut(srgb_to_linear_lut, src, dst, count, channels);
+}
+
+
+// Линейное пространство -> sRGB по таблице (альфа - последний канал при 2 и 4 каналах - не меняется). Можно на месте:
+void PixOps_linear_to_srgb(const uint8_t *src, uint8_t *dst, size_t count, int channels) {
+    call_once(&init_once, pixops_init);
+    apply_lut(linear_to_srgb_lut, src, dst, count, channels);
+}
+
+
+// float -> half (IEEE 754 binary16, округление к ближайшему чётному):
+void PixOps_f32_to_f16(const float *src, uint16_t *dst, size_t count) {
+    call_once(&init_once, pixops_init);
+    kernels.f32_to_f16(src, dst, count);
+}
+
+
+// half -> float:
+void PixOps_f16_to_f32(const uint16_t *src, float *dst, size_t count) {
+    call_once(&init_once, pixops_init);
+    kernels.f16_to_f32(src, dst, count);
+}
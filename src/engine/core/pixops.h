@@ -0,0 +1,65 @@
+//
+// pixops.h - Векторизованные ядра обработки строк пикселей (SSE2/SSSE3/AVX2 с выбором при запуске и скалярный запасной путь).
+//
+// Ядра работают с непрерывными строками по 8 бит на канал, плюс преобразование float <-> half (F16C, если есть). Набор инструкций определяется один раз по процессору,
+// для бенчмарков и проверки его можно понизить через PixOps_set_isa. Обработка целых картинок (в том числе
+// параллельно по строкам) - в pixmap.h.
+//
+
+#pragma once
+
+
+// Подключаем:
+#include "std.h"
+
+
+// Набор инструкций ядер:
+typedef enum PixOps_ISA {
+    PIXOPS_ISA_SCALAR,  // Обычный код (любой процессор).
+    PIXOPS_ISA_SSE2,    // x86 SSE2.
+    PIXOPS_ISA_SSSE3,   // x86 SSSE3 (перестановка байт pshufb).
+    PIXOPS_ISA_AVX2,    // x86 AVX2.
+} PixOps_ISA;
+
+
+// Получить используемый набор инструкций:
+PixOps_ISA PixOps_get_isa();
+
+// Получить лучший набор инструкций, поддерживаемый процессором:
+PixOps_ISA PixOps_get_best_isa();
+
+// Выбрать набор инструкций (не выше поддерживаемого). Не вызывать во время работы ядер в других потоках:
+void PixOps_set_isa(PixOps_ISA isa);
+
+// Получить название набора инструкций:
+const char* PixOps_get_isa_name(PixOps_ISA isa);
+
+// RGB -> RGBA (alpha - значение нового канала). src и dst не должны пересекаться:
+void PixOps_rgb_to_rgba(const uint8_t *src, uint8_t *dst, size_t count, uint8_t alpha);
+
+// RGBA -> RGB. Можно на месте (src == dst):
+void PixOps_rgba_to_rgb(const uint8_t *src, uint8_t *dst, size_t count);
+
+// Поменять местами каналы R и B (RGBA <-> BGRA, RGB <-> BGR). Можно на месте:
+void PixOps_swap_rb(const uint8_t *src, uint8_t *dst, size_t count, int channels);
+
+// Обменять содержимое двух строк по size байт:
+void PixOps_swap_rows(uint8_t *a, uint8_t *b, size_t size);
+
+// Умножить RGB на альфу (RGBA). Можно на месте:
+void PixOps_premultiply(const uint8_t *src, uint8_t *dst, size_t count);
+
+// Разделить RGB на альфу (RGBA, при нулевой альфе цвет обнуляется). Можно на месте:
+void PixOps_unpremultiply(const uint8_t *src, uint8_t *dst, size_t count);
+
+// sRGB -> линейное пространство по таблице (альфа - последний канал при 2 и 4 каналах - не меняется). Можно на месте:
+void PixOps_srgb_to_linear(const uint8_t *src, uint8_t *dst, size_t count, int channels);
+
+// Линейное пространство -> sRGB по таблице (альфа - последний канал при 2 и 4 каналах - не меняется). Можно на месте:
+void PixOps_linear_to_srgb(const uint8_t *src, uint8_t *dst, size_t count, int channels);
+
+// float -> half (IEEE 754 binary16, округление к ближайшему чётному). count - число значений:
+void PixOps_f32_to_f16(const float *src, uint16_t *dst, size_t count);
+
+// half -> float (точно). count - число значений:
+void PixOps_f16_to_f32(const uint16_t *src, float *dst, size_t count);
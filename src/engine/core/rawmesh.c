@@ -0,0 +1,232 @@
+//
+// rawmesh.c - Реализация кэша готовых сеток (.rawmesh).
+//
+
+
+// Подключаем:
+#include "std.h"
+#include "mm.h"
+#include "files.h"
+#include "archive.h"
+#include "filecache.h"
+#include "rawmesh.h"
+
+
+// Настройки кэша (задаются при запуске, до загрузки из других потоков):
+static FileCache rawmesh = { "RawMesh", RAWMESH_EXTENSION };
+
+
+// Выровнять смещение вверх:
+static inline uint64_t align_up(uint64_t value) {
+    return (value + RAWMESH_ALIGNMENT - 1) & ~(uint64_t)(RAWMESH_ALIGNMENT - 1);
+}
+
+
+// Совпадают ли форматы вершин (сравниваются только используемые атрибуты):
+static bool same_layout(const RawMeshLayout *a, const RawMeshLayout *b) {
+    return a->stride == b->stride && a->attribs_count == b->attribs_count &&
+           memcmp(a->attribs, b->attribs, a->attribs_count * sizeof(RawMeshAttrib)) == 0;
+}
+
+
+// Путь файла кэша для источника и формата вершин:
+static char* make_cache_path(uint64_t path_hash, const RawMeshLayout *layout) {
+    size_t layout_size = offsetof(RawMeshLayout, attribs) + layout->attribs_count * sizeof(RawMeshAttrib);
+    return FileCache_make_path(&rawmesh, path_hash, Archive_crc32(0, layout, layout_size));
+}
+
+
+// Лежит ли блок [offset, offset + size) внутри файла:
+static inline bool in_file(const FileMap *map, uint64_t offset, uint64_t size) {
+    return offset <= map->size && size <= map->size - offset;
+}
+
+
+// Проверить, что файл кэша целый и того же источника и формата:
+static bool is_valid(const RawMesh *rm, const RawMeshHeader *key) {
+    const RawMeshHeader *h = rm->header;
+    if (rm->map->size < sizeof(RawMeshHeader)) return false;
+    if (memcmp(h->magic, RAWMESH_MAGIC, 4) != 0 || h->version != RAWMESH_VERSION) return false;
+    if (h->source.path_hash != key->source.path_hash || !same_layout(&h->layout, &key->layout)) return false;
+    if (h->vertex_count > UINT32_MAX || h->index_count > UINT32_MAX) return false;
+    if (!in_file(rm->map, h->submeshes_offset, (uint64_t)h->submeshes_count * sizeof(RawMeshSubmesh))) return false;
+    if (!in_file(rm->map, h->vertices_offset, h->vertex_count * h->layout.stride)) return false;
+    if (!in_file(rm->map, h->indices_offset, h->index_count * sizeof(uint32_t))) return false;
+    if (h->vertices_offset % RAWMESH_ALIGNMENT || h->indices_offset % RAWMESH_ALIGNMENT) return false;
+    const RawMeshSubmesh *submeshes = (const RawMeshSubmesh*)(rm->map->data + h->submeshes_offset);
+    const uint32_t *indices = (const uint32_t*)(rm->map->data + h->indices_offset);
+    for (uint32_t i = 0; i < h->submeshes_count; i++) {
+        const RawMeshSubmesh *s = &submeshes[i];
+        if ((uint64_t)s->first_vertex + s->vertex_count > h->vertex_count) return false;
+        if ((uint64_t)s->first_index + s->index_count > h->index_count) return false;
+
+        // Индексы не должны выходить за вершины подсетки (иначе GPU читает за блоком вершин):
+        for (uint32_t k = 0; k < s->index_count; k++) {
+            if (indices[s->first_index + k] >= s->vertex_count) return false;
+        }
+    }
+    return true;
+}
+
+
+// Открыть файл кэша:
+static RawMesh* open_cache(const char *cache_path) {
+    FileMap *map = Files_map(cache_path, FILE_MAP_SEQUENTIAL);
+    if (!map) return NULL;
+    RawMesh *rm = (RawMesh*)mm_alloc(sizeof(RawMesh));
+    rm->map = map;
+    rm->header = (const RawMeshHeader*)map->data;
+    rm->submeshes = NULL;
+    rm->vertices = NULL;
+    rm->indices = NULL;
+    return rm;
+}
+
+
+// Заполнить указатели на блоки (после is_valid):
+static RawMesh* resolve(RawMesh *rm) {
+    const RawMeshHeader *h = rm->header;
+    rm->submeshes = (const RawMeshSubmesh*)(rm->map->data + h->submeshes_offset);
+    rm->vertices = rm->map->data + h->vertices_offset;
+    rm->indices = (const uint32_t*)(rm->map->data + h->indices_offset);
+    return rm;
+}
+
+
+// Расширить границы вершинами [first, first + count):
+static void grow_bounds(
+    const uint8_t *vertices, const RawMeshLayout *layout, uint32_t first, uint32_t count, float *min, float *max
+) {
+    for (uint32_t i = 0; i < count; i++) {
+        float p[3];
+        memcpy(p, vertices + (size_t)(first + i) * layout->stride + layout->attribs[0].offset, sizeof(p));
+        for (int k = 0; k < 3; k++) {
+            if (p[k] < min[k]) min[k] = p[k];
+            if (p[k] > max[k]) max[k] = p[k];
+        }
+    }
+}
+
+
+// Включить кэш в каталоге:
+bool RawMesh_set_cache_dir(const char *dir) {
+    return FileCache_set_dir(&rawmesh, dir);
+}
+
+
+// Включён ли кэш:
+bool RawMesh_is_enabled() {
+    return rawmesh.dir != NULL;
+}
+
+
+// Открыть кэш сетки источника:
+RawMesh* RawMesh_open(const char *source_path, const RawMeshLayout *layout, RawMeshHeader *out_key) {
+    RawMeshHeader key;
+    memset(&key, 0, sizeof(key));
+    if (out_key) *out_key = key;
+    if (!rawmesh.dir || !source_path || !layout) return NULL;
+    if (layout->stride == 0 || layout->attribs_count == 0 || layout->attribs_count > RAWMESH_ATTRIBS_MAX) return NULL;
+
+    // Кэшируются только файлы на диске:
+    if (!FileCache_source_key(source_path, &key.source)) return NULL;
+    memcpy(key.magic, RAWMESH_MAGIC, 4);
+    key.version = RAWMESH_VERSION;
+    key.layout.stride = layout->stride;
+    key.layout.attribs_count = layout->attribs_count;
+    memcpy(key.layout.attribs, layout->attribs, layout->attribs_count * sizeof(RawMeshAttrib));
+    char *cache_path = make_cache_path(key.source.path_hash, &key.layout);
+
+    // Попадание (время и размер совпали или совпало содержимое):
+    RawMesh *rm = open_cache(cache_path);
+    FileCacheMatch match = FILECACHE_MISS;
+    if (rm && is_valid(rm, &key)) match = FileCache_match(&rm->header->source, &key.source, source_path);
+    if (match == FILECACHE_TOUCHED) {
+        RawMesh_close(&rm);
+        FileCache_update_key(cache_path, offsetof(RawMeshHeader, source), &key.source);
+        rm = open_cache(cache_path);
+        if (rm && !is_valid(rm, &key)) RawMesh_close(&rm);
+    }
+    mm_free(cache_path);
+    if (match != FILECACHE_MISS && rm) return resolve(rm);
+    RawMesh_close(&rm);
+
+    // Промах - ключ для записи после разбора источника:
+    if (out_key && FileCache_source_crc(source_path, &key.source)) *out_key = key;
+    return NULL;
+}
+
+
+// Записать файл кэша:
+bool RawMesh_write(
+    const RawMeshHeader *key, const void *vertices, uint32_t vertex_count, const uint32_t *indices,
+    uint32_t index_count, const RawMeshSubmesh *submeshes, uint32_t submeshes_count
+) {
+    if (!rawmesh.dir || !key || key->version != RAWMESH_VERSION || !submeshes || submeshes_count == 0) return false;
+    if ((vertex_count > 0 && !vertices) || (index_count > 0 && !indices)) return false;
+    const RawMeshLayout *layout = &key->layout;
+    if (layout->attribs[0].type != RAWMESH_FLOAT32 || layout->attribs[0].components < 3) {
+        fprintf(stderr, "RawMesh_write: The first attribute must be a float position.\n");
+        return false;
+    }
+
+    // Заголовок, таблица подсеток с границами и смещения блоков:
+    RawMeshHeader header = *key;
+    header.submeshes_count = submeshes_count;
+    header.vertex_count = vertex_count;
+    header.index_count = index_count;
+    RawMeshSubmesh *table = (RawMeshSubmesh*)mm_alloc(sizeof(RawMeshSubmesh) * submeshes_count);
+    for (int k = 0; k < 3; k++) {
+        header.bounds_min[k] = INFINITY;
+        header.bounds_max[k] = -INFINITY;
+    }
+    bool ok = true;
+    for (uint32_t i = 0; i < submeshes_count; i++) {
+        table[i] = submeshes[i];
+        RawMeshSubmesh *s = &table[i];
+        if ((uint64_t)s->first_vertex + s->vertex_count > vertex_count ||
+            (uint64_t)s->first_index + s->index_count > index_count) {
+            ok = false;
+            break;
+        }
+        for (int k = 0; k < 3; k++) {
+            s->bounds_min[k] = INFINITY;
+            s->bounds_max[k] = -INFINITY;
+        }
+        grow_bounds((const uint8_t*)vertices, layout, s->first_vertex, s->vertex_count, s->bounds_min, s->bounds_max);
+        for (int k = 0; k < 3; k++) {
+            if (s->bounds_min[k] < header.bounds_min[k]) header.bounds_min[k] = s->bounds_min[k];
+            if (s->bounds_max[k] > header.bounds_max[k]) header.bounds_max[k] = s->bounds_max[k];
+        }
+    }
+    if (!ok) {
+        fprintf(stderr, "RawMesh_write: Submesh range is out of bounds.\n");
+        mm_free(table);
+        return false;
+    }
+    header.submeshes_offset = align_up(sizeof(RawMeshHeader));
+    header.vertices_offset = align_up(header.submeshes_offset + sizeof(RawMeshSubmesh) * submeshes_count);
+    header.indices_offset = align_up(header.vertices_offset + (uint64_t)vertex_count * layout->stride);
+
+    // Блоки по порядку, с нулями до выравнивания:
+    char *cache_path = make_cache_path(key->source.path_hash, layout);
+    FileCacheWriter writer;
+    FileCache_write_begin(&rawmesh, cache_path, &writer);
+    FileCache_write_at(&writer, 0, &header, sizeof(header));
+    FileCache_write_at(&writer, header.submeshes_offset, table, sizeof(RawMeshSubmesh) * submeshes_count);
+    FileCache_write_at(&writer, header.vertices_offset, vertices, (size_t)vertex_count * layout->stride);
+    FileCache_write_at(&writer, header.indices_offset, indices, (size_t)index_count * sizeof(uint32_t));
+    ok = FileCache_write_end(&rawmesh, &writer);
+    mm_free(cache_path);
+    mm_free(table);
+    return ok;
+}
+
+
+// Закрыть файл кэша:
+void RawMesh_close(RawMesh **rawmesh) {
+    if (!rawmesh || !*rawmesh) return;
+    Files_unmap(&(*rawmesh)->map);
+    mm_free(*rawmesh);
+    *rawmesh = NULL;
+}
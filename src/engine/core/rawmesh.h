@@ -0,0 +1,114 @@
+//
+// rawmesh.h - Кэш готовых сеток (.rawmesh): вершины и индексы в том виде, в каком они уходят в GPU.
+//
+// Файл: заголовок (ключ источника, формат вершин, общие границы), таблица подсеток (диапазоны вершин и индексов,
+// границы), затем блоки вершин и индексов, выровненные по RAWMESH_ALIGNMENT. Файл кэша отображается в память, и
+// буферы GL заполняются прямо из отображения - загрузка без разбора, одно копирование в GPU. Имя файла - хэш
+// пути источника и формата вершин, в заголовке - ключ источника (filecache.h).
+// Кэш включается RawMesh_set_cache_dir.
+//
+
+#pragma once
+
+
+// Подключаем:
+#include "std.h"
+#include "files.h"
+#include "filecache.h"
+
+
+// Определения:
+#define RAWMESH_MAGIC       "ERMS"      // Сигнатура файла.
+#define RAWMESH_VERSION     2           // Версия формата.
+#define RAWMESH_EXTENSION   ".rawmesh"  // Расширение файлов кэша.
+#define RAWMESH_ALIGNMENT   64          // Выравнивание таблицы подсеток и блоков в файле.
+#define RAWMESH_ATTRIBS_MAX 8           // Максимум атрибутов вершины.
+
+
+// Тип компонент атрибута:
+typedef enum RawMeshAttribType {
+    RAWMESH_FLOAT32,
+} RawMeshAttribType;
+
+
+// Объявление структур:
+typedef struct RawMeshAttrib RawMeshAttrib;    // Атрибут вершины.
+typedef struct RawMeshLayout RawMeshLayout;    // Формат вершины.
+typedef struct RawMeshSubmesh RawMeshSubmesh;  // Подсетка.
+typedef struct RawMeshHeader RawMeshHeader;    // Заголовок файла кэша.
+typedef struct RawMesh RawMesh;                // Открытый файл кэша.
+
+
+// Атрибут вершины:
+struct RawMeshAttrib {
+    uint32_t location;    // Номер атрибута в шейдере.
+    uint32_t components;  // Компонент (1..4).
+    uint32_t type;        // RawMeshAttribType.
+    uint32_t offset;      // Смещение в вершине.
+};
+
+
+// Формат вершины (первый атрибут - позиция из трёх float, по нему считаются границы):
+struct RawMeshLayout {
+    uint32_t stride;         // Размер вершины.
+    uint32_t attribs_count;
+    RawMeshAttrib attribs[RAWMESH_ATTRIBS_MAX];
+};
+
+
+// Подсетка (индексы - относительно first_vertex):
+struct RawMeshSubmesh {
+    uint32_t first_vertex;
+    uint32_t vertex_count;
+    uint32_t first_index;
+    uint32_t index_count;
+    float bounds_min[3];
+    float bounds_max[3];
+};
+
+
+// Заголовок файла кэша:
+struct RawMeshHeader {
+    char     magic[4];          // RAWMESH_MAGIC.
+    uint32_t version;           // RAWMESH_VERSION.
+    FileCacheKey source;        // Ключ источника.
+    uint32_t submeshes_count;
+    RawMeshLayout layout;
+    float    bounds_min[3];     // Границы всей сетки.
+    float    bounds_max[3];
+    uint64_t vertex_count;
+    uint64_t index_count;       // Индексы uint32.
+    uint64_t submeshes_offset;  // От начала файла.
+    uint64_t vertices_offset;
+    uint64_t indices_offset;
+};
+
+
+// Открытый файл кэша (указатели - в отображение, действительны до RawMesh_close):
+struct RawMesh {
+    FileMap *map;
+    const RawMeshHeader *header;
+    const RawMeshSubmesh *submeshes;
+    const void *vertices;
+    const uint32_t *indices;
+};
+
+
+// Включить кэш в каталоге (NULL - выключить). Каталог создаётся:
+bool RawMesh_set_cache_dir(const char *dir);
+
+// Включён ли кэш:
+bool RawMesh_is_enabled();
+
+// Открыть кэш сетки источника с форматом вершин layout. NULL - промах, тогда out_key заполняется ключом для
+// RawMesh_write (если кэш выключен или источник не на диске, например в смонтированном архиве, - нулями):
+RawMesh* RawMesh_open(const char *source_path, const RawMeshLayout *layout, RawMeshHeader *out_key);
+
+// Записать файл кэша по ключу из RawMesh_open (границы считаются здесь). false - не записан:
+bool RawMesh_write(
+    const RawMeshHeader *key, const void *vertices, uint32_t vertex_count, const uint32_t *indices,
+    uint32_t index_count, const RawMeshSubmesh *submeshes, uint32_t submeshes_count
+);
+
+// Закрыть файл кэша:
+void RawMesh_close(RawMesh **rawmesh);
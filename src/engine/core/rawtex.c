@@ -0,0 +1,230 @@
+//
+// rawtex.c - Реализация кэша декодированных текстур (.rawtex).
+//
+
+
+// Подключаем:
+#include "std.h"
+#include "mm.h"
+#include "files.h"
+#include "archive.h"
+#include "filecache.h"
+#include "pixmap.h"
+#include "texcompress.h"
+#include "rawtex.h"
+
+
+// Настройки кэша (задаются при запуске, до загрузки из других потоков):
+static struct {
+    FileCache cache;              // Каталог кэша.
+    int compression;              // RAWTEX_RAW или TexCompress_Format.
+    TexCompress_Quality quality;  // Качество сжатия.
+} rawtex = { { "RawTex", RAWTEX_EXTENSION }, RAWTEX_RAW, TEXCOMPRESS_QUALITY };
+
+
+// Выровнять смещение вверх:
+static inline uint64_t align_up(uint64_t value) {
+    return (value + RAWTEX_ALIGNMENT - 1) & ~(uint64_t)(RAWTEX_ALIGNMENT - 1);
+}
+
+
+// Путь файла кэша для источника и варианта:
+static char* make_cache_path(uint64_t path_hash, int channels, bool mips, int compression) {
+    uint64_t variant = (uint64_t)channels | ((uint64_t)mips << 4) | ((uint64_t)(compression + 1) << 8);
+    return FileCache_make_path(&rawtex.cache, path_hash, variant);
+}
+
+
+// Размер уровня по заголовку (ширина, высота, каналы, сжатие):
+static uint64_t expected_level_size(const RawTexHeader *h, uint32_t level) {
+    int width = (int)(h->width >> level), height = (int)(h->height >> level);
+    if (width < 1) width = 1;
+    if (height < 1) height = 1;
+    if (h->compression != RAWTEX_RAW) {
+        return TexCompress_get_level_size((TexCompress_Format)h->compression, width, height);
+    }
+    return (uint64_t)width * height * h->channels;
+}
+
+
+// Проверить, что файл кэша целый и того же варианта:
+static bool is_valid(const RawTex *rt, const RawTexHeader *key) {
+    const RawTexHeader *h = rt->header;
+    if (rt->map->size < sizeof(RawTexHeader)) return false;
+    if (memcmp(h->magic, RAWTEX_MAGIC, 4) != 0 || h->version != RAWTEX_VERSION) return false;
+    if (h->source.path_hash != key->source.path_hash || h->channels != key->channels) return false;
+    if (h->compression != key->compression) return false;
+    if (h->levels_count == 0 || h->levels_count > PIXMAP_MIPS_MAX) return false;
+    if (h->width == 0 || h->height == 0 || h->width > 65536 || h->height > 65536) return false;
+    if (h->channels < 1 || h->channels > 4) return false;
+    if (h->has_mips != key->has_mips) return false;  // Запрошены мипмапы, а в кэше их нет (или наоборот).
+    for (uint32_t i = 0; i < h->levels_count; i++) {
+        if (h->level_sizes[i] != expected_level_size(h, i)) return false;  // Загрузка в GPU читает ровно столько.
+        if (h->level_offsets[i] > rt->map->size || h->level_sizes[i] > rt->map->size - h->level_offsets[i]) return false;
+    }
+    return true;
+}
+
+
+// Открыть файл кэша:
+static RawTex* open_cache(const char *cache_path) {
+    FileMap *map = Files_map(cache_path, FILE_MAP_SEQUENTIAL);
+    if (!map) return NULL;
+    RawTex *rt = (RawTex*)mm_alloc(sizeof(RawTex));
+    rt->map = map;
+    rt->header = (const RawTexHeader*)map->data;
+    return rt;
+}
+
+
+// Включить кэш в каталоге:
+bool RawTex_set_cache_dir(const char *dir) {
+    return FileCache_set_dir(&rawtex.cache, dir);
+}
+
+
+// Включён ли кэш:
+bool RawTex_is_enabled() {
+    return rawtex.cache.dir != NULL;
+}
+
+
+// Сжимать текстуры в кэше блочным сжатием:
+void RawTex_set_compression(int compression, TexCompress_Quality quality) {
+    rawtex.compression = compression;
+    rawtex.quality = quality;
+}
+
+
+// Получить формат сжатия текстур в кэше:
+int RawTex_get_compression() {
+    return rawtex.compression;
+}
+
+
+// Открыть кэш картинки (при промахе картинка декодируется и кэш создаётся):
+RawTex* RawTex_load(const char *source_path, int channels, bool mips, bool compress) {
+    if (!rawtex.cache.dir || !source_path) return NULL;
+    if (!channels) channels = PIXMAP_RGBA;
+
+    // Кэшируются только файлы на диске:
+    RawTexHeader key;
+    memset(&key, 0, sizeof(key));
+    if (!FileCache_source_key(source_path, &key.source)) return NULL;
+    memcpy(key.magic, RAWTEX_MAGIC, 4);
+    key.version = RAWTEX_VERSION;
+    key.channels = (uint32_t)channels;
+    key.compression = compress ? rawtex.compression : RAWTEX_RAW;
+    key.has_mips = mips ? 1 : 0;
+    char *cache_path = make_cache_path(key.source.path_hash, channels, mips, key.compression);
+
+    // Попадание (время и размер совпали или совпало содержимое):
+    RawTex *rt = open_cache(cache_path);
+    FileCacheMatch match = FILECACHE_MISS;
+    if (rt && is_valid(rt, &key)) match = FileCache_match(&rt->header->source, &key.source, source_path);
+    if (match == FILECACHE_TOUCHED) {
+        RawTex_close(&rt);
+        FileCache_update_key(cache_path, offsetof(RawTexHeader, source), &key.source);
+        rt = open_cache(cache_path);
+        if (rt && !is_valid(rt, &key)) RawTex_close(&rt);
+    }
+    if (match != FILECACHE_MISS && rt) {
+        mm_free(cache_path);
+        return rt;
+    }
+    RawTex_close(&rt);
+
+    // Промах - декодируем источник и создаём кэш:
+    FileMap *source = Files_map(source_path, FILE_MAP_SEQUENTIAL);
+    if (source) key.source.source_crc = Archive_crc32(0, source->data, source->size);
+    Pixmap *pixmap = source ? Pixmap_decode(source->data, source->size, channels) : NULL;
+    Files_unmap(&source);
+    if (!pixmap) {
+        mm_free(cache_path);
+        return NULL;
+    }
+
+    PixmapMips single = { .count = 1, .levels = { pixmap } };
+    PixmapMips *chain = mips ? Pixmap_build_mips(pixmap, PIXMAP_MIP_BOX, false) : &single;
+    TexCompress_Image *compressed = NULL;
+    if (key.compression != RAWTEX_RAW) {
+        compressed = TexCompress_encode(chain, (TexCompress_Format)key.compression, rawtex.quality);
+    }
+    bool written = RawTex_write(cache_path, &key, compressed ? NULL : chain, compressed);
+    TexCompress_destroy(&compressed);
+    if (chain != &single) Pixmap_destroy_mips(&chain);
+    Pixmap_destroy(&pixmap);
+
+    rt = written ? open_cache(cache_path) : NULL;
+    if (rt && !is_valid(rt, &key)) RawTex_close(&rt);
+    mm_free(cache_path);
+    return rt;
+}
+
+
+// Записать файл кэша:
+bool RawTex_write(
+    const char *cache_path, const RawTexHeader *key, const PixmapMips *pixels, const TexCompress_Image *compressed
+) {
+    if (!cache_path || !key || (!pixels && !compressed) || (pixels && compressed)) return false;
+    if (pixels && pixels->levels[0]->type != PIXMAP_U8) {
+        fprintf(stderr, "RawTex_write: Only 8-bit pixmaps are supported.\n");
+        return false;
+    }
+    RawTexHeader header = *key;
+    memcpy(header.magic, RAWTEX_MAGIC, 4);
+    header.version = RAWTEX_VERSION;
+    const Pixmap *base = pixels ? pixels->levels[0] : NULL;
+    header.width = (uint32_t)(base ? base->width : compressed->width);
+    header.height = (uint32_t)(base ? base->height : compressed->height);
+    header.levels_count = (uint32_t)(pixels ? pixels->count : compressed->levels_count);
+    header.compression = compressed ? (int32_t)compressed->format : RAWTEX_RAW;
+    memset(header.level_offsets, 0, sizeof(header.level_offsets));
+    memset(header.level_sizes, 0, sizeof(header.level_sizes));
+    uint64_t offset = align_up(sizeof(RawTexHeader));
+    for (uint32_t i = 0; i < header.levels_count; i++) {
+        header.level_offsets[i] = offset;
+        header.level_sizes[i] = pixels ? Pixmap_get_size(pixels->levels[i]) : compressed->level_sizes[i];
+        offset = align_up(offset + header.level_sizes[i]);
+    }
+
+    // Пишем атомарно (временный файл и переименование):
+    FileCacheWriter writer;
+    FileCache_write_begin(&rawtex.cache, cache_path, &writer);
+    FileCache_write_at(&writer, 0, &header, sizeof(header));
+    for (uint32_t i = 0; i < header.levels_count; i++) {
+        if (pixels) {
+            const Pixmap *level = pixels->levels[i];
+            size_t stride = Pixmap_get_stride(level), row_size = (size_t)level->width * level->channels;
+            for (int y = 0; y < level->height; y++) {
+                uint64_t row_offset = y == 0 ? header.level_offsets[i] : writer.pos;
+                FileCache_write_at(&writer, row_offset, level->data + y * stride, row_size);
+            }
+        } else {
+            const uint8_t *data = compressed->data + compressed->level_offsets[i];
+            FileCache_write_at(&writer, header.level_offsets[i], data, (size_t)header.level_sizes[i]);
+        }
+    }
+    return FileCache_write_end(&rawtex.cache, &writer);
+}
+
+
+// Получить данные уровня:
+const uint8_t* RawTex_get_level(const RawTex *rawtex, int level, size_t *out_size, int *out_width, int *out_height) {
+    if (!rawtex || level < 0 || (uint32_t)level >= rawtex->header->levels_count) return NULL;
+    const RawTexHeader *h = rawtex->header;
+    int width = (int)(h->width >> level), height = (int)(h->height >> level);
+    if (out_size) *out_size = (size_t)h->level_sizes[level];
+    if (out_width) *out_width = width > 0 ? width : 1;
+    if (out_height) *out_height = height > 0 ? height : 1;
+    return rawtex->map->data + h->level_offsets[level];
+}
+
+
+// Закрыть файл кэша:
+void RawTex_close(RawTex **rawtex) {
+    if (!rawtex || !*rawtex) return;
+    Files_unmap(&(*rawtex)->map);
+    mm_free(*rawtex);
+    *rawtex = NULL;
+}
@@ -0,0 +1,82 @@
+//
+// rawtex.h - Кэш декодированных текстур (.rawtex): готовые пиксели (или сжатые блоки) всей цепочки мипмапов.
+//
+// Файл кэша отображается в память и загружается в текстуру прямо из отображения, без распаковки PNG/JPG.
+// Имя файла - хэш пути источника и варианта (каналы, мипмапы, сжатие), в заголовке - ключ источника
+// (filecache.h). Кэш включается RawTex_set_cache_dir.
+//
+
+#pragma once
+
+
+// Подключаем:
+#include "std.h"
+#include "files.h"
+#include "filecache.h"
+#include "pixmap.h"
+#include "texcompress.h"
+
+
+// Определения:
+#define RAWTEX_MAGIC     "ERTX"     // Сигнатура файла.
+#define RAWTEX_VERSION   3          // Версия формата.
+#define RAWTEX_EXTENSION ".rawtex"  // Расширение файлов кэша.
+#define RAWTEX_ALIGNMENT 64         // Выравнивание данных уровней в файле.
+#define RAWTEX_RAW       (-1)       // Значение compression для несжатых пикселей.
+
+
+// Объявление структур:
+typedef struct RawTexHeader RawTexHeader;  // Заголовок файла кэша.
+typedef struct RawTex RawTex;              // Открытый файл кэша.
+
+
+// Заголовок файла кэша (за ним - уровни, каждый выровнен по RAWTEX_ALIGNMENT):
+struct RawTexHeader {
+    char     magic[4];         // RAWTEX_MAGIC.
+    uint32_t version;          // RAWTEX_VERSION.
+    FileCacheKey source;       // Ключ источника.
+    uint32_t width;
+    uint32_t height;
+    uint32_t channels;         // Каналы пикселей (для сжатых - каналы, из которых сжимали).
+    int32_t  compression;      // RAWTEX_RAW или TexCompress_Format.
+    uint32_t has_mips;         // Запрошена цепочка мипмапов (у картинки 1x1 в ней всего один уровень).
+    uint32_t levels_count;
+    uint64_t level_offsets[PIXMAP_MIPS_MAX];  // От начала файла.
+    uint64_t level_sizes[PIXMAP_MIPS_MAX];
+};
+
+
+// Открытый файл кэша (данные уровней - в отображении, действительны до RawTex_close):
+struct RawTex {
+    FileMap *map;
+    const RawTexHeader *header;
+};
+
+
+// Включить кэш в каталоге (NULL - выключить). Каталог создаётся:
+bool RawTex_set_cache_dir(const char *dir);
+
+// Включён ли кэш:
+bool RawTex_is_enabled();
+
+// Сжимать текстуры в кэше блочным сжатием (RAWTEX_RAW - хранить пиксели как есть):
+void RawTex_set_compression(int compression, TexCompress_Quality quality);
+
+// Получить формат сжатия текстур в кэше (RAWTEX_RAW - без сжатия):
+int RawTex_get_compression();
+
+// Открыть кэш картинки (при промахе картинка декодируется и кэш создаётся). NULL - кэш выключен, источник
+// не на диске (например, в смонтированном архиве) или ошибка. mips - хранить цепочку мипмапов,
+// compress - сжимать (формат из RawTex_set_compression):
+RawTex* RawTex_load(const char *source_path, int channels, bool mips, bool compress);
+
+// Записать файл кэша (pixels - несжатые уровни, compressed - сжатые, одно из двух):
+bool RawTex_write(
+    const char *cache_path, const RawTexHeader *key, const PixmapMips *pixels, const TexCompress_Image *compressed
+);
+
+// Получить данные уровня:
+const uint8_t* RawTex_get_level(const RawTex *rawtex, int level, size_t *out_size, int *out_width, int *out_height);
+
+// Закрыть файл кэша:
+void RawTex_close(RawTex **rawtex);
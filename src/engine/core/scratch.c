@@ -0,0 +1,188 @@
+//
+// scratch.c - Реализация арены временной памяти.
+//
+// Блок арены: [размер блока в size_t, дополненный до SCRATCH_ALIGNMENT|сам блок].
+//
+
+
+// Подключаем:
+#include "libs/tinycthread.h"
+#include "std.h"
+#include "mm.h"
+#include "scratch.h"
+
+
+static _Thread_local ScratchArena *scratch_bound = NULL;  // Арена, привязанная к текущему потоку.
+static tss_t scratch_thread_key;                          // Арена потока (уничтожается при завершении потока).
+static once_flag scratch_key_once = ONCE_FLAG_INIT;
+
+
+// Выровнять размер вверх:
+static inline size_t align_up(size_t size) {
+    return (size + SCRATCH_ALIGNMENT - 1) & ~(size_t)(SCRATCH_ALIGNMENT - 1);
+}
+
+
+// Размер блока арены:
+static inline size_t block_size(const void *ptr) {
+    return *(const size_t*)((const uint8_t*)ptr - SCRATCH_ALIGNMENT);
+}
+
+
+// Деструктор арены потока:
+static void thread_arena_dtor(void *arena) {
+    ScratchArena *ptr = (ScratchArena*)arena;
+    Scratch_destroy(&ptr);
+}
+
+
+static void key_init() {
+    tss_create(&scratch_thread_key, thread_arena_dtor);
+}
+
+
+// Выделить блок в арене (NULL - не помещается):
+static void* arena_alloc(ScratchArena *arena, size_t size) {
+    size_t need = SCRATCH_ALIGNMENT + align_up(size);
+    if (arena->used + need > arena->peak) arena->peak = arena->used + need;
+    if (need > arena->capacity - arena->used) return NULL;
+    uint8_t *block = arena->data + arena->used;
+    *(size_t*)block = size;
+    arena->last = arena->used;
+    arena->used += need;
+    return block + SCRATCH_ALIGNMENT;
+}
+
+
+// Создать арену:
+ScratchArena* Scratch_create(size_t capacity, size_t max_capacity) {
+    ScratchArena *arena = (ScratchArena*)mm_alloc(sizeof(ScratchArena));
+    if (max_capacity < capacity) max_capacity = capacity;
+    arena->capacity = align_up(capacity);
+    arena->max_capacity = max_capacity;
+    arena->data = arena->capacity ? (uint8_t*)mm_alloc(arena->capacity) : NULL;
+    arena->used = 0;
+    arena->last = 0;
+    arena->peak = 0;
+    return arena;
+}
+
+
+// Уничтожить арену:
+void Scratch_destroy(ScratchArena **arena) {
+    if (!arena || !*arena) return;
+    if (scratch_bound == *arena) scratch_bound = NULL;
+    mm_free((*arena)->data);
+    mm_free(*arena);
+    *arena = NULL;
+}
+
+
+// Получить арену текущего потока:
+ScratchArena* Scratch_get_thread(size_t max_capacity) {
+    call_once(&scratch_key_once, key_init);
+    ScratchArena *arena = (ScratchArena*)tss_get(scratch_thread_key);
+    if (!arena) {
+        arena = Scratch_create(max_capacity < SCRATCH_INITIAL_SIZE ? max_capacity : SCRATCH_INITIAL_SIZE, max_capacity);
+        tss_set(scratch_thread_key, arena);
+    }
+    arena->max_capacity = max_capacity > arena->capacity ? max_capacity : arena->capacity;
+    return arena;
+}
+
+
+// Уничтожить арену текущего потока:
+void Scratch_release_thread() {
+    call_once(&scratch_key_once, key_init);
+    ScratchArena *arena = (ScratchArena*)tss_get(scratch_thread_key);
+    if (!arena) return;
+    tss_set(scratch_thread_key, NULL);
+    Scratch_destroy(&arena);
+}
+
+
+// Привязать арену к текущему потоку:
+ScratchArena* Scratch_bind(ScratchArena *arena) {
+    ScratchArena *previous = scratch_bound;
+    scratch_bound = arena;
+    return previous;
+}
+
+
+// Получить отметку арены:
+size_t Scratch_mark(const ScratchArena *arena) {
+    return arena ? arena->used : 0;
+}
+
+
+// Освободить все блоки после отметки:
+void Scratch_rewind(ScratchArena *arena, size_t mark) {
+    if (!arena || mark > arena->used) return;
+    arena->used = mark;
+    arena->last = mark;
+    if (mark != 0) return;
+
+    // Арена пуста - вырастаем, чтобы в следующий раз всё поместилось:
+    size_t want = align_up(arena->peak < arena->max_capacity ? arena->peak : arena->max_capacity);
+    if (want > arena->capacity) {
+        mm_free(arena->data);
+        arena->data = (uint8_t*)mm_alloc(want);
+        arena->capacity = want;
+    }
+    arena->peak = 0;
+}
+
+
+// Принадлежит ли указатель арене:
+bool Scratch_owns(const ScratchArena *arena, const void *ptr) {
+    if (!arena || !ptr || !arena->data) return false;
+    const uint8_t *p = (const uint8_t*)ptr;
+    return p >= arena->data && p < arena->data + arena->capacity;
+}
+
+
+// Выделить память из привязанной арены (или из mm):
+void* Scratch_alloc(size_t size) {
+    void *ptr = scratch_bound ? arena_alloc(scratch_bound, size) : NULL;
+    return ptr ? ptr : mm_alloc(size);
+}
+
+
+// Расширить блок:
+void* Scratch_realloc(void *ptr, size_t new_size) {
+    if (!ptr) return Scratch_alloc(new_size);
+    ScratchArena *arena = scratch_bound;
+    if (!Scratch_owns(arena, ptr)) return mm_realloc(ptr, new_size);
+
+    // Последний блок расширяется на месте:
+    size_t offset = (size_t)((uint8_t*)ptr - arena->data) - SCRATCH_ALIGNMENT;
+    if (offset == arena->last) {
+        size_t need = SCRATCH_ALIGNMENT + align_up(new_size);
+        if (offset + need > arena->peak) arena->peak = offset + need;
+        if (need <= arena->capacity - offset) {
+            *(size_t*)(arena->data + offset) = new_size;
+            arena->used = offset + need;
+            return ptr;
+        }
+    }
+
+    // Иначе - новый блок с копированием:
+    size_t old_size = block_size(ptr);
+    void *new_ptr = Scratch_alloc(new_size);
+    memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+    Scratch_free(ptr);
+    return new_ptr;
+}
+
+
+// Освободить блок:
+void Scratch_free(void *ptr) {
+    if (!ptr) return;
+    ScratchArena *arena = scratch_bound;
+    if (!Scratch_owns(arena, ptr)) {
+        mm_free(ptr);
+        return;
+    }
+    size_t offset = (size_t)((uint8_t*)ptr - arena->data) - SCRATCH_ALIGNMENT;
+    if (offset == arena->last) arena->used = offset;
+}
@@ -0,0 +1,68 @@
+//
+// scratch.h - Арена временной памяти (линейный распределитель) для временных буферов библиотек.
+//
+// Арена выделяет память сдвигом указателя внутри одного блока и освобождает всё разом (Scratch_rewind).
+// Scratch_alloc/Scratch_realloc/Scratch_free берут память из арены, привязанной к текущему потоку
+// (Scratch_bind), а если арена не привязана или заполнена - из mm. Так подключается stb_image: временные
+// буферы декодирования не нагружают общую кучу. Блоки арены недействительны после Scratch_rewind.
+//
+
+#pragma once
+
+
+// Подключаем:
+#include "std.h"
+
+
+// Определения:
+#define SCRATCH_ALIGNMENT    16            // Выравнивание блоков арены.
+#define SCRATCH_INITIAL_SIZE (1024*1024)   // Начальный размер арены потока (растёт до max_capacity).
+
+
+// Объявление структур:
+typedef struct ScratchArena ScratchArena;  // Арена временной памяти.
+
+
+// Арена временной памяти:
+struct ScratchArena {
+    uint8_t *data;
+    size_t capacity;      // Размер блока арены.
+    size_t max_capacity;  // До скольки арена может вырасти при Scratch_rewind(0).
+    size_t used;          // Занято байт.
+    size_t last;          // Смещение последнего блока (его можно расширить или освободить на месте).
+    size_t peak;          // Сколько памяти понадобилось бы арене (включая не поместившиеся запросы).
+};
+
+
+// Создать арену:
+ScratchArena* Scratch_create(size_t capacity, size_t max_capacity);
+
+// Уничтожить арену:
+void Scratch_destroy(ScratchArena **arena);
+
+// Получить арену текущего потока (создаётся при первом вызове, уничтожается при завершении потока):
+ScratchArena* Scratch_get_thread(size_t max_capacity);
+
+// Уничтожить арену текущего потока (для потока, который не завершается через thrd_exit, например главного):
+void Scratch_release_thread();
+
+// Привязать арену к текущему потоку для Scratch_alloc/realloc/free (NULL - отвязать). Возвращает прежнюю:
+ScratchArena* Scratch_bind(ScratchArena *arena);
+
+// Получить отметку арены (для Scratch_rewind):
+size_t Scratch_mark(const ScratchArena *arena);
+
+// Освободить все блоки после отметки. При отметке 0 арена вырастает до пиковой потребности (не больше max_capacity):
+void Scratch_rewind(ScratchArena *arena, size_t mark);
+
+// Принадлежит ли указатель арене:
+bool Scratch_owns(const ScratchArena *arena, const void *ptr);
+
+// Выделить память из привязанной арены (или из mm):
+void* Scratch_alloc(size_t size);
+
+// Расширить блок (блок арены расширяется на месте, если он последний):
+void* Scratch_realloc(void *ptr, size_t new_size);
+
+// Освободить блок (блок арены освобождается на месте, если он последний, иначе - при Scratch_rewind):
+void Scratch_free(void *ptr);
@@ -0,0 +1,58 @@
+//
+// snapshot.c - Реализация двойного буфера состояния кадра.
+//
+
+
+// Подключаем:
+#include "std.h"
+#include "mm.h"
+#include "snapshot.h"
+
+
+// Создать двойной буфер (persistent = true - симуляция продолжает с прошлого состояния):
+Snapshot* Snapshot_create(size_t size, bool persistent) {
+    if (size == 0) return NULL;
+    Snapshot *snapshot = (Snapshot*)mm_alloc(sizeof(Snapshot));
+    snapshot->slots[0] = mm_calloc(1, size);
+    snapshot->slots[1] = mm_calloc(1, size);
+    snapshot->size = size;
+    snapshot->write_index = 0;
+    snapshot->persistent = persistent;
+    snapshot->frame = 0;
+    return snapshot;
+}
+
+
+// Уничтожить двойной буфер:
+void Snapshot_destroy(Snapshot **snapshot) {
+    if (!snapshot || !*snapshot) return;
+    mm_free((*snapshot)->slots[0]);
+    mm_free((*snapshot)->slots[1]);
+    mm_free(*snapshot);
+    *snapshot = NULL;
+}
+
+
+// Получить буфер записи (для потока симуляции):
+void* Snapshot_write(Snapshot *snapshot) {
+    if (!snapshot) return NULL;
+    return snapshot->slots[snapshot->write_index];
+}
+
+
+// Получить опубликованный буфер (для потока рендера):
+const void* Snapshot_read(Snapshot *snapshot) {
+    if (!snapshot) return NULL;
+    return snapshot->slots[1 - snapshot->write_index];
+}
+
+
+// Опубликовать буфер записи и начать новый (вызывается только в точке синхронизации потоков):
+void Snapshot_swap(Snapshot *snapshot) {
+    if (!snapshot) return;
+    snapshot->write_index = 1 - snapshot->write_index;
+    if (snapshot->persistent) {
+        memcpy(snapshot->slots[snapshot->write_index], snapshot->slots[1 - snapshot->write_index], snapshot->size);
+    }
+    snapshot->frame++;
+}
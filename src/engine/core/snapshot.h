@@ -0,0 +1,43 @@
+//
+// snapshot.h - Двойной буфер состояния кадра для передачи данных между потоками.
+//
+// Поток симуляции заполняет буфер записи (Snapshot_write), а поток рендера читает
+// опубликованный буфер (Snapshot_read). Буферы меняются местами в точке синхронизации
+// потоков (Snapshot_swap), когда ни один из них не работает со снимком.
+//
+
+#pragma once
+
+
+// Подключаем:
+#include "std.h"
+
+
+// Объявление структур:
+typedef struct Snapshot Snapshot;  // Двойной буфер состояния кадра.
+
+
+// Двойной буфер состояния кадра:
+struct Snapshot {
+    void  *slots[2];     // Два буфера одинакового размера.
+    size_t size;         // Размер одного буфера в байтах.
+    int    write_index;  // Индекс буфера записи (буфер чтения = 1 - write_index).
+    bool   persistent;   // Копировать опубликованное состояние в новый буфер записи при обмене.
+    uint64_t frame;      // Сколько раз буферы менялись местами.
+};
+
+
+// Создать двойной буфер (persistent = true - симуляция продолжает с прошлого состояния):
+Snapshot* Snapshot_create(size_t size, bool persistent);
+
+// Уничтожить двойной буфер:
+void Snapshot_destroy(Snapshot **snapshot);
+
+// Получить буфер записи (для потока симуляции):
+void* Snapshot_write(Snapshot *snapshot);
+
+// Получить опубликованный буфер (для потока рендера):
+const void* Snapshot_read(Snapshot *snapshot);
+
+// Опубликовать буфер записи и начать новый (вызывается только в точке синхронизации потоков):
+void Snapshot_swap(Snapshot *snapshot);
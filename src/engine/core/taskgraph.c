@@ -0,0 +1,297 @@
+//
+// taskgraph.c - Реализация графа задач кадра поверх системы задач.
+//
+// Граф собирается один раз (TaskGraph_build) и выполняется каждый кадр.
+// Зависимости берутся из явных связей и из пересечения масок ресурсов:
+// узел, добавленный позже, ждёт более ранний, если они конфликтуют по записи.
+//
+
+
+// Подключаем:
+#include "libs/tinycthread.h"
+#include "std.h"
+#include "mm.h"
+#include "array.h"
+#include "jobs.h"
+#include "time.h"
+#include "taskgraph.h"
+
+
+// Объявление функций:
+static void schedule_node(TaskGraph *graph, TaskNode *node, int index);
+
+
+// Получить узел по индексу без проверок:
+static inline TaskNode* node_at(TaskGraph *graph, int index) {
+    return (TaskNode*)Array_get_ptr(graph->nodes, (size_t)index);
+}
+
+
+// Добавить связь from -> to, если её ещё нет:
+static void add_edge(TaskGraph *graph, int from, int to) {
+    TaskNode *src = node_at(graph, from);
+    for (size_t i = 0; i < Array_len(src->dependents); i++) {
+        if (*(int*)Array_get(src->dependents, i) == to) return;
+    }
+    Array_push(src->dependents, &to);
+    node_at(graph, to)->dep_count++;
+}
+
+
+// Выполнить узел и запустить узлы, которые его ждали:
+static void run_node(TaskGraph *graph, TaskNode *node) {
+    node->start = Time_now(NULL) - graph->frame_start;
+    if (node->func) node->func(node->data);
+    node->end = Time_now(NULL) - graph->frame_start;
+
+    for (size_t i = 0; i < Array_len(node->dependents); i++) {
+        int next = *(int*)Array_get(node->dependents, i);
+        TaskNode *next_node = node_at(graph, next);
+        if (atomic_fetch_sub(&next_node->remaining, 1) == 1) schedule_node(graph, next_node, next);
+    }
+    atomic_fetch_add(&graph->done, 1);
+}
+
+
+// Задача системы задач для узла:
+static void node_job(void *data) {
+    TaskNode *node = (TaskNode*)data;
+    run_node(node->graph, node);
+}
+
+
+// Поставить узел на выполнение:
+static void schedule_node(TaskGraph *graph, TaskNode *node, int index) {
+    if (node->flags & TASK_NODE_MAIN_THREAD) {
+        mtx_lock(&graph->main_lock);
+        Array_push(graph->main_queue, &index);
+        atomic_fetch_add(&graph->main_len, 1);
+        mtx_unlock(&graph->main_lock);
+    } else {
+        Jobs_run(node_job, node, NULL);
+    }
+}
+
+
+// Создать граф задач:
+TaskGraph* TaskGraph_create() {
+    TaskGraph *graph = (TaskGraph*)mm_alloc(sizeof(TaskGraph));
+    graph->nodes = Array_create(sizeof(TaskNode*), 32);
+    graph->order = Array_create(sizeof(int), 32);
+    graph->main_queue = Array_create(sizeof(int), 32);
+    mtx_init(&graph->main_lock, mtx_plain);
+    atomic_store(&graph->main_len, 0);
+    atomic_store(&graph->done, 0);
+    graph->built = false;
+    graph->frame_start = 0.0;
+    graph->frame_time = 0.0;
+    return graph;
+}
+
+
+// Уничтожить граф задач:
+void TaskGraph_destroy(TaskGraph **graph) {
+    if (!graph || !*graph) return;
+    for (size_t i = 0; i < Array_len((*graph)->nodes); i++) {
+        TaskNode *node = node_at(*graph, (int)i);
+        Array_destroy(&node->deps);
+        Array_destroy(&node->dependents);
+        mm_free(node);
+    }
+    Array_destroy(&(*graph)->nodes);
+    Array_destroy(&(*graph)->order);
+    Array_destroy(&(*graph)->main_queue);
+    mtx_destroy(&(*graph)->main_lock);
+    mm_free(*graph);
+    *graph = NULL;
+}
+
+
+// Добавить узел в граф. Возвращает индекс узла:
+int TaskGraph_add(TaskGraph *graph, const char *name, TaskFunc func, void *data, uint32_t flags) {
+    if (!graph) return -1;
+    TaskNode *node = (TaskNode*)mm_calloc(1, sizeof(TaskNode));
+    snprintf(node->name, sizeof(node->name), "%s", name ? name : "unnamed");
+    node->func = func;
+    node->data = data;
+    node->flags = flags;
+    node->deps = Array_create(sizeof(int), 4);
+    node->dependents = Array_create(sizeof(int), 4);
+    node->graph = graph;
+    Array_push(graph->nodes, &node);
+    graph->built = false;
+    return (int)Array_len(graph->nodes) - 1;
+}
+
+
+// Установить ресурсы, которые узел читает и изменяет (битовые маски, до 64 ресурсов):
+void TaskGraph_set_access(TaskGraph *graph, int node, uint64_t reads, uint64_t writes) {
+    TaskNode *n = TaskGraph_get_node(graph, node);
+    if (!n) return;
+    n->reads = reads;
+    n->writes = writes;
+    graph->built = false;
+}
+
+
+// Добавить явную зависимость (node выполняется после depends_on):
+void TaskGraph_depend(TaskGraph *graph, int node, int depends_on) {
+    TaskNode *n = TaskGraph_get_node(graph, node);
+    if (!n || !TaskGraph_get_node(graph, depends_on) || node == depends_on) return;
+    Array_push(n->deps, &depends_on);
+    graph->built = false;
+}
+
+
+// Собрать граф (вычислить зависимости и порядок). Возвращает false при цикле в зависимостях:
+bool TaskGraph_build(TaskGraph *graph) {
+    if (!graph) return false;
+    int count = (int)Array_len(graph->nodes);
+
+    // Сбрасываем прошлую сборку:
+    for (int i = 0; i < count; i++) {
+        TaskNode *node = node_at(graph, i);
+        Array_clear(node->dependents, false);
+        node->dep_count = 0;
+    }
+    Array_clear(graph->order, false);
+
+    // Явные зависимости и конфликты по ресурсам (чтение после записи, запись после чтения или записи):
+    for (int j = 0; j < count; j++) {
+        TaskNode *b = node_at(graph, j);
+        for (size_t k = 0; k < Array_len(b->deps); k++) add_edge(graph, *(int*)Array_get(b->deps, k), j);
+        for (int i = 0; i < j; i++) {
+            TaskNode *a = node_at(graph, i);
+            if ((a->writes & (b->reads | b->writes)) || (a->reads & b->writes)) add_edge(graph, i, j);
+        }
+    }
+
+    // Топологическая сортировка (алгоритм Кана) для проверки циклов:
+    int *in = (int*)mm_alloc(sizeof(int) * (count > 0 ? count : 1));
+    for (int i = 0; i < count; i++) {
+        in[i] = node_at(graph, i)->dep_count;
+        if (in[i] == 0) Array_push(graph->order, &i);
+    }
+    for (size_t head = 0; head < Array_len(graph->order); head++) {
+        TaskNode *node = node_at(graph, *(int*)Array_get(graph->order, head));
+        for (size_t k = 0; k < Array_len(node->dependents); k++) {
+            int next = *(int*)Array_get(node->dependents, k);
+            if (--in[next] == 0) Array_push(graph->order, &next);
+        }
+    }
+    mm_free(in);
+
+    graph->built = (int)Array_len(graph->order) == count;
+    if (!graph->built) fprintf(stderr, "TaskGraph_build: Dependency cycle detected.\n");
+    return graph->built;
+}
+
+
+// Выполнить граф (независимые узлы выполняются параллельно в системе задач):
+void TaskGraph_execute(TaskGraph *graph) {
+    if (!graph) return;
+    if (!graph->built && !TaskGraph_build(graph)) return;
+    int count = (int)Array_len(graph->nodes);
+    if (count == 0) return;
+
+    // Подготавливаем счётчики:
+    graph->frame_start = Time_now(NULL);
+    atomic_store(&graph->done, 0);
+    for (int i = 0; i < count; i++) {
+        TaskNode *node = node_at(graph, i);
+        atomic_store(&node->remaining, node->dep_count);
+    }
+
+    // Запускаем корневые узлы:
+    for (int i = 0; i < count; i++) {
+        TaskNode *node = node_at(graph, i);
+        if (node->dep_count == 0) schedule_node(graph, node, i);
+    }
+
+    // Выполняем узлы главного потока и помогаем системе задач, пока граф не завершится:
+    while (atomic_load(&graph->done) < count) {
+        int index = -1;
+        if (atomic_load(&graph->main_len) > 0) {
+            mtx_lock(&graph->main_lock);
+            if (Array_len(graph->main_queue) > 0) {
+                Array_pop(graph->main_queue, &index);
+                atomic_fetch_sub(&graph->main_len, 1);
+            }
+            mtx_unlock(&graph->main_lock);
+        }
+        if (index >= 0) run_node(graph, node_at(graph, index));
+        else if (!Jobs_try_execute()) thrd_yield();
+    }
+    graph->frame_time = Time_now(NULL) - graph->frame_start;
+}
+
+
+// Получить узел по индексу:
+TaskNode* TaskGraph_get_node(TaskGraph *graph, int node) {
+    if (!graph || node < 0 || (size_t)node >= Array_len(graph->nodes)) return NULL;
+    return node_at(graph, node);
+}
+
+
+// Получить критический путь последнего кадра. Возвращает длину пути в узлах:
+int TaskGraph_get_critical_path(TaskGraph *graph, int *out_nodes, int max_nodes, double *out_time) {
+    if (out_time) *out_time = 0.0;
+    if (!graph || !graph->built) return 0;
+    int count = (int)Array_len(graph->nodes);
+    if (count == 0) return 0;
+
+    // Самый долгий путь до каждого узла (в топологическом порядке):
+    double *cost = (double*)mm_calloc(count, sizeof(double));
+    int *prev = (int*)mm_alloc(sizeof(int) * count);
+    for (int i = 0; i < count; i++) prev[i] = -1;
+    int last = -1;
+    for (size_t k = 0; k < Array_len(graph->order); k++) {
+        int i = *(int*)Array_get(graph->order, k);
+        TaskNode *node = node_at(graph, i);
+        cost[i] += node->end - node->start;
+        for (size_t d = 0; d < Array_len(node->dependents); d++) {
+            int next = *(int*)Array_get(node->dependents, d);
+            if (prev[next] < 0 || cost[i] > cost[next]) {
+                cost[next] = cost[i];
+                prev[next] = i;
+            }
+        }
+        if (last < 0 || cost[i] > cost[last]) last = i;
+    }
+    if (out_time) *out_time = cost[last];
+
+    // Восстанавливаем путь от конца к началу:
+    int length = 0;
+    for (int i = last; i >= 0; i = prev[i]) length++;
+    if (out_nodes) {
+        int pos = length;
+        for (int i = last; i >= 0; i = prev[i]) {
+            pos--;
+            if (pos < max_nodes) out_nodes[pos] = i;
+        }
+    }
+    mm_free(cost);
+    mm_free(prev);
+    return length;
+}
+
+
+// Вывести статистику времени узлов и критический путь последнего кадра:
+void TaskGraph_print_stats(TaskGraph *graph, FILE *out) {
+    if (!graph || !out) return;
+    fprintf(out, "TaskGraph: %zu nodes, frame %.3f ms.\n", Array_len(graph->nodes), graph->frame_time * 1000.0);
+    for (size_t i = 0; i < Array_len(graph->nodes); i++) {
+        TaskNode *node = node_at(graph, (int)i);
+        fprintf(out, "  [%2zu] %-*s %8.3f ms (%.3f -> %.3f)%s\n", i, TASKGRAPH_NAME_SIZE, node->name,
+                (node->end - node->start) * 1000.0, node->start * 1000.0, node->end * 1000.0,
+                (node->flags & TASK_NODE_MAIN_THREAD) ? " [main]" : "");
+    }
+
+    // Критический путь:
+    int path[64];
+    double time = 0.0;
+    int length = TaskGraph_get_critical_path(graph, path, 64, &time);
+    fprintf(out, "  Critical path (%.3f ms):", time * 1000.0);
+    for (int i = 0; i < length && i < 64; i++) fprintf(out, "%s %s", i ? " ->" : "", node_at(graph, path[i])->name);
+    fprintf(out, "\n");
+}
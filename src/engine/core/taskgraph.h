@@ -0,0 +1,94 @@
+//
+// taskgraph.h - Граф задач кадра с зависимостями между узлами.
+//
+
+#pragma once
+
+
+// Подключаем:
+#include "libs/tinycthread.h"
+#include "std.h"
+#include "array.h"
+
+
+// Определения:
+#define TASKGRAPH_NAME_SIZE 32  // Максимальная длина имени узла (с учётом '\0').
+
+
+// Флаги узла графа:
+typedef enum TaskNodeFlags {
+    TASK_NODE_NONE        = 0,
+    TASK_NODE_MAIN_THREAD = 1 << 0,  // Выполнять только на потоке, вызвавшем TaskGraph_execute (например GL).
+} TaskNodeFlags;
+
+
+// Объявление структур:
+typedef struct TaskNode TaskNode;    // Узел графа задач.
+typedef struct TaskGraph TaskGraph;  // Граф задач.
+
+
+// Функция узла:
+typedef void (*TaskFunc)(void *data);
+
+
+// Узел графа задач:
+struct TaskNode {
+    char name[TASKGRAPH_NAME_SIZE];  // Имя узла (для статистики).
+    TaskFunc func;        // Функция узла.
+    void *data;           // Данные узла.
+    uint32_t flags;       // Флаги узла (TaskNodeFlags).
+    uint64_t reads;       // Битовая маска ресурсов, которые узел читает.
+    uint64_t writes;      // Битовая маска ресурсов, которые узел изменяет.
+    Array *deps;          // Явные зависимости (индексы узлов, int).
+    Array *dependents;    // Узлы, которые ждут этот узел (заполняется при сборке).
+    int dep_count;        // Количество входящих зависимостей (заполняется при сборке).
+    atomic_int remaining; // Сколько зависимостей ещё не выполнено в текущем кадре.
+    double start;         // Время начала в последнем кадре (сек. от начала кадра).
+    double end;           // Время окончания в последнем кадре (сек. от начала кадра).
+    TaskGraph *graph;     // Граф, которому принадлежит узел.
+};
+
+
+// Граф задач:
+struct TaskGraph {
+    Array *nodes;          // Узлы графа (TaskNode*).
+    Array *order;          // Топологический порядок узлов (int, заполняется при сборке).
+    Array *main_queue;     // Готовые к выполнению узлы для главного потока (int).
+    mtx_t  main_lock;      // Блокировка очереди главного потока.
+    atomic_int main_len;   // Длина очереди главного потока.
+    atomic_int done;       // Сколько узлов выполнено в текущем кадре.
+    bool   built;          // Собран ли граф.
+    double frame_start;    // Время начала последнего выполнения.
+    double frame_time;     // Длительность последнего выполнения (сек).
+};
+
+
+// Создать граф задач:
+TaskGraph* TaskGraph_create();
+
+// Уничтожить граф задач:
+void TaskGraph_destroy(TaskGraph **graph);
+
+// Добавить узел в граф. Возвращает индекс узла:
+int TaskGraph_add(TaskGraph *graph, const char *name, TaskFunc func, void *data, uint32_t flags);
+
+// Установить ресурсы, которые узел читает и изменяет (битовые маски, до 64 ресурсов):
+void TaskGraph_set_access(TaskGraph *graph, int node, uint64_t reads, uint64_t writes);
+
+// Добавить явную зависимость (node выполняется после depends_on):
+void TaskGraph_depend(TaskGraph *graph, int node, int depends_on);
+
+// Собрать граф (вычислить зависимости и порядок). Возвращает false при цикле в зависимостях:
+bool TaskGraph_build(TaskGraph *graph);
+
+// Выполнить граф (независимые узлы выполняются параллельно в системе задач):
+void TaskGraph_execute(TaskGraph *graph);
+
+// Получить узел по индексу:
+TaskNode* TaskGraph_get_node(TaskGraph *graph, int node);
+
+// Получить критический путь последнего кадра. Возвращает длину пути в узлах:
+int TaskGraph_get_critical_path(TaskGraph *graph, int *out_nodes, int max_nodes, double *out_time);
+
+// Вывести статистику времени узлов и критический путь последнего кадра:
+void TaskGraph_print_stats(TaskGraph *graph, FILE *out);
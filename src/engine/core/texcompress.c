@@ -0,0 +1,557 @@
+//
+// texcompress.c - Реализация блочного сжатия текстур (BC1/BC3/BC4/BC5/BC7).
+//
+// Цвет блока приближается отрезком: концы ищутся по главной оси (ковариация + степенной метод), в режиме
+// качества уточняются наименьшими квадратами по выбранным индексам. Индексы всегда выбираются по точной
+// палитре после квантования концов, поэтому ошибка считается так же, как её увидит декодер.
+//
+
+
+// Подключаем:
+#include <limits.h>
+#include "std.h"
+#include "mm.h"
+#include "jobs.h"
+#include "pixmap.h"
+#include "texcompress.h"
+
+
+// Объявление структур:
+typedef struct TexCompress_Job TexCompress_Job;  // Сжатие картинки (строки блоков параллельно).
+
+
+// Сжатие картинки:
+struct TexCompress_Job {
+    const Pixmap *pixmap;  // RGBA.
+    TexCompress_Format format;
+    bool quality;
+    uint8_t *dst;
+    int blocks_x;
+};
+
+
+// Веса интерполяции 4-битных индексов BC7 (из спецификации):
+static const int bc7_weights4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+
+// Общие функции:
+
+
+// Прочитать блок 4x4 RGBA (за краем картинки повторяются крайние пиксели):
+static void fetch_block(const Pixmap *pixmap, int bx, int by, uint8_t block[64]) {
+    size_t stride = Pixmap_get_stride(pixmap);
+    for (int y = 0; y < 4; y++) {
+        int sy = by * 4 + y < pixmap->height ? by * 4 + y : pixmap->height - 1;
+        for (int x = 0; x < 4; x++) {
+            int sx = bx * 4 + x < pixmap->width ? bx * 4 + x : pixmap->width - 1;
+            memcpy(block + (y * 4 + x) * 4, pixmap->data + (size_t)sy * stride + (size_t)sx * 4, 4);
+        }
+    }
+}
+
+
+static inline float clampf(float v, float lo, float hi) {
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+
+// Приблизить точки (count штук по ch каналов) отрезком вдоль главной оси:
+static void fit_line(const float *points, int count, int ch, int iterations, float e0[4], float e1[4]) {
+    float mean[4] = {0}, cov[4][4] = {{0}}, axis[4], lo[4], hi[4];
+    for (int c = 0; c < ch; c++) { lo[c] = 255.0f; hi[c] = 0.0f; }
+    for (int i = 0; i < count; i++) {
+        for (int c = 0; c < ch; c++) {
+            float v = points[i * ch + c];
+            mean[c] += v;
+            if (v < lo[c]) lo[c] = v;
+            if (v > hi[c]) hi[c] = v;
+        }
+    }
+    for (int c = 0; c < ch; c++) mean[c] /= (float)count;
+    for (int i = 0; i < count; i++) {
+        for (int a = 0; a < ch; a++) {
+            for (int b = a; b < ch; b++) cov[a][b] += (points[i * ch + a] - mean[a]) * (points[i * ch + b] - mean[b]);
+        }
+    }
+    for (int a = 0; a < ch; a++) for (int b = 0; b < a; b++) cov[a][b] = cov[b][a];
+
+    // Степенной метод от диагонали охватывающего параллелепипеда:
+    for (int c = 0; c < ch; c++) axis[c] = hi[c] - lo[c];
+    for (int it = 0; it < iterations; it++) {
+        float next[4] = {0}, len = 0.0f;
+        for (int a = 0; a < ch; a++) {
+            for (int b = 0; b < ch; b++) next[a] += cov[a][b] * axis[b];
+            len = fabsf(next[a]) > len ? fabsf(next[a]) : len;
+        }
+        if (len < 1e-6f) break;
+        for (int c = 0; c < ch; c++) axis[c] = next[c] / len;
+    }
+    float norm = 0.0f;
+    for (int c = 0; c < ch; c++) norm += axis[c] * axis[c];
+    if (norm < 1e-12f) {  // Все точки одинаковые.
+        for (int c = 0; c < ch; c++) e0[c] = e1[c] = mean[c];
+        return;
+    }
+    norm = 1.0f / sqrtf(norm);
+    for (int c = 0; c < ch; c++) axis[c] *= norm;
+
+    // Концы - крайние проекции точек на ось:
+    float tmin = 1e30f, tmax = -1e30f;
+    for (int i = 0; i < count; i++) {
+        float t = 0.0f;
+        for (int c = 0; c < ch; c++) t += (points[i * ch + c] - mean[c]) * axis[c];
+        if (t < tmin) tmin = t;
+        if (t > tmax) tmax = t;
+    }
+    for (int c = 0; c < ch; c++) {
+        e0[c] = clampf(mean[c] + axis[c] * tmin, 0.0f, 255.0f);
+        e1[c] = clampf(mean[c] + axis[c] * tmax, 0.0f, 255.0f);
+    }
+}
+
+
+// Уточнить концы наименьшими квадратами по весам точек (вес 0 - e0, 1 - e1). false - система вырождена:
+static bool refine_line(const float *points, const float *weights, int count, int ch, float e0[4], float e1[4]) {
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f, x[4] = {0}, y[4] = {0};
+    for (int i = 0; i < count; i++) {
+        float w = weights[i], iw = 1.0f - w;
+        aa += iw * iw;
+        ab += iw * w;
+        bb += w * w;
+        for (int c = 0; c < ch; c++) {
+            x[c] += iw * points[i * ch + c];
+            y[c] += w * points[i * ch + c];
+        }
+    }
+    float det = aa * bb - ab * ab;
+    if (fabsf(det) < 1e-6f) return false;
+    float inv = 1.0f / det;
+    for (int c = 0; c < ch; c++) {
+        e0[c] = clampf((bb * x[c] - ab * y[c]) * inv, 0.0f, 255.0f);
+        e1[c] = clampf((aa * y[c] - ab * x[c]) * inv, 0.0f, 255.0f);
+    }
+    return true;
+}
+
+
+// BC1 (цвет):
+
+
+static inline uint16_t pack565(const float c[3]) {
+    int r = (int)(clampf(c[0], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+    int g = (int)(clampf(c[1], 0.0f, 255.0f) * 63.0f / 255.0f + 0.5f);
+    int b = (int)(clampf(c[2], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+
+static inline void unpack565(uint16_t v, int out[3]) {
+    int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+    out[0] = (r << 3) | (r >> 2);
+    out[1] = (g << 2) | (g >> 4);
+    out[2] = (b << 3) | (b >> 2);
+}
+
+
+// Закодировать цветовой блок BC1. Возвращает ошибку (сумма квадратов).
+// allow_transparent - пиксели с альфой < 128 кодируются прозрачным индексом 3 (режим трёх цветов):
+static int encode_color_block(const uint8_t *block, bool quality, bool allow_transparent, uint8_t out[8]) {
+    float points[16 * 3];
+    bool transparent[16];
+    int count = 0;
+    bool three_color = false;
+    for (int i = 0; i < 16; i++) {
+        transparent[i] = allow_transparent && block[i * 4 + 3] < 128;
+        if (transparent[i]) { three_color = true; continue; }
+        for (int c = 0; c < 3; c++) points[count * 3 + c] = block[i * 4 + c];
+        count++;
+    }
+
+    // Полностью прозрачный блок:
+    if (count == 0) {
+        memset(out, 0, 4);
+        memset(out + 4, 0xFF, 4);
+        return 0;
+    }
+
+    float e0[4], e1[4];
+    fit_line(points, count, 3, quality ? 8 : 3, e0, e1);
+
+    int best_error = INT_MAX;
+    int passes = quality ? 3 : 1;
+    for (int pass = 0; pass < passes; pass++) {
+        uint16_t c0 = pack565(e0), c1 = pack565(e1);
+        bool swapped = three_color ? c0 > c1 : c0 < c1;
+        if (swapped) { uint16_t t = c0; c0 = c1; c1 = t; }
+
+        // Палитра (как в декодере):
+        int pal[4][3], a[3], b[3];
+        unpack565(c0, a);
+        unpack565(c1, b);
+        for (int c = 0; c < 3; c++) {
+            pal[0][c] = a[c];
+            pal[1][c] = b[c];
+            if (three_color) {
+                pal[2][c] = (a[c] + b[c]) / 2;
+                pal[3][c] = 0;
+            } else {
+                pal[2][c] = (2 * a[c] + b[c]) / 3;
+                pal[3][c] = (a[c] + 2 * b[c]) / 3;
+            }
+        }
+        int colors = (three_color || c0 == c1) ? 3 : 4;
+        if (c0 == c1) colors = 1;
+
+        // Индексы по точной палитре:
+        uint32_t indices = 0;
+        int error = 0;
+        float weights[16];
+        int n = 0;
+        for (int i = 0; i < 16; i++) {
+            int best = 0, best_d = INT_MAX;
+            if (transparent[i]) {
+                best = 3;
+                best_d = 0;
+            } else {
+                for (int p = 0; p < colors; p++) {
+                    int dr = block[i * 4] - pal[p][0], dg = block[i * 4 + 1] - pal[p][1], db = block[i * 4 + 2] - pal[p][2];
+                    int d = dr * dr + dg * dg + db * db;
+                    if (d < best_d) { best_d = d; best = p; }
+                }
+                static const float pos4[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+                static const float pos3[4] = {0.0f, 1.0f, 0.5f, 0.0f};
+                float w = three_color ? pos3[best] : pos4[best];
+                weights[n++] = swapped ? 1.0f - w : w;  // Вес относительно e0/e1 до перестановки.
+            }
+            indices |= (uint32_t)best << (i * 2);
+            error += best_d;
+        }
+        if (error < best_error) {
+            best_error = error;
+            out[0] = (uint8_t)(c0 & 0xFF);
+            out[1] = (uint8_t)(c0 >> 8);
+            out[2] = (uint8_t)(c1 & 0xFF);
+            out[3] = (uint8_t)(c1 >> 8);
+            for (int k = 0; k < 4; k++) out[4 + k] = (uint8_t)(indices >> (k * 8));
+        }
+        if (pass + 1 < passes && (best_error == 0 || !refine_line(points, weights, count, 3, e0, e1))) break;
+    }
+    return best_error;
+}
+
+
+// BC4 (один канал):
+
+
+// Палитра канала (a0 > a1 - 8 значений, иначе 6 значений + 0 и 255):
+static void alpha_palette(int a0, int a1, int pal[8]) {
+    pal[0] = a0;
+    pal[1] = a1;
+    if (a0 > a1) {
+        for (int i = 1; i < 7; i++) pal[i + 1] = ((7 - i) * a0 + i * a1 + 3) / 7;
+    } else {
+        for (int i = 1; i < 5; i++) pal[i + 1] = ((5 - i) * a0 + i * a1 + 2) / 5;
+        pal[6] = 0;
+        pal[7] = 255;
+    }
+}
+
+
+// Выбрать индексы для палитры. Возвращает ошибку:
+static int alpha_indices(const uint8_t *values, int stride, const int pal[8], uint8_t idx[16]) {
+    int error = 0;
+    for (int i = 0; i < 16; i++) {
+        int v = values[i * stride], best = 0, best_d = INT_MAX;
+        for (int p = 0; p < 8; p++) {
+            int d = (v - pal[p]) * (v - pal[p]);
+            if (d < best_d) { best_d = d; best = p; }
+        }
+        idx[i] = (uint8_t)best;
+        error += best_d;
+    }
+    return error;
+}
+
+
+static void write_alpha_block(int a0, int a1, const uint8_t idx[16], uint8_t out[8]) {
+    out[0] = (uint8_t)a0;
+    out[1] = (uint8_t)a1;
+    uint64_t bits = 0;
+    for (int i = 0; i < 16; i++) bits |= (uint64_t)idx[i] << (i * 3);
+    for (int k = 0; k < 6; k++) out[2 + k] = (uint8_t)(bits >> (k * 8));
+}
+
+
+// Закодировать канал блока (values - первый байт канала, stride - шаг между пикселями):
+static void encode_alpha_block(const uint8_t *values, int stride, bool quality, uint8_t out[8]) {
+    int lo = 255, hi = 0, lo_inner = 255, hi_inner = 0;
+    for (int i = 0; i < 16; i++) {
+        int v = values[i * stride];
+        if (v < lo) lo = v;
+        if (v > hi) hi = v;
+        if (v > 0 && v < lo_inner) lo_inner = v;
+        if (v < 255 && v > hi_inner) hi_inner = v;
+    }
+    int pal[8];
+    uint8_t idx[16], best_idx[16];
+    int best_a0 = hi, best_a1 = lo;
+    if (hi == lo) {  // Один уровень: a0 <= a1, все индексы 0.
+        memset(best_idx, 0, sizeof(best_idx));
+        write_alpha_block(hi, lo, best_idx, out);
+        return;
+    }
+    alpha_palette(hi, lo, pal);
+    int best_error = alpha_indices(values, stride, pal, best_idx);
+
+    if (quality) {
+        // Режим 6 значений: края 0 и 255 берутся из палитры, отрезок - только по внутренним значениям:
+        if (lo_inner <= hi_inner) {
+            alpha_palette(lo_inner, hi_inner, pal);
+            int error = alpha_indices(values, stride, pal, idx);
+            if (error < best_error) {
+                best_error = error;
+                best_a0 = lo_inner;
+                best_a1 = hi_inner;
+                memcpy(best_idx, idx, sizeof(idx));
+            }
+        }
+
+        // Сужение отрезка режима 8 значений (крайние значения часто единичны):
+        for (int shrink = 1; shrink <= 4 && best_error > 0; shrink++) {
+            for (int side = 0; side < 3; side++) {
+                int a0 = hi - (side != 1 ? shrink : 0), a1 = lo + (side != 0 ? shrink : 0);
+                if (a0 <= a1) continue;
+                alpha_palette(a0, a1, pal);
+                int error = alpha_indices(values, stride, pal, idx);
+                if (error < best_error) {
+                    best_error = error;
+                    best_a0 = a0;
+                    best_a1 = a1;
+                    memcpy(best_idx, idx, sizeof(idx));
+                }
+            }
+        }
+    }
+    write_alpha_block(best_a0, best_a1, best_idx, out);
+}
+
+
+// BC7 (режим 6):
+
+
+// Запись битов блока от младшего к старшему:
+static inline void put_bits(uint8_t out[16], int *pos, uint32_t value, int count) {
+    for (int i = 0; i < count; i++, (*pos)++) {
+        if (value & (1u << i)) out[*pos >> 3] |= (uint8_t)(1u << (*pos & 7));
+    }
+}
+
+
+// Квантовать конец в 7 бит + общий p-бит (подбирается p с меньшей ошибкой):
+static void bc7_quantize(const float e[4], int q[4], int *pbit) {
+    int best_error = INT_MAX;
+    for (int p = 0; p < 2; p++) {
+        int error = 0, t[4];
+        for (int c = 0; c < 4; c++) {
+            int v = (int)((clampf(e[c], 0.0f, 255.0f) - p) / 2.0f + 0.5f);
+            t[c] = v < 0 ? 0 : (v > 127 ? 127 : v);
+            int d = ((t[c] << 1) | p) - (int)(e[c] + 0.5f);
+            error += d * d;
+        }
+        if (error < best_error) {
+            best_error = error;
+            memcpy(q, t, sizeof(t));
+            *pbit = p;
+        }
+    }
+}
+
+
+static void encode_bc7_block(const uint8_t *block, bool quality, uint8_t out[16]) {
+    float points[16 * 4];
+    for (int i = 0; i < 64; i++) points[i] = block[i];
+    float e0[4], e1[4];
+    fit_line(points, 16, 4, quality ? 8 : 3, e0, e1);
+
+    int best_error = INT_MAX;
+    int passes = quality ? 3 : 1;
+    for (int pass = 0; pass < passes; pass++) {
+        int q0[4], q1[4], p0, p1, a[4], b[4], pal[16][4];
+        bc7_quantize(e0, q0, &p0);
+        bc7_quantize(e1, q1, &p1);
+        for (int c = 0; c < 4; c++) {
+            a[c] = (q0[c] << 1) | p0;
+            b[c] = (q1[c] << 1) | p1;
+        }
+        for (int i = 0; i < 16; i++) {
+            for (int c = 0; c < 4; c++) pal[i][c] = ((64 - bc7_weights4[i]) * a[c] + bc7_weights4[i] * b[c] + 32) >> 6;
+        }
+
+        // Индексы по точной палитре:
+        uint8_t idx[16];
+        float weights[16];
+        int error = 0;
+        for (int i = 0; i < 16; i++) {
+            int best = 0, best_d = INT_MAX;
+            for (int p = 0; p < 16; p++) {
+                int d = 0;
+                for (int c = 0; c < 4; c++) {
+                    int diff = block[i * 4 + c] - pal[p][c];
+                    d += diff * diff;
+                }
+                if (d < best_d) { best_d = d; best = p; }
+            }
+            idx[i] = (uint8_t)best;
+            weights[i] = bc7_weights4[best] / 64.0f;
+            error += best_d;
+        }
+
+        if (error < best_error) {
+            best_error = error;
+
+            // Старший бит индекса первого пикселя не хранится - он должен быть 0 (иначе меняем концы местами):
+            if (idx[0] & 8) {
+                for (int c = 0; c < 4; c++) { int t = q0[c]; q0[c] = q1[c]; q1[c] = t; }
+                int t = p0; p0 = p1; p1 = t;
+                for (int i = 0; i < 16; i++) idx[i] = (uint8_t)(15 - idx[i]);
+            }
+            memset(out, 0, 16);
+            int pos = 0;
+            put_bits(out, &pos, 1u << 6, 7);  // Режим 6.
+            for (int c = 0; c < 4; c++) {
+                put_bits(out, &pos, (uint32_t)q0[c], 7);
+                put_bits(out, &pos, (uint32_t)q1[c], 7);
+            }
+            put_bits(out, &pos, (uint32_t)p0, 1);
+            put_bits(out, &pos, (uint32_t)p1, 1);
+            for (int i = 0; i < 16; i++) put_bits(out, &pos, idx[i], i == 0 ? 3 : 4);
+        }
+        if (pass + 1 < passes && (best_error == 0 || !refine_line(points, weights, 16, 4, e0, e1))) break;
+    }
+}
+
+
+// Закодировать блок в выбранном формате:
+static void encode_block(const uint8_t *block, TexCompress_Format format, bool quality, uint8_t *out) {
+    switch (format) {
+        case TEXCOMPRESS_BC1: { encode_color_block(block, quality, true, out); break; }
+        case TEXCOMPRESS_BC3: {
+            encode_alpha_block(block + 3, 4, quality, out);
+            encode_color_block(block, quality, false, out + 8);
+            break;
+        }
+        case TEXCOMPRESS_BC4: { encode_alpha_block(block, 4, quality, out); break; }
+        case TEXCOMPRESS_BC5: {
+            encode_alpha_block(block, 4, quality, out);
+            encode_alpha_block(block + 1, 4, quality, out + 8);
+            break;
+        }
+        case TEXCOMPRESS_BC7: { encode_bc7_block(block, quality, out); break; }
+    }
+}
+
+
+// Сжать диапазон строк блоков:
+static void encode_rows(size_t start, size_t end, void *data) {
+    TexCompress_Job *job = (TexCompress_Job*)data;
+    size_t block_bytes = TexCompress_get_block_bytes(job->format);
+    uint8_t block[64];
+    for (size_t by = start; by < end; by++) {
+        uint8_t *out = job->dst + by * job->blocks_x * block_bytes;
+        for (int bx = 0; bx < job->blocks_x; bx++, out += block_bytes) {
+            fetch_block(job->pixmap, bx, (int)by, block);
+            encode_block(block, job->format, job->quality, out);
+        }
+    }
+}
+
+
+// Заполнить размеры уровней сжатой текстуры. Возвращает общий размер:
+static size_t layout_levels(TexCompress_Image *image, const PixmapMips *mips, TexCompress_Format format) {
+    image->format = format;
+    image->width = mips->levels[0]->width;
+    image->height = mips->levels[0]->height;
+    image->levels_count = mips->count;
+    size_t size = 0;
+    for (int i = 0; i < mips->count; i++) {
+        image->level_offsets[i] = size;
+        image->level_sizes[i] = TexCompress_get_level_size(format, mips->levels[i]->width, mips->levels[i]->height);
+        size += image->level_sizes[i];
+    }
+    return size;
+}
+
+
+// Получить размер блока 4x4 в байтах:
+size_t TexCompress_get_block_bytes(TexCompress_Format format) {
+    return (format == TEXCOMPRESS_BC1 || format == TEXCOMPRESS_BC4) ? 8 : 16;
+}
+
+
+// Получить размер сжатого уровня в байтах:
+size_t TexCompress_get_level_size(TexCompress_Format format, int width, int height) {
+    size_t bx = (size_t)(width + 3) / 4, by = (size_t)(height + 3) / 4;
+    return bx * by * TexCompress_get_block_bytes(format);
+}
+
+
+// Получить название формата:
+const char* TexCompress_get_format_name(TexCompress_Format format) {
+    switch (format) {
+        case TEXCOMPRESS_BC1: return "BC1";
+        case TEXCOMPRESS_BC3: return "BC3";
+        case TEXCOMPRESS_BC4: return "BC4";
+        case TEXCOMPRESS_BC5: return "BC5";
+        case TEXCOMPRESS_BC7: return "BC7";
+        default: return "unknown";
+    }
+}
+
+
+// Сжать одну картинку в dst:
+void TexCompress_encode_level(const Pixmap *pixmap, TexCompress_Format format, TexCompress_Quality quality, uint8_t *dst) {
+    if (!pixmap || !pixmap->data || !dst || pixmap->width <= 0 || pixmap->height <= 0) return;
+
+    // Кодеры читают RGBA по 8 бит на канал:
+    Pixmap *u8 = NULL, *rgba = NULL;
+    if (pixmap->type != PIXMAP_U8) pixmap = u8 = Pixmap_convert_type(pixmap, PIXMAP_U8);
+    if (pixmap->channels != PIXMAP_RGBA) {
+        rgba = Pixmap_convert(pixmap, PIXMAP_RGBA);
+        pixmap = rgba;
+    }
+
+    TexCompress_Job job = {
+        .pixmap = pixmap, .format = format, .quality = quality == TEXCOMPRESS_QUALITY,
+        .dst = dst, .blocks_x = (pixmap->width + 3) / 4,
+    };
+    size_t blocks_y = (size_t)(pixmap->height + 3) / 4;
+    if (Jobs_is_initialized() && blocks_y > 1) {
+        Jobs_parallel_for(blocks_y, 1, encode_rows, &job);
+    } else {
+        encode_rows(0, blocks_y, &job);
+    }
+    Pixmap_destroy(&rgba);
+    Pixmap_destroy(&u8);
+}
+
+
+// Сжать цепочку мипмапов:
+TexCompress_Image* TexCompress_encode(const PixmapMips *mips, TexCompress_Format format, TexCompress_Quality quality) {
+    if (!mips || mips->count <= 0) return NULL;
+    TexCompress_Image *image = (TexCompress_Image*)mm_alloc(sizeof(TexCompress_Image));
+    image->size = layout_levels(image, mips, format);
+    image->data = (uint8_t*)mm_alloc(image->size);
+    for (int i = 0; i < mips->count; i++) {
+        TexCompress_encode_level(mips->levels[i], format, quality, image->data + image->level_offsets[i]);
+    }
+    return image;
+}
+
+
+// Уничтожить сжатую текстуру:
+void TexCompress_destroy(TexCompress_Image **image) {
+    if (!image || !*image) return;
+    mm_free((*image)->data);
+    mm_free(*image);
+    *image = NULL;
+}
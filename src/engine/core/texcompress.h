@@ -0,0 +1,67 @@
+//
+// texcompress.h - Блочное сжатие текстур на процессоре (BC1/BC3/BC4/BC5/BC7) для загрузки через glCompressedTexImage2D.
+//
+// Каждый блок 4x4 кодируется независимо, строки блоков делятся между потоками системы задач. Сжатые уровни
+// кэшируются вместе с остальными текстурами в .rawtex (rawtex.h, RawTex_set_compression).
+// BC7 кодируется режимом 6 (одна группа, RGBA 7.7.7.7 + p-бит, 16 уровней) - без перебора разбиений.
+//
+
+#pragma once
+
+
+// Подключаем:
+#include "std.h"
+#include "pixmap.h"
+
+
+// Формат сжатия:
+typedef enum TexCompress_Format {
+    TEXCOMPRESS_BC1,  // RGB (+ 1 бит альфы), 8 байт на блок.
+    TEXCOMPRESS_BC3,  // RGBA (альфа отдельным блоком BC4), 16 байт на блок.
+    TEXCOMPRESS_BC4,  // Один канал (R), 8 байт на блок.
+    TEXCOMPRESS_BC5,  // Два канала (RG, например карты нормалей), 16 байт на блок.
+    TEXCOMPRESS_BC7,  // RGBA высокого качества, 16 байт на блок.
+} TexCompress_Format;
+
+
+// Качество сжатия:
+typedef enum TexCompress_Quality {
+    TEXCOMPRESS_FAST,     // Концы отрезка по главной оси без уточнения.
+    TEXCOMPRESS_QUALITY,  // То же плюс уточнение концов методом наименьших квадратов.
+} TexCompress_Quality;
+
+
+// Объявление структур:
+typedef struct TexCompress_Image TexCompress_Image;  // Сжатая текстура с уровнями мипмапов.
+
+
+// Сжатая текстура с уровнями мипмапов (уровни лежат в data подряд):
+struct TexCompress_Image {
+    TexCompress_Format format;
+    int width;
+    int height;
+    int levels_count;
+    size_t level_offsets[PIXMAP_MIPS_MAX];
+    size_t level_sizes[PIXMAP_MIPS_MAX];
+    uint8_t *data;
+    size_t size;
+};
+
+
+// Получить размер блока 4x4 в байтах:
+size_t TexCompress_get_block_bytes(TexCompress_Format format);
+
+// Получить размер сжатого уровня в байтах:
+size_t TexCompress_get_level_size(TexCompress_Format format, int width, int height);
+
+// Получить название формата:
+const char* TexCompress_get_format_name(TexCompress_Format format);
+
+// Сжать одну картинку в dst (TexCompress_get_level_size байт). Блоки кодируются параллельно:
+void TexCompress_encode_level(const Pixmap *pixmap, TexCompress_Format format, TexCompress_Quality quality, uint8_t *dst);
+
+// Сжать цепочку мипмапов:
+TexCompress_Image* TexCompress_encode(const PixmapMips *mips, TexCompress_Format format, TexCompress_Quality quality);
+
+// Уничтожить сжатую текстуру:
+void TexCompress_destroy(TexCompress_Image **image);
@@ -0,0 +1,349 @@
+//
+// watcher.c - Реализация слежения за изменением файлов.
+//
+// В Linux inotify следит за каталогами (а не за самими файлами), потому что многие редакторы сохраняют
+// файл через запись во временный и переименование - у файла меняется inode и прямое слежение теряется.
+// Дескриптор неблокирующий и читается в Watcher_poll, отдельный поток не нужен.
+//
+
+
+// Включаем POSIX функции (stat.st_mtim) при строгом -std=c17:
+#if !defined(_WIN32) && !defined(_WIN64) && !defined(_DEFAULT_SOURCE)
+    #define _DEFAULT_SOURCE
+#endif
+
+
+// Подключаем:
+#include "std.h"
+#include "mm.h"
+#include "array.h"
+#include "time.h"
+#include "files.h"
+#include "watcher.h"
+#include "libs/tinycthread.h"
+
+#if defined(_WIN32) || defined(_WIN64)
+    #include <sys/types.h>
+    #include <sys/stat.h>
+#else
+    #include <unistd.h>
+    #include <sys/stat.h>
+#endif
+
+#if defined(__linux__)
+    #include <sys/inotify.h>
+    #define WATCHER_HAS_INOTIFY 1
+#endif
+
+
+// Объявление структур:
+typedef struct WatchDir WatchDir;      // Каталог под слежением inotify.
+typedef struct WatchEntry WatchEntry;  // Подписка на файл.
+typedef struct WatchCall WatchCall;    // Готовый к вызову вызов функции изменения.
+
+
+// Каталог под слежением inotify:
+struct WatchDir {
+    char *path;  // Путь до каталога.
+    int wd;      // Дескриптор слежения inotify.
+};
+
+
+// Подписка на файл:
+struct WatchEntry {
+    uint32_t id;                // Идентификатор подписки.
+    char *path;                 // Путь до файла.
+    const char *name;           // Имя файла (указатель внутрь path).
+    size_t dir;                 // Индекс каталога в списке каталогов (inotify).
+    Watcher_Callback callback;  // Функция изменения.
+    void *data;                 // Данные для функции изменения.
+    int64_t mtime;              // Время изменения файла в нс (опрос).
+    int64_t size;               // Размер файла (опрос).
+    bool pending;               // Файл изменился, ждём WATCHER_SETTLE_TIME.
+    double pending_time;        // Время последнего изменения.
+};
+
+
+// Готовый к вызову вызов функции изменения:
+struct WatchCall {
+    uint32_t id;                // Подписка (вызываем, только если она ещё существует).
+    Watcher_Callback callback;  // Функция изменения.
+    void *data;                 // Данные для функции изменения.
+};
+
+
+// Состояние модуля:
+static struct {
+    bool initialized;
+    Watcher_Backend backend;
+    int fd;              // Дескриптор inotify.
+    Array *dirs;         // Каталоги под слежением (WatchDir).
+    Array *entries;      // Подписки (WatchEntry).
+    Array *calls;        // Вызовы текущего Watcher_poll (WatchCall).
+    uint32_t next_id;    // Следующий идентификатор подписки.
+    double last_scan;    // Время последнего опроса файлов.
+    mtx_t lock;          // Защищает всё состояние (рекурсивный: функции изменения добавляют и удаляют подписки).
+} watcher = {0};
+
+
+// Найти подписку по идентификатору (NULL - нет):
+static WatchEntry* find_entry(uint32_t id) {
+    for (size_t i = 0; i < Array_len(watcher.entries); i++) {
+        WatchEntry *entry = (WatchEntry*)Array_get(watcher.entries, i);
+        if (entry->id == id) return entry;
+    }
+    return NULL;
+}
+
+
+// Удалить подписку по индексу:
+static void remove_entry(size_t index) {
+    WatchEntry entry;
+    Array_remove_swap(watcher.entries, index, &entry);
+    mm_free(entry.path);
+}
+
+
+// Найти или добавить каталог под слежением inotify. Возвращает индекс (SIZE_MAX - ошибка):
+#if defined(WATCHER_HAS_INOTIFY)
+static size_t watch_dir(const char *dir) {
+    for (size_t i = 0; i < Array_len(watcher.dirs); i++) {
+        WatchDir *item = (WatchDir*)Array_get(watcher.dirs, i);
+        if (strcmp(item->path, dir) == 0) return i;
+    }
+    int wd = inotify_add_watch(watcher.fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_MODIFY | IN_CREATE);
+    if (wd < 0) {
+        fprintf(stderr, "Watcher_add: Failed to watch directory \"%s\".\n", dir);
+        return SIZE_MAX;
+    }
+
+    // Разные пути могут вести в один каталог - inotify вернёт тот же дескриптор:
+    for (size_t i = 0; i < Array_len(watcher.dirs); i++) {
+        WatchDir *item = (WatchDir*)Array_get(watcher.dirs, i);
+        if (item->wd == wd) return i;
+    }
+    WatchDir item = {mm_strdup(dir), wd};
+    Array_push(watcher.dirs, &item);
+    return Array_len(watcher.dirs) - 1;
+}
+
+
+// Прочитать накопившиеся события inotify и отметить изменённые файлы:
+static void read_events(double now) {
+    _Alignas(struct inotify_event) char buffer[4096];
+    for (;;) {
+        ssize_t len = read(watcher.fd, buffer, sizeof(buffer));
+        if (len <= 0) break;  // EAGAIN - событий больше нет.
+        for (char *p = buffer; p < buffer + len;) {
+            const struct inotify_event *event = (const struct inotify_event*)p;
+            p += sizeof(struct inotify_event) + event->len;
+            if (event->len == 0) continue;
+
+            for (size_t i = 0; i < Array_len(watcher.entries); i++) {
+                WatchEntry *entry = (WatchEntry*)Array_get(watcher.entries, i);
+                WatchDir *dir = (WatchDir*)Array_get(watcher.dirs, entry->dir);
+                if (dir->wd != event->wd || strcmp(entry->name, event->name) != 0) continue;
+                entry->pending = true;
+                entry->pending_time = now;
+            }
+        }
+    }
+}
+#endif
+
+
+// Опросить файлы и отметить изменённые:
+static void scan_files(double now) {
+    for (size_t i = 0; i < Array_len(watcher.entries); i++) {
+        WatchEntry *entry = (WatchEntry*)Array_get(watcher.entries, i);
+        int64_t mtime = 0, size = 0;
+        if (!Files_stat(entry->path, &mtime, &size)) continue;  // Файл удалён (или в процессе замены).
+        if (mtime == entry->mtime && size == entry->size) continue;
+        entry->mtime = mtime;
+        entry->size = size;
+        entry->pending = true;
+        entry->pending_time = now;
+    }
+}
+
+
+// Инициализация слежения за файлами:
+bool Watcher_init() {
+    if (watcher.initialized) return true;
+    memset(&watcher, 0, sizeof(watcher));
+    watcher.fd = -1;
+    watcher.backend = WATCHER_BACKEND_POLLING;
+
+    #if defined(WATCHER_HAS_INOTIFY)
+        watcher.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (watcher.fd >= 0) watcher.backend = WATCHER_BACKEND_INOTIFY;
+    #endif
+
+    watcher.dirs = Array_create(sizeof(WatchDir), 16);
+    watcher.entries = Array_create(sizeof(WatchEntry), 64);
+    watcher.calls = Array_create(sizeof(WatchCall), 16);
+    watcher.next_id = 1;
+    watcher.last_scan = Time_now(NULL);
+    mtx_init(&watcher.lock, mtx_plain | mtx_recursive);
+    watcher.initialized = true;
+    return true;
+}
+
+
+// Завершение слежения (удаляет все подписки):
+void Watcher_destroy() {
+    if (!watcher.initialized) return;
+    for (size_t i = 0; i < Array_len(watcher.entries); i++) {
+        mm_free(((WatchEntry*)Array_get(watcher.entries, i))->path);
+    }
+    for (size_t i = 0; i < Array_len(watcher.dirs); i++) {
+        mm_free(((WatchDir*)Array_get(watcher.dirs, i))->path);
+    }
+    #if defined(WATCHER_HAS_INOTIFY)
+        if (watcher.fd >= 0) close(watcher.fd);  // Закрытие снимает все слежения inotify.
+    #endif
+    Array_destroy(&watcher.dirs);
+    Array_destroy(&watcher.entries);
+    Array_destroy(&watcher.calls);
+    mtx_destroy(&watcher.lock);
+    memset(&watcher, 0, sizeof(watcher));
+}
+
+
+// Инициализировано ли слежение:
+bool Watcher_is_initialized() {
+    return watcher.initialized;
+}
+
+
+// Получить механизм слежения:
+Watcher_Backend Watcher_get_backend() {
+    return watcher.backend;
+}
+
+
+// Получить название механизма слежения:
+const char* Watcher_get_backend_name() {
+    switch (watcher.backend) {
+        case WATCHER_BACKEND_INOTIFY: return "inotify";
+        case WATCHER_BACKEND_POLLING: return "polling";
+        default: return "none";
+    }
+}
+
+
+// Следить за файлом. Возвращает идентификатор подписки (0 - ошибка или слежение не инициализировано):
+uint32_t Watcher_add(const char *path, Watcher_Callback callback, void *data) {
+    if (!watcher.initialized || !path || !callback) return 0;
+
+    WatchEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.path = mm_strdup(path);
+    for (char *c = entry.path; *c; c++) if (*c == '\\') *c = '/';
+    const char *slash = strrchr(entry.path, '/');
+    entry.name = slash ? slash + 1 : entry.path;
+    entry.callback = callback;
+    entry.data = data;
+
+    // Следим только за файлами на диске (данные из смонтированного архива не меняются):
+    if (!Files_stat(entry.path, &entry.mtime, &entry.size)) {
+        mm_free(entry.path);
+        return 0;
+    }
+
+    mtx_lock(&watcher.lock);
+    #if defined(WATCHER_HAS_INOTIFY)
+        if (watcher.backend == WATCHER_BACKEND_INOTIFY) {
+            char dir[1024];
+            if (slash) snprintf(dir, sizeof(dir), "%.*s", (int)(slash - entry.path), entry.path);
+            else snprintf(dir, sizeof(dir), ".");
+            entry.dir = watch_dir(dir[0] ? dir : "/");
+            if (entry.dir == SIZE_MAX) {
+                mtx_unlock(&watcher.lock);
+                mm_free(entry.path);
+                return 0;
+            }
+        }
+    #endif
+
+    entry.id = watcher.next_id++;
+    if (watcher.next_id == 0) watcher.next_id = 1;
+    Array_push(watcher.entries, &entry);
+    mtx_unlock(&watcher.lock);
+    return entry.id;
+}
+
+
+// Удалить подписку:
+void Watcher_remove(uint32_t id) {
+    if (!watcher.initialized || id == 0) return;
+    mtx_lock(&watcher.lock);
+    for (size_t i = 0; i < Array_len(watcher.entries); i++) {
+        if (((WatchEntry*)Array_get(watcher.entries, i))->id != id) continue;
+        remove_entry(i);
+        break;
+    }
+    mtx_unlock(&watcher.lock);
+}
+
+
+// Удалить все подписки с этими данными (вызывать при уничтожении ресурса):
+void Watcher_remove_data(void *data) {
+    if (!watcher.initialized) return;
+    mtx_lock(&watcher.lock);
+    for (size_t i = Array_len(watcher.entries); i-- > 0;) {
+        if (((WatchEntry*)Array_get(watcher.entries, i))->data == data) remove_entry(i);
+    }
+    mtx_unlock(&watcher.lock);
+}
+
+
+// Проверить изменения и вызвать функции изменения. Одна пара (функция, данные) вызывается не чаще раза за вызов.
+// Возвращает количество вызванных функций:
+int Watcher_poll() {
+    if (!watcher.initialized) return 0;
+    mtx_lock(&watcher.lock);
+    if (Array_len(watcher.entries) == 0) {
+        mtx_unlock(&watcher.lock);
+        return 0;
+    }
+    double now = Time_now(NULL);
+
+    // Собираем изменения:
+    #if defined(WATCHER_HAS_INOTIFY)
+        if (watcher.backend == WATCHER_BACKEND_INOTIFY) read_events(now);
+    #endif
+    if (watcher.backend == WATCHER_BACKEND_POLLING && now - watcher.last_scan >= WATCHER_POLL_INTERVAL) {
+        scan_files(now);
+        watcher.last_scan = now;
+    }
+
+    // Выбираем устоявшиеся изменения (вершинный и фрагментный шейдер одной программы - один вызов):
+    watcher.calls->len = 0;
+    for (size_t i = 0; i < Array_len(watcher.entries); i++) {
+        WatchEntry *entry = (WatchEntry*)Array_get(watcher.entries, i);
+        if (!entry->pending || now - entry->pending_time < WATCHER_SETTLE_TIME) continue;
+        entry->pending = false;
+        bool duplicate = false;
+        for (size_t k = 0; k < Array_len(watcher.calls) && !duplicate; k++) {
+            WatchCall *call = (WatchCall*)Array_get(watcher.calls, k);
+            duplicate = call->callback == entry->callback && call->data == entry->data;
+        }
+        if (!duplicate) Array_push(watcher.calls, &(WatchCall){entry->id, entry->callback, entry->data});
+    }
+
+    // Вызываем под блокировкой: ресурс, уничтожаемый в другом потоке, дождётся конца своей перезагрузки. Функция
+    // изменения может добавлять и удалять подписки, поэтому каждую ищем заново:
+    int called = 0;
+    for (size_t i = 0; i < Array_len(watcher.calls); i++) {
+        WatchCall call = *(WatchCall*)Array_get(watcher.calls, i);
+        WatchEntry *entry = find_entry(call.id);
+        if (!entry) continue;
+        char path[1024];
+        snprintf(path, sizeof(path), "%s", entry->path);
+        call.callback(path, call.data);
+        called++;
+    }
+    mtx_unlock(&watcher.lock);
+    return called;
+}
@@ -0,0 +1,62 @@
+//
+// watcher.h - Слежение за изменением файлов для горячей перезагрузки ресурсов (inotify в Linux, иначе опрос).
+//
+// События объединяются: файл считается изменённым, когда после последнего события прошло WATCHER_SETTLE_TIME
+// (редакторы пишут файл в несколько приёмов). Функции изменения вызываются только из Watcher_poll, поэтому
+// ресурсы перезагружаются в том потоке и в тот момент, где его вызывают (окно - поток GL на границе кадра).
+// Watcher_init, Watcher_destroy и Watcher_poll вызываются из одного потока, добавлять и удалять подписки можно из
+// любого (например, при уничтожении ресурса в потоке задач): состояние защищено рекурсивной блокировкой, и функции
+// изменения вызываются под ней, поэтому удаление подписки в другом потоке ждёт конца перезагрузки её ресурса.
+//
+
+#pragma once
+
+
+// Подключаем:
+#include "std.h"
+
+
+// Определения:
+#define WATCHER_SETTLE_TIME   0.1  // Сколько секунд файл должен не меняться, прежде чем сообщить об изменении.
+#define WATCHER_POLL_INTERVAL 0.5  // Период опроса файлов (сек), если inotify недоступен.
+
+
+// Механизм слежения:
+typedef enum Watcher_Backend {
+    WATCHER_BACKEND_NONE,     // Не инициализировано (изменения не отслеживаются).
+    WATCHER_BACKEND_INOTIFY,  // Linux inotify (следим за каталогами файлов).
+    WATCHER_BACKEND_POLLING,  // Периодическая проверка времени изменения и размера файлов.
+} Watcher_Backend;
+
+
+// Функция изменения файла (вызывается в Watcher_poll):
+typedef void (*Watcher_Callback)(const char *path, void *data);
+
+
+// Инициализация слежения за файлами:
+bool Watcher_init();
+
+// Завершение слежения (удаляет все подписки):
+void Watcher_destroy();
+
+// Инициализировано ли слежение:
+bool Watcher_is_initialized();
+
+// Получить механизм слежения:
+Watcher_Backend Watcher_get_backend();
+
+// Получить название механизма слежения:
+const char* Watcher_get_backend_name();
+
+// Следить за файлом на диске. Возвращает идентификатор подписки (0 - файла нет или слежение не инициализировано):
+uint32_t Watcher_add(const char *path, Watcher_Callback callback, void *data);
+
+// Удалить подписку:
+void Watcher_remove(uint32_t id);
+
+// Удалить все подписки с этими данными (вызывать при уничтожении ресурса):
+void Watcher_remove_data(void *data);
+
+// Проверить изменения и вызвать функции изменения. Одна пара (функция, данные) вызывается не чаще раза за вызов.
+// Возвращает количество вызванных функций:
+int Watcher_poll();
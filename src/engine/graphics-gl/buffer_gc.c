@@ -1,6 +1,11 @@
 //
 // buffer_gc.c - Создаёт код для отслеживания буферов OpenGL, которые должны быть уничтожены разом.
 //
+// Буферы можно отдавать на уничтожение из любого потока: BufferGC_GL_push кладёт узел в lock-free
+// стек, а BufferGC_GL_flush в потоке контекста забирает его целиком и раскладывает по кадрам.
+// Удаление происходит через BUFFER_GC_GL_DEFER_FRAMES кадров, чтобы не ждать GPU на объектах,
+// которые ещё используются в отправленных командах.
+//
 
 
 // Подключаем:
@@ -11,21 +16,25 @@
 #include "buffer_gc.h"
 
 
+// Количество кадров в кольце:
+#define FRAMES_COUNT (BUFFER_GC_GL_DEFER_FRAMES + 1)
+
+
 // Создаём единую глобальную структуру:
 BufferGC_GL buffer_gc_gl = {0};
 
 
 // Найти максимальный размер стеков:
-static inline size_t find_max_stacks_len() {
+static inline size_t find_max_stacks_len(BufferGC_GL_Frame *frame) {
     size_t max_stack_len = 0;
-    if (Array_len(buffer_gc_gl.qbo)  > max_stack_len) max_stack_len = Array_len(buffer_gc_gl.qbo);
-    if (Array_len(buffer_gc_gl.ssbo) > max_stack_len) max_stack_len = Array_len(buffer_gc_gl.ssbo);
-    if (Array_len(buffer_gc_gl.fbo)  > max_stack_len) max_stack_len = Array_len(buffer_gc_gl.fbo);
-    if (Array_len(buffer_gc_gl.rbo)  > max_stack_len) max_stack_len = Array_len(buffer_gc_gl.rbo);
-    if (Array_len(buffer_gc_gl.vbo)  > max_stack_len) max_stack_len = Array_len(buffer_gc_gl.vbo);
-    if (Array_len(buffer_gc_gl.ebo)  > max_stack_len) max_stack_len = Array_len(buffer_gc_gl.ebo);
-    if (Array_len(buffer_gc_gl.vao)  > max_stack_len) max_stack_len = Array_len(buffer_gc_gl.vao);
-    if (Array_len(buffer_gc_gl.tbo)  > max_stack_len) max_stack_len = Array_len(buffer_gc_gl.tbo);
+    if (Array_len(frame->qbo)  > max_stack_len) max_stack_len = Array_len(frame->qbo);
+    if (Array_len(frame->ssbo) > max_stack_len) max_stack_len = Array_len(frame->ssbo);
+    if (Array_len(frame->fbo)  > max_stack_len) max_stack_len = Array_len(frame->fbo);
+    if (Array_len(frame->rbo)  > max_stack_len) max_stack_len = Array_len(frame->rbo);
+    if (Array_len(frame->vbo)  > max_stack_len) max_stack_len = Array_len(frame->vbo);
+    if (Array_len(frame->ebo)  > max_stack_len) max_stack_len = Array_len(frame->ebo);
+    if (Array_len(frame->vao)  > max_stack_len) max_stack_len = Array_len(frame->vao);
+    if (Array_len(frame->tbo)  > max_stack_len) max_stack_len = Array_len(frame->tbo);
     // ...
     return max_stack_len;
 }
@@ -38,98 +47,151 @@ static inline void stack_flush(Array *stack) {
 }
 
 
-// Инициализация стеков буферов:
-void BufferGC_GL_init() {
-    buffer_gc_gl.qbo  = Array_create(sizeof(uint32_t), BUFFER_GC_GL_START_CAPACITY);
-    buffer_gc_gl.ssbo = Array_create(sizeof(uint32_t), BUFFER_GC_GL_START_CAPACITY);
-    buffer_gc_gl.fbo  = Array_create(sizeof(uint32_t), BUFFER_GC_GL_START_CAPACITY);
-    buffer_gc_gl.rbo  = Array_create(sizeof(uint32_t), BUFFER_GC_GL_START_CAPACITY);
-    buffer_gc_gl.vbo  = Array_create(sizeof(uint32_t), BUFFER_GC_GL_START_CAPACITY);
-    buffer_gc_gl.ebo  = Array_create(sizeof(uint32_t), BUFFER_GC_GL_START_CAPACITY);
-    buffer_gc_gl.vao  = Array_create(sizeof(uint32_t), BUFFER_GC_GL_START_CAPACITY);
-    buffer_gc_gl.tbo  = Array_create(sizeof(uint32_t), BUFFER_GC_GL_START_CAPACITY);
-    // ...
-}
-
-
-// Уничтожение стеков буферов:
-void BufferGC_GL_destroy() {
-    Array_destroy(&buffer_gc_gl.qbo);
-    Array_destroy(&buffer_gc_gl.ssbo);
-    Array_destroy(&buffer_gc_gl.fbo);
-    Array_destroy(&buffer_gc_gl.rbo);
-    Array_destroy(&buffer_gc_gl.vbo);
-    Array_destroy(&buffer_gc_gl.ebo);
-    Array_destroy(&buffer_gc_gl.vao);
-    Array_destroy(&buffer_gc_gl.tbo);
-    // ...
-}
-
-
-// Добавить буфер на уничтожение:
-void BufferGC_GL_push(BufferGC_GL_Type type, unsigned int id) {
-    switch (type) {
-        case BGC_GL_QBO:  Array_push(buffer_gc_gl.qbo,  &id); break;
-        case BGC_GL_SSBO: Array_push(buffer_gc_gl.ssbo, &id); break;
-        case BGC_GL_FBO:  Array_push(buffer_gc_gl.fbo,  &id); break;
-        case BGC_GL_RBO:  Array_push(buffer_gc_gl.rbo,  &id); break;
-        case BGC_GL_VBO:  Array_push(buffer_gc_gl.vbo,  &id); break;
-        case BGC_GL_EBO:  Array_push(buffer_gc_gl.ebo,  &id); break;
-        case BGC_GL_VAO:  Array_push(buffer_gc_gl.vao,  &id); break;
-        case BGC_GL_TBO:  Array_push(buffer_gc_gl.tbo,  &id); break;
-        // ...
+// Перенести буферы из очереди в кадр:
+static void queue_drain(BufferGC_GL_Frame *frame) {
+    // Забираем весь стек разом (единственный потребитель, поэтому ABA невозможна):
+    BufferGC_GL_Node *node = atomic_exchange_explicit(&buffer_gc_gl.queue, NULL, memory_order_acquire);
+    while (node) {
+        BufferGC_GL_Node *next = node->next;
+        switch (node->type) {
+            case BGC_GL_QBO:  Array_push(frame->qbo,  &node->id); break;
+            case BGC_GL_SSBO: Array_push(frame->ssbo, &node->id); break;
+            case BGC_GL_FBO:  Array_push(frame->fbo,  &node->id); break;
+            case BGC_GL_RBO:  Array_push(frame->rbo,  &node->id); break;
+            case BGC_GL_VBO:  Array_push(frame->vbo,  &node->id); break;
+            case BGC_GL_EBO:  Array_push(frame->ebo,  &node->id); break;
+            case BGC_GL_VAO:  Array_push(frame->vao,  &node->id); break;
+            case BGC_GL_TBO:  Array_push(frame->tbo,  &node->id); break;
+            // ...
+        }
+        mm_free(node);
+        node = next;
     }
 }
 
 
-// Очистка всех буферов:
-void BufferGC_GL_flush() {
-    // Находим максимальный размер стека буферов:
-    size_t max_stack_len = find_max_stacks_len();
-
+// Удалить все буферы кадра:
+static void frame_flush(BufferGC_GL_Frame *frame) {
     // Если нет буферов -> выходим:
-    if (max_stack_len == 0) return;
+    if (find_max_stacks_len(frame) == 0) return;
 
     // Очищаем стек буферов QBO:
-    if (Array_len(buffer_gc_gl.qbo) > 0) {
-        glDeleteQueries(Array_len(buffer_gc_gl.qbo), (uint32_t*)buffer_gc_gl.qbo->data);
-        stack_flush(buffer_gc_gl.qbo);
+    if (Array_len(frame->qbo) > 0) {
+        glDeleteQueries(Array_len(frame->qbo), (uint32_t*)frame->qbo->data);
+        stack_flush(frame->qbo);
     }
     // Очищаем стек буферов SSBO:
-    if (Array_len(buffer_gc_gl.ssbo) > 0) {
-        glDeleteBuffers(Array_len(buffer_gc_gl.ssbo), (uint32_t*)buffer_gc_gl.ssbo->data);
-        stack_flush(buffer_gc_gl.ssbo);
+    if (Array_len(frame->ssbo) > 0) {
+        glDeleteBuffers(Array_len(frame->ssbo), (uint32_t*)frame->ssbo->data);
+        stack_flush(frame->ssbo);
     }
     // Очищаем стек буферов FBO:
-    if (Array_len(buffer_gc_gl.fbo) > 0) {
-        glDeleteFramebuffers(Array_len(buffer_gc_gl.fbo), (uint32_t*)buffer_gc_gl.fbo->data);
-        stack_flush(buffer_gc_gl.fbo);
+    if (Array_len(frame->fbo) > 0) {
+        glDeleteFramebuffers(Array_len(frame->fbo), (uint32_t*)frame->fbo->data);
+        stack_flush(frame->fbo);
     }
     // Очищаем стек буферов RBO:
-    if (Array_len(buffer_gc_gl.rbo) > 0) {
-        glDeleteRenderbuffers(Array_len(buffer_gc_gl.rbo), (uint32_t*)buffer_gc_gl.rbo->data);
-        stack_flush(buffer_gc_gl.rbo);
+    if (Array_len(frame->rbo) > 0) {
+        glDeleteRenderbuffers(Array_len(frame->rbo), (uint32_t*)frame->rbo->data);
+        stack_flush(frame->rbo);
     }
     // Очищаем стек буферов VBO:
-    if (Array_len(buffer_gc_gl.vbo) > 0) {
-        glDeleteBuffers(Array_len(buffer_gc_gl.vbo), (uint32_t*)buffer_gc_gl.vbo->data);
-        stack_flush(buffer_gc_gl.vbo);
+    if (Array_len(frame->vbo) > 0) {
+        glDeleteBuffers(Array_len(frame->vbo), (uint32_t*)frame->vbo->data);
+        stack_flush(frame->vbo);
     }
     // Очищаем стек буферов EBO:
-    if (Array_len(buffer_gc_gl.ebo) > 0) {
-        glDeleteBuffers(Array_len(buffer_gc_gl.ebo), (uint32_t*)buffer_gc_gl.ebo->data);
-        stack_flush(buffer_gc_gl.ebo);
+    if (Array_len(frame->ebo) > 0) {
+        glDeleteBuffers(Array_len(frame->ebo), (uint32_t*)frame->ebo->data);
+        stack_flush(frame->ebo);
     }
     // Очищаем стек буферов VAO:
-    if (Array_len(buffer_gc_gl.vao) > 0) {
-        glDeleteVertexArrays(Array_len(buffer_gc_gl.vao), (uint32_t*)buffer_gc_gl.vao->data);
-        stack_flush(buffer_gc_gl.vao);
+    if (Array_len(frame->vao) > 0) {
+        glDeleteVertexArrays(Array_len(frame->vao), (uint32_t*)frame->vao->data);
+        stack_flush(frame->vao);
     }
     // Очищаем стек буферов TBO:
-    if (Array_len(buffer_gc_gl.tbo) > 0) {
-        glDeleteTextures(Array_len(buffer_gc_gl.tbo), (uint32_t*)buffer_gc_gl.tbo->data);
-        stack_flush(buffer_gc_gl.tbo);
+    if (Array_len(frame->tbo) > 0) {
+        glDeleteTextures(Array_len(frame->tbo), (uint32_t*)frame->tbo->data);
+        stack_flush(frame->tbo);
     }
 
     // ...
 }
+
+
+// Инициализация стеков буферов:
+void BufferGC_GL_init() {
+    for (int i = 0; i < FRAMES_COUNT; i++) {
+        BufferGC_GL_Frame *frame = &buffer_gc_gl.frames[i];
+        frame->qbo  = Array_create(sizeof(uint32_t), BUFFER_GC_GL_START_CAPACITY);
+        frame->ssbo = Array_create(sizeof(uint32_t), BUFFER_GC_GL_START_CAPACITY);
+        frame->fbo  = Array_create(sizeof(uint32_t), BUFFER_GC_GL_START_CAPACITY);
+        frame->rbo  = Array_create(sizeof(uint32_t), BUFFER_GC_GL_START_CAPACITY);
+        frame->vbo  = Array_create(sizeof(uint32_t), BUFFER_GC_GL_START_CAPACITY);
+        frame->ebo  = Array_create(sizeof(uint32_t), BUFFER_GC_GL_START_CAPACITY);
+        frame->vao  = Array_create(sizeof(uint32_t), BUFFER_GC_GL_START_CAPACITY);
+        frame->tbo  = Array_create(sizeof(uint32_t), BUFFER_GC_GL_START_CAPACITY);
+        // ...
+    }
+    buffer_gc_gl.frame = 0;
+}
+
+
+// Уничтожение стеков буферов:
+void BufferGC_GL_destroy() {
+    // Освобождаем узлы, которые так и не попали в кадр:
+    BufferGC_GL_Node *node = atomic_exchange(&buffer_gc_gl.queue, NULL);
+    while (node) {
+        BufferGC_GL_Node *next = node->next;
+        mm_free(node);
+        node = next;
+    }
+
+    for (int i = 0; i < FRAMES_COUNT; i++) {
+        BufferGC_GL_Frame *frame = &buffer_gc_gl.frames[i];
+        Array_destroy(&frame->qbo);
+        Array_destroy(&frame->ssbo);
+        Array_destroy(&frame->fbo);
+        Array_destroy(&frame->rbo);
+        Array_destroy(&frame->vbo);
+        Array_destroy(&frame->ebo);
+        Array_destroy(&frame->vao);
+        Array_destroy(&frame->tbo);
+        // ...
+    }
+}
+
+
+// Добавить буфер на уничтожение (можно вызывать из любого потока):
+void BufferGC_GL_push(BufferGC_GL_Type type, unsigned int id) {
+    BufferGC_GL_Node *node = (BufferGC_GL_Node*)mm_alloc(sizeof(BufferGC_GL_Node));
+    node->type = type;
+    node->id = id;
+
+    // Кладём узел на вершину стека:
+    node->next = atomic_load_explicit(&buffer_gc_gl.queue, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(
+        &buffer_gc_gl.queue, &node->next, node, memory_order_release, memory_order_relaxed
+    ));
+}
+
+
+// Очистка буферов, добавленных BUFFER_GC_GL_DEFER_FRAMES кадров назад (только в потоке контекста GL):
+void BufferGC_GL_flush() {
+    // Собираем всё из очереди в текущий кадр:
+    queue_drain(&buffer_gc_gl.frames[buffer_gc_gl.frame]);
+
+    // Переходим к следующему кадру кольца. В нём лежат самые старые буферы - удаляем их:
+    buffer_gc_gl.frame = (buffer_gc_gl.frame + 1) % FRAMES_COUNT;
+    frame_flush(&buffer_gc_gl.frames[buffer_gc_gl.frame]);
+}
+
+
+// Немедленная очистка всех буферов (только в потоке контекста GL. Например перед уничтожением контекста):
+void BufferGC_GL_flush_all() {
+    queue_drain(&buffer_gc_gl.frames[buffer_gc_gl.frame]);
+    for (int i = 0; i < FRAMES_COUNT; i++) {
+        frame_flush(&buffer_gc_gl.frames[i]);
+    }
+}
@@ -6,11 +6,13 @@
 
 
 // Подключаем:
+#include <engine/core/std.h>
 #include <engine/core/array.h>
 
 
 // Определения:
 #define BUFFER_GC_GL_START_CAPACITY 1024
+#define BUFFER_GC_GL_DEFER_FRAMES   2  // Через сколько кадров удалять буферы (пока GPU может их использовать).
 
 
 // Типы буферов на уничтожение:
@@ -28,11 +30,21 @@ typedef enum BufferGC_GL_Type {
 
 
 // Объявление структур:
+typedef struct BufferGC_GL_Node BufferGC_GL_Node;
+typedef struct BufferGC_GL_Frame BufferGC_GL_Frame;
 typedef struct BufferGC_GL BufferGC_GL;
 
 
-// Единица кэша локаций юниформов:
-struct BufferGC_GL {
+// Узел очереди на уничтожение (очередь много производителей - один потребитель):
+struct BufferGC_GL_Node {
+    BufferGC_GL_Node *next;
+    BufferGC_GL_Type type;
+    uint32_t id;
+};
+
+
+// Буферы, собранные за один кадр:
+struct BufferGC_GL_Frame {
     Array *qbo;
     Array *ssbo;
     Array *fbo;
@@ -45,6 +57,14 @@ struct BufferGC_GL {
 };
 
 
+// Сборщик буферов на уничтожение:
+struct BufferGC_GL {
+    _Atomic(BufferGC_GL_Node*) queue;  // Очередь из любых потоков (lock-free стек).
+    BufferGC_GL_Frame frames[BUFFER_GC_GL_DEFER_FRAMES + 1];  // Кольцо кадров ожидания.
+    int frame;  // Индекс кадра, в который собираются буферы из очереди.
+};
+
+
 // Создаём единую глобальную структуру:
 extern BufferGC_GL buffer_gc_gl;
 
@@ -55,8 +75,11 @@ void BufferGC_GL_init();
 // Уничтожение стеков буферов:
 void BufferGC_GL_destroy();
 
-// Добавить буфер на уничтожение:
+// Добавить буфер на уничтожение (можно вызывать из любого потока):
 void BufferGC_GL_push(BufferGC_GL_Type type, unsigned int id);
 
-// Очистка всех буферов:
+// Очистка буферов, добавленных BUFFER_GC_GL_DEFER_FRAMES кадров назад (только в потоке контекста GL):
 void BufferGC_GL_flush();
+
+// Немедленная очистка всех буферов (только в потоке контекста GL. Например перед уничтожением контекста):
+void BufferGC_GL_flush_all();
@@ -0,0 +1,226 @@
+//
+// capture.c - Реализация асинхронного захвата кадров через кольцо PBO.
+//
+
+
+// Подключаем:
+#include <engine/core/std.h>
+#include <engine/core/mm.h>
+#include <engine/core/files.h>
+#include <engine/core/jobs.h>
+#include <engine/core/pixmap.h>
+#include "gl.h"
+#include "buffer_gc.h"
+#include "capture.h"
+
+
+// Объявление структур:
+typedef struct CaptureJob CaptureJob;  // Кодирование и запись одного кадра.
+
+
+// Кодирование и запись одного кадра:
+struct CaptureJob {
+    Pixmap *pixmap;
+    char *path;
+};
+
+
+// Объявление функций:
+static void Impl_screenshot(Capture *self, uint32_t fbo_id, int width, int height, const char *filepath);
+static bool Impl_start_recording(Capture *self, const char *dir, CaptureFormat format);
+static void Impl_stop_recording(Capture *self);
+static void Impl_update(Capture *self, uint32_t fbo_id, int width, int height);
+static void Impl_flush(Capture *self);
+
+
+// Закодировать и записать кадр (в потоке системы задач):
+static void encode_job(void *data) {
+    CaptureJob *job = (CaptureJob*)data;
+    const char *ext = strrchr(job->path, '.');
+    ext = ext ? ext + 1 : "";
+    if (strcmp(ext, "rgba") == 0) {
+        if (!Files_save_bin(job->path, job->pixmap->data, Pixmap_get_size(job->pixmap), "wb")) {
+            fprintf(stderr, "Capture: Saving frame failed: \"%s\"\n", job->path);
+        }
+    } else {
+        Pixmap_save(job->pixmap, job->path, ext);
+    }
+    Pixmap_destroy(&job->pixmap);
+    mm_free(job->path);
+    mm_free(job);
+}
+
+
+// Забрать самый старый буфер кольца (wait = false - только если GPU уже закончил). false - ещё не готов:
+static bool collect(Capture *self, bool wait) {
+    if (self->pending == 0) return false;
+    CaptureSlot *slot = &self->slots[self->head];
+    GLenum status = glClientWaitSync(
+        (GLsync)slot->fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? (GLuint64)1000000000 : 0
+    );
+    if (status == GL_TIMEOUT_EXPIRED && wait) {
+        status = glClientWaitSync((GLsync)slot->fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    }
+    if (status == GL_TIMEOUT_EXPIRED) return false;
+    glDeleteSync((GLsync)slot->fence);
+    slot->fence = NULL;
+
+    // Копируем строки в обратном порядке (GL читает снизу вверх) - отражение бесплатно:
+    size_t row_size = (size_t)slot->width * PIXMAP_RGBA;
+    size_t size = row_size * slot->height;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+    const uint8_t *src = NULL;
+    if (status != GL_WAIT_FAILED) src = (const uint8_t*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+    if (src) {
+        Pixmap *pixmap = Pixmap_create(slot->width, slot->height, PIXMAP_RGBA);
+        for (int y = 0; y < slot->height; y++) {
+            memcpy(pixmap->data + (size_t)y * row_size, src + (size_t)(slot->height - 1 - y) * row_size, row_size);
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+
+        CaptureJob *job = (CaptureJob*)mm_alloc(sizeof(CaptureJob));
+        job->pixmap = pixmap;
+        job->path = slot->path;
+        slot->path = NULL;
+        Jobs_run(encode_job, job, &self->encoding);
+    } else {
+        fprintf(stderr, "Capture: Failed to read frame for \"%s\".\n", slot->path);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    mm_free(slot->path);
+    slot->path = NULL;
+
+    self->head = (self->head + 1) % CAPTURE_RING_SIZE;
+    self->pending--;
+    return true;
+}
+
+
+// Начать чтение кадра в свободный буфер кольца (path забирается):
+static void read_frame(Capture *self, uint32_t fbo_id, int width, int height, char *path) {
+    CaptureSlot *slot = &self->slots[(self->head + self->pending) % CAPTURE_RING_SIZE];
+    size_t size = (size_t)width * height * PIXMAP_RGBA;
+
+    // Сохраняем состояние, которое меняем:
+    int32_t read_fbo, read_buffer, pack_buffer, alignment;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &read_fbo);
+    glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &pack_buffer);
+    glGetIntegerv(GL_PACK_ALIGNMENT, &alignment);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo_id);
+    glGetIntegerv(GL_READ_BUFFER, &read_buffer);
+    glReadBuffer(fbo_id == 0 ? GL_BACK : GL_COLOR_ATTACHMENT0);
+
+    // Чтение в PBO только ставится в очередь GPU:
+    if (slot->pbo == 0) glGenBuffers(1, &slot->pbo);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+    if (slot->capacity < size) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)size, NULL, GL_STREAM_READ);
+        slot->capacity = size;
+    }
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot->width = width;
+    slot->height = height;
+    slot->path = path;
+    self->pending++;
+
+    glPixelStorei(GL_PACK_ALIGNMENT, alignment);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, (uint32_t)pack_buffer);
+    glReadBuffer((GLenum)read_buffer);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, (uint32_t)read_fbo);
+}
+
+
+// Создать захват кадров:
+Capture* Capture_create() {
+    Capture *capture = (Capture*)mm_alloc(sizeof(Capture));
+    memset(capture, 0, sizeof(Capture));
+    atomic_init(&capture->encoding.pending, 0);
+
+    // Регистрируем API:
+    capture->screenshot = Impl_screenshot;
+    capture->start_recording = Impl_start_recording;
+    capture->stop_recording = Impl_stop_recording;
+    capture->update = Impl_update;
+    capture->flush = Impl_flush;
+    return capture;
+}
+
+
+// Уничтожить захват кадров:
+void Capture_destroy(Capture **capture) {
+    if (!capture || !*capture) return;
+    Capture *self = *capture;
+    self->stop_recording(self);
+    self->flush(self);
+    for (int i = 0; i < CAPTURE_RING_SIZE; i++) {
+        if (self->slots[i].pbo) BufferGC_GL_push(BGC_GL_VBO, self->slots[i].pbo);  // Добавляем буфер в стек на уничтожение.
+    }
+    mm_free(self);
+    *capture = NULL;
+}
+
+
+// Реализация API:
+
+
+static void Impl_screenshot(Capture *self, uint32_t fbo_id, int width, int height, const char *filepath) {
+    if (!self || !filepath || width <= 0 || height <= 0) return;
+
+    // Снимок не пропускаем: если кольцо занято - ждём самый старый буфер:
+    if (self->pending == CAPTURE_RING_SIZE) collect(self, true);
+    read_frame(self, fbo_id, width, height, mm_strdup(filepath));
+}
+
+
+static bool Impl_start_recording(Capture *self, const char *dir, CaptureFormat format) {
+    if (!self || !dir || !*dir) return false;
+    if (!Files_make_dirs(dir)) {
+        fprintf(stderr, "Capture->start_recording: Failed to create \"%s\".\n", dir);
+        return false;
+    }
+    self->stop_recording(self);
+    self->record_dir = mm_strdup(dir);
+    self->format = format;
+    self->frame_index = 0;
+    self->frames_dropped = 0;
+    self->recording = true;
+    return true;
+}
+
+
+static void Impl_stop_recording(Capture *self) {
+    if (!self || !self->recording) return;
+    self->recording = false;
+    self->flush(self);
+    mm_free(self->record_dir);
+    self->record_dir = NULL;
+}
+
+
+static void Impl_update(Capture *self, uint32_t fbo_id, int width, int height) {
+    if (!self) return;
+
+    // Забираем все буферы, которые GPU уже заполнил:
+    while (collect(self, false)) {}
+
+    // Кадр записи (пропускаем, если кольцо или кодирование не успевают - чтобы не тормозить кадр):
+    if (!self->recording || width <= 0 || height <= 0) return;
+    if (self->pending == CAPTURE_RING_SIZE || atomic_load(&self->encoding.pending) >= CAPTURE_MAX_ENCODING) {
+        self->frames_dropped++;
+        return;
+    }
+    size_t size = strlen(self->record_dir) + 32;
+    char *path = (char*)mm_alloc(size);
+    const char *ext = self->format == CAPTURE_RAW ? "rgba" : "png";
+    snprintf(path, size, "%s/frame_%06u.%s", self->record_dir, self->frame_index++, ext);
+    read_frame(self, fbo_id, width, height, path);
+}
+
+
+static void Impl_flush(Capture *self) {
+    if (!self) return;
+    while (self->pending > 0) collect(self, true);
+    Jobs_wait(&self->encoding);
+}
@@ -0,0 +1,83 @@
+//
+// capture.h - Асинхронные снимки экрана и запись последовательности кадров.
+//
+// Кадр читается из заднего буфера окна или из FBO в один из буферов кольца PBO (glReadPixels в PBO не ждёт GPU),
+// через несколько кадров, когда забор готов, буфер отображается в память и копируется в картинку, а кодирование
+// (PNG и др.) и запись файла идут в потоках системы задач. Поток GL не ждёт ни GPU, ни кодирования, поэтому
+// можно записывать каждый кадр на полной частоте (если кодирование не успевает - лишние кадры записи пропускаются).
+//
+
+#pragma once
+
+
+// Подключаем:
+#include <engine/core/std.h>
+#include <engine/core/jobs.h>
+#include <engine/core/pixmap.h>
+
+
+// Определения:
+#define CAPTURE_RING_SIZE    4  // Буферов PBO в кольце (кадр забирается, когда GPU его прочитал, обычно через 1-2 кадра).
+#define CAPTURE_MAX_ENCODING 8  // Кадров записи в кодировании одновременно (больше - кадр записи пропускается).
+
+
+// Формат кадров записи:
+typedef enum CaptureFormat {
+    CAPTURE_PNG,  // frame_000000.png.
+    CAPTURE_RAW,  // frame_000000.rgba: строки RGBA сверху вниз без заголовка (ffmpeg -f rawvideo -pix_fmt rgba -s WxH).
+} CaptureFormat;
+
+
+// Объявление структур:
+typedef struct CaptureSlot CaptureSlot;  // Буфер кольца PBO.
+typedef struct Capture Capture;          // Захват кадров.
+
+
+// Буфер кольца PBO:
+struct CaptureSlot {
+    uint32_t pbo;
+    size_t capacity;  // Размер памяти PBO в байтах.
+    int width;
+    int height;
+    void *fence;      // Забор GL после чтения (GLsync).
+    char *path;       // Куда сохранить кадр.
+};
+
+
+// Захват кадров:
+struct Capture {
+    CaptureSlot slots[CAPTURE_RING_SIZE];
+    int head;                  // Самый старый ожидающий буфер кольца.
+    int pending;               // Сколько буферов ждут GPU.
+    JobCounter encoding;       // Кадры в кодировании.
+    bool recording;
+    CaptureFormat format;
+    char *record_dir;
+    uint32_t frame_index;      // Номер следующего кадра записи.
+    uint32_t frames_dropped;   // Пропущено кадров записи (кольцо или кодирование не успевали).
+
+    // Функции:
+
+    // Снять кадр (fbo_id = 0 - задний буфер окна) и сохранить в filepath (формат по расширению: png, jpg, bmp,
+    // tga или rgba - сырые пиксели). Файл появится через несколько кадров:
+    void (*screenshot) (Capture *self, uint32_t fbo_id, int width, int height, const char *filepath);
+
+    // Начать запись кадров в каталог (кадры снимаются в update):
+    bool (*start_recording) (Capture *self, const char *dir, CaptureFormat format);
+
+    // Остановить запись (дожидается записи всех кадров). Итог записи остаётся в frame_index и frames_dropped:
+    void (*stop_recording) (Capture *self);
+
+    // Вызывать раз в кадр после отрисовки, до display: снимает кадр записи и забирает готовые кадры:
+    void (*update) (Capture *self, uint32_t fbo_id, int width, int height);
+
+    // Дождаться всех снятых кадров и их записи:
+    void (*flush) (Capture *self);
+};
+
+
+// Создать захват кадров (нужен контекст GL):
+Capture* Capture_create();
+
+// Уничтожить захват кадров (дожидается записи снятых кадров):
+void Capture_destroy(Capture **capture);
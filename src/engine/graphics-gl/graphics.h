@@ -22,6 +22,7 @@ extern "C" {
 #include "model/model.h"
 #include "model/loader/loader.h"
 #include "camera.h"
+#include "capture.h"
 #include "gl.h"
 #include "input.h"
 #include "renderer.h"
@@ -124,6 +124,30 @@ void Input_destroy(Input **input) {
 }
 
 
+// Скопировать состояние ввода от событий (кнопки, позиция, смещения), без видимости курсора:
+void Input_copy_state(Input *dst, const Input *src) {
+    if (!dst || !src || dst == src) return;
+
+    // Мышь:
+    Input_MouseState *dm = dst->mouse, *sm = src->mouse;
+    int mouse_keys = dm->max_keys < sm->max_keys ? dm->max_keys : sm->max_keys;
+    memcpy(dm->pressed, sm->pressed, mouse_keys * sizeof(bool));
+    memcpy(dm->down,    sm->down,    mouse_keys * sizeof(bool));
+    memcpy(dm->up,      sm->up,      mouse_keys * sizeof(bool));
+    dm->focused = sm->focused;
+    dm->pos = sm->pos;
+    dm->rel = sm->rel;
+    dm->wheel = sm->wheel;
+
+    // Клавиатура:
+    Input_KeyboardState *dk = dst->keyboard, *sk = src->keyboard;
+    int keys = dk->max_keys < sk->max_keys ? dk->max_keys : sk->max_keys;
+    memcpy(dk->pressed, sk->pressed, keys * sizeof(bool));
+    memcpy(dk->down,    sk->down,    keys * sizeof(bool));
+    memcpy(dk->up,      sk->up,      keys * sizeof(bool));
+}
+
+
 // Реализация API:
 
 
@@ -218,3 +218,6 @@ Input* Input_create(
 
 // Уничтожить структуру ввода:
 void Input_destroy(Input **input);
+
+// Скопировать состояние ввода от событий (кнопки, позиция, смещения), без видимости курсора:
+void Input_copy_state(Input *dst, const Input *src);
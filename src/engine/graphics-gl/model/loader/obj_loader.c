@@ -8,6 +8,11 @@
 #include <engine/core/math.h>
 #include <engine/core/mm.h>
 #include <engine/core/array.h>
+#include <engine/core/files.h>
+#include <engine/core/jobs.h>
+#include <engine/core/objfile.h>
+#include <engine/core/rawmesh.h>
+#include <engine/core/watcher.h>
 #include "../../renderer.h"
 #include "../material.h"
 #include "../mesh.h"
@@ -15,128 +20,136 @@
 #include "loader.h"
 
 
-// Индекс вершины полигона (определение параметров вершины из формата "f p/t/n p/t/n ..."):
-typedef struct {
-    int p, t, n;  // p - индекс позиции, t - индекс текстурных координат, n - индекс нормали.
-} ObjIndex;
+// Создать вершину по индексам угла треугольника:
+static inline Vertex make_vertex(ObjIndex idx, const ObjFile *obj) {
+    const float *p = (const float*)obj->positions->data + (size_t)idx.p * 3;
+    const float *n = idx.n >= 0 ? (const float*)obj->normals->data + (size_t)idx.n * 3 : (const float[3]){0.0f, 0.0f, 0.0f};
+    const float *t = idx.t >= 0 ? (const float*)obj->texcoords->data + (size_t)idx.t * 2 : (const float[2]){0.0f, 0.0f};
+    return (Vertex){p[0], p[1], p[2], n[0], n[1], n[2], 1.0f, 1.0f, 1.0f, t[0], -t[1]};  // X, Y, Z, NX, NY, NZ, R, G, B, U, -V.
+}
 
 
-// Создать вершину по индексам из полигона:
-static inline Vertex make_vertex(ObjIndex idx, Array* positions, Array* normls, Array* texcrd) {
-    Vec3d p = *(Vec3d*)Array_get(positions, idx.p);
-    Vec3d n = (idx.n >= 0 && idx.n < Array_len(normls)) ? *(Vec3d*)Array_get(normls, idx.n) : (Vec3d){0.0, 0.0, 0.0};
-    Vec2d t = (idx.t >= 0 && idx.t < Array_len(texcrd)) ? *(Vec2d*)Array_get(texcrd, idx.t) : (Vec2d){0.0, 0.0};
-    return (Vertex){p.x, p.y, p.z, n.x, n.y, n.z, 1.0f, 1.0f, 1.0f, t.x, -t.y};  // X, Y, Z, NX, NY, NZ, R, G, B, U, -V.
-}
+// Формат Vertex в кэше .rawmesh (первый атрибут - позиция):
+static const RawMeshLayout vertex_layout = {
+    .stride = sizeof(Vertex),
+    .attribs_count = 4,
+    .attribs = {
+        { 0, 3, RAWMESH_FLOAT32, offsetof(Vertex, px) },  // a_position.
+        { 1, 3, RAWMESH_FLOAT32, offsetof(Vertex, nx) },  // a_normal.
+        { 2, 3, RAWMESH_FLOAT32, offsetof(Vertex, r) },   // a_color.
+        { 3, 2, RAWMESH_FLOAT32, offsetof(Vertex, u) },   // a_texcoord.
+    },
+};
 
 
-// Загрузить модели из OBJ-файла:
-Array* ModelsLoader_OBJ(Renderer *renderer, const char *filepath) {
-    Array *models = Array_create(sizeof(void*), ARRAY_DEFAULT_CAPACITY);
+// Сборка вершин (параллельно по диапазонам уникальных углов):
+typedef struct VertexJob {
+    const ObjFile *obj;
+    const ObjIndex *unique;
+    Vertex *vertices;
+} VertexJob;
 
-    // Открываем файл:
-    FILE* f = fopen(filepath, "r");
-    if (!f) return NULL;
-    char line[1024];  // Обычно строка в OBJ-файле не превышает 1024 байт.
 
-    // Массивы данных:
-    Array *positions = Array_create(sizeof(Vec3d), 128);
-    Array *normals = Array_create(sizeof(Vec3d), 128);
-    Array *texcoords = Array_create(sizeof(Vec2d), 128);
-    Array *vertices  = Array_create(sizeof(Vertex), 256);
-    Array *indices   = Array_create(sizeof(uint32_t), 256);
+static void make_vertices(size_t start, size_t end, void *data) {
+    VertexJob *job = (VertexJob*)data;
+    for (size_t i = start; i < end; i++) job->vertices[i] = make_vertex(job->unique[i], job->obj);
+}
 
-    // Обрабатываем материалы:
-    Material *mat = Material_create(NULL, (float[]){1.0f, 1.0f, 1.0f, 1.0f}, NULL);
-    Model *model = Model_create(renderer, (Vec3d){0.0f, 0.0f, 0.0f}, (Vec3d){0.0f, 0.0f, 0.0f}, (Vec3d){1.0f, 1.0f, 1.0f});
 
-    // Проходимся по строкам файла:
-    while (fgets(line, sizeof(line), f)) {
-        // v x y z:
-        if (line[0] == 'v' && line[1] == ' ') {
-            Vec3d p;
-            sscanf(line, "v %lf %lf %lf", &p.x, &p.y, &p.z);
-            Array_push(positions, &p);
+// Файл модели изменился - заменяем сетки модели новыми (вызывается Watcher_poll на потоке GL на границе кадра).
+// Сетки обновляются на месте, поэтому указатели на них и их материалы остаются действительными:
+static void on_file_changed(const char *path, void *data) {
+    Model *model = (Model*)data;
+    Array *fresh_models = ModelsLoader_OBJ(model->renderer, path);
+    if (!fresh_models || Array_len(fresh_models) == 0) {
+        fprintf(stderr, "ModelsLoader_OBJ: Failed to reload \"%s\".\n", path);
+        if (fresh_models) Array_destroy(&fresh_models);
+        return;
+    }
+    Model *fresh = Array_get_ptr(fresh_models, 0);
+    Material *fresh_mat = Array_len(fresh->meshes) > 0 ? ((Mesh*)Array_get_ptr(fresh->meshes, 0))->material : NULL;
+    Material *mat = Array_len(model->meshes) > 0 ? ((Mesh*)Array_get_ptr(model->meshes, 0))->material : fresh_mat;
+
+    // Меняем буферы местами: старые уйдут вместе со свежей моделью (удаление буферов отложено на несколько кадров):
+    size_t count = Array_len(fresh->meshes);
+    for (size_t i = 0; i < count; i++) {
+        Mesh *src = Array_get_ptr(fresh->meshes, i);
+        if (i < Array_len(model->meshes)) {
+            Mesh *dst = Array_get_ptr(model->meshes, i);
+            Mesh tmp = *dst;
+            *dst = *src;
+            dst->material = tmp.material;
+            *src = tmp;
+        } else {
+            src->material = mat;
+            model->add_mesh(model, src);
+            Array_set(fresh->meshes, i, &(Mesh*){NULL});
         }
+    }
 
-        // vn x y z:
-        else if (line[0] == 'v' && line[1] == 'n') {
-            Vec3d n;
-            sscanf(line, "vn %lf %lf %lf", &n.x, &n.y, &n.z);
-            Array_push(normals, &n);
-        }
+    // Лишние старые сетки удаляем:
+    while (Array_len(model->meshes) > count) {
+        Mesh *mesh = NULL;
+        Array_pop(model->meshes, &mesh);
+        Mesh_destroy(&mesh);
+    }
 
-        // vt u v:
-        else if (line[0] == 'v' && line[1] == 't') {
-            Vec2d t;
-            sscanf(line, "vt %lf %lf", &t.x, &t.y);
-            Array_push(texcoords, &t);
-        }
+    // Освобождаем свежую модель (её материал не используется, если у модели были свои сетки):
+    for (size_t i = 0; i < Array_len(fresh_models); i++) {
+        Model *item = Array_get_ptr(fresh_models, i);
+        Model_destroy(&item);
+    }
+    Array_destroy(&fresh_models);
+    if (fresh_mat && fresh_mat != mat) Material_destroy(&fresh_mat);
+}
+
+
+// Загрузить модели из OBJ-файла:
+Array* ModelsLoader_OBJ(Renderer *renderer, const char *filepath) {
+    // Сначала кэш .rawmesh, иначе разбираем файл (отображение в память, файл может лежать в архиве):
+    RawMeshHeader key;
+    RawMesh *cache = RawMesh_open(filepath, &vertex_layout, &key);
+    ObjFile *obj = cache ? NULL : ObjFile_load(filepath);
+    if (!cache && !obj) return NULL;
+    Array *models = Array_create(sizeof(void*), ARRAY_DEFAULT_CAPACITY);
 
-        // f a b c:
-        else if (line[0] == 'f' && line[1] == ' ') {
-            ObjIndex face[64];   // Максимум 64 вершины в полигоне.
-            int face_count = 0;  // Количество вершин в полигоне.
-            char* token = strtok(line, " ");  // Делим на куски по пробелу.
-
-            // Проходим все вершины полигона:
-            while ((token = strtok(NULL, " "))) {  // Получаем очередную вершину.
-                ObjIndex idx = {0, -1, -1};  // p всегда 0, t и n = -1 по умолчанию.
-                int slash_count = 0;
-                for (char* c = token; *c; c++) { if (*c == '/') slash_count++; }
-
-                // Читаем индексы:
-                if (slash_count == 0) {  // Только позиции: f 1 2 3:
-                    sscanf(token, "%d", &idx.p);
-                } else if (slash_count == 1) {  // Позиции + текстуры: f 1/1 2/2 3/3:
-                    sscanf(token, "%d/%d", &idx.p, &idx.t);
-                } else if (slash_count == 2) {
-                    if (strstr(token, "//")) {  // Позиции + нормали: f 1//1 2//2 3//3:
-                        sscanf(token, "%d//%d", &idx.p, &idx.n);
-                    } else {  // Позиции + текстуры + нормали: f 1/1/1 2/2/2 3/3/3:
-                        sscanf(token, "%d/%d/%d", &idx.p, &idx.t, &idx.n);
-                    }
-                }
-
-                // Индексы в OBJ начинаются с 1, уменьшаем:
-                idx.p--; if (idx.t >= 0) idx.t--; if (idx.n >= 0) idx.n--;
-                face[face_count++] = idx;  // Сохраняем вершину.
-            }
-
-            // Триангуляция (triangle fan) по индексам вершин полигона:
-            for (int i = 1; i < face_count - 1; i++) {
-                ObjIndex i0 = face[0];
-                ObjIndex i1 = face[i];
-                ObjIndex i2 = face[i + 1];
-                uint32_t base = vertices->len;  // Номер первой вершины треугольника.
-
-                // Создаём вершины треугольника:
-                Vertex v0 = make_vertex(i0, positions, normals, texcoords);
-                Vertex v1 = make_vertex(i1, positions, normals, texcoords);
-                Vertex v2 = make_vertex(i2, positions, normals, texcoords);
-
-                // Добавляем вершины и индексы в массивы:
-                Array_push(vertices, &v0);
-                Array_push(vertices, &v1);
-                Array_push(vertices, &v2);
-                Array_push(indices, &(uint32_t){base + 0});
-                Array_push(indices, &(uint32_t){base + 1});
-                Array_push(indices, &(uint32_t){base + 2});
-            }
+    // Добавляем одну модель (при изменении файла её сетки перезагрузятся):
+    Material *mat = Material_create(NULL, (float[]){1.0f, 1.0f, 1.0f, 1.0f}, NULL);
+    Model *model = Model_create(renderer, (Vec3d){0.0f, 0.0f, 0.0f}, (Vec3d){0.0f, 0.0f, 0.0f}, (Vec3d){1.0f, 1.0f, 1.0f});
+    if (cache) {
+        // Буферы GL заполняются прямо из отображения файла кэша:
+        const Vertex *vertices = (const Vertex*)cache->vertices;
+        for (uint32_t i = 0; i < cache->header->submeshes_count; i++) {
+            const RawMeshSubmesh *sub = &cache->submeshes[i];
+            model->add_mesh(model, Mesh_create(
+                vertices + sub->first_vertex, sub->vertex_count, cache->indices + sub->first_index, sub->index_count,
+                false, mat
+            ));
         }
+        RawMesh_close(&cache);
+    } else {
+        // Собираем вершины треугольников (общие углы соседних треугольников - одна вершина):
+        size_t count = Array_len(obj->corners);
+        uint32_t *indices = (uint32_t*)mm_alloc(sizeof(uint32_t) * (count > 0 ? count : 1));
+        ObjIndex *unique = (ObjIndex*)mm_alloc(sizeof(ObjIndex) * (count > 0 ? count : 1));
+        uint32_t vertex_count = ObjFile_weld(obj, unique, indices);
+        Vertex *vertices = (Vertex*)mm_alloc(sizeof(Vertex) * (vertex_count > 0 ? vertex_count : 1));
+        VertexJob job = { obj, unique, vertices };
+        Jobs_parallel_for(vertex_count, 0, make_vertices, &job);
+        mm_free(unique);
+        ObjFile_destroy(&obj);
+
+        // Кэш для следующих загрузок (ключ пустой, если кэш выключен или файл не на диске):
+        RawMeshSubmesh whole = { .first_vertex = 0, .vertex_count = vertex_count, .index_count = (uint32_t)count };
+        if (key.version == RAWMESH_VERSION) RawMesh_write(&key, vertices, vertex_count, indices, (uint32_t)count, &whole, 1);
+        model->add_mesh(model, Mesh_create(vertices, vertex_count, indices, (uint32_t)count, false, mat));
+
+        // Удаляем временные массивы:
+        mm_free(vertices);
+        mm_free(indices);
     }
-    fclose(f);
-
-    // Добавляем одну модель:
-    model->add_mesh(model, Mesh_create(vertices->data, Array_len(vertices), indices->data, Array_len(indices), false, mat));
     Array_push(models, &model);
-
-    // Удаляем временные массивы:
-    Array_destroy(&positions);
-    Array_destroy(&normals);
-    Array_destroy(&texcoords);
-    Array_destroy(&vertices);
-    Array_destroy(&indices);
+    Watcher_add(filepath, on_file_changed, model);
 
     // Возвращаем список моделей:
     return models;
@@ -40,7 +40,8 @@ struct Mesh {
 };
 
 
-// Создать сетку:
+// Создать сетку (данные копируются в буферы GL при создании, поэтому vertices и indices могут указывать прямо
+// в отображение файла, например кэша .rawmesh):
 Mesh* Mesh_create(
     const Vertex* vertices,
     uint32_t vertex_count,
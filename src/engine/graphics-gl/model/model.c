@@ -8,6 +8,7 @@
 #include <engine/core/math.h>
 #include <engine/core/array.h>
 #include <engine/core/mm.h>
+#include <engine/core/watcher.h>
 #include "../renderer.h"
 #include "../gl.h"
 #include "material.h"
@@ -46,6 +47,7 @@ Model* Model_create(Renderer *renderer, Vec3d position, Vec3d rotation, Vec3d si
 // Уничтожить модель:
 void Model_destroy(Model **model) {
     if (!model || !*model) return;
+    Watcher_remove_data(*model);  // Модель могла отслеживать файл (ModelsLoader_OBJ).
 
     // Проходимся по сеткам и удаляем их:
     for (size_t i=0; i < Array_len((*model)->meshes); i++) {
@@ -109,7 +109,7 @@ void Renderer_destroy(Renderer **rnd) {
     if (!rnd || !*rnd) return;
 
     // Уничтожение стеков буферов:
-    BufferGC_GL_flush();
+    BufferGC_GL_flush_all();
     BufferGC_GL_destroy();
 
     // Уничтожение текстурных юнитов:
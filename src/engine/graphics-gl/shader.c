@@ -9,6 +9,8 @@
 #include <engine/core/mm.h>
 #include <engine/core/array.h>
 #include <engine/core/crash.h>
+#include <engine/core/files.h>
+#include <engine/core/watcher.h>
 #include "texture.h"
 #include "texunit.h"
 #include "gl.h"
@@ -66,11 +68,13 @@ static inline void clear_caches(ShaderProgram *shader, bool delete_arrays) {
             if (u->name) mm_free(u->name);
         }
         if (delete_arrays) { Array_destroy(&shader->uniform_locations); }
+        else { shader->uniform_locations->len = 0; }
     }
 
     // Освобождаем кэш юниформов:
     if (shader->uniform_values) {
         if (delete_arrays) { Array_destroy(&shader->uniform_values); }
+        else { shader->uniform_values->len = 0; }
     }
 
     // Освобождаем кэш юнитов:
@@ -82,10 +86,41 @@ static inline void clear_caches(ShaderProgram *shader, bool delete_arrays) {
             }
         }
         if (delete_arrays) { Array_destroy(&shader->sampler_units); }
+        else { shader->sampler_units->len = 0; }
     }
 }
 
 
+// Скомпилировать программу из файлов (false - файлы не прочитаны или ошибка, прежняя программа остаётся):
+static bool compile_files(ShaderProgram *self) {
+    char *vert = self->vertex_path ? Files_load(self->vertex_path, "r") : NULL;
+    char *frag = self->fragment_path ? Files_load(self->fragment_path, "r") : NULL;
+    char *geom = self->geometry_path ? Files_load(self->geometry_path, "r") : NULL;
+    bool ok = !(self->vertex_path && !vert) && !(self->fragment_path && !frag) && !(self->geometry_path && !geom);
+    if (ok) {
+        uint32_t old_id = self->id;
+        self->vertex = vert;
+        self->fragment = frag;
+        self->geometry = geom;
+        self->compile(self);
+        ok = self->id != old_id;
+    }
+
+    // Исходники нужны только на время компиляции:
+    self->vertex = self->fragment = self->geometry = NULL;
+    if (vert) mm_free(vert);
+    if (frag) mm_free(frag);
+    if (geom) mm_free(geom);
+    return ok;
+}
+
+
+// Файл шейдера изменился (вызывается Watcher_poll на потоке GL на границе кадра):
+static void on_file_changed(const char *path, void *data) {
+    if (!compile_files((ShaderProgram*)data)) fprintf(stderr, "ShaderProgram: Reloading \"%s\" failed, keeping previous program.\n", path);
+}
+
+
 static inline void set_sampler(ShaderProgram *self, const char* name, uint32_t tex_id, TextureType type) {
     int32_t loc = self->get_location(self, name);
     if (loc < 0) return; // Униформа не найдена.
@@ -139,10 +174,6 @@ static inline void set_sampler(ShaderProgram *self, const char* name, uint32_t t
 
 static inline uint32_t compile_shader(ShaderProgram *program, const char* source, GLenum type) {
     if (!source) return 0;
-    if (program->error) {
-        mm_free(program->error);
-        program->error = NULL;
-    }
 
     uint32_t shader = glCreateShader(type);
     glShaderSource(shader, 1, &source, NULL);
@@ -165,10 +196,13 @@ static inline uint32_t compile_shader(ShaderProgram *program, const char* source
                                (type == GL_GEOMETRY_SHADER) ? "GEOMETRY" : "UNKNOWN";
         // Сколько надо выделить памяти:
         int needed = snprintf(NULL, 0, "ShaderCompileError (%s):\n%s\n", type_str, log_msg);
-        program->error = mm_alloc(needed + 1);
+        char *error = mm_alloc(needed + 1);
         // Форматируем строку:
-        sprintf(program->error, "ShaderCompileError (%s):\n%s\n", type_str, log_msg);
-        fprintf(stderr, "%s", program->error);
+        sprintf(error, "ShaderCompileError (%s):\n%s\n", type_str, log_msg);
+        fprintf(stderr, "%s", error);
+        // Оставляем первую ошибку компиляции:
+        if (!program->error) program->error = error;
+        else mm_free(error);
         if (has_source) mm_free(log_msg);
         glDeleteShader(shader);
         return 0;
@@ -215,6 +249,9 @@ ShaderProgram* ShaderProgram_create(Renderer *renderer, const char *vert, const
     shader->vertex = vert;
     shader->fragment = frag;
     shader->geometry = geom;
+    shader->vertex_path = NULL;
+    shader->fragment_path = NULL;
+    shader->geometry_path = NULL;
     shader->error = NULL;
     shader->id = 0;
     shader->renderer = renderer;
@@ -230,9 +267,28 @@ ShaderProgram* ShaderProgram_create(Renderer *renderer, const char *vert, const
 }
 
 
+// Загрузить шейдерную программу из файлов и скомпилировать (geom может быть NULL).
+// При изменении файлов программа перекомпилируется на границе кадра, при ошибке остаётся старая:
+ShaderProgram* ShaderProgram_load(Renderer *renderer, const char *vert_path, const char *frag_path, const char *geom_path) {
+    ShaderProgram *shader = ShaderProgram_create(renderer, NULL, NULL, NULL);
+    if (!shader) return NULL;
+    shader->vertex_path = vert_path ? mm_strdup(vert_path) : NULL;
+    shader->fragment_path = frag_path ? mm_strdup(frag_path) : NULL;
+    shader->geometry_path = geom_path ? mm_strdup(geom_path) : NULL;
+    compile_files(shader);
+
+    // Следим за исходниками:
+    if (vert_path) Watcher_add(vert_path, on_file_changed, shader);
+    if (frag_path) Watcher_add(frag_path, on_file_changed, shader);
+    if (geom_path) Watcher_add(geom_path, on_file_changed, shader);
+    return shader;
+}
+
+
 // Уничтожить шейдерную программу:
 void ShaderProgram_destroy(ShaderProgram **shader) {
     if (!shader || !*shader) return;
+    Watcher_remove_data(*shader);
 
     // Освобождаем кэш:
     clear_caches(*shader, true);
@@ -245,6 +301,9 @@ void ShaderProgram_destroy(ShaderProgram **shader) {
 
     // Освобождаем структуру:
     if ((*shader)->error) mm_free((*shader)->error);
+    if ((*shader)->vertex_path) mm_free((*shader)->vertex_path);
+    if ((*shader)->fragment_path) mm_free((*shader)->fragment_path);
+    if ((*shader)->geometry_path) mm_free((*shader)->geometry_path);
     mm_free(*shader);
     *shader = NULL;
 }
@@ -255,6 +314,10 @@ void ShaderProgram_destroy(ShaderProgram **shader) {
 
 static void Impl_compile(ShaderProgram *self) {
     if (!self) return;
+    if (self->error) {
+        mm_free(self->error);
+        self->error = NULL;
+    }
 
     uint32_t program = glCreateProgram();
     uint32_t shaders[3] = {0};
@@ -274,6 +337,15 @@ static void Impl_compile(ShaderProgram *self) {
     if (self->fragment) shaders[1] = compile_shader(self, self->fragment, GL_FRAGMENT_SHADER);
     if (self->geometry) shaders[2] = compile_shader(self, self->geometry, GL_GEOMETRY_SHADER);
 
+    // Стадия не скомпилировалась - не линкуем (иначе программа без стадии заменит рабочую):
+    if ((self->vertex && !shaders[0]) || (self->fragment && !shaders[1]) || (self->geometry && !shaders[2])) {
+        for (int i = 0; i < 3; ++i) {
+            if (shaders[i]) glDeleteShader(shaders[i]);
+        }
+        glDeleteProgram(program);  // Прежняя программа (если была) остаётся рабочей.
+        return;
+    }
+
     // Линкуем программу:
     for (int i = 0; i < 3; ++i) {
         if (shaders[i]) glAttachShader(program, shaders[i]);
@@ -294,13 +366,18 @@ static void Impl_compile(ShaderProgram *self) {
         }
         // Сколько надо выделить памяти:
         int needed = snprintf(NULL, 0, "ShaderLinkingError:\n%s\n", log_msg);
-        self->error = mm_alloc(needed + 1);
+        char *error = mm_alloc(needed + 1);
         // Форматируем строку:
-        sprintf(self->error, "ShaderCompileError:\n%s\n", log_msg);
-        fprintf(stderr, "%s", self->error);
-        crash_print("%s", self->error);
+        sprintf(error, "ShaderLinkingError:\n%s\n", log_msg);
+        fprintf(stderr, "%s", error);
+        crash_print("%s", error);
+        if (!self->error) self->error = error;
+        else mm_free(error);
         if (has_source) mm_free(log_msg);
-        glDeleteProgram(program);
+        for (int i = 0; i < 3; ++i) {
+            if (shaders[i]) glDeleteShader(shaders[i]);
+        }
+        glDeleteProgram(program);  // Прежняя программа (если была) остаётся рабочей.
         return;
     }
 
@@ -311,9 +388,11 @@ static void Impl_compile(ShaderProgram *self) {
             glDeleteShader(shaders[i]);
         }
     }
+    if (self->id) glDeleteProgram(self->id);  // Перекомпиляция - заменяем прежнюю программу.
     self->id = program;
+    if (self->_is_begin_) glUseProgram(program);
 
-    // Очищаем кэш:
+    // Очищаем кэш (локации и значения юниформов относятся к прежней программе):
     clear_caches(self, false);
 }
 
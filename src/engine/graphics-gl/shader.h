@@ -64,6 +64,9 @@ struct ShaderProgram {
     const char* vertex;
     const char* fragment;
     const char* geometry;
+    char* vertex_path;    // Путь до файла вершинного шейдера (ShaderProgram_load, для горячей перезагрузки).
+    char* fragment_path;  // Путь до файла фрагментного шейдера.
+    char* geometry_path;  // Путь до файла геометрического шейдера.
     char* error;
     uint32_t id;
     Renderer *renderer;
@@ -110,5 +113,9 @@ struct ShaderProgram {
 // Создать шейдерную программу:
 ShaderProgram* ShaderProgram_create(Renderer *renderer, const char *vert, const char *frag, const char *geom);
 
+// Загрузить шейдерную программу из файлов и скомпилировать (geom может быть NULL).
+// При изменении файлов программа перекомпилируется на границе кадра, при ошибке остаётся старая:
+ShaderProgram* ShaderProgram_load(Renderer *renderer, const char *vert_path, const char *frag_path, const char *geom_path);
+
 // Уничтожить шейдерную программу:
 void ShaderProgram_destroy(ShaderProgram **shader);
@@ -6,17 +6,35 @@
 // Подключаем:
 #include <engine/core/std.h>
 #include <engine/core/mm.h>
+#include <engine/core/jobs.h>
 #include <engine/core/pixmap.h>
+#include <engine/core/rawtex.h>
+#include <engine/core/watcher.h>
 #include "buffer_gc.h"
 #include "gl.h"
 #include "renderer.h"
 #include "texture.h"
 
 
+// Форматы блочного сжатия (расширения S3TC и BPTC, в glad не объявлены):
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+    #define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+    #define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+    #define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+
+
 // Объявление функций:
 static void Impl_begin(Texture *self);
 static void Impl_end(Texture *self);
 static void Impl_load(Texture *self, Pixmap *pixmap, bool use_mipmap);
+static void Impl_load_mips(Texture *self, const PixmapMips *mips);
+static bool Impl_load_compressed(Texture *self, const TexCompress_Image *image);
+static void Impl_update_region(Texture *self, int x, int y, const Pixmap *pixmap);
 static void Impl_set_data(Texture *self, const int width, const int height, const void *data, bool use_mipmap,
                           TextureFormat tex_format, TextureFormat data_format, TextureDataType data_type);
 static Pixmap* Impl_get_pixmap(Texture *self, int channels);
@@ -31,6 +49,9 @@ static void RegisterAPI(Texture *texture) {
     texture->begin = Impl_begin;
     texture->end = Impl_end;
     texture->load = Impl_load;
+    texture->load_mips = Impl_load_mips;
+    texture->load_compressed = Impl_load_compressed;
+    texture->update_region = Impl_update_region;
     texture->set_data = Impl_set_data;
     texture->get_pixmap = Impl_get_pixmap;
     texture->set_filter = Impl_set_filter;
@@ -40,6 +61,34 @@ static void RegisterAPI(Texture *texture) {
 }
 
 
+// Файл текстуры изменился - загружаем в ту же текстуру (вызывается Watcher_poll на потоке GL на границе кадра):
+static void on_file_changed(const char *path, void *data) {
+    Texture *self = (Texture*)data;
+    Pixmap *img = Pixmap_load(path, PIXMAP_RGBA);
+    if (!img) {
+        fprintf(stderr, "Texture: Failed to reload \"%s\".\n", path);
+        return;
+    }
+
+    // set_data сбрасывает фильтрацию на линейную, поэтому сохраняем параметры выборки:
+    int32_t min_filter = GL_LINEAR, mag_filter = GL_LINEAR, wrap_s = GL_REPEAT, wrap_t = GL_REPEAT;
+    self->begin(self);
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, &min_filter);
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, &mag_filter);
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, &wrap_s);
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, &wrap_t);
+    self->end(self);
+
+    self->set_data(self, img->width, img->height, img->data, self->has_mipmap, TEX_RGBA, TEX_RGBA, TEX_DATA_UBYTE);
+    Pixmap_destroy(&img);
+
+    self->set_filter(self, GL_TEXTURE_MIN_FILTER, min_filter);
+    self->set_filter(self, GL_TEXTURE_MAG_FILTER, mag_filter);
+    self->set_wrap(self, GL_TEXTURE_WRAP_S, wrap_s);
+    self->set_wrap(self, GL_TEXTURE_WRAP_T, wrap_t);
+}
+
+
 // Создать текстуру:
 Texture* Texture_create(Renderer *renderer) {
     if (!renderer) return NULL;
@@ -64,9 +113,9 @@ Texture* Texture_create(Renderer *renderer) {
 // Уничтожить текстуру:
 void Texture_destroy(Texture **texture) {
     if (!texture || !*texture) return;
+    Watcher_remove_data(*texture);
 
-    // Удаляем саму текстуру:
-    glBindTexture(GL_TEXTURE_2D, 0);
+    // Удаляем саму текстуру (только в очередь сборщика - без вызовов GL, можно из любого потока):
     BufferGC_GL_push(BGC_GL_TBO, (*texture)->id);  // Добавляем буфер в стек на уничтожение.
     (*texture)->_is_begin_ = false;
     (*texture)->id = 0;
@@ -76,11 +125,212 @@ void Texture_destroy(Texture **texture) {
     *texture = NULL;
 }
 
+// Загрузить в текстуру открытый кэш .rawtex (данные уровней передаются в GL прямо из отображения файла).
+// false - драйвер не поддерживает формат сжатия:
+static bool upload_cache(Texture *texture, const RawTex *rt) {
+    const RawTexHeader *header = rt->header;
+    bool loaded = true;
+    if (header->compression != RAWTEX_RAW) {
+        TexCompress_Image image = {
+            .format = (TexCompress_Format)header->compression, .width = (int)header->width,
+            .height = (int)header->height, .levels_count = (int)header->levels_count,
+            .data = (uint8_t*)rt->map->data, .size = rt->map->size,
+        };
+        for (int i = 0; i < image.levels_count; i++) {
+            image.level_offsets[i] = (size_t)header->level_offsets[i];
+            image.level_sizes[i] = (size_t)header->level_sizes[i];
+        }
+        loaded = texture->load_compressed(texture, &image);
+    } else if (header->has_mips) {
+        // Уровни - представления над отображением (без копирования):
+        Pixmap levels[PIXMAP_MIPS_MAX];
+        PixmapMips mips = { .count = (int)header->levels_count };
+        for (int i = 0; i < mips.count; i++) {
+            levels[i].channels = (int)header->channels;
+            levels[i].type = PIXMAP_U8;
+            levels[i].stride = 0;  // Уровни в файле кэша плотно упакованы.
+            levels[i].parent = NULL;
+            levels[i].data = (unsigned char*)RawTex_get_level(rt, i, NULL, &levels[i].width, &levels[i].height);
+            mips.levels[i] = &levels[i];
+        }
+        texture->load_mips(texture, &mips);
+    } else {
+        texture->set_data(
+            texture, (int)header->width, (int)header->height, RawTex_get_level(rt, 0, NULL, NULL, NULL),
+            false, TEX_RGBA, TEX_RGBA, TEX_DATA_UBYTE
+        );
+    }
+    return loaded;
+}
+
+
+// Загрузить текстуру из кэша .rawtex:
+static bool load_from_cache(Texture *texture, const char *filepath, bool use_mipmap, bool compress) {
+    RawTex *rt = RawTex_load(filepath, PIXMAP_RGBA, use_mipmap, compress);
+    if (!rt) return false;
+    bool loaded = upload_cache(texture, rt);
+    RawTex_close(&rt);
+    return loaded;
+}
+
+
+// Открытие файлов кэша пакета в задачах:
+typedef struct CacheBatchJob {
+    const char **paths;
+    RawTex **caches;
+    bool use_mipmap;
+    bool compress;
+} CacheBatchJob;
+
+
+static void open_caches(size_t start, size_t end, void *data) {
+    CacheBatchJob *job = (CacheBatchJob*)data;
+    for (size_t i = start; i < end; i++) {
+        if (job->paths[i]) job->caches[i] = RawTex_load(job->paths[i], PIXMAP_RGBA, job->use_mipmap, job->compress);
+    }
+}
+
+
 // Загрузить текстуру:
 void Texture_load(Texture *texture, const char *filepath, bool use_mipmap) {
-    Pixmap *img = Pixmap_load(filepath, PIXMAP_RGBA);
-    texture->set_data(texture, img->width, img->height, img->data, use_mipmap, TEX_RGBA, TEX_RGBA, TEX_DATA_UBYTE);
+    // Сначала пробуем кэш (сжатый, затем несжатый, если драйвер не поддерживает формат сжатия):
+    bool cached = false;
+    if (RawTex_is_enabled()) {
+        bool compress = RawTex_get_compression() != RAWTEX_RAW;
+        cached = load_from_cache(texture, filepath, use_mipmap, compress);
+        if (!cached && compress) cached = load_from_cache(texture, filepath, use_mipmap, false);
+    }
+    if (!cached) {
+        Pixmap *img = Pixmap_load(filepath, PIXMAP_RGBA);
+        texture->set_data(texture, img->width, img->height, img->data, use_mipmap, TEX_RGBA, TEX_RGBA, TEX_DATA_UBYTE);
+        Pixmap_destroy(&img);
+    }
+
+    // Следим за файлом текстуры (прежний файл больше не отслеживаем):
+    Watcher_remove_data(texture);
+    if (filepath) Watcher_add(filepath, on_file_changed, texture);
+}
+
+
+// Загрузить HDR-текстуру:
+void Texture_load_float(Texture *texture, const char *filepath, bool use_mipmap) {
+    if (!texture) return;
+    Pixmap *img = Pixmap_load_typed(filepath, PIXMAP_RGB, PIXMAP_F16);
+    texture->load(texture, img, use_mipmap);
     Pixmap_destroy(&img);
+
+    // Перезагрузка по изменению файла идёт через 8-битный путь - такую текстуру не отслеживаем:
+    Watcher_remove_data(texture);
+}
+
+
+// Загрузить несколько текстур:
+void Texture_load_batch(Texture **textures, const char **paths, size_t count, bool use_mipmap, size_t memory_budget) {
+    if (!textures || !paths || count == 0) return;
+
+    // Сначала кэш: файлы кэша открываются (при промахе - создаются) параллельно в задачах, загрузка в GL - здесь.
+    // Что не удалось взять из кэша, декодируется пакетом ниже:
+    bool *cached = (bool*)mm_calloc(count, sizeof(bool));
+    if (RawTex_is_enabled()) {
+        CacheBatchJob job = { paths, (RawTex**)mm_calloc(count, sizeof(RawTex*)), use_mipmap, false };
+        job.compress = RawTex_get_compression() != RAWTEX_RAW;
+        Jobs_parallel_for(count, 1, open_caches, &job);
+        for (size_t i = 0; i < count; i++) {
+            Texture *texture = textures[i];
+            bool loaded = job.caches[i] && (!texture || upload_cache(texture, job.caches[i]));
+            if (!loaded && texture && job.compress) loaded = load_from_cache(texture, paths[i], use_mipmap, false);
+            RawTex_close(&job.caches[i]);
+            if (!loaded) continue;
+            if (texture) {
+                Watcher_remove_data(texture);
+                Watcher_add(paths[i], on_file_changed, texture);
+            }
+            cached[i] = true;
+        }
+        mm_free(job.caches);
+    }
+
+    // Остальные - пакетное декодирование (пути, взятые из кэша, пропускаются):
+    const char **rest = (const char**)mm_alloc(sizeof(char*) * count);
+    size_t *rest_index = (size_t*)mm_alloc(sizeof(size_t) * count);
+    size_t rest_count = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (cached[i]) continue;
+        rest[rest_count] = paths[i];
+        rest_index[rest_count++] = i;
+    }
+    PixmapBatch *batch = Pixmap_load_batch(rest, rest_count, PIXMAP_RGBA, memory_budget);
+    Pixmap *img;
+    size_t index;
+    while ((img = Pixmap_batch_next(batch, true, &index)) != NULL) {
+        index = rest_index[index];
+        Texture *texture = textures[index];
+        if (texture) {
+            texture->set_data(texture, img->width, img->height, img->data, use_mipmap, TEX_RGBA, TEX_RGBA, TEX_DATA_UBYTE);
+            Watcher_remove_data(texture);
+            if (paths[index]) Watcher_add(paths[index], on_file_changed, texture);
+        }
+        Pixmap_destroy(&img);
+    }
+    Pixmap_batch_destroy(&batch);
+    mm_free(rest_index);
+    mm_free(rest);
+    mm_free(cached);
+}
+
+
+// Задать раскладку строк картинки для glTexImage2D/glTexSubImage2D (шаг строк - через GL_UNPACK_ROW_LENGTH).
+// Шаг, не кратный размеру пикселя, так не описать - тогда в copy возвращается плотная копия:
+static const Pixmap* unpack_begin(const Pixmap *pixmap, Pixmap **copy, int32_t saved[2]) {
+    *copy = NULL;
+    size_t pixel_size = Pixmap_get_pixel_size(pixmap);
+    if (Pixmap_get_stride(pixmap) % pixel_size != 0) pixmap = *copy = Pixmap_copy(pixmap);
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &saved[0]);
+    glGetIntegerv(GL_UNPACK_ROW_LENGTH, &saved[1]);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, (int32_t)(Pixmap_get_stride(pixmap) / pixel_size));
+    return pixmap;
+}
+
+
+// Вернуть раскладку строк:
+static void unpack_end(Pixmap **copy, const int32_t saved[2]) {
+    glPixelStorei(GL_UNPACK_ALIGNMENT, saved[0]);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, saved[1]);
+    Pixmap_destroy(copy);
+}
+
+
+// Формат данных GL по числу каналов:
+static int gl_format_of(int channels) {
+    switch (channels) {
+        case 1:  return GL_RED;
+        case 2:  return GL_RG;
+        case 3:  return GL_RGB;
+        default: return GL_RGBA;
+    }
+}
+
+
+// Тип данных GL по типу значения канала:
+static int gl_type_of(PixmapType type) {
+    switch (type) {
+        case PIXMAP_U16: return GL_UNSIGNED_SHORT;
+        case PIXMAP_F16: return GL_HALF_FLOAT;
+        case PIXMAP_F32: return GL_FLOAT;
+        default:         return GL_UNSIGNED_BYTE;
+    }
+}
+
+
+// Внутренний формат GL для картинки (float - в текстуру с плавающей точкой той же точности):
+static int gl_internal_format_of(int channels, PixmapType type) {
+    static const int half[4] = { GL_R16F, GL_RG16F, GL_RGB16F, GL_RGBA16F };
+    static const int full[4] = { GL_R32F, GL_RG32F, GL_RGB32F, GL_RGBA32F };
+    int index = channels >= 1 && channels <= 4 ? channels - 1 : 3;
+    if (type == PIXMAP_F16) return half[index];
+    if (type == PIXMAP_F32) return full[index];
+    return gl_format_of(channels);
 }
 
 
@@ -115,11 +365,154 @@ static void Impl_load(Texture *self, Pixmap *pixmap, bool use_mipmap) {
         default: { tex_format = TEX_RGBA; break; }
     }
 
-    // Выделяем память под данные:
+    // Float загружаем в половинной точности (вдвое меньше памяти и передачи), 16-битные целые - в 8-битную текстуру:
+    Pixmap *half = NULL;
+    if (pixmap->type == PIXMAP_F32) pixmap = half = Pixmap_convert_type(pixmap, PIXMAP_F16);
+    TextureFormat data_format = tex_format;
+    TextureDataType data_type = pixmap->type == PIXMAP_U16 ? TEX_DATA_USHORT : TEX_DATA_UBYTE;
+    if (pixmap->type == PIXMAP_F16) {  // Тип данных set_data выставит сам (GL_HALF_FLOAT).
+        static const TextureFormat half_formats[4] = { TEX_R16F, TEX_RG16F, TEX_RGB16F, TEX_RGBA16F };
+        tex_format = half_formats[(pixmap->channels >= 1 && pixmap->channels <= 4 ? pixmap->channels : 4) - 1];
+    }
+
+    // 8-битный RGB загружаем как RGBA: строки по 4 байта на пиксель всегда выровнены и драйверу не нужно расширять данные:
+    Pixmap *rgba = NULL;
+    if (pixmap->channels == PIXMAP_RGB && pixmap->type == PIXMAP_U8) {
+        rgba = Pixmap_convert(pixmap, PIXMAP_RGBA);
+        pixmap = rgba;
+        tex_format = data_format = TEX_RGBA;
+    }
+
+    // Выделяем память под данные (строки представления идут с шагом родителя):
+    Pixmap *packed;
+    int32_t saved[2];
+    const Pixmap *source = unpack_begin(pixmap, &packed, saved);
     self->set_data(
-        self, pixmap->width, pixmap->height, pixmap->data, use_mipmap,
-        tex_format, tex_format, TEX_DATA_UBYTE
+        self, source->width, source->height, source->data, use_mipmap,
+        tex_format, data_format, data_type
     );
+    unpack_end(&packed, saved);
+    Pixmap_destroy(&rgba);
+    Pixmap_destroy(&half);
+}
+
+
+static void Impl_load_mips(Texture *self, const PixmapMips *mips) {
+    if (!self || !mips || mips->count <= 0) return;
+    const Pixmap *base = mips->levels[0];
+
+    // Подбираем формат данных:
+    int gl_format;
+    switch (base->channels) {
+        case 1:  { gl_format = GL_RED; break; }
+        case 2:  { gl_format = GL_RG; break; }
+        case 3:  { gl_format = GL_RGB; break; }
+        default: { gl_format = GL_RGBA; break; }
+    }
+
+    if (self->id == 0) glGenTextures(1, &self->id);
+    if (self->id == 0) {
+        fprintf(stderr, "Texture->load_mips: The texture could not be created.\n");
+        return;
+    }
+    self->width = base->width;
+    self->height = base->height;
+    self->begin(self);
+
+    // Строки малых уровней не выровнены по 4 байта, уровни-представления идут с шагом родителя:
+    for (int i = 0; i < mips->count; i++) {
+        Pixmap *packed;
+        int32_t saved[2];
+        const Pixmap *level = unpack_begin(mips->levels[i], &packed, saved);
+        glTexImage2D(
+            GL_TEXTURE_2D, i, gl_internal_format_of(base->channels, base->type), level->width, level->height, 0,
+            gl_format, gl_type_of(level->type), level->data
+        );
+        unpack_end(&packed, saved);
+    }
+
+    // Неполная цепочка (не до 1x1) тоже должна считаться полной:
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mips->count - 1);
+    self->has_mipmap = mips->count > 1;
+    self->set_linear(self);
+    self->end(self);
+}
+
+
+// Поддерживает ли драйвер формат сжатия (список форматов запрашивается один раз):
+static bool is_compressed_format_supported(int gl_format) {
+    static int32_t *formats = NULL;
+    static int32_t formats_count = -1;
+    if (formats_count < 0) {
+        glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &formats_count);
+        if (formats_count < 0) formats_count = 0;
+        formats = (int32_t*)mm_alloc(sizeof(int32_t) * (formats_count + 1));
+        if (formats_count > 0) glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, formats);
+    }
+    for (int32_t i = 0; i < formats_count; i++) if (formats[i] == gl_format) return true;
+    return false;
+}
+
+
+static bool Impl_load_compressed(Texture *self, const TexCompress_Image *image) {
+    if (!self || !image || image->levels_count <= 0) return false;
+
+    // Подбираем формат:
+    int gl_format;
+    switch (image->format) {
+        case TEXCOMPRESS_BC1: { gl_format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT; break; }
+        case TEXCOMPRESS_BC3: { gl_format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; break; }
+        case TEXCOMPRESS_BC4: { gl_format = GL_COMPRESSED_RED_RGTC1; break; }
+        case TEXCOMPRESS_BC5: { gl_format = GL_COMPRESSED_RG_RGTC2; break; }
+        case TEXCOMPRESS_BC7: { gl_format = GL_COMPRESSED_RGBA_BPTC_UNORM; break; }
+        default: return false;
+    }
+    if (!is_compressed_format_supported(gl_format)) {
+        fprintf(stderr, "Texture->load_compressed: %s is not supported by the driver.\n",
+                TexCompress_get_format_name(image->format));
+        return false;
+    }
+
+    if (self->id == 0) glGenTextures(1, &self->id);
+    if (self->id == 0) {
+        fprintf(stderr, "Texture->load_compressed: The texture could not be created.\n");
+        return false;
+    }
+    self->width = image->width;
+    self->height = image->height;
+    self->begin(self);
+    for (int i = 0; i < image->levels_count; i++) {
+        int width = image->width >> i, height = image->height >> i;
+        glCompressedTexImage2D(
+            GL_TEXTURE_2D, i, gl_format, width > 0 ? width : 1, height > 0 ? height : 1, 0,
+            (int)image->level_sizes[i], image->data + image->level_offsets[i]
+        );
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image->levels_count - 1);
+    self->has_mipmap = image->levels_count > 1;
+    self->set_linear(self);
+    self->end(self);
+    return true;
+}
+
+
+static void Impl_update_region(Texture *self, int x, int y, const Pixmap *pixmap) {
+    if (!self || !pixmap || !pixmap->data || self->id == 0) return;
+    if (x < 0 || y < 0 || x + pixmap->width > self->width || y + pixmap->height > self->height) {
+        fprintf(stderr, "Texture->update_region: Region is out of the texture.\n");
+        return;
+    }
+    int gl_format = gl_format_of(pixmap->channels);
+    Pixmap *packed;
+    int32_t saved[2];
+    self->begin(self);
+    const Pixmap *source = unpack_begin(pixmap, &packed, saved);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, source->width, source->height, gl_format, gl_type_of(source->type), source->data);
+    unpack_end(&packed, saved);
+    if (self->has_mipmap) glGenerateMipmap(GL_TEXTURE_2D);
+    self->end(self);
 }
 
 
@@ -152,6 +545,7 @@ static void Impl_set_data(
         case TEX_RGB32F:   { gl_tex_format = GL_RGB32F; break; }
         case TEX_RGBA32F:  { gl_tex_format = GL_RGBA32F; break; }
         case TEX_R16F:     { gl_tex_format = GL_R16F; break; }
+        case TEX_RG16F:    { gl_tex_format = GL_RG16F; break; }
         case TEX_SRGB:     { gl_tex_format = GL_SRGB8; break; }
         case TEX_SRGBA:    { gl_tex_format = GL_SRGB8_ALPHA8; break; }
         case TEX_BGR:      { gl_tex_format = GL_BGR; break; }
@@ -177,6 +571,7 @@ static void Impl_set_data(
         case TEX_RGB32F:   { gl_data_format = GL_RGB32F; break; }
         case TEX_RGBA32F:  { gl_data_format = GL_RGBA32F; break; }
         case TEX_R16F:     { gl_data_format = GL_R16F; break; }
+        case TEX_RG16F:    { gl_data_format = GL_RG16F; break; }
         case TEX_SRGB:     { gl_data_format = GL_SRGB8; break; }
         case TEX_SRGBA:    { gl_data_format = GL_SRGB8_ALPHA8; break; }
         case TEX_BGR:      { gl_data_format = GL_BGR; break; }
@@ -204,13 +599,15 @@ static void Impl_set_data(
     }
 
     // Перепроверка:
-    if (gl_tex_format == GL_RGB16F || gl_tex_format == GL_RGBA16F) gl_data_type = GL_HALF_FLOAT;
-    else if (gl_tex_format == GL_RGB32F || gl_tex_format == GL_RGBA32F) gl_data_type = GL_FLOAT;
+    if (gl_tex_format == GL_R16F || gl_tex_format == GL_RG16F || gl_tex_format == GL_RGB16F || gl_tex_format == GL_RGBA16F) {
+        gl_data_type = GL_HALF_FLOAT;
+    } else if (gl_tex_format == GL_RGB32F || gl_tex_format == GL_RGBA32F) gl_data_type = GL_FLOAT;
 
     // Загрузка данных текстуры:
     glTexImage2D(GL_TEXTURE_2D, 0, gl_tex_format, self->width, self->height, 0, gl_data_format, gl_data_type, data);
 
-    // Если надо использовать мипмапы, создаём их:
+    // Если надо использовать мипмапы, создаём их (снимаем ограничение уровней от load_mips):
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000);
     self->has_mipmap = use_mipmap;
     if (use_mipmap) glGenerateMipmap(GL_TEXTURE_2D);
 
@@ -223,8 +620,8 @@ static void Impl_set_data(
 static Pixmap* Impl_get_pixmap(Texture *self, int channels) {
     if (!self) return NULL;
 
-    // Выделяем память под данные (указатель на блок сохраняется в img ниже):
-    unsigned char* data = mm_alloc(self->width * self->height * channels);
+    // Создаём изображение:
+    Pixmap *pixmap = Pixmap_create(self->width, self->height, channels);
 
     // Подбираем формат данных:
     int gl_data_format;
@@ -236,17 +633,12 @@ static Pixmap* Impl_get_pixmap(Texture *self, int channels) {
         default: { gl_data_format = GL_RGBA; break; }
     }
     self->begin(self);
-    glGetTexImage(GL_TEXTURE_2D, 0, gl_data_format, GL_UNSIGNED_BYTE, data);
+    int32_t alignment;
+    glGetIntegerv(GL_PACK_ALIGNMENT, &alignment);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTexImage(GL_TEXTURE_2D, 0, gl_data_format, GL_UNSIGNED_BYTE, pixmap->data);
+    glPixelStorei(GL_PACK_ALIGNMENT, alignment);
     self->end(self);
-
-    // Создаём изображение:
-    Pixmap* pixmap = mm_alloc(sizeof(Pixmap));
-
-    pixmap->width = self->width;
-    pixmap->height = self->height;
-    pixmap->channels = channels;
-    pixmap->from_stbi = false;
-    pixmap->data = data;
     return pixmap;  // Не забудьте уничтожить Pixmap!
 }
 
@@ -8,6 +8,7 @@
 // Подключаем:
 #include <engine/core/std.h>
 #include <engine/core/pixmap.h>
+#include <engine/core/texcompress.h>
 #include "renderer.h"
 
 
@@ -23,6 +24,7 @@ typedef enum TextureFormat {
     TEX_DEPTH16, TEX_DEPTH24,
     TEX_DEPTH32, TEX_DEPTH32F,
     TEX_DEPTH_COMPONENT, TEX_DEPTH_STENCIL,
+    TEX_RG16F,
 } TextureFormat;
 
 
@@ -61,7 +63,10 @@ struct Texture {
 
     void (*begin) (Texture *self);  // Активация текстуры.
     void (*end)   (Texture *self);  // Деактивация текстуры.
-    void (*load)  (Texture *self, Pixmap *pixmap, bool use_mipmap);  // Загрузить текстуру из картинки.
+    void (*load)  (Texture *self, Pixmap *pixmap, bool use_mipmap);  // Загрузить текстуру из картинки (float - как half).
+    void (*load_mips) (Texture *self, const PixmapMips *mips);  // Загрузить готовую цепочку мипмапов (Pixmap_build_mips).
+    bool (*load_compressed) (Texture *self, const TexCompress_Image *image);  // Загрузить сжатую текстуру (false - формат не поддерживается).
+    void (*update_region) (Texture *self, int x, int y, const Pixmap *pixmap);  // Обновить область картинкой (можно представлением).
 
     // Установить данные текстуры:
     void (*set_data) (Texture *self, const int width, const int height, const void *data, bool use_mipmap,
@@ -78,8 +83,17 @@ struct Texture {
 // Создать текстуру:
 Texture* Texture_create(Renderer *renderer);
 
-// Уничтожить текстуру:
+// Уничтожить текстуру (можно из любого потока - сама текстура GL удаляется сборщиком буферов в потоке GL):
 void Texture_destroy(Texture **texture);
 
-// Загрузить текстуру:
+// Загрузить текстуру (файл отслеживается, при изменении текстура перезагружается на границе кадра):
 void Texture_load(Texture *texture, const char *filepath, bool use_mipmap);
+
+// Загрузить HDR-текстуру (RGB16F): картинка декодируется во float и загружается в половинной точности.
+// Файл не отслеживается:
+void Texture_load_float(Texture *texture, const char *filepath, bool use_mipmap);
+
+// Загрузить несколько текстур: если включён кэш .rawtex - файлы кэша открываются (и при промахе создаются)
+// параллельно в задачах, остальные картинки декодируются в потоках системы задач (в пределах memory_budget байт,
+// 0 - без ограничения). Каждая готовая сразу загружается в свою текстуру на этом потоке:
+void Texture_load_batch(Texture **textures, const char **paths, size_t count, bool use_mipmap, size_t memory_budget);
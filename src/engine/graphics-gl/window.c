@@ -9,6 +9,9 @@
 #include <engine/core/mm.h>
 #include <engine/core/pixmap.h>
 #include <engine/core/crash.h>
+#include <engine/core/asyncio.h>
+#include <engine/core/watcher.h>
+#include <engine/core/libs/tinycthread.h>
 #include "input.h"
 #include "renderer.h"
 #include "gl.h"
@@ -29,13 +32,30 @@ struct WinVars {
     bool focused;
     bool defocused;
     bool closing;
+
+    // Конвейерный режим (WinConfig.pipelined):
+    thrd_t sim_thread;   // Поток симуляции (выполняет update).
+    mtx_t  sim_lock;     // Блокировка синхронизации потоков.
+    cnd_t  sim_cond;     // Условие синхронизации потоков.
+    Input *poll_input;   // Ввод, в который пишутся события, пока update читает основной ввод.
+    float  sim_dtime;    // Дельта времени для следующего update.
+    bool   sim_go;       // Поток симуляции должен начать update.
+    bool   sim_done;     // Поток симуляции закончил update.
+    bool   sim_quit;     // Поток симуляции должен завершиться.
 };
 
 
 // Объявление функций:
 // Вспомогательные функции:
 static void RegisterAPI(Window *window);
+static void Process_events(Window *self, WinConfig *cfg, Input *input);
+static void Frame_delay(Window *self, WinConfig *cfg, double frame_start);
+static void Frame_begin(Window *self);
 static void MainLoop(Window *self, WinConfig *cfg);
+static int Sim_thread(void *arg);
+static bool Sim_start(Window *self);
+static void Sim_stop(Window *self);
+static void MainLoop_pipelined(Window *self, WinConfig *cfg);
 static void Closing_stage(Window *self);
 static Input_Scancode Convert_scancode(SDL_Scancode scancode);
 static void Impl_set_mouse_pos(Window *self, int x, int y);
@@ -168,6 +188,9 @@ WinConfig* Window_create_config(
     config->resizable = true;
     config->fullscreen = false;
     config->always_top = false;
+    config->graph = NULL;
+    config->pipelined = false;
+    config->snapshot = NULL;
     config->min_width = 0;
     config->min_height = 0;
     config->max_width = 0;
@@ -249,6 +272,152 @@ void Window_destroy(Window **window) {
 }
 
 
+// Обработать события окна и заполнить состояние ввода:
+static void Process_events(Window *self, WinConfig *cfg, Input *input) {
+    WinVars *vars = self->vars;
+
+    // Сброс состояний клавиатуры и мыши:
+    input->mouse->rel = (Vec2i){0, 0};
+    input->mouse->wheel = (Vec2i){0, 0};
+    memset(input->mouse->down, 0, input->mouse->max_keys * sizeof(bool));
+    memset(input->mouse->up,   0, input->mouse->max_keys * sizeof(bool));
+    memset(input->keyboard->down, 0, input->keyboard->max_keys * sizeof(bool));
+    memset(input->keyboard->up,   0, input->keyboard->max_keys * sizeof(bool));
+
+    // Обрабатываем события:
+    SDL_Event event;
+    while (SDL_PollEvent(&event)) {
+        switch (event.type) {
+            // Если окно хотят закрыть:
+            case SDL_EVENT_QUIT: {
+                self->close(self);
+            } break;
+
+            // Если размер окна изменился:
+            case SDL_EVENT_WINDOW_RESIZED: {
+                if (event.window.data1 > 0 && event.window.data2 > 0 && cfg->resize && vars->context) {
+                    cfg->resize(self, event.window.data1, event.window.data2);
+                }
+            } break;
+
+            // Окно развернули:
+            case SDL_EVENT_WINDOW_RESTORED: {
+                if (cfg->show) cfg->show(self);
+            } break;
+
+            // Окно свернули:
+            case SDL_EVENT_WINDOW_MINIMIZED: {
+                if (cfg->hide) cfg->hide(self);
+            } break;
+
+            // Окно стало активным:
+            case SDL_EVENT_WINDOW_FOCUS_GAINED: {
+                vars->focused = true;
+            } break;
+
+            // Окно потеряло фокус:
+            case SDL_EVENT_WINDOW_FOCUS_LOST: {
+                vars->defocused = true;
+            } break;
+
+            // Обработка ввода:
+
+            // Если мышь зашла в окно:
+            case SDL_EVENT_WINDOW_MOUSE_ENTER: {
+                input->mouse->focused = true;
+            } break;
+
+            // Если мышь покинула окно:
+            case SDL_EVENT_WINDOW_MOUSE_LEAVE: {
+                input->mouse->focused = false;
+            } break;
+
+            // Если мышь передвинулась:
+            case SDL_EVENT_MOUSE_MOTION: {
+                input->mouse->rel.x = event.motion.xrel;
+                input->mouse->rel.y = event.motion.yrel;
+                input->mouse->pos.x = event.motion.x;
+                input->mouse->pos.y = event.motion.y;
+            } break;
+
+            // Если колёсико мыши провернулось:
+            case SDL_EVENT_MOUSE_WHEEL: {
+                input->mouse->wheel.x = event.wheel.x;
+                input->mouse->wheel.y = event.wheel.y;
+            } break;
+
+            // Если нажимают кнопку мыши:
+            case SDL_EVENT_MOUSE_BUTTON_DOWN: {
+                if (event.button.button < input->mouse->max_keys) {
+                    input->mouse->pressed[event.button.button - 1] = true;
+                    input->mouse->down[event.button.button - 1] = true;
+                }
+            } break;
+
+            // Если отпускают кнопку мыши:
+            case SDL_EVENT_MOUSE_BUTTON_UP: {
+                if (event.button.button < input->mouse->max_keys) {
+                    input->mouse->pressed[event.button.button - 1] = false;
+                    input->mouse->up[event.button.button - 1] = true;
+                }
+            } break;
+
+            // Если нажимают кнопку на клавиатуре:
+            case SDL_EVENT_KEY_DOWN: {
+                Input_Scancode scancode = Convert_scancode(event.key.scancode);
+                if (scancode < input->keyboard->max_keys) {
+                    if (!input->keyboard->pressed[scancode]) {
+                        input->keyboard->pressed[scancode] = true;
+                        input->keyboard->down[scancode] = true;
+                    }
+                }
+            } break;
+
+            // Если отпускают кнопку на клавиатуре:
+            case SDL_EVENT_KEY_UP: {
+                Input_Scancode scancode = Convert_scancode(event.key.scancode);
+                if (scancode < input->keyboard->max_keys) {
+                    input->keyboard->pressed[scancode] = false;
+                    input->keyboard->up[scancode] = true;
+                }
+            } break;
+        }
+    }
+}
+
+
+// Сделать задержку до конца кадра (ограничение фпс):
+static void Frame_delay(Window *self, WinConfig *cfg, double frame_start) {
+    // Делаем задержку между кадрами:
+    if (!self->config->vsync && cfg->fps > 0) {
+        double target = 1.0f / (float)cfg->fps;
+        double elapsed;  // Сколько прошло времени с начала кадра в секундах.
+        do {
+            elapsed = self->get_time(self) - frame_start;
+            if (target - elapsed > 0.002) {  // По 2 мс ожидание:
+                SDL_Delay(1);  // Задержка 1 мс + затраты на тайминги ос примерно >1 мс.
+            }
+        } while (elapsed < target);  // Цикл ожидания тайминга до нужного времени.
+    } else if (!self->config->vsync && cfg->fps <= 0) { /* Никакой задержки. */ }
+    else { SDL_Delay(0); }  // При vsync можно не задерживать - SDL будет синхронизировать кадры.
+}
+
+
+// Начало кадра (общая часть для обоих режимов главного цикла):
+static void Frame_begin(Window *self) {
+    WinVars *vars = self->vars;
+    vars->focused = false;
+    vars->defocused = false;
+
+    // Проверяем чтобы дельта времени не была равна нулю. Иначе используем прошлую дельту времени:
+    if (vars->dtime > 0.0) { vars->dtime_old = vars->dtime; }
+    else { vars->dtime = vars->dtime_old; }
+
+    // Вызываем функции завершения асинхронного чтения на потоке GL (можно сразу загружать данные в GPU):
+    AsyncIO_poll();
+}
+
+
 // Главный цикл окна (ядро окна. Запускается из Impl_create):
 static void MainLoop(Window *self, WinConfig *cfg) {
     // Получаем глобальные переменные окна:
@@ -258,131 +427,28 @@ static void MainLoop(Window *self, WinConfig *cfg) {
     // Вызываем старт:
     if (cfg->start) cfg->start(self);
 
+    // Конвейерный режим (update в отдельном потоке):
+    if (cfg->pipelined && Sim_start(self)) {
+        MainLoop_pipelined(self, cfg);
+        return;
+    }
+
     // Основной цикл окна:
     vars->running = true;
     while (vars->running) {
         // Настраиваем переменные:
         double frame_start = self->get_time(self);
-        vars->focused = false;
-        vars->defocused = false;
-
-        // Проверяем чтобы дельта времени не была равна нулю. Иначе используем прошлую дельту времени:
-        if (vars->dtime > 0.0) { vars->dtime_old = vars->dtime; }
-        else { vars->dtime = vars->dtime_old; }
+        Frame_begin(self);
 
-        // Получаем копию указателя на систему ввода:
-        Input *input = self->input;
-
-        // Сброс состояний клавиатуры и мыши:
-        input->mouse->rel = (Vec2i){0, 0};
-        input->mouse->wheel = (Vec2i){0, 0};
-        memset(input->mouse->down, 0, input->mouse->max_keys * sizeof(bool));
-        memset(input->mouse->up,   0, input->mouse->max_keys * sizeof(bool));
-        memset(input->keyboard->down, 0, input->keyboard->max_keys * sizeof(bool));
-        memset(input->keyboard->up,   0, input->keyboard->max_keys * sizeof(bool));
+        // Горячая перезагрузка изменённых ресурсов (между кадрами, никто их сейчас не использует):
+        Watcher_poll();
 
         // Обрабатываем события:
-        SDL_Event event;
-        while (SDL_PollEvent(&event)) {
-            switch (event.type) {
-                // Если окно хотят закрыть:
-                case SDL_EVENT_QUIT: {
-                    self->close(self);
-                } break;
-
-                // Если размер окна изменился:
-                case SDL_EVENT_WINDOW_RESIZED: {
-                    if (event.window.data1 > 0 && event.window.data2 > 0 && cfg->resize && vars->context) {
-                        cfg->resize(self, event.window.data1, event.window.data2);
-                    }
-                } break;
-
-                // Окно развернули:
-                case SDL_EVENT_WINDOW_RESTORED: {
-                    if (cfg->show) cfg->show(self);
-                } break;
-
-                // Окно свернули:
-                case SDL_EVENT_WINDOW_MINIMIZED: {
-                    if (cfg->hide) cfg->hide(self);
-                } break;
-
-                // Окно стало активным:
-                case SDL_EVENT_WINDOW_FOCUS_GAINED: {
-                    vars->focused = true;
-                } break;
-
-                // Окно потеряло фокус:
-                case SDL_EVENT_WINDOW_FOCUS_LOST: {
-                    vars->defocused = true;
-                } break;
-
-                // Обработка ввода:
-
-                // Если мышь зашла в окно:
-                case SDL_EVENT_WINDOW_MOUSE_ENTER: {
-                    input->mouse->focused = true;
-                } break;
-
-                // Если мышь покинула окно:
-                case SDL_EVENT_WINDOW_MOUSE_LEAVE: {
-                    input->mouse->focused = false;
-                } break;
-
-                // Если мышь передвинулась:
-                case SDL_EVENT_MOUSE_MOTION: {
-                    input->mouse->rel.x = event.motion.xrel;
-                    input->mouse->rel.y = event.motion.yrel;
-                    input->mouse->pos.x = event.motion.x;
-                    input->mouse->pos.y = event.motion.y;
-                } break;
-
-                // Если колёсико мыши провернулось:
-                case SDL_EVENT_MOUSE_WHEEL: {
-                    input->mouse->wheel.x = event.wheel.x;
-                    input->mouse->wheel.y = event.wheel.y;
-                } break;
-
-                // Если нажимают кнопку мыши:
-                case SDL_EVENT_MOUSE_BUTTON_DOWN: {
-                    if (event.button.button < input->mouse->max_keys) {
-                        input->mouse->pressed[event.button.button - 1] = true;
-                        input->mouse->down[event.button.button - 1] = true;
-                    }
-                } break;
-
-                // Если отпускают кнопку мыши:
-                case SDL_EVENT_MOUSE_BUTTON_UP: {
-                    if (event.button.button < input->mouse->max_keys) {
-                        input->mouse->pressed[event.button.button - 1] = false;
-                        input->mouse->up[event.button.button - 1] = true;
-                    }
-                } break;
-
-                // Если нажимают кнопку на клавиатуре:
-                case SDL_EVENT_KEY_DOWN: {
-                    Input_Scancode scancode = Convert_scancode(event.key.scancode);
-                    if (scancode < input->keyboard->max_keys) {
-                        if (!input->keyboard->pressed[scancode]) {
-                            input->keyboard->pressed[scancode] = true;
-                            input->keyboard->down[scancode] = true;
-                        }
-                    }
-                } break;
-
-                // Если отпускают кнопку на клавиатуре:
-                case SDL_EVENT_KEY_UP: {
-                    Input_Scancode scancode = Convert_scancode(event.key.scancode);
-                    if (scancode < input->keyboard->max_keys) {
-                        input->keyboard->pressed[scancode] = false;
-                        input->keyboard->up[scancode] = true;
-                    }
-                } break;
-            }
-        }
+        Process_events(self, cfg, self->input);
 
         // Обработка основных функций (обновление и отрисовка):
         if (cfg->update) cfg->update(self, self->input, self->get_dtime(self));
+        if (cfg->graph)  TaskGraph_execute(cfg->graph);  // Узлы с TASK_NODE_MAIN_THREAD выполняются здесь (GL).
         if (cfg->render) cfg->render(self, self->input, self->get_dtime(self));
 
         // Очищаем все буфера (массивное удаление всех буферов за раз):
@@ -395,17 +461,7 @@ static void MainLoop(Window *self, WinConfig *cfg) {
         }
 
         // Делаем задержку между кадрами:
-        if (!self->config->vsync && cfg->fps > 0) {
-            double target = 1.0f / (float)cfg->fps;
-            double elapsed;  // Сколько прошло времени с начала кадра в секундах.
-            do {
-                elapsed = self->get_time(self) - frame_start;
-                if (target - elapsed > 0.002) {  // По 2 мс ожидание:
-                    SDL_Delay(1);  // Задержка 1 мс + затраты на тайминги ос примерно >1 мс.
-                }
-            } while (elapsed < target);  // Цикл ожидания тайминга до нужного времени.
-        } else if (!self->config->vsync && cfg->fps <= 0) { /* Никакой задержки. */ }
-        else { SDL_Delay(0); }  // При vsync можно не задерживать - SDL будет синхронизировать кадры.
+        Frame_delay(self, cfg, frame_start);
 
         // Получаем дельту времени (время кадра или же время обработки одного цикла окна):
         vars->dtime = self->get_time(self) - frame_start;
@@ -417,6 +473,126 @@ static void MainLoop(Window *self, WinConfig *cfg) {
 }
 
 
+// Поток симуляции (конвейерный режим): выполняет update следующего кадра, пока рендерится текущий:
+static int Sim_thread(void *arg) {
+    Window *self = (Window*)arg;
+    WinVars *vars = self->vars;
+    WinConfig *cfg = self->config;
+
+    mtx_lock(&vars->sim_lock);
+    while (true) {
+        while (!vars->sim_go && !vars->sim_quit) cnd_wait(&vars->sim_cond, &vars->sim_lock);
+        if (vars->sim_quit) break;
+        vars->sim_go = false;
+        float dtime = vars->sim_dtime;
+        mtx_unlock(&vars->sim_lock);
+
+        // Обновление кадра (GL и SDL функции окна здесь вызывать нельзя):
+        if (cfg->update) cfg->update(self, self->input, dtime);
+
+        mtx_lock(&vars->sim_lock);
+        vars->sim_done = true;
+        cnd_broadcast(&vars->sim_cond);
+    }
+    mtx_unlock(&vars->sim_lock);
+    return 0;
+}
+
+
+// Запустить поток симуляции:
+static bool Sim_start(Window *self) {
+    WinVars *vars = self->vars;
+    vars->sim_go = false;
+    vars->sim_done = true;
+    vars->sim_quit = false;
+    vars->sim_dtime = (float)vars->dtime;
+    mtx_init(&vars->sim_lock, mtx_plain);
+    cnd_init(&vars->sim_cond);
+    vars->poll_input = Input_create(Impl_set_mouse_pos, Impl_set_mouse_visible);
+    if (thrd_create(&vars->sim_thread, Sim_thread, self) != thrd_success) {
+        crash_print("Window: Failed to create simulation thread. Falling back to serial loop.\n");
+        Input_destroy(&vars->poll_input);
+        mtx_destroy(&vars->sim_lock);
+        cnd_destroy(&vars->sim_cond);
+        return false;
+    }
+    return true;
+}
+
+
+// Остановить поток симуляции (дожидается текущего update):
+static void Sim_stop(Window *self) {
+    WinVars *vars = self->vars;
+    mtx_lock(&vars->sim_lock);
+    while (!vars->sim_done) cnd_wait(&vars->sim_cond, &vars->sim_lock);
+    vars->sim_quit = true;
+    cnd_broadcast(&vars->sim_cond);
+    mtx_unlock(&vars->sim_lock);
+    thrd_join(vars->sim_thread, NULL);
+    mtx_destroy(&vars->sim_lock);
+    cnd_destroy(&vars->sim_cond);
+    Input_destroy(&vars->poll_input);
+}
+
+
+// Конвейерный главный цикл: update кадра N+1 в потоке симуляции, render кадра N в потоке GL:
+static void MainLoop_pipelined(Window *self, WinConfig *cfg) {
+    WinVars *vars = self->vars;
+    bool sim_started = false;  // Был ли запущен хотя бы один update.
+
+    vars->running = true;
+    while (vars->running) {
+        double frame_start = self->get_time(self);
+        Frame_begin(self);
+
+        // События пишутся в отдельный ввод, пока update читает self->input:
+        Process_events(self, cfg, vars->poll_input);
+
+        // Точка синхронизации: ждём завершения update прошлого кадра:
+        mtx_lock(&vars->sim_lock);
+        while (!vars->sim_done) cnd_wait(&vars->sim_cond, &vars->sim_lock);
+
+        // Горячая перезагрузка изменённых ресурсов (update сейчас не выполняется):
+        Watcher_poll();
+
+        // Публикуем снимок кадра и передаём свежий ввод (никто из потоков сейчас их не трогает):
+        bool has_frame = sim_started;
+        if (has_frame && cfg->snapshot) Snapshot_swap(cfg->snapshot);
+        Input_copy_state(self->input, vars->poll_input);
+
+        // Запускаем update следующего кадра:
+        bool closing = vars->closing;
+        if (!closing) {
+            vars->sim_done = false;
+            vars->sim_go = true;
+            vars->sim_dtime = (float)self->get_dtime(self);
+            cnd_broadcast(&vars->sim_cond);
+            sim_started = true;
+        }
+        mtx_unlock(&vars->sim_lock);
+
+        // Рендерим опубликованный кадр (граф задач выполняется на потоке GL, параллельно с update):
+        if (has_frame && cfg->graph)  TaskGraph_execute(cfg->graph);
+        if (has_frame && cfg->render) cfg->render(self, self->input, self->get_dtime(self));
+
+        // Очищаем все буфера (массивное удаление всех буферов за раз):
+        self->renderer->buffers_flush(self->renderer);
+
+        // Проверяем что окно хотят закрыть:
+        if (closing) break;
+
+        // Делаем задержку между кадрами:
+        Frame_delay(self, cfg, frame_start);
+        vars->dtime = self->get_time(self) - frame_start;
+    }
+
+    // Останавливаем поток симуляции и закрываем окно:
+    Sim_stop(self);
+    self->close(self);
+    if (vars->closing) Closing_stage(self);
+}
+
+
 // Этап закрытия окна:
 static void Closing_stage(Window *self) {
     if (!self || !self->config) return;
@@ -583,7 +759,7 @@ static void Impl_set_icon(Window *self, Pixmap *icon) {
     } else {
         SDL_Surface *sdl_icon = SDL_CreateSurfaceFrom(
             icon->width, icon->height, SDL_PIXELFORMAT_RGBA32,
-            icon->data, icon->width * icon->channels);
+            icon->data, (int)Pixmap_get_stride(icon));
         if (icon) {
             SDL_SetWindowIcon(vars->window, sdl_icon);
             SDL_DestroySurface(sdl_icon);
@@ -8,6 +8,8 @@
 // Подключаем:
 #include <engine/core/std.h>
 #include <engine/core/pixmap.h>
+#include <engine/core/snapshot.h>
+#include <engine/core/taskgraph.h>
 #include "renderer.h"
 #include "input.h"
 
@@ -110,6 +112,13 @@ struct WinConfig {
     bool resizable;     // Масштабируемость окна.
     bool fullscreen;    // Полноэкранный режим.
     bool always_top;    // Всегда на переднем плане.
+    TaskGraph *graph;   // Граф задач кадра (NULL - не используется. Выполняется между update и render).
+
+    // Конвейерный режим: update кадра N+1 выполняется в потоке симуляции, пока поток GL рендерит кадр N.
+    // В этом режиме update не должен вызывать GL и SDL функции окна, а graph и render должны читать
+    // состояние только из snapshot (Snapshot_read), который update заполняет через Snapshot_write.
+    bool pipelined;      // Включить конвейерный режим.
+    Snapshot *snapshot;  // Снимок состояния кадра (transforms, матрицы камер, списки отрисовки).
 
     union {
         int size[2];  // Размер окна.
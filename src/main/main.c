@@ -13,6 +13,9 @@ void engine_init() {
     core_init();
     printf("Core initialized.\n");
 
+    // Если архив ресурсов собран (./build.sh -t=packer), файлы "data/" читаются из него:
+    if (Files_mount("data" ARCHIVE_EXTENSION, "data/", false)) printf("Mounted \"data%s\".\n", ARCHIVE_EXTENSION);
+
     printf("Engine start.\n\n");
 }
 
@@ -42,6 +45,9 @@ Mesh *mesh;
 Material *mat;
 Model *model;
 
+Capture *capture;
+uint32_t screenshot_index = 0;
+
 // Вершины треугольника (X, Y)
 static const float f = 1.0f;
 // static const Vertex triangle_vertices[] = {
@@ -71,6 +77,12 @@ void start(Window *self) {
     self->set_fps(self, 60);
     self->set_vsync(self, false);
 
+    // Кэш декодированных текстур (повторный запуск не распаковывает PNG/JPG):
+    RawTex_set_cache_dir("cache/rawtex/");
+
+    // Кэш готовых сеток (повторный запуск не разбирает OBJ):
+    RawMesh_set_cache_dir("cache/rawmesh/");
+
     Pixmap *icon = Pixmap_load("data/icons/icon.png", PIXMAP_RGBA);
     self->set_icon(self, icon);
     Pixmap_destroy(&icon);
@@ -84,14 +96,9 @@ void start(Window *self) {
     // tex2->set_pixelized(tex2);
 
     printf("loading shaders... ");
-    const char *vert1 = Files_load("data/shaders/default.vert", "r");
-    const char *frag1 = Files_load("data/shaders/default.frag", "r");
-    if (vert1 && frag1) printf("Done.\n");
+    shader = ShaderProgram_load(self->renderer, "data/shaders/default.vert", "data/shaders/default.frag", NULL);
+    if (shader && shader->id) printf("Done.\n");
     else printf("Failed.\n");
-    shader = ShaderProgram_create(self->renderer, vert1, frag1, NULL);
-    shader->compile(shader);
-    mm_free((char*)vert1);
-    mm_free((char*)frag1);
 
     camera3d = Camera3D_create(
         self, self->get_width(self), self->get_height(self),
@@ -119,6 +126,9 @@ void start(Window *self) {
         model = Array_get_ptr(arr, 0);
     }
     Array_destroy(&arr);
+
+    // Снимки экрана (F12) и запись кадров (F11) без остановки кадра:
+    capture = Capture_create();
 }
 
 
@@ -167,6 +177,25 @@ void render(Window *self, Input *input, float dtime) {
     rnd->shader->set_mat4(rnd->shader, "u_model", model->model);
     model->render(model);
 
+    // Захват кадра - после отрисовки, до display:
+    int width, height;
+    self->get_size(self, &width, &height);
+    if (input->get_key_down(self)[K_F12]) {
+        char path[64];
+        snprintf(path, sizeof(path), "cache/screenshots/screenshot_%04u.png", screenshot_index++);
+        Files_make_dirs("cache/screenshots/");
+        capture->screenshot(capture, 0, width, height, path);
+    }
+    if (input->get_key_down(self)[K_F11]) {
+        if (capture->recording) {
+            capture->stop_recording(capture);
+            printf("Recorded %u frames, dropped %u.\n", capture->frame_index, capture->frames_dropped);
+        } else {
+            capture->start_recording(capture, "cache/capture", CAPTURE_PNG);
+        }
+    }
+    capture->update(capture, 0, width, height);
+
     self->display(self);
 }
 
@@ -198,6 +227,7 @@ void destroy(Window *self) {
     // Уничтожение:
     print_before_free();
 
+    Capture_destroy(&capture);
     Model_destroy(&model);
     Material_destroy(&mat);
 
@@ -223,6 +253,7 @@ int main(int argc, char* argv[]) {
 
     Window_destroy_config(&config);
     Window_destroy(&window);
+    core_quit();
 
     print_after_free();
     printf("\nEngine stop.\n");
@@ -0,0 +1,160 @@
+//
+// objbench.c - Бенчмарк разбора OBJ-файлов (objfile.h).
+//
+// Сборка:  ./build.sh -t=objbench
+// Запуск:  build/bin-objbench/objbench [файл.obj | сторона сетки] [повторы]   (по умолчанию сетка 1500 x 1500, 5 повторов)
+//
+// Без файла генерирует в памяти сетку из четырёхугольников с позициями, текстурными координатами и нормалями
+// (сторона 1500 - около 4.5 млн треугольников). Печатает лучшее время разбора ObjFile_parse на всех потоках системы
+// задач и скорость в МБ/с, время сварки одинаковых углов ObjFile_weld, а для сравнения - время разбора тех же строк
+// через sscanf в одном потоке (как в прежнем загрузчике).
+//
+
+
+// Подключаем:
+#include <engine/core/std.h>
+#include <engine/core/mm.h>
+#include <engine/core/files.h>
+#include <engine/core/jobs.h>
+#include <engine/core/objfile.h>
+#include <engine/core/time.h>
+
+
+// Дописать строку в буфер (буфер растёт вдвое):
+static void append(char **text, size_t *size, size_t *capacity, const char *line, int len) {
+    if (*size + (size_t)len + 1 > *capacity) {
+        *capacity = (*capacity + (size_t)len + 1) * 2;
+        *text = (char*)mm_realloc(*text, *capacity);
+    }
+    memcpy(*text + *size, line, (size_t)len);
+    *size += (size_t)len;
+}
+
+
+// Сгенерировать OBJ сетки side x side вершин:
+static char* generate_grid(int side, size_t *out_size) {
+    size_t size = 0, capacity = 1 << 20;
+    char *text = (char*)mm_alloc(capacity);
+    char line[256];
+    int len;
+    for (int y = 0; y < side; y++) {
+        for (int x = 0; x < side; x++) {
+            float u = (float)x / (side - 1), v = (float)y / (side - 1);
+            float h = 0.25f * sinf(u * 12.9898f) * cosf(v * 78.233f);
+            len = snprintf(line, sizeof(line), "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn %.6f %.6f %.6f\n",
+                           u * 100.0f - 50.0f, h, v * 100.0f - 50.0f, u, v, -h * 0.1f, 0.994987f, h * 0.1f);
+            append(&text, &size, &capacity, line, len);
+        }
+    }
+    for (int y = 0; y < side - 1; y++) {
+        for (int x = 0; x < side - 1; x++) {
+            int a = y * side + x + 1, b = a + 1, c = a + side + 1, d = a + side;
+            len = snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, c, c, c, d, d, d);
+            append(&text, &size, &capacity, line, len);
+        }
+    }
+    *out_size = size;
+    return text;
+}
+
+
+// Разбор через sscanf по строкам (как в прежнем загрузчике, только счёт без сохранения). Возвращает треугольники:
+static size_t parse_sscanf(const char *text, size_t size) {
+    char line[1024];
+    size_t triangles = 0;
+    const char *c = text, *end = text + size;
+    while (c < end) {
+        const char *nl = (const char*)memchr(c, '\n', (size_t)(end - c));
+        size_t len = (size_t)((nl ? nl : end) - c);
+        if (len >= sizeof(line)) len = sizeof(line) - 1;
+        memcpy(line, c, len);
+        line[len] = '\0';
+        c = nl ? nl + 1 : end;
+
+        double x, y, z;
+        if (line[0] == 'v' && line[1] == ' ') sscanf(line, "v %lf %lf %lf", &x, &y, &z);
+        else if (line[0] == 'v' && line[1] == 'n') sscanf(line, "vn %lf %lf %lf", &x, &y, &z);
+        else if (line[0] == 'v' && line[1] == 't') sscanf(line, "vt %lf %lf", &x, &y);
+        else if (line[0] == 'f' && line[1] == ' ') {
+            int count = 0, p, t, n;
+            for (char *token = strtok(line, " "); (token = strtok(NULL, " ")); count++) sscanf(token, "%d/%d/%d", &p, &t, &n);
+            if (count >= 3) triangles += (size_t)count - 2;
+        }
+    }
+    return triangles;
+}
+
+
+int main(int argc, char *argv[]) {
+    int repeats = argc > 2 ? atoi(argv[2]) : 5;
+    if (repeats <= 0) repeats = 1;
+    Jobs_init(0);
+
+    // Файл или сгенерированная сетка:
+    FileMap *map = NULL;
+    char *generated = NULL;
+    const char *text;
+    size_t size;
+    int side = argc > 1 ? atoi(argv[1]) : 1500;
+    if (argc > 1 && side <= 0) {
+        map = Files_map(argv[1], FILE_MAP_SEQUENTIAL);
+        if (!map) {
+            fprintf(stderr, "objbench: Failed to open \"%s\".\n", argv[1]);
+            return 1;
+        }
+        text = (const char*)map->data;
+        size = map->size;
+        printf("File: %s (%.1f MB)\n", argv[1], size / 1e6);
+    } else {
+        if (side < 2) side = 2;
+        generated = generate_grid(side, &size);
+        text = generated;
+        printf("Grid: %d x %d (%.1f MB)\n", side, side, size / 1e6);
+    }
+
+    // ObjFile_parse:
+    double best = 1e30;
+    size_t triangles = 0, positions = 0;
+    for (int r = 0; r < repeats; r++) {
+        double start = Time_now(NULL);
+        ObjFile *obj = ObjFile_parse(text, size);
+        double elapsed = Time_now(NULL) - start;
+        if (elapsed < best) best = elapsed;
+        triangles = Array_len(obj->corners) / 3;
+        positions = Array_len(obj->positions);
+        ObjFile_destroy(&obj);
+    }
+    printf("%zu positions, %zu triangles, %d threads\n", positions, triangles, Jobs_get_threads_count());
+    printf("%-14s %9.2f ms %9.1f MB/s %9.2f Mtri/s\n", "ObjFile_parse", best * 1000.0, size / best / 1e6, triangles / best / 1e6);
+
+    // ObjFile_weld (на последнем разборе):
+    ObjFile *obj = ObjFile_parse(text, size);
+    size_t count = Array_len(obj->corners);
+    ObjIndex *unique = (ObjIndex*)mm_alloc(sizeof(ObjIndex) * (count > 0 ? count : 1));
+    uint32_t *indices = (uint32_t*)mm_alloc(sizeof(uint32_t) * (count > 0 ? count : 1));
+    double weld_best = 1e30;
+    uint32_t vertices = 0;
+    for (int r = 0; r < repeats; r++) {
+        double start = Time_now(NULL);
+        vertices = ObjFile_weld(obj, unique, indices);
+        double elapsed = Time_now(NULL) - start;
+        if (elapsed < weld_best) weld_best = elapsed;
+    }
+    printf("%-14s %9.2f ms %9.1f Mcorner/s   (%zu corners -> %u vertices, x%.1f)\n", "ObjFile_weld", weld_best * 1000.0,
+           count / weld_best / 1e6, count, vertices, vertices > 0 ? (double)count / vertices : 0.0);
+    mm_free(unique);
+    mm_free(indices);
+    ObjFile_destroy(&obj);
+
+    // sscanf для сравнения (один проход - он медленный):
+    double start = Time_now(NULL);
+    size_t ref_triangles = parse_sscanf(text, size);
+    double elapsed = Time_now(NULL) - start;
+    printf("%-14s %9.2f ms %9.1f MB/s   (x%.1f)\n", "sscanf", elapsed * 1000.0, size / elapsed / 1e6, elapsed / best);
+    if (ref_triangles != triangles) printf("!! Triangle count mismatch: %zu vs %zu\n", ref_triangles, triangles);
+
+    Files_unmap(&map);
+    mm_free(generated);
+    Jobs_destroy();
+    return 0;
+}
@@ -0,0 +1,49 @@
+//
+// packer.c - Утилита сборки архива ресурсов (.pak) из каталога.
+//
+// Сборка:  ./build.sh -t=packer
+// Запуск:  build/bin-packer/packer [-store] [каталог] [архив]   (по умолчанию "data" -> "data.pak")
+//          -store - не сжимать записи.
+//
+
+
+// Подключаем:
+#include <engine/core/std.h>
+#include <engine/core/mm.h>
+#include <engine/core/jobs.h>
+#include <engine/core/archive.h>
+
+
+int main(int argc, char *argv[]) {
+    bool compress = true;
+    const char *args[2] = {"data", "data" ARCHIVE_EXTENSION};
+    int args_count = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-store") == 0) compress = false;
+        else if (args_count < 2) args[args_count++] = argv[i];
+    }
+    const char *src_dir = args[0];
+    const char *out_path = args[1];
+
+    // Блоки сжимаются параллельно в системе задач:
+    Jobs_init(0);
+
+    printf("Packing \"%s\" into \"%s\"%s:\n", src_dir, out_path, compress ? " (compressed)" : "");
+    bool ok = Archive_pack(src_dir, out_path, compress, true);
+    if (!ok) fprintf(stderr, "Packing failed.\n");
+
+    // Проверяем собранный архив:
+    Archive *archive = ok ? Archive_open(out_path, true) : NULL;
+    if (ok && !archive) {
+        fprintf(stderr, "Verification failed.\n");
+        ok = false;
+    }
+    if (archive) {
+        printf("Verified %u entries.\n", archive->header->entries_count);
+        Archive_close(&archive);
+    }
+
+    Jobs_destroy();
+    if (mm_get_used_size() > 0) printf("Memory leak!\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,166 @@
+//
+// pixbench.c - Бенчмарк ядер обработки пикселей (pixops.h) на всех доступных наборах инструкций.
+//
+// Сборка:  ./build.sh -t=pixbench
+// Запуск:  build/bin-pixbench/pixbench [ширина] [высота] [повторы]   (по умолчанию 7680 x 4320 (8K), 5 повторов)
+//
+// Для каждого ядра печатает лучшее время строки картинки в один поток на каждом наборе инструкций, затем время
+// всей картинки через Pixmap_* с разбиением по строкам между потоками системы задач. Результаты векторных ядер
+// сверяются со скалярными.
+//
+
+
+// Подключаем:
+#include <engine/core/std.h>
+#include <engine/core/mm.h>
+#include <engine/core/jobs.h>
+#include <engine/core/time.h>
+#include <engine/core/pixmap.h>
+#include <engine/core/pixops.h>
+
+
+// Объявление структур:
+typedef struct Bench Bench;  // Ядро под замером.
+
+
+// Ядро под замером (обрабатывает всю картинку в один поток):
+struct Bench {
+    const char *name;
+    int src_channels;
+    int dst_channels;
+    void (*run)(const uint8_t *src, uint8_t *dst, size_t count);
+};
+
+
+static void run_rgb_to_rgba(const uint8_t *src, uint8_t *dst, size_t count) { PixOps_rgb_to_rgba(src, dst, count, 255); }
+static void run_rgba_to_rgb(const uint8_t *src, uint8_t *dst, size_t count) { PixOps_rgba_to_rgb(src, dst, count); }
+static void run_swap_rb(const uint8_t *src, uint8_t *dst, size_t count) { PixOps_swap_rb(src, dst, count, 4); }
+static void run_premultiply(const uint8_t *src, uint8_t *dst, size_t count) { PixOps_premultiply(src, dst, count); }
+static void run_unpremultiply(const uint8_t *src, uint8_t *dst, size_t count) { PixOps_unpremultiply(src, dst, count); }
+static void run_srgb_to_linear(const uint8_t *src, uint8_t *dst, size_t count) { PixOps_srgb_to_linear(src, dst, count, 4); }
+// Половинная точность: по одному значению на пиксель (4 байта float, 2 байта half; случайные биты включают NaN):
+static void run_f32_to_f16(const uint8_t *src, uint8_t *dst, size_t count) { PixOps_f32_to_f16((const float*)src, (uint16_t*)dst, count); }
+static void run_f16_to_f32(const uint8_t *src, uint8_t *dst, size_t count) { PixOps_f16_to_f32((const uint16_t*)src, (float*)dst, count); }
+static void run_swap_rows(const uint8_t *src, uint8_t *dst, size_t count) {
+    size_t stride = count * 4 / 2;  // Меняем местами половины буфера (как при отражении картинки).
+    memcpy(dst, src, count * 4);
+    PixOps_swap_rows(dst, dst + stride, stride);
+}
+
+
+static const Bench benches[] = {
+    {"rgb_to_rgba",    3, 4, run_rgb_to_rgba},
+    {"rgba_to_rgb",    4, 3, run_rgba_to_rgb},
+    {"swap_rb",        4, 4, run_swap_rb},
+    {"swap_rows",      4, 4, run_swap_rows},
+    {"premultiply",    4, 4, run_premultiply},
+    {"unpremultiply",  4, 4, run_unpremultiply},
+    {"srgb_to_linear", 4, 4, run_srgb_to_linear},
+    {"f32_to_f16",     4, 2, run_f32_to_f16},
+    {"f16_to_f32",     2, 4, run_f16_to_f32},
+};
+
+
+// Лучшее время из repeats запусков (сек):
+static double measure(const Bench *bench, const uint8_t *src, uint8_t *dst, size_t count, int repeats) {
+    double best = 1e30;
+    for (int r = 0; r < repeats; r++) {
+        double start = Time_now(NULL);
+        bench->run(src, dst, count);
+        double elapsed = Time_now(NULL) - start;
+        if (elapsed < best) best = elapsed;
+    }
+    return best;
+}
+
+
+int main(int argc, char *argv[]) {
+    int width   = argc > 1 ? atoi(argv[1]) : 7680;
+    int height  = argc > 2 ? atoi(argv[2]) : 4320;
+    int repeats = argc > 3 ? atoi(argv[3]) : 5;
+    if (width <= 0 || height <= 0 || repeats <= 0) {
+        fprintf(stderr, "Usage: pixbench [width] [height] [repeats]\n");
+        return 1;
+    }
+    size_t count = (size_t)width * height;
+
+    // Случайные пиксели (одинаковые для всех наборов инструкций):
+    uint8_t *src = mm_alloc(count * 4);
+    uint8_t *dst = mm_alloc(count * 4);
+    uint8_t *ref = mm_alloc(count * 4);
+    uint32_t seed = 0x12345678;
+    for (size_t i = 0; i < count * 4; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        src[i] = (uint8_t)(seed >> 24);
+    }
+
+    PixOps_ISA best = PixOps_get_best_isa();
+    printf("Image: %d x %d (%.1f MPix), best ISA: %s\n", width, height, count / 1e6, PixOps_get_isa_name(best));
+    printf("%-16s", "kernel");
+    for (int isa = PIXOPS_ISA_SCALAR; isa <= (int)best; isa++) printf("%14s", PixOps_get_isa_name((PixOps_ISA)isa));
+    printf("\n");
+
+    // Один поток, все наборы инструкций:
+    bool ok = true;
+    for (size_t b = 0; b < sizeof(benches) / sizeof(benches[0]); b++) {
+        const Bench *bench = &benches[b];
+        size_t dst_size = count * bench->dst_channels;
+        printf("%-16s", bench->name);
+        for (int isa = PIXOPS_ISA_SCALAR; isa <= (int)best; isa++) {
+            PixOps_set_isa((PixOps_ISA)isa);
+            double t = measure(bench, src, dst, count, repeats);
+            printf("%8.2f ms %s", t * 1000.0, isa == PIXOPS_ISA_SCALAR ? "   " : "");
+            if (isa == PIXOPS_ISA_SCALAR) {
+                memcpy(ref, dst, dst_size);
+            } else if (memcmp(ref, dst, dst_size) != 0) {
+                printf("!! ");
+                ok = false;
+            } else {
+                printf("ok ");
+            }
+        }
+        printf("\n");
+    }
+    PixOps_set_isa(best);
+
+    // Целая картинка, разбиение по строкам между потоками:
+    Jobs_init(0);
+    printf("\nPixmap_* on %d threads (%s):\n", Jobs_get_threads_count(), PixOps_get_isa_name(best));
+    Pixmap *pixmap = Pixmap_create(width, height, PIXMAP_RGBA);
+    memcpy(pixmap->data, src, count * 4);
+    Pixmap *rgb = Pixmap_convert(pixmap, PIXMAP_RGB);
+    double t_convert = 1e30, t_swizzle = 1e30, t_flip = 1e30, t_premul = 1e30, t_srgb = 1e30;
+    for (int r = 0; r < repeats; r++) {
+        double t0 = Time_now(NULL);
+        Pixmap *rgba = Pixmap_convert(rgb, PIXMAP_RGBA);
+        double t1 = Time_now(NULL);
+        Pixmap_swizzle_rb(pixmap);
+        double t2 = Time_now(NULL);
+        Pixmap_flip_vertical(pixmap);
+        double t3 = Time_now(NULL);
+        Pixmap_premultiply(pixmap);
+        double t4 = Time_now(NULL);
+        Pixmap_srgb_to_linear(pixmap);
+        double t5 = Time_now(NULL);
+        Pixmap_destroy(&rgba);
+        if (t1 - t0 < t_convert) t_convert = t1 - t0;
+        if (t2 - t1 < t_swizzle) t_swizzle = t2 - t1;
+        if (t3 - t2 < t_flip)    t_flip    = t3 - t2;
+        if (t4 - t3 < t_premul)  t_premul  = t4 - t3;
+        if (t5 - t4 < t_srgb)    t_srgb    = t5 - t4;
+    }
+    printf("  convert rgb->rgba  %8.2f ms (with allocation)\n", t_convert * 1000.0);
+    printf("  swizzle_rb         %8.2f ms\n", t_swizzle * 1000.0);
+    printf("  flip_vertical      %8.2f ms\n", t_flip * 1000.0);
+    printf("  premultiply        %8.2f ms\n", t_premul * 1000.0);
+    printf("  srgb_to_linear     %8.2f ms\n", t_srgb * 1000.0);
+    Pixmap_destroy(&rgb);
+    Pixmap_destroy(&pixmap);
+    Jobs_destroy();
+
+    mm_free(src);
+    mm_free(dst);
+    mm_free(ref);
+    if (!ok) fprintf(stderr, "Mismatch with scalar results.\n");
+    return ok ? 0 : 1;
+}